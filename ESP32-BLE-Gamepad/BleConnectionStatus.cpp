@@ -1,6 +1,7 @@
 #include "BleConnectionStatus.h"
 #include "NimBLEDevice.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
 
 /* Time to sleep between advertisements */
 static uint32_t sleepSeconds = 20;
@@ -24,7 +25,9 @@ void BleConnectionStatus::onDisconnect(NimBLEServer *pServer)
 ///*
 void BleConnectionStatus::onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo)
 {
-    printf("Client connected:: %s\n", connInfo.getAddress().toString().c_str());
+    char addr[18];
+    printf("Client connected:: %s\n", connInfo.getAddress().formatTo(addr));
+    storeConnParams(connInfo);
     this->connected = true;
 }
 
@@ -32,6 +35,57 @@ void BleConnectionStatus::onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &co
 {
     printf("Client disconnected - sleeping for %" PRIu32 " seconds\n", sleepSeconds);
     this->connected = false;
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    // Bond changes are written in batches, the pending ones would not survive the sleep
+    NimBLEBondStore::flush();
+#endif
     esp_deep_sleep_start();
 }
-//*/
\ No newline at end of file
+//*/
+
+void BleConnectionStatus::onAuthenticationComplete(NimBLEConnInfo &connInfo)
+{
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    // The first host to bond is the primary one, pairing with other hosts never evicts it
+    if (connInfo.isBonded() && NimBLEBondStore::getPinnedCount() == 0)
+    {
+        NimBLEBondStore::setPinned(connInfo.getIdAddress(), true);
+    }
+#endif
+}
+
+void BleConnectionStatus::onMTUChange(uint16_t MTU, NimBLEConnInfo &connInfo)
+{
+    this->mtu.store(MTU, std::memory_order_relaxed);
+}
+
+void BleConnectionStatus::onConnParamsUpdate(NimBLEConnInfo &connInfo)
+{
+    storeConnParams(connInfo);
+}
+
+void BleConnectionStatus::onStatus(NimBLECharacteristic *pCharacteristic, int code)
+{
+    // 0 for a notification handed to the controller, BLE_HS_EDONE for a confirmed indication
+    if (code == 0 || code == BLE_HS_EDONE)
+    {
+        this->notifySuccessCount.fetch_add(1, std::memory_order_relaxed);
+        if (this->notifyLatencyCallback != nullptr)
+        {
+            uint32_t now = (uint32_t)esp_timer_get_time();
+            this->notifyLatencyCallback(now - this->reportGeneratedAtUs.load(std::memory_order_relaxed));
+        }
+    }
+    else
+    {
+        this->notifyFailureCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void BleConnectionStatus::storeConnParams(NimBLEConnInfo &connInfo)
+{
+    this->connInterval.store(connInfo.getConnInterval(), std::memory_order_relaxed);
+    this->connLatency.store(connInfo.getConnLatency(), std::memory_order_relaxed);
+    this->connTimeout.store(connInfo.getConnTimeout(), std::memory_order_relaxed);
+    this->mtu.store(connInfo.getMTU(), std::memory_order_relaxed);
+}
@@ -6,10 +6,11 @@
 #include "nimconfig.h"
 #if defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
 
+#include <atomic>
 #include <NimBLEServer.h>
 #include "NimBLECharacteristic.h"
 
-class BleConnectionStatus : public NimBLEServerCallbacks
+class BleConnectionStatus : public NimBLEServerCallbacks, public NimBLECharacteristicCallbacks
 {
 public:
     BleConnectionStatus(void);
@@ -18,7 +19,32 @@ public:
     // void onDisconnect(NimBLEServer *pServer);
     void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo);
     void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo, int reason);
+    void onAuthenticationComplete(NimBLEConnInfo &connInfo);
+    void onMTUChange(uint16_t MTU, NimBLEConnInfo &connInfo);
+    void onConnParamsUpdate(NimBLEConnInfo &connInfo);
+    void onStatus(NimBLECharacteristic *pCharacteristic, int code);
     NimBLECharacteristic *inputGamepad;
+
+    // Notification results, updated from the NimBLE host task without locking
+    std::atomic<uint32_t> notifySuccessCount{0};
+    std::atomic<uint32_t> notifyFailureCount{0};
+
+    // Parameters of the current connection (interval in 1.25 ms units, timeout in 10 ms units)
+    std::atomic<uint16_t> connInterval{0};
+    std::atomic<uint16_t> connLatency{0};
+    std::atomic<uint16_t> connTimeout{0};
+    std::atomic<uint16_t> mtu{0};
+
+    // Time sendReport() started building the last report (low 32 bits of esp_timer_get_time())
+    std::atomic<uint32_t> reportGeneratedAtUs{0};
+
+    // Optional hook called from the NimBLE host task with the latency of each sent report: from its generation
+    // to the ATT confirmation when the client subscribed to indications (see setIndicateReports), otherwise
+    // to the NOTIFY_TX event, when the host stack has handed the notification to the controller
+    void (*notifyLatencyCallback)(uint32_t latencyUs) = nullptr;
+
+private:
+    void storeConnParams(NimBLEConnInfo &connInfo);
 };
 
 #endif // CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
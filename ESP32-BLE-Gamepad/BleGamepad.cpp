@@ -17,18 +17,23 @@
 #define LOG_TAG "BLEGamepad"
 #else
 #include "esp_log.h"
+#include "esp_timer.h"
 static const char *LOG_TAG = "BLEGamepad";
 #endif
 
-#define SERVICE_UUID_DEVICE_INFORMATION "180A" // Service - Device information
+// Bit of startedEvent, set by the setup task once the server is up and advertising
+#define STARTED_EVENT_READY_BIT BIT0
 
-#define CHARACTERISTIC_UUID_MODEL_NUMBER "2A24"      // Characteristic - Model Number String - 0x2A24
-#define CHARACTERISTIC_UUID_SOFTWARE_REVISION "2A28" // Characteristic - Software Revision String - 0x2A28
-#define CHARACTERISTIC_UUID_SERIAL_NUMBER "2A25"     // Characteristic - Serial Number String - 0x2A25
-#define CHARACTERISTIC_UUID_FIRMWARE_REVISION "2A26" // Characteristic - Firmware Revision String - 0x2A26
-#define CHARACTERISTIC_UUID_HARDWARE_REVISION "2A27" // Characteristic - Hardware Revision String - 0x2A27
+// Built at compile time, no string parsing when the server starts
+static constexpr NimBLEUUID SERVICE_UUID_DEVICE_INFORMATION("180A"); // Service - Device information
 
-uint8_t tempHidReportDescriptor[150];
+static constexpr NimBLEUUID CHARACTERISTIC_UUID_MODEL_NUMBER("2A24");      // Characteristic - Model Number String - 0x2A24
+static constexpr NimBLEUUID CHARACTERISTIC_UUID_SOFTWARE_REVISION("2A28"); // Characteristic - Software Revision String - 0x2A28
+static constexpr NimBLEUUID CHARACTERISTIC_UUID_SERIAL_NUMBER("2A25");     // Characteristic - Serial Number String - 0x2A25
+static constexpr NimBLEUUID CHARACTERISTIC_UUID_FIRMWARE_REVISION("2A26"); // Characteristic - Firmware Revision String - 0x2A26
+static constexpr NimBLEUUID CHARACTERISTIC_UUID_HARDWARE_REVISION("2A27"); // Characteristic - Hardware Revision String - 0x2A27
+
+uint8_t tempHidReportDescriptor[256];
 int hidReportDescriptorSize = 0;
 uint8_t reportSize = 0;
 uint8_t numOfButtonBytes = 0;
@@ -63,7 +68,15 @@ BleGamepad::BleGamepad(std::string deviceName, std::string deviceManufacturer, u
                                                                                                        _hat2(0),
                                                                                                        _hat3(0),
                                                                                                        _hat4(0),
-                                                                                                       hid(0)
+                                                                                                       _keyReport(),
+                                                                                                       _consumerUsage(0),
+                                                                                                       includeKeyboard(false),
+                                                                                                       includeConsumer(false),
+                                                                                                       hid(0),
+                                                                                                       inputKeyboard(0),
+                                                                                                       inputConsumer(0),
+                                                                                                       startedEvent(0),
+                                                                                                       setupStackUsed(0)
 {
     this->resetButtons();
     this->deviceName = deviceName;
@@ -571,13 +584,188 @@ void BleGamepad::begin(BleGamepadConfiguration *config)
     // END_COLLECTION (Application)
     tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
 
-    xTaskCreate(this->taskServer, "server", 20000, (void *)this, 5, NULL);
+    // The keyboard and consumer collections are separate top level collections with their own reports,
+    // so a macro typing on them never changes or delays the gamepad report
+    includeKeyboard = configuration.getIncludeKeyboard();
+    if (includeKeyboard && configuration.getKeyboardReportId() == configuration.getHidReportId())
+    {
+        ESP_LOGE(LOG_TAG, "Keyboard report ID %u is used by the gamepad, keyboard disabled", configuration.getKeyboardReportId());
+        includeKeyboard = false;
+    }
+
+    if (includeKeyboard)
+    {
+        // USAGE_PAGE (Generic Desktop)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // USAGE (Keyboard)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x06;
+
+        // COLLECTION (Application)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xa1;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_ID (Default: 1)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x85;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = configuration.getKeyboardReportId();
+
+        // USAGE_PAGE (Keyboard/Keypad)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x07;
+
+        // USAGE_MINIMUM (Left Control)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x19;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xE0;
+
+        // USAGE_MAXIMUM (Right GUI)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x29;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xE7;
+
+        // LOGICAL_MINIMUM (0)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // LOGICAL_MAXIMUM (1)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x25;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_SIZE (1)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_COUNT (8)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x08;
+
+        // INPUT (Data, Variable, Absolute) ;Modifier byte
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x02;
+
+        // REPORT_COUNT (1)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_SIZE (8)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x08;
+
+        // INPUT (Constant) ;Reserved byte
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_COUNT (6)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = KEYBOARD_REPORT_KEYS;
+
+        // LOGICAL_MAXIMUM (101)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x25;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x65;
+
+        // USAGE_MINIMUM (0)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x19;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // USAGE_MAXIMUM (101)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x29;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x65;
+
+        // INPUT (Data, Array, Absolute) ;Key array
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // END_COLLECTION (Application)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
+    }
+
+    includeConsumer = configuration.getIncludeConsumer();
+    if (includeConsumer && (configuration.getConsumerReportId() == configuration.getHidReportId() ||
+                            (includeKeyboard && configuration.getConsumerReportId() == configuration.getKeyboardReportId())))
+    {
+        ESP_LOGE(LOG_TAG, "Consumer report ID %u is already used, consumer control disabled", configuration.getConsumerReportId());
+        includeConsumer = false;
+    }
+
+    if (includeConsumer)
+    {
+        // USAGE_PAGE (Consumer)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x05;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x0C;
+
+        // USAGE (Consumer Control)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x09;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // COLLECTION (Application)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xa1;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // REPORT_ID (Default: 2)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x85;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = configuration.getConsumerReportId();
+
+        // LOGICAL_MINIMUM (0)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x15;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // LOGICAL_MAXIMUM (1023)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x26;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xFF;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03;
+
+        // USAGE_MINIMUM (0)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x19;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // USAGE_MAXIMUM (1023)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x2A;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xFF;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x03;
+
+        // REPORT_SIZE (16)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x75;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x10;
+
+        // REPORT_COUNT (1)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x95;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x01;
+
+        // INPUT (Data, Array, Absolute)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x81;
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0x00;
+
+        // END_COLLECTION (Application)
+        tempHidReportDescriptor[hidReportDescriptorSize++] = 0xc0;
+    }
+
+    if (startedEvent == 0)
+    {
+        startedEvent = xEventGroupCreate();
+    }
+    xEventGroupClearBits(startedEvent, STARTED_EVENT_READY_BIT);
+
+    xTaskCreate(this->taskServer, "gamepad_setup", BLE_GAMEPAD_SETUP_STACK_SIZE, (void *)this, 5, NULL);
 }
 
 void BleGamepad::end(void)
 {
 }
 
+bool BleGamepad::waitForStart(TickType_t ticksToWait)
+{
+    if (startedEvent == 0)
+    {
+        return false;
+    }
+    return xEventGroupWaitBits(startedEvent, STARTED_EVENT_READY_BIT, pdFALSE, pdTRUE, ticksToWait) & STARTED_EVENT_READY_BIT;
+}
+
+uint32_t BleGamepad::getSetupStackUsed(void)
+{
+    return this->setupStackUsed;
+}
+
 void BleGamepad::setAxes(int16_t x, int16_t y, int16_t z, int16_t rZ, int16_t rX, int16_t rY, int16_t slider1, int16_t slider2)
 {
     if (x == -32768)
@@ -700,6 +888,9 @@ void BleGamepad::sendReport(void)
 {
     if (this->isConnected())
     {
+        // The latency samples start here, before the report is assembled
+        this->connectionStatus->reportGeneratedAtUs.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+
         uint8_t currentReportIndex = 0;
 
         uint8_t m[reportSize];
@@ -802,6 +993,121 @@ void BleGamepad::sendReport(void)
     }
 }
 
+void BleGamepad::sendKeyboardReport(void)
+{
+    if (this->inputKeyboard != nullptr && this->isConnected())
+    {
+        this->inputKeyboard->setValue(_keyReport, sizeof(_keyReport));
+        this->inputKeyboard->notify();
+    }
+}
+
+void BleGamepad::sendConsumerReport(void)
+{
+    if (this->inputConsumer != nullptr && this->isConnected())
+    {
+        uint8_t m[2] = {lowByte(_consumerUsage), highByte(_consumerUsage)};
+        this->inputConsumer->setValue(m, sizeof(m));
+        this->inputConsumer->notify();
+    }
+}
+
+void BleGamepad::pressKey(uint8_t usage, uint8_t modifiers)
+{
+    // Usages E0-E7 are the modifier keys, they are bits of the first byte rather than array entries
+    if (usage >= 0xE0 && usage <= 0xE7)
+    {
+        modifiers |= 1 << (usage - 0xE0);
+        usage = 0;
+    }
+
+    _keyReport[0] |= modifiers;
+
+    if (usage != 0)
+    {
+        uint8_t freeSlot = 0;
+        for (uint8_t i = 2; i < sizeof(_keyReport); i++)
+        {
+            if (_keyReport[i] == usage)
+            {
+                freeSlot = 0;
+                break;
+            }
+            if (_keyReport[i] == 0 && freeSlot == 0)
+            {
+                freeSlot = i;
+            }
+        }
+
+        if (freeSlot != 0)
+        {
+            _keyReport[freeSlot] = usage;
+        }
+    }
+
+    if (configuration.getAutoReport())
+    {
+        sendKeyboardReport();
+    }
+}
+
+void BleGamepad::releaseKey(uint8_t usage, uint8_t modifiers)
+{
+    if (usage >= 0xE0 && usage <= 0xE7)
+    {
+        modifiers |= 1 << (usage - 0xE0);
+        usage = 0;
+    }
+
+    _keyReport[0] &= ~modifiers;
+
+    if (usage != 0)
+    {
+        for (uint8_t i = 2; i < sizeof(_keyReport); i++)
+        {
+            if (_keyReport[i] == usage)
+            {
+                _keyReport[i] = 0;
+            }
+        }
+    }
+
+    if (configuration.getAutoReport())
+    {
+        sendKeyboardReport();
+    }
+}
+
+void BleGamepad::releaseAllKeys()
+{
+    memset(&_keyReport, 0, sizeof(_keyReport));
+
+    if (configuration.getAutoReport())
+    {
+        sendKeyboardReport();
+    }
+}
+
+void BleGamepad::pressConsumer(uint16_t usage)
+{
+    _consumerUsage = usage;
+
+    if (configuration.getAutoReport())
+    {
+        sendConsumerReport();
+    }
+}
+
+void BleGamepad::releaseConsumer()
+{
+    _consumerUsage = 0;
+
+    if (configuration.getAutoReport())
+    {
+        sendConsumerReport();
+    }
+}
+
 void BleGamepad::press(uint8_t b)
 {
     uint8_t index = (b - 1) / 8;
@@ -1321,6 +1627,29 @@ void BleGamepad::setSteering(int16_t steering)
     }
 }
 
+void BleGamepad::getState(BleGamepadState *state)
+{
+    memcpy(state->buttons, _buttons, sizeof(state->buttons));
+    state->specialButtons = _specialButtons;
+    state->axes[0] = _x;
+    state->axes[1] = _y;
+    state->axes[2] = _z;
+    state->axes[3] = _rZ;
+    state->axes[4] = _rX;
+    state->axes[5] = _rY;
+    state->axes[6] = _slider1;
+    state->axes[7] = _slider2;
+    state->axes[8] = _rudder;
+    state->axes[9] = _throttle;
+    state->axes[10] = _accelerator;
+    state->axes[11] = _brake;
+    state->axes[12] = _steering;
+    state->hats[0] = _hat1;
+    state->hats[1] = _hat2;
+    state->hats[2] = _hat3;
+    state->hats[3] = _hat4;
+}
+
 bool BleGamepad::isPressed(uint8_t b)
 {
     uint8_t index = (b - 1) / 8;
@@ -1337,6 +1666,21 @@ bool BleGamepad::isConnected(void)
     return this->connectionStatus->connected;
 }
 
+BleConnectionStatus *BleGamepad::getConnectionStatus(void)
+{
+    return this->connectionStatus;
+}
+
+bool BleGamepad::isAdvertising(void)
+{
+    // hid is only created once the server task has initialised NimBLE
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    return hid != 0 && NimBLEDevice::getAdvertising()->isActive(BLE_GAMEPAD_ADV_INSTANCE);
+#else
+    return hid != 0 && NimBLEDevice::getAdvertising()->isAdvertising();
+#endif
+}
+
 void BleGamepad::setBatteryLevel(uint8_t level)
 {
     this->batteryLevel = level;
@@ -1371,8 +1715,32 @@ void BleGamepad::taskServer(void *pvParameter)
 
     BleGamepadInstance->hid = new NimBLEHIDDevice(pServer);
 
-    BleGamepadInstance->inputGamepad = BleGamepadInstance->hid->inputReport(BleGamepadInstance->configuration.getHidReportId()); // <-- input REPORTID from report map
+    BleGamepadInstance->inputGamepad = BleGamepadInstance->hid->inputReport(BleGamepadInstance->configuration.getHidReportId(), // <-- input REPORTID from report map
+                                                                            BleGamepadInstance->configuration.getIndicateReports());
     BleGamepadInstance->connectionStatus->inputGamepad = BleGamepadInstance->inputGamepad;
+    BleGamepadInstance->inputGamepad->setCallbacks(BleGamepadInstance->connectionStatus);
+
+    // Opt-in: with a single task sending reports, sendReport() can skip the attribute lock when the report fits inline
+    if (BleGamepadInstance->configuration.getSingleWriterReports())
+    {
+        if (reportSize <= CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH)
+        {
+            BleGamepadInstance->inputGamepad->setSingleWriter(true);
+        }
+        else
+        {
+            ESP_LOGW(LOG_TAG, "Report of %u bytes does not fit inline, single writer reports disabled", (unsigned)reportSize);
+        }
+    }
+
+    if (BleGamepadInstance->includeKeyboard)
+    {
+        BleGamepadInstance->inputKeyboard = BleGamepadInstance->hid->inputReport(BleGamepadInstance->configuration.getKeyboardReportId());
+    }
+    if (BleGamepadInstance->includeConsumer)
+    {
+        BleGamepadInstance->inputConsumer = BleGamepadInstance->hid->inputReport(BleGamepadInstance->configuration.getConsumerReportId());
+    }
 
     BleGamepadInstance->hid->manufacturer()->setValue(BleGamepadInstance->deviceManufacturer);
 
@@ -1420,12 +1788,48 @@ void BleGamepad::taskServer(void *pvParameter)
 
     BleGamepadInstance->onStarted(pServer);
 
+#if CONFIG_BT_NIMBLE_EXT_ADV
+    // Legacy PDUs so every host finds the gamepad. There is no fast phase here, a disconnect
+    // ends in deep sleep and the next boot starts advertising afresh.
+    NimBLEExtAdvertisement advertisement;
+    advertisement.setLegacyAdvertising(true);
+    advertisement.setConnectable(true);
+    advertisement.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+    advertisement.setAppearance(HID_GAMEPAD);
+    advertisement.setCompleteServices16({BleGamepadInstance->hid->hidService()->getUUID()});
+    advertisement.setMinInterval(244);
+    advertisement.setMaxInterval(338);
+    NimBLEExtAdvertisement scanResponse;
+    scanResponse.setName(BleGamepadInstance->deviceName);
+
+    NimBLEExtAdvertising *pAdvertising = pServer->getAdvertising();
+    if (pAdvertising->setInstanceData(BLE_GAMEPAD_ADV_INSTANCE, advertisement) &&
+        pAdvertising->setScanResponseData(BLE_GAMEPAD_ADV_INSTANCE, scanResponse))
+    {
+        pAdvertising->start(BLE_GAMEPAD_ADV_INSTANCE);
+    }
+#else
     NimBLEAdvertising *pAdvertising = pServer->getAdvertising();
     pAdvertising->setAppearance(HID_GAMEPAD);
     pAdvertising->addServiceUUID(BleGamepadInstance->hid->hidService()->getUUID());
+    // 20-30 ms for the first 30 s after start or a disconnect so the host reconnects quickly, then 152.5-211.25 ms
+    pAdvertising->setFastAdvertising(30000, 32, 48);
+    pAdvertising->setMinInterval(244);
+    pAdvertising->setMaxInterval(338);
     pAdvertising->start();
+#endif
     BleGamepadInstance->hid->setBatteryLevel(BleGamepadInstance->batteryLevel);
 
     ESP_LOGD(LOG_TAG, "Advertising started!");
-    vTaskDelay(portMAX_DELAY); // delay(portMAX_DELAY);
+
+    // The host task runs the server from now on, this stack is only needed for the setup above
+    UBaseType_t headroom = uxTaskGetStackHighWaterMark(NULL);
+    BleGamepadInstance->setupStackUsed = BLE_GAMEPAD_SETUP_STACK_SIZE - headroom;
+    ESP_LOGI(LOG_TAG, "Setup used %u of %u bytes of stack", (unsigned)BleGamepadInstance->setupStackUsed, (unsigned)BLE_GAMEPAD_SETUP_STACK_SIZE);
+    if (headroom < BLE_GAMEPAD_SETUP_STACK_MARGIN)
+    {
+        ESP_LOGW(LOG_TAG, "Setup stack left only %u bytes, raise BLE_GAMEPAD_SETUP_STACK_SIZE", (unsigned)headroom);
+    }
+    xEventGroupSetBits(BleGamepadInstance->startedEvent, STARTED_EVENT_READY_BIT);
+    vTaskDelete(NULL);
 }
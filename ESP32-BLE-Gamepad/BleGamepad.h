@@ -6,11 +6,34 @@
 #include "nimconfig.h"
 #if defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "BleConnectionStatus.h"
 #include "NimBLEHIDDevice.h"
 #include "NimBLECharacteristic.h"
 #include "BleGamepadConfiguration.h"
 
+// Input state as last set, axes in report order
+struct BleGamepadState
+{
+    uint8_t buttons[16];
+    uint8_t specialButtons;
+    int16_t axes[13]; // x, y, z, rZ, rX, rY, slider1, slider2, rudder, throttle, accelerator, brake, steering
+    signed char hats[4];
+};
+
+// NimBLE and GATT setup runs once on a task of this size, which then deletes itself. The stack it
+// used is logged and returned by getSetupStackUsed(), define this to size it for your setup. A
+// warning is logged when less than BLE_GAMEPAD_SETUP_STACK_MARGIN bytes were left.
+#ifndef BLE_GAMEPAD_SETUP_STACK_SIZE
+#define BLE_GAMEPAD_SETUP_STACK_SIZE 4096
+#endif
+#define BLE_GAMEPAD_SETUP_STACK_MARGIN 512
+
+#if CONFIG_BT_NIMBLE_EXT_ADV
+#define BLE_GAMEPAD_ADV_INSTANCE 0 // The other extended advertising instances are free for broadcasts
+#endif
+
 class BleGamepad
 {
 private:
@@ -33,6 +56,10 @@ private:
     int16_t _hat2;
     int16_t _hat3;
     int16_t _hat4;
+    uint8_t _keyReport[2 + KEYBOARD_REPORT_KEYS]; // Modifiers, reserved, key array
+    uint16_t _consumerUsage;
+    bool includeKeyboard;
+    bool includeConsumer;
 
     BleGamepadConfiguration configuration;
 
@@ -40,6 +67,11 @@ private:
 
     NimBLEHIDDevice *hid;
     NimBLECharacteristic *inputGamepad;
+    NimBLECharacteristic *inputKeyboard;
+    NimBLECharacteristic *inputConsumer;
+
+    EventGroupHandle_t startedEvent;
+    uint32_t setupStackUsed;
 
     void rawAction(uint8_t msg[], char msgSize);
     static void taskServer(void *pvParameter);
@@ -49,6 +81,8 @@ public:
     BleGamepad(std::string deviceName = "ESP32 BLE Gamepad", std::string deviceManufacturer = "Espressif", uint8_t batteryLevel = 100);
     void begin(BleGamepadConfiguration *config = new BleGamepadConfiguration());
     void end(void);
+    bool waitForStart(TickType_t ticksToWait = portMAX_DELAY); // true once the services are up and advertising started
+    uint32_t getSetupStackUsed(void);                          // Bytes of stack the setup task used, 0 until it is done
     void setAxes(int16_t x = 0, int16_t y = 0, int16_t z = 0, int16_t rZ = 0, int16_t rX = 0, int16_t rY = 0, int16_t slider1 = 0, int16_t slider2 = 0);
     void press(uint8_t b = BUTTON_1);   // press BUTTON_1 by default
     void release(uint8_t b = BUTTON_1); // release BUTTON_1 by default
@@ -98,8 +132,18 @@ public:
     void setSteering(int16_t steering = 0);
     void setSimulationControls(int16_t rudder = 0, int16_t throttle = 0, int16_t accelerator = 0, int16_t brake = 0, int16_t steering = 0);
     void sendReport();
+    void pressKey(uint8_t usage, uint8_t modifiers = 0); // usage from the Keyboard/Keypad page, E0-E7 are modifiers
+    void releaseKey(uint8_t usage, uint8_t modifiers = 0);
+    void releaseAllKeys();
+    void pressConsumer(uint16_t usage); // CONSUMER_x usage, one at a time
+    void releaseConsumer();
+    void sendKeyboardReport();
+    void sendConsumerReport();
     bool isPressed(uint8_t b = BUTTON_1); // check BUTTON_1 by default
+    void getState(BleGamepadState *state); // Snapshot for observers, may mix values of two concurrent updates
     bool isConnected(void);
+    bool isAdvertising(void);
+    BleConnectionStatus *getConnectionStatus(void);
     void resetButtons();
     void setBatteryLevel(uint8_t level);
     uint8_t batteryLevel;
@@ -2,7 +2,13 @@
 
 BleGamepadConfiguration::BleGamepadConfiguration() : _controllerType(CONTROLLER_TYPE_GAMEPAD),
                                                      _autoReport(true),
+                                                     _indicateReports(false),
+                                                     _singleWriterReports(false),
                                                      _hidReportId(3),
+                                                     _includeKeyboard(false),
+                                                     _keyboardReportId(1),
+                                                     _includeConsumer(false),
+                                                     _consumerReportId(2),
                                                      _buttonCount(16),
                                                      _hatSwitchCount(1),
                                                      _whichSpecialButtons{false, false, false, false, false, false, false, false},
@@ -85,9 +91,15 @@ int16_t BleGamepadConfiguration::getSimulationMin(){ return _simulationMin; }
 int16_t BleGamepadConfiguration::getSimulationMax(){ return _simulationMax; }
 uint8_t BleGamepadConfiguration::getControllerType() { return _controllerType; }
 uint8_t BleGamepadConfiguration::getHidReportId() { return _hidReportId; }
+bool BleGamepadConfiguration::getIncludeKeyboard() { return _includeKeyboard; }
+uint8_t BleGamepadConfiguration::getKeyboardReportId() { return _keyboardReportId; }
+bool BleGamepadConfiguration::getIncludeConsumer() { return _includeConsumer; }
+uint8_t BleGamepadConfiguration::getConsumerReportId() { return _consumerReportId; }
 uint16_t BleGamepadConfiguration::getButtonCount() { return _buttonCount; }
 uint8_t BleGamepadConfiguration::getHatSwitchCount() { return _hatSwitchCount; }
 bool BleGamepadConfiguration::getAutoReport() { return _autoReport; }
+bool BleGamepadConfiguration::getIndicateReports() { return _indicateReports; }
+bool BleGamepadConfiguration::getSingleWriterReports() { return _singleWriterReports; }
 bool BleGamepadConfiguration::getIncludeStart() { return _whichSpecialButtons[START_BUTTON]; }
 bool BleGamepadConfiguration::getIncludeSelect() { return _whichSpecialButtons[SELECT_BUTTON]; }
 bool BleGamepadConfiguration::getIncludeMenu() { return _whichSpecialButtons[MENU_BUTTON]; }
@@ -153,9 +165,17 @@ void BleGamepadConfiguration::setWhichSimulationControls(bool rudder, bool throt
 
 void BleGamepadConfiguration::setControllerType(uint8_t value) { _controllerType = value; }
 void BleGamepadConfiguration::setHidReportId(uint8_t value) { _hidReportId = value; }
+void BleGamepadConfiguration::setIncludeKeyboard(bool value) { _includeKeyboard = value; }
+void BleGamepadConfiguration::setKeyboardReportId(uint8_t value) { _keyboardReportId = value; }
+void BleGamepadConfiguration::setIncludeConsumer(bool value) { _includeConsumer = value; }
+void BleGamepadConfiguration::setConsumerReportId(uint8_t value) { _consumerReportId = value; }
 void BleGamepadConfiguration::setButtonCount(uint16_t value) { _buttonCount = value; }
 void BleGamepadConfiguration::setHatSwitchCount(uint8_t value) { _hatSwitchCount = value; }
 void BleGamepadConfiguration::setAutoReport(bool value) { _autoReport = value; }
+// A client subscribed to indications confirms each gamepad report, HID hosts keep using notifications
+void BleGamepadConfiguration::setIndicateReports(bool value) { _indicateReports = value; }
+// Only when one task calls sendReport(), including the setters with auto report, as updates skip the attribute lock
+void BleGamepadConfiguration::setSingleWriterReports(bool value) { _singleWriterReports = value; }
 void BleGamepadConfiguration::setIncludeStart(bool value) { _whichSpecialButtons[START_BUTTON] = value; }
 void BleGamepadConfiguration::setIncludeSelect(bool value) { _whichSpecialButtons[SELECT_BUTTON] = value; }
 void BleGamepadConfiguration::setIncludeMenu(bool value) { _whichSpecialButtons[MENU_BUTTON] = value; }
@@ -200,12 +200,29 @@
 #define VOLUME_DEC_BUTTON 6
 #define VOLUME_MUTE_BUTTON 7
 
+#define KEYBOARD_REPORT_KEYS 6 // Keys held at the same time in the keyboard report
+
+// Consumer control usages for the consumer collection
+#define CONSUMER_PLAY_PAUSE 0x00CD
+#define CONSUMER_SCAN_NEXT 0x00B5
+#define CONSUMER_SCAN_PREVIOUS 0x00B6
+#define CONSUMER_STOP 0x00B7
+#define CONSUMER_MUTE 0x00E2
+#define CONSUMER_VOLUME_INC 0x00E9
+#define CONSUMER_VOLUME_DEC 0x00EA
+
 class BleGamepadConfiguration
 {
 private:
     uint8_t _controllerType;
     bool _autoReport;
+    bool _indicateReports;
+    bool _singleWriterReports;
     uint8_t _hidReportId;
+    bool _includeKeyboard;
+    uint8_t _keyboardReportId;
+    bool _includeConsumer;
+    uint8_t _consumerReportId;
     uint16_t _buttonCount;
     uint8_t _hatSwitchCount;
     bool _whichSpecialButtons[POSSIBLESPECIALBUTTONS];
@@ -227,8 +244,14 @@ public:
     BleGamepadConfiguration();
 
     bool getAutoReport();
+    bool getIndicateReports();
+    bool getSingleWriterReports();
     uint8_t getControllerType();
     uint8_t getHidReportId();
+    bool getIncludeKeyboard();
+    uint8_t getKeyboardReportId();
+    bool getIncludeConsumer();
+    uint8_t getConsumerReportId();
     uint16_t getButtonCount();
     uint8_t getTotalSpecialButtonCount();
     uint8_t getDesktopSpecialButtonCount();
@@ -274,7 +297,13 @@ public:
 
     void setControllerType(uint8_t controllerType);
     void setAutoReport(bool value);
+    void setIndicateReports(bool value);
+    void setSingleWriterReports(bool value);
     void setHidReportId(uint8_t value);
+    void setIncludeKeyboard(bool value);
+    void setKeyboardReportId(uint8_t value);
+    void setIncludeConsumer(bool value);
+    void setConsumerReportId(uint8_t value);
     void setButtonCount(uint16_t value);
     void setHatSwitchCount(uint8_t value);
     void setIncludeStart(bool value);
@@ -0,0 +1,185 @@
+#include "BleHidMacro.h"
+
+#if defined(CONFIG_BT_ENABLED) && defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
+
+#include "esp_log.h"
+
+static const char *LOG_TAG = "BLEHidMacro";
+
+BleHidMacro::BleHidMacro(void) : gamepad(nullptr),
+                                 autoReport(false),
+                                 queue(nullptr),
+                                 task(nullptr),
+                                 running(false),
+                                 stackUsed(0)
+{
+}
+
+bool BleHidMacro::begin(BleGamepad *gamepad, bool autoReport, UBaseType_t priority, uint8_t queueLength)
+{
+    if (this->task != nullptr)
+    {
+        return false;
+    }
+
+    this->gamepad = gamepad;
+    this->autoReport = autoReport;
+    this->queue = xQueueCreate(queueLength, sizeof(Job));
+    if (this->queue == nullptr)
+    {
+        return false;
+    }
+
+    if (xTaskCreate(this->taskMacro, "hid_macro", BLE_HID_MACRO_STACK_SIZE, (void *)this, priority, &this->task) != pdPASS)
+    {
+        vQueueDelete(this->queue);
+        this->queue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool BleHidMacro::run(const BleHidMacroStep *steps, uint8_t count)
+{
+    if (this->queue == nullptr || count == 0)
+    {
+        return false;
+    }
+
+    Job job = {steps, count};
+    if (xQueueSend(this->queue, &job, 0) != pdTRUE)
+    {
+        ESP_LOGW(LOG_TAG, "Macro queue full, macro dropped");
+        return false;
+    }
+    return true;
+}
+
+void BleHidMacro::cancel(void)
+{
+    if (this->queue == nullptr)
+    {
+        return;
+    }
+
+    xQueueReset(this->queue);
+    if (__atomic_load_n(&this->running, __ATOMIC_RELAXED))
+    {
+        xTaskNotifyGive(this->task);
+    }
+}
+
+bool BleHidMacro::isRunning(void)
+{
+    return __atomic_load_n(&this->running, __ATOMIC_RELAXED) || (this->queue != nullptr && uxQueueMessagesWaiting(this->queue) > 0);
+}
+
+uint32_t BleHidMacro::getStackUsed(void)
+{
+    return __atomic_load_n(&this->stackUsed, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Waits between two steps, the notification sent by cancel() ends the wait early.
+ * @return false if the macro was cancelled.
+ */
+bool BleHidMacro::wait(uint16_t ms)
+{
+    return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms)) == 0;
+}
+
+/**
+ * @brief Sends the changed report when the gamepad does not send it on every change.
+ */
+void BleHidMacro::send(bool keyboard)
+{
+    if (autoReport)
+    {
+        return;
+    }
+
+    if (keyboard)
+    {
+        gamepad->sendKeyboardReport();
+    }
+    else
+    {
+        gamepad->sendConsumerReport();
+    }
+}
+
+void BleHidMacro::play(const Job &job)
+{
+    for (uint8_t i = 0; i < job.count; i++)
+    {
+        const BleHidMacroStep &step = job.steps[i];
+        bool completed;
+
+        switch (step.action)
+        {
+        case MACRO_KEY_PRESS:
+            gamepad->pressKey(step.code, step.modifiers);
+            send(true);
+            completed = wait(step.ms);
+            break;
+        case MACRO_KEY_RELEASE:
+            gamepad->releaseKey(step.code, step.modifiers);
+            send(true);
+            completed = wait(step.ms);
+            break;
+        case MACRO_KEY_TAP:
+            gamepad->pressKey(step.code, step.modifiers);
+            send(true);
+            completed = wait(step.ms);
+            gamepad->releaseKey(step.code, step.modifiers);
+            send(true);
+            break;
+        case MACRO_CONSUMER_TAP:
+            gamepad->pressConsumer(step.code);
+            send(false);
+            completed = wait(step.ms);
+            gamepad->releaseConsumer();
+            send(false);
+            break;
+        default:
+            completed = wait(step.ms);
+            break;
+        }
+
+        if (!completed)
+        {
+            ESP_LOGD(LOG_TAG, "Macro cancelled at step %u", i);
+            return;
+        }
+    }
+}
+
+void BleHidMacro::taskMacro(void *pvParameter)
+{
+    BleHidMacro *macro = (BleHidMacro *)pvParameter;
+    Job job;
+
+    for (;;)
+    {
+        xQueueReceive(macro->queue, &job, portMAX_DELAY);
+
+        __atomic_store_n(&macro->running, true, __ATOMIC_RELAXED);
+        ulTaskNotifyTake(pdTRUE, 0); // Drop a cancel that arrived after the previous macro ended
+
+        macro->play(job);
+
+        // A cancelled or unbalanced macro must not leave keys held on the host
+        macro->gamepad->releaseAllKeys();
+        macro->send(true);
+        __atomic_store_n(&macro->running, false, __ATOMIC_RELAXED);
+
+        uint32_t used = BLE_HID_MACRO_STACK_SIZE - uxTaskGetStackHighWaterMark(NULL);
+        if (used > macro->stackUsed)
+        {
+            __atomic_store_n(&macro->stackUsed, used, __ATOMIC_RELAXED);
+            ESP_LOGI(LOG_TAG, "Macro used %u of %u bytes of stack", (unsigned)used, (unsigned)BLE_HID_MACRO_STACK_SIZE);
+        }
+    }
+}
+
+#endif // CONFIG_BT_ENABLED && CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
@@ -0,0 +1,73 @@
+#ifndef ESP32_BLE_HID_MACRO_H
+#define ESP32_BLE_HID_MACRO_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "BleGamepad.h"
+
+// Stack of the macro task. A step only updates a report and notifies it through NimBLE, which with
+// the log lines of the notify path needs more than the 2048 bytes this used to get. The most the
+// task used is logged when it grows and returned by getStackUsed(), define this to size it for
+// your macros.
+#ifndef BLE_HID_MACRO_STACK_SIZE
+#define BLE_HID_MACRO_STACK_SIZE 3072
+#endif
+
+enum BleHidMacroAction : uint8_t
+{
+    MACRO_KEY_PRESS,      // Press code with modifiers, then wait ms
+    MACRO_KEY_RELEASE,    // Release code with modifiers, then wait ms
+    MACRO_KEY_TAP,        // Press code with modifiers, hold for ms, release
+    MACRO_CONSUMER_TAP,   // Press the consumer usage code, hold for ms, release
+    MACRO_WAIT            // Wait ms
+};
+
+struct BleHidMacroStep
+{
+    uint8_t action;    // BleHidMacroAction
+    uint8_t modifiers; // KEY_CTRL, KEY_SHIFT, KEY_ALT... for the key actions
+    uint16_t code;     // Keyboard/Keypad usage, or a CONSUMER_x usage
+    uint16_t ms;
+};
+
+// Plays key sequences on the keyboard and consumer collections of a BleGamepad from its own task,
+// so the task pressing the button returns at once and the gamepad reports keep their timing
+class BleHidMacro
+{
+private:
+    struct Job
+    {
+        const BleHidMacroStep *steps;
+        uint8_t count;
+    };
+
+    BleGamepad *gamepad;
+    bool autoReport;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    bool running;
+    uint32_t stackUsed;
+
+    static void taskMacro(void *pvParameter);
+    bool wait(uint16_t ms);
+    void send(bool keyboard);
+    void play(const Job &job);
+
+public:
+    BleHidMacro(void);
+    bool begin(BleGamepad *gamepad, bool autoReport, UBaseType_t priority = 4, uint8_t queueLength = 4);
+    bool run(const BleHidMacroStep *steps, uint8_t count); // steps must outlive the macro, false if the queue is full
+    void cancel(void);
+    bool isRunning(void);
+    uint32_t getStackUsed(void); // Most bytes of stack the macro task used, 0 until a macro ran
+};
+
+#endif // CONFIG_BT_NIMBLE_ROLE_PERIPHERAL
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_BLE_HID_MACRO_H
@@ -14,8 +14,6 @@
 #include "nimconfig.h"
 #if defined(CONFIG_BT_ENABLED)
 
-#include <algorithm>
-
 #include "NimBLEAddress.h"
 #include "NimBLEUtils.h"
 #include "NimBLELog.h"
@@ -32,16 +30,16 @@ static const char* LOG_TAG = "NimBLEAddress";
  * @param [in] address The native NimBLE address.
  */
 NimBLEAddress::NimBLEAddress(ble_addr_t address) {
-    memcpy(m_address, address.val, 6);
-    m_addrType = address.type;
+    m_value = 0;
+    memcpy(&m_value, address.val, 6);
+    m_value |= uint64_t(address.type) << TYPE_SHIFT;
 } // NimBLEAddress
 
 
 /**
  * @brief Create a blank address, i.e. 00:00:00:00:00:00, type 0.
  */
-NimBLEAddress::NimBLEAddress() {
-    NimBLEAddress("");
+NimBLEAddress::NimBLEAddress() : m_value(0) {
 } // NimBLEAddress
 
 
@@ -58,31 +56,33 @@ NimBLEAddress::NimBLEAddress() {
  * @param [in] type The type of the address.
  */
 NimBLEAddress::NimBLEAddress(const std::string &stringAddress, uint8_t type) {
-    m_addrType = type;
+    m_value = uint64_t(type) << TYPE_SHIFT;
 
     if (stringAddress.length() == 0) {
-        memset(m_address, 0, 6);
         return;
     }
 
     if (stringAddress.length() == 6) {
-        std::reverse_copy(stringAddress.data(), stringAddress.data() + 6, m_address);
+        for(size_t index = 0; index < 6; index++) {
+            m_value |= uint64_t(uint8_t(stringAddress[index])) << (8 * (5 - index));
+        }
         return;
     }
 
     if (stringAddress.length() != 17) {
-        memset(m_address, 0, sizeof m_address); // "00:00:00:00:00:00" represents an invalid address
+        // "00:00:00:00:00:00" represents an invalid address
         NIMBLE_LOGD(LOG_TAG, "Invalid address '%s'", stringAddress.c_str());
         return;
     }
 
-    int data[6];
+    unsigned int data[6];
     if(sscanf(stringAddress.c_str(), "%x:%x:%x:%x:%x:%x", &data[5], &data[4], &data[3], &data[2], &data[1], &data[0]) != 6) {
-        memset(m_address, 0, sizeof m_address); // "00:00:00:00:00:00" represents an invalid address
+        // "00:00:00:00:00:00" represents an invalid address
         NIMBLE_LOGD(LOG_TAG, "Invalid address '%s'", stringAddress.c_str());
+        return;
     }
-    for(size_t index = 0; index < sizeof m_address; index++) {
-        m_address[index] = data[index];
+    for(size_t index = 0; index < 6; index++) {
+        m_value |= uint64_t(data[index] & 0xFF) << (8 * index);
     }
 } // NimBLEAddress
 
@@ -93,8 +93,10 @@ NimBLEAddress::NimBLEAddress(const std::string &stringAddress, uint8_t type) {
  * @param [in] type The type of the address.
  */
 NimBLEAddress::NimBLEAddress(uint8_t address[6], uint8_t type) {
-    std::reverse_copy(address, address + sizeof m_address, m_address);
-    m_addrType = type;
+    m_value = uint64_t(type) << TYPE_SHIFT;
+    for(size_t index = 0; index < 6; index++) {
+        m_value |= uint64_t(address[index]) << (8 * (5 - index));
+    }
 } // NimBLEAddress
 
 
@@ -105,8 +107,7 @@ NimBLEAddress::NimBLEAddress(uint8_t address[6], uint8_t type) {
  * @param [in] type The type of the address.
  */
 NimBLEAddress::NimBLEAddress(const uint64_t &address, uint8_t type) {
-    memcpy(m_address, &address, sizeof m_address);
-    m_addrType = type;
+    m_value = (address & ADDRESS_MASK) | (uint64_t(type) << TYPE_SHIFT);
 } // NimBLEAddress
 
 
@@ -120,24 +121,6 @@ bool NimBLEAddress::equals(const NimBLEAddress &otherAddress) const {
 } // equals
 
 
-/**
- * @brief Get the native representation of the address.
- * @return a pointer to the uint8_t[6] array of the address.
- */
-const uint8_t *NimBLEAddress::getNative() const {
-    return m_address;
-} // getNative
-
-
-/**
- * @brief Get the address type.
- * @return The address type.
- */
-uint8_t NimBLEAddress::getType() const {
-    return m_addrType;
-} // getType
-
-
 /**
  * @brief Convert a BLE address to a string.
  *
@@ -156,19 +139,27 @@ std::string NimBLEAddress::toString() const {
 
 
 /**
- * @brief Convenience operator to check if this address is equal to another.
- */
-bool NimBLEAddress::operator ==(const NimBLEAddress & rhs) const {
-    return memcmp(rhs.m_address, m_address, sizeof m_address) == 0;
-} // operator ==
-
-
-/**
- * @brief Convenience operator to check if this address is not equal to another.
+ * @brief Write the string representation of the address to a caller buffer.
+ * @details Same format as toString() without allocating, for log calls:
+ * ```
+ * char buf[18];
+ * NIMBLE_LOGI(LOG_TAG, "Address: %s", address.formatTo(buf));
+ * ```
+ * @param [out] buffer The buffer to write the 17 characters and the terminator to.
+ * @return buffer.
  */
-bool NimBLEAddress::operator !=(const NimBLEAddress & rhs) const {
-    return !this->operator==(rhs);
-} // operator !=
+const char* NimBLEAddress::formatTo(char (&buffer)[18]) const {
+    static const char hex[] = "0123456789abcdef";
+    char* p = buffer;
+    for(int i = 5; i >= 0; i--) {
+        uint8_t byte = m_value >> (8 * i);
+        *p++ = hex[byte >> 4];
+        *p++ = hex[byte & 0x0F];
+        *p++ = ':';
+    }
+    buffer[17] = '\0'; // replaces the last separator
+    return buffer;
+} // formatTo
 
 
 /**
@@ -178,20 +169,7 @@ bool NimBLEAddress::operator !=(const NimBLEAddress & rhs) const {
  */
 NimBLEAddress::operator std::string() const {
     char buffer[18];
-    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
-                                     m_address[5], m_address[4], m_address[3],
-                                     m_address[2], m_address[1], m_address[0]);
-    return std::string(buffer);
+    return std::string(formatTo(buffer), 17);
 } // operator std::string
 
-
-/**
- * @brief Convenience operator to convert the native address representation to uint_64.
- */
-NimBLEAddress::operator uint64_t() const {
-    uint64_t address = 0;
-    memcpy(&address, m_address, sizeof m_address);
-    return address;
-} // operator uint64_t
-
 #endif
@@ -30,11 +30,15 @@
 
 #include <string>
 #include <algorithm>
+#include <functional>
 
 /**
  * @brief A %BLE device address.
  *
  * Every %BLE device has a unique address which can be used to identify it and form connections.
+ * @details The address is packed in one 64 bit value, the 48 bits of the address in NimBLE
+ * (inverse) byte order with the type above them, so comparing and hashing addresses are
+ * integer operations. Addresses are equal when the 48 bits are, the type is not compared.
  */
 class NimBLEAddress {
 public:
@@ -46,7 +50,9 @@ public:
     bool            equals(const NimBLEAddress &otherAddress) const;
     const uint8_t*  getNative() const;
     std::string     toString() const;
+    const char*     formatTo(char (&buffer)[18]) const;
     uint8_t         getType() const;
+    uint32_t        hash() const;
 
     bool operator   ==(const NimBLEAddress & rhs) const;
     bool operator   !=(const NimBLEAddress & rhs) const;
@@ -54,8 +60,71 @@ public:
     operator        uint64_t() const;
 
 private:
-    uint8_t        m_address[6];
-    uint8_t        m_addrType;
+    static constexpr uint64_t ADDRESS_MASK = 0xFFFFFFFFFFFFULL;
+    static constexpr int      TYPE_SHIFT   = 48;
+
+    uint64_t       m_value;
+}; // NimBLEAddress
+
+// getNative() points into m_value, the bytes must be in memory in address order
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "NimBLEAddress requires a little endian target");
+
+
+/**
+ * @brief Get the native representation of the address.
+ * @return a pointer to the uint8_t[6] array of the address.
+ */
+inline const uint8_t *NimBLEAddress::getNative() const {
+    return reinterpret_cast<const uint8_t*>(&m_value);
+} // getNative
+
+
+/**
+ * @brief Get the address type.
+ * @return The address type.
+ */
+inline uint8_t NimBLEAddress::getType() const {
+    return m_value >> TYPE_SHIFT;
+} // getType
+
+
+/**
+ * @brief Get a hash of the address, for hashed indexes and std::unordered containers.
+ * @details Multiplicative hash of the 48 bits, the type is not included so equal addresses
+ * have equal hashes. Every bit of the result depends on the whole address.
+ */
+inline uint32_t NimBLEAddress::hash() const {
+    return ((m_value & ADDRESS_MASK) * 0x9E3779B97F4A7C15ULL) >> 32;
+} // hash
+
+
+/**
+ * @brief Convenience operator to check if this address is equal to another.
+ */
+inline bool NimBLEAddress::operator ==(const NimBLEAddress & rhs) const {
+    return ((m_value ^ rhs.m_value) & ADDRESS_MASK) == 0;
+} // operator ==
+
+
+/**
+ * @brief Convenience operator to check if this address is not equal to another.
+ */
+inline bool NimBLEAddress::operator !=(const NimBLEAddress & rhs) const {
+    return !this->operator==(rhs);
+} // operator !=
+
+
+/**
+ * @brief Convenience operator to convert the native address representation to uint_64.
+ */
+inline NimBLEAddress::operator uint64_t() const {
+    return m_value & ADDRESS_MASK;
+} // operator uint64_t
+
+
+template<>
+struct std::hash<NimBLEAddress> {
+    size_t operator()(const NimBLEAddress &address) const { return address.hash(); }
 };
 
 #endif /* CONFIG_BT_ENABLED */
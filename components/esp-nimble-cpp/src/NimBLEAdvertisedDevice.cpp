@@ -21,6 +21,7 @@
 #include "NimBLELog.h"
 
 #include <climits>
+#include <cstring>
 
 static const char* LOG_TAG = "NimBLEAdvertisedDevice";
 
@@ -28,14 +29,15 @@ static const char* LOG_TAG = "NimBLEAdvertisedDevice";
 /**
  * @brief Constructor
  */
-NimBLEAdvertisedDevice::NimBLEAdvertisedDevice() :
-    m_payload(62,0)
-{
+NimBLEAdvertisedDevice::NimBLEAdvertisedDevice() {
     m_advType          = 0;
     m_rssi             = -9999;
     m_callbackSent     = 0;
     m_timestamp        = 0;
     m_advLength        = 0;
+    m_payloadLength    = 0;
+    m_adTypeMask       = 0;
+    m_adCount          = 0;
 } // NimBLEAdvertisedDevice
 
 
@@ -163,18 +165,25 @@ uint16_t NimBLEAdvertisedDevice::getMaxInterval() {
  * @return The manufacturer data.
  */
 std::string NimBLEAdvertisedDevice::getManufacturerData(uint8_t index) {
+    return std::string(getManufacturerDataView(index));
+} // getManufacturerData
+
+
+/**
+ * @brief Get the manufacturer data without copying it.
+ * @param [in] index The index of the of the manufacturer data set to get.
+ * @return A view of the manufacturer data in the payload, valid until the payload is next updated.
+ */
+std::string_view NimBLEAdvertisedDevice::getManufacturerDataView(uint8_t index) {
     size_t data_loc = 0;
-    index++;
+    uint16_t item = index + 1; // 1 based, index 255 must not wrap to "first structure"
 
-    if(findAdvField(BLE_HS_ADV_TYPE_MFG_DATA, index, &data_loc) > 0) {
-        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length > 1) {
-            return std::string((char*)field->value, field->length - 1);
-        }
+    if(findAdvField(BLE_HS_ADV_TYPE_MFG_DATA, item, &data_loc) >= item) {
+        return fieldValue(data_loc);
     }
 
-    return "";
-} // getManufacturerData
+    return std::string_view();
+} // getManufacturerDataView
 
 
 /**
@@ -191,17 +200,17 @@ uint8_t NimBLEAdvertisedDevice::getManufacturerDataCount() {
  * @return The URI data.
  */
 std::string NimBLEAdvertisedDevice::getURI() {
-    size_t data_loc = 0;
+    return std::string(getURIView());
+} // getURI
 
-    if(findAdvField(BLE_HS_ADV_TYPE_URI, 0, &data_loc) > 0) {
-        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length > 1) {
-            return std::string((char*)field->value, field->length - 1);
-        }
-    }
 
-    return "";
-} // getURI
+/**
+ * @brief Get the URI from the advertisement without copying it.
+ * @return A view of the URI data in the payload, valid until the payload is next updated.
+ */
+std::string_view NimBLEAdvertisedDevice::getURIView() {
+    return getPayloadByTypeView(BLE_HS_ADV_TYPE_URI);
+} // getURIView
 
 /**
  * @brief Get the data from any type available in the advertisement
@@ -209,17 +218,24 @@ std::string NimBLEAdvertisedDevice::getURI() {
  * @return The data available under the type `type`
 */
 std::string NimBLEAdvertisedDevice::getPayloadByType(uint16_t type) {
+    return std::string(getPayloadByTypeView(type));
+} // getPayloadByType
+
+
+/**
+ * @brief Get the data of the first field of a type without copying it.
+ * @param [in] type The advertised data type BLE_HS_ADV_TYPE
+ * @return A view of the data in the payload, valid until the payload is next updated.
+ */
+std::string_view NimBLEAdvertisedDevice::getPayloadByTypeView(uint16_t type) {
     size_t data_loc = 0;
 
     if(findAdvField(type, 0, &data_loc) > 0) {
-        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length > 1) {
-            return std::string((char*)field->value, field->length - 1);
-        }
+        return fieldValue(data_loc);
     }
 
-    return "";
-} // getPayloadByType
+    return std::string_view();
+} // getPayloadByTypeView
 
 
 /**
@@ -227,19 +243,25 @@ std::string NimBLEAdvertisedDevice::getPayloadByType(uint16_t type) {
  * @return The name of the advertised device.
  */
 std::string NimBLEAdvertisedDevice::getName() {
+    return std::string(getNameView());
+} // getName
+
+
+/**
+ * @brief Get the advertised name without copying it.
+ * @return A view of the complete (or else shortened) name, valid until the payload is next updated.
+ */
+std::string_view NimBLEAdvertisedDevice::getNameView() {
     size_t data_loc = 0;
 
     if(findAdvField(BLE_HS_ADV_TYPE_COMP_NAME, 0, &data_loc) > 0 ||
        findAdvField(BLE_HS_ADV_TYPE_INCOMP_NAME, 0, &data_loc) > 0)
     {
-        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length > 1) {
-            return std::string((char*)field->value, field->length - 1);
-        }
+        return fieldValue(data_loc);
     }
 
-    return "";
-} // getName
+    return std::string_view();
+} // getNameView
 
 
 /**
@@ -283,26 +305,26 @@ NimBLEAddress NimBLEAdvertisedDevice::getTargetAddress(uint8_t index) {
     ble_hs_adv_field *field = nullptr;
     uint8_t count = 0;
     size_t data_loc = ULONG_MAX;
+    uint16_t item = index + 1; // 1 based, wider than the index so 255 does not wrap
 
-    index++;
-    count = findAdvField(BLE_HS_ADV_TYPE_PUBLIC_TGT_ADDR, index, &data_loc);
+    count = findAdvField(BLE_HS_ADV_TYPE_PUBLIC_TGT_ADDR, item, &data_loc);
 
-    if (count < index) {
-        index -= count;
-        count = findAdvField(BLE_HS_ADV_TYPE_RANDOM_TGT_ADDR, index, &data_loc);
+    if (count < item) {
+        item -= count;
+        count = findAdvField(BLE_HS_ADV_TYPE_RANDOM_TGT_ADDR, item, &data_loc);
     }
 
     if(count > 0 && data_loc != ULONG_MAX) {
         field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length < index *  BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN) {
-            index -= count - field->length / BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN;
+        if(field->length < item *  BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN) {
+            item -= count - field->length / BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN;
         }
-        if(field->length > index * BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN) {
-            return NimBLEAddress(field->value + (index - 1) * BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN);
+        if(field->length > item * BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN) {
+            return NimBLEAddress(field->value + (item - 1) * BLE_HS_ADV_PUBLIC_TGT_ADDR_ENTRY_LEN);
         }
     }
 
-    return NimBLEAddress("");
+    return NimBLEAddress();
 }
 
 
@@ -312,38 +334,52 @@ NimBLEAddress NimBLEAdvertisedDevice::getTargetAddress(uint8_t index) {
  * @return The advertised service data or empty string if no data.
  */
 std::string NimBLEAdvertisedDevice::getServiceData(uint8_t index) {
-    ble_hs_adv_field *field = nullptr;
+    return std::string(getServiceDataView(index));
+} //getServiceData
+
+
+/**
+ * @brief Get the service data.
+ * @param [in] uuid The uuid of the service data requested.
+ * @return The advertised service data or empty string if no data.
+ */
+std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID &uuid) {
+    return std::string(getServiceDataView(uuid));
+} //getServiceData
+
+
+/**
+ * @brief Get the service data without copying it.
+ * @param [in] index The index of the service data requested.
+ * @return A view of the service data in the payload, valid until the payload is next updated.
+ */
+std::string_view NimBLEAdvertisedDevice::getServiceDataView(uint8_t index) {
     uint8_t bytes;
     size_t data_loc = findServiceData(index, &bytes);
 
     if(data_loc != ULONG_MAX) {
-        field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(field->length > bytes) {
-            return std::string((char*)(field->value + bytes), field->length - bytes - 1);
-        }
+        return fieldValue(data_loc, bytes);
     }
 
-    return "";
-} //getServiceData
+    return std::string_view();
+} // getServiceDataView
 
 
 /**
- * @brief Get the service data.
+ * @brief Get the service data without copying it.
  * @param [in] uuid The uuid of the service data requested.
- * @return The advertised service data or empty string if no data.
+ * @return A view of the service data in the payload, valid until the payload is next updated.
  */
-std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID &uuid) {
-    ble_hs_adv_field *field = nullptr;
+std::string_view NimBLEAdvertisedDevice::getServiceDataView(const NimBLEUUID &uuid) {
     uint8_t bytes;
     uint8_t index = 0;
     size_t  data_loc = findServiceData(index, &bytes);
-    size_t  plSize = m_payload.size() - 2;
     uint8_t uuidBytes = uuid.bitSize() / 8;
 
-    while(data_loc < plSize) {
-        field = (ble_hs_adv_field *)&m_payload[data_loc];
-        if(bytes == uuidBytes && NimBLEUUID(field->value, bytes, false) == uuid) {
-           return std::string((char*)(field->value + bytes), field->length - bytes - 1);
+    while(data_loc != ULONG_MAX) {
+        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
+        if(bytes == uuidBytes && field->length > bytes && NimBLEUUID(field->value, bytes, false) == uuid) {
+            return fieldValue(data_loc, bytes);
         }
 
         index++;
@@ -351,8 +387,75 @@ std::string NimBLEAdvertisedDevice::getServiceData(const NimBLEUUID &uuid) {
     }
 
     NIMBLE_LOGI(LOG_TAG, "No service data found");
-    return "";
-} //getServiceData
+    return std::string_view();
+} // getServiceDataView
+
+
+/**
+ * @brief Read an iBeacon frame from the manufacturer data, without copying the payload.
+ * @param [out] frame The frame to fill.
+ * @return True if one of the manufacturer data fields is an iBeacon frame.
+ */
+bool NimBLEAdvertisedDevice::getBeaconFrame(NimBLEBeaconFrame *frame) {
+    if (!(m_adTypeMask & adTypeBit(BLE_HS_ADV_TYPE_MFG_DATA))) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < m_adCount; i++) {
+        ble_hs_adv_field *field = (ble_hs_adv_field*)&m_payload[m_adOffsets[i]];
+        if (field->type == BLE_HS_ADV_TYPE_MFG_DATA &&
+            NimBLEBeaconFrame::decode(field->value, field->length - 1, frame)) {
+            return true;
+        }
+    }
+
+    return false;
+} // getBeaconFrame
+
+
+/**
+ * @brief Find the Eddystone service data of a frame type.
+ * @param [in] frameType The Eddystone frame type.
+ * @return A view of the service data after the UUID, empty if the payload has no such frame.
+ */
+std::string_view NimBLEAdvertisedDevice::findEddystoneFrame(uint8_t frameType) {
+    if (!(m_adTypeMask & adTypeBit(BLE_HS_ADV_TYPE_SVC_DATA_UUID16))) {
+        return std::string_view();
+    }
+
+    for (uint8_t i = 0; i < m_adCount; i++) {
+        ble_hs_adv_field *field = (ble_hs_adv_field*)&m_payload[m_adOffsets[i]];
+        if (field->type == BLE_HS_ADV_TYPE_SVC_DATA_UUID16 && field->length > 3 &&
+            (field->value[0] | field->value[1] << 8) == NimBLEEddystoneTLMFrame::SERVICE_UUID &&
+            field->value[2] == frameType) {
+            return fieldValue(m_adOffsets[i], 2);
+        }
+    }
+
+    return std::string_view();
+} // findEddystoneFrame
+
+
+/**
+ * @brief Read an Eddystone TLM frame from the service data, without copying the payload.
+ * @param [out] frame The frame to fill.
+ * @return True if the payload has an unencrypted TLM frame.
+ */
+bool NimBLEAdvertisedDevice::getEddystoneFrame(NimBLEEddystoneTLMFrame *frame) {
+    std::string_view data = findEddystoneFrame(NimBLEEddystoneTLMFrame::FRAME_TYPE);
+    return NimBLEEddystoneTLMFrame::decode((const uint8_t*)data.data(), data.size(), frame);
+} // getEddystoneFrame
+
+
+/**
+ * @brief Read an Eddystone URL frame from the service data, without copying the payload.
+ * @param [out] frame The frame to fill.
+ * @return True if the payload has a URL frame.
+ */
+bool NimBLEAdvertisedDevice::getEddystoneFrame(NimBLEEddystoneURLFrame *frame) {
+    std::string_view data = findEddystoneFrame(NimBLEEddystoneURLFrame::FRAME_TYPE);
+    return NimBLEEddystoneURLFrame::decode((const uint8_t*)data.data(), data.size(), frame);
+} // getEddystoneFrame
 
 
 /**
@@ -385,25 +488,25 @@ NimBLEUUID NimBLEAdvertisedDevice::getServiceDataUUID(uint8_t index) {
 size_t NimBLEAdvertisedDevice::findServiceData(uint8_t index, uint8_t *bytes) {
     size_t data_loc = 0;
     uint8_t found = 0;
+    uint16_t item = index + 1; // 1 based, wider than the index so 255 does not wrap
 
     *bytes = 0;
-    index++;
-    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID16, index, &data_loc);
-    if(found == index) {
+    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID16, item, &data_loc);
+    if(found == item) {
         *bytes = 2;
         return data_loc;
     }
 
-    index -= found;
-    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID32, index, &data_loc);
-    if(found == index) {
+    item -= found;
+    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID32, item, &data_loc);
+    if(found == item) {
         *bytes = 4;
         return data_loc;
     }
 
-    index -= found;
-    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID128, index, &data_loc);
-    if(found == index) {
+    item -= found;
+    found = findAdvField(BLE_HS_ADV_TYPE_SVC_DATA_UUID128, item, &data_loc);
+    if(found == item) {
         *bytes = 16;
         return data_loc;
     }
@@ -433,43 +536,26 @@ uint8_t NimBLEAdvertisedDevice::getServiceDataCount() {
  * @return The Service UUID of the advertised service, or an empty UUID if not found.
  */
 NimBLEUUID NimBLEAdvertisedDevice::getServiceUUID(uint8_t index) {
-    uint8_t count = 0;
-    size_t data_loc = 0;
-    uint8_t uuidBytes = 0;
-    uint8_t type = BLE_HS_ADV_TYPE_INCOMP_UUIDS16;
-    ble_hs_adv_field *field = nullptr;
-
-    index++;
-
-    do {
-        count = findAdvField(type, index, &data_loc);
-        if(count >= index) {
-            if(type < BLE_HS_ADV_TYPE_INCOMP_UUIDS32) {
-                uuidBytes = 2;
-            } else if(type < BLE_HS_ADV_TYPE_INCOMP_UUIDS128) {
-                uuidBytes = 4;
-            } else {
-                uuidBytes = 16;
-            }
-            break;
-
-        } else {
-            type++;
-            index -= count;
+    // UUIDs are numbered by list type (16, 32 then 128 bit; incomplete before complete), then payload order
+    for(uint8_t type = BLE_HS_ADV_TYPE_INCOMP_UUIDS16; type <= BLE_HS_ADV_TYPE_COMP_UUIDS128; type++) {
+        if(!(m_adTypeMask & adTypeBit(type))) {
+            continue;
         }
 
-    } while(type <= BLE_HS_ADV_TYPE_COMP_UUIDS128);
+        uint8_t uuidBytes = type < BLE_HS_ADV_TYPE_INCOMP_UUIDS32 ? 2 :
+                            type < BLE_HS_ADV_TYPE_INCOMP_UUIDS128 ? 4 : 16;
 
-    if(uuidBytes > 0) {
-        field = (ble_hs_adv_field *)&m_payload[data_loc];
-        // In the case of more than one field of service uuid's we need to adjust
-        // the index to account for the uuids of the previous fields.
-        if(field->length < index * uuidBytes) {
-            index -= count - field->length / uuidBytes;
-        }
+        for(uint8_t i = 0; i < m_adCount; i++) {
+            ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[m_adOffsets[i]];
+            if(field->type != type) {
+                continue;
+            }
 
-        if(field->length > uuidBytes * index) {
-            return NimBLEUUID(field->value + uuidBytes * (index - 1), uuidBytes, false);
+            uint8_t count = (field->length - 1) / uuidBytes;
+            if(index < count) {
+                return NimBLEUUID(field->value + uuidBytes * index, uuidBytes, false);
+            }
+            index -= count;
         }
     }
 
@@ -501,10 +587,18 @@ uint8_t NimBLEAdvertisedDevice::getServiceUUIDCount() {
  * @return Return true if service is advertised
  */
 bool NimBLEAdvertisedDevice::isAdvertisingService(const NimBLEUUID &uuid) {
-    size_t count = getServiceUUIDCount();
-    for(size_t i = 0; i < count; i++) {
-        if(uuid == getServiceUUID(i)) {
-            return true;
+    for(uint8_t i = 0; i < m_adCount; i++) {
+        ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[m_adOffsets[i]];
+        if(field->type < BLE_HS_ADV_TYPE_INCOMP_UUIDS16 || field->type > BLE_HS_ADV_TYPE_COMP_UUIDS128) {
+            continue;
+        }
+
+        uint8_t uuidBytes = field->type < BLE_HS_ADV_TYPE_INCOMP_UUIDS32 ? 2 :
+                            field->type < BLE_HS_ADV_TYPE_INCOMP_UUIDS128 ? 4 : 16;
+        for(uint8_t pos = 0; pos + uuidBytes < field->length; pos += uuidBytes) {
+            if(uuid == NimBLEUUID(field->value + pos, uuidBytes, false)) {
+                return true;
+            }
         }
     }
 
@@ -682,38 +776,39 @@ uint16_t NimBLEAdvertisedDevice::getPeriodicInterval() {
 #endif
 
 
-uint8_t NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint8_t index, size_t * data_loc) {
-    ble_hs_adv_field *field = nullptr;
-    size_t  length = m_payload.size();
-    size_t  data   = 0;
+/**
+ * @brief Find an AD structure of a type in the payload index.
+ * @param [in] type The AD type to look for.
+ * @param [in] index The 1 based item to find, 0 for the first structure of the type.
+ * @param [out] data_loc Set to the payload offset of the structure holding the item, if found.
+ * @return The number of items of the type counted up to and including the one found.
+ * List types (UUIDs, target addresses) count each entry, other types count each structure.
+ */
+uint8_t NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint16_t index, size_t * data_loc) {
     uint8_t count  = 0;
 
-    if (length < 3) {
+    if (!(m_adTypeMask & adTypeBit(type))) {
         return count;
     }
 
-    while (length > 2) {
-        field = (ble_hs_adv_field*)&m_payload[data];
-
-        if (field->length >= length) {
-            return count;
-        }
+    for (uint8_t i = 0; i < m_adCount; i++) {
+        ble_hs_adv_field *field = (ble_hs_adv_field*)&m_payload[m_adOffsets[i]];
 
         if (field->type == type) {
             switch (type) {
                 case BLE_HS_ADV_TYPE_INCOMP_UUIDS16:
                 case BLE_HS_ADV_TYPE_COMP_UUIDS16:
-                    count += field->length / 2;
+                    count += (field->length - 1) / 2;
                     break;
 
                 case BLE_HS_ADV_TYPE_INCOMP_UUIDS32:
                 case BLE_HS_ADV_TYPE_COMP_UUIDS32:
-                    count += field->length / 4;
+                    count += (field->length - 1) / 4;
                     break;
 
                 case BLE_HS_ADV_TYPE_INCOMP_UUIDS128:
                 case BLE_HS_ADV_TYPE_COMP_UUIDS128:
-                    count += field->length / 16;
+                    count += (field->length - 1) / 16;
                     break;
 
                 case BLE_HS_ADV_TYPE_PUBLIC_TGT_ADDR:
@@ -728,21 +823,60 @@ uint8_t NimBLEAdvertisedDevice::findAdvField(uint8_t type, uint8_t index, size_t
 
             if (data_loc != nullptr) {
                 if (index == 0 || count >= index) {
+                    *data_loc = m_adOffsets[i];
                     break;
                 }
             }
         }
+    }
+
+    return count;
+} // findAdvField
+
+
+/**
+ * @brief Tokenise the payload into the AD structure index.
+ * @details Called once per payload update so the getters never re-walk the raw bytes.
+ * Zero length structures (padding) are skipped and parsing stops at a truncated structure.
+ */
+void NimBLEAdvertisedDevice::indexPayload() {
+    size_t pos = 0;
+
+    m_adTypeMask = 0;
+    m_adCount    = 0;
+
+    while (pos + 1 < m_payloadLength && m_adCount < sizeof(m_adOffsets)) {
+        uint8_t length = m_payload[pos];
+        if (length == 0) {
+            pos++;
+            continue;
+        }
+        if (pos + 1 + length > m_payloadLength) {
+            break;
+        }
 
-        length -= 1 + field->length;
-        data += 1 + field->length;
+        m_adOffsets[m_adCount++] = pos;
+        m_adTypeMask |= adTypeBit(m_payload[pos + 1]);
+        pos += 1 + length;
     }
+} // indexPayload
+
 
-    if (data_loc != nullptr && field != nullptr) {
-        *data_loc = data;
+/**
+ * @brief Get a view of the value of an AD structure.
+ * @param [in] data_loc The payload offset of the structure.
+ * @param [in] skip The number of leading value bytes to leave out (e.g. a service data UUID).
+ * @return A view into the payload, empty if the structure has no data after skip.
+ */
+std::string_view NimBLEAdvertisedDevice::fieldValue(size_t data_loc, uint8_t skip) {
+    ble_hs_adv_field *field = (ble_hs_adv_field *)&m_payload[data_loc];
+
+    if (field->length > skip + 1) {
+        return std::string_view((const char*)field->value + skip, field->length - skip - 1);
     }
 
-    return count;
-}
+    return std::string_view();
+} // fieldValue
 
 
 /**
@@ -833,18 +967,27 @@ uint8_t* NimBLEAdvertisedDevice::getPayload() {
 
 
 /**
- * @brief Stores the payload of the advertised device in a vector.
+ * @brief Stores the payload of the advertised device in the inline buffer.
  * @param [in] payload The advertisement payload.
  * @param [in] length The length of the payload in bytes.
  * @param [in] append Indicates if the the data should be appended (scan response).
+ * @details A scan response replaces any previous scan response, so the payload is always
+ * the latest advertisement followed by the latest scan response.
  */
 void NimBLEAdvertisedDevice::setPayload(const uint8_t *payload, uint8_t length, bool append) {
+    size_t offset = append ? m_advLength : 0;
+
+    if(offset + length > sizeof(m_payload)) {
+        NIMBLE_LOGW(LOG_TAG, "Payload too large (%u bytes), truncated", (unsigned)(offset + length));
+        length = sizeof(m_payload) - offset;
+    }
+
     if(!append) {
         m_advLength = length;
-        m_payload.assign(payload, payload + length);
-    } else {
-        m_payload.insert(m_payload.end(), payload, payload + length);
     }
+    memcpy(m_payload + offset, payload, length);
+    m_payloadLength = offset + length;
+    indexPayload();
 }
 
 
@@ -884,7 +1027,7 @@ time_t NimBLEAdvertisedDevice::getTimestamp() {
  * @return The size of the payload in bytes.
  */
 size_t NimBLEAdvertisedDevice::getPayloadLength() {
-    return m_payload.size();
+    return m_payloadLength;
 } // getPayloadLength
 
 
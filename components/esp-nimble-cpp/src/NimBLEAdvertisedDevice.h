@@ -18,7 +18,7 @@
 #if defined(CONFIG_BT_ENABLED) && defined(CONFIG_BT_NIMBLE_ROLE_OBSERVER)
 
 #include "NimBLEAddress.h"
-#include "NimBLEScan.h"
+#include "NimBLEBeaconFrame.h"
 #include "NimBLEUUID.h"
 
 #if defined(CONFIG_NIMBLE_CPP_IDF)
@@ -29,8 +29,19 @@
 
 #include <map>
 #include <vector>
+#include <string_view>
 #include <time.h>
 
+/**
+ * @brief Largest payload stored for an advertised device: one extended advertising report, or a
+ * legacy advertisement plus its scan response.
+ */
+#if CONFIG_BT_NIMBLE_EXT_ADV
+#    define NIMBLE_CPP_ADV_PAYLOAD_MAX_LEN 255
+#else
+#    define NIMBLE_CPP_ADV_PAYLOAD_MAX_LEN (BLE_HS_ADV_MAX_SZ * 2)
+#endif
+
 
 class NimBLEScan;
 /**
@@ -52,8 +63,11 @@ public:
     uint16_t        getMaxInterval();
     uint8_t         getManufacturerDataCount();
     std::string     getManufacturerData(uint8_t index = 0);
+    std::string_view getManufacturerDataView(uint8_t index = 0);
     std::string     getURI();
+    std::string_view getURIView();
     std::string     getPayloadByType(uint16_t type);
+    std::string_view getPayloadByTypeView(uint16_t type);
 
     /**
      * @brief A template to convert the service data to <type\>.
@@ -65,18 +79,21 @@ public:
      */
     template<typename T>
     T       getManufacturerData(bool skipSizeCheck = false) {
-        std::string data = getManufacturerData();
+        std::string_view data = getManufacturerDataView();
         if(!skipSizeCheck && data.size() < sizeof(T)) return T();
         const char *pData = data.data();
         return *((T *)pData);
     }
 
     std::string     getName();
+    std::string_view getNameView();
     int             getRSSI();
     NimBLEScan*     getScan();
     uint8_t         getServiceDataCount();
     std::string     getServiceData(uint8_t index = 0);
     std::string     getServiceData(const NimBLEUUID &uuid);
+    std::string_view getServiceDataView(uint8_t index = 0);
+    std::string_view getServiceDataView(const NimBLEUUID &uuid);
 
     /**
      * @brief A template to convert the service data to <tt><type\></tt>.
@@ -89,7 +106,7 @@ public:
      */
     template<typename T>
     T       getServiceData(uint8_t index = 0, bool skipSizeCheck = false) {
-        std::string data = getServiceData(index);
+        std::string_view data = getServiceDataView(index);
         if(!skipSizeCheck && data.size() < sizeof(T)) return T();
         const char *pData = data.data();
         return *((T *)pData);
@@ -106,12 +123,15 @@ public:
      */
     template<typename T>
     T       getServiceData(const NimBLEUUID &uuid, bool skipSizeCheck = false) {
-        std::string data = getServiceData(uuid);
+        std::string_view data = getServiceDataView(uuid);
         if(!skipSizeCheck && data.size() < sizeof(T)) return T();
         const char *pData = data.data();
         return *((T *)pData);
     }
 
+    bool            getBeaconFrame(NimBLEBeaconFrame *frame);
+    bool            getEddystoneFrame(NimBLEEddystoneTLMFrame *frame);
+    bool            getEddystoneFrame(NimBLEEddystoneURLFrame *frame);
     NimBLEUUID      getServiceDataUUID(uint8_t index = 0);
     NimBLEUUID      getServiceUUID(uint8_t index = 0);
     uint8_t         getServiceUUIDCount();
@@ -159,10 +179,18 @@ private:
     void    setSecondaryPhy(uint8_t phy)       { m_secPhy = phy; }
     void    setPeriodicInterval(uint16_t itvl) { m_periodicItvl = itvl; }
 #endif
-    uint8_t findAdvField(uint8_t type, uint8_t index = 0, size_t * data_loc = nullptr);
+    uint8_t findAdvField(uint8_t type, uint16_t index = 0, size_t * data_loc = nullptr);
     size_t  findServiceData(uint8_t index, uint8_t* bytes);
+    std::string_view findEddystoneFrame(uint8_t frameType);
+    void    indexPayload();
+    std::string_view fieldValue(size_t data_loc, uint8_t skip = 0);
 
-    NimBLEAddress   m_address = NimBLEAddress("");
+    /**
+     * @brief Bit for an AD type in m_adTypeMask. Types sharing a bit only cost a scan of the offsets.
+     */
+    static constexpr uint64_t adTypeBit(uint8_t type) { return 1ULL << (type & 63); }
+
+    NimBLEAddress   m_address;
     uint8_t         m_advType;
     int             m_rssi;
     time_t          m_timestamp;
@@ -176,8 +204,18 @@ private:
     uint16_t        m_periodicItvl;
 #endif
 
-    std::vector<uint8_t>    m_payload;
+    uint16_t        m_payloadLength;
+    uint8_t         m_payload[NIMBLE_CPP_ADV_PAYLOAD_MAX_LEN];
+
+    // AD structures found by indexPayload(): offset of each length byte in payload order,
+    // and a filter of the types present so absent types are rejected without a scan.
+    uint64_t        m_adTypeMask;
+    uint8_t         m_adCount;
+    uint8_t         m_adOffsets[NIMBLE_CPP_ADV_PAYLOAD_MAX_LEN / 2];
 };
 
+// The scan holds a pool of devices by value, it needs the complete class.
+#include "NimBLEScan.h"
+
 #endif /* CONFIG_BT_ENABLED && CONFIG_BT_NIMBLE_ROLE_OBSERVER */
 #endif /* COMPONENTS_NIMBLEADVERTISEDDEVICE_H_ */
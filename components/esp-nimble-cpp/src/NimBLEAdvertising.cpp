@@ -48,7 +48,6 @@ void NimBLEAdvertising::reset() {
         stop();
     }
     memset(&m_advData, 0, sizeof m_advData);
-    memset(&m_scanData, 0, sizeof m_scanData);
     memset(&m_advParams, 0, sizeof m_advParams);
     memset(&m_slaveItvl, 0, sizeof m_slaveItvl);
     const char *name = ble_svc_gap_device_name();
@@ -69,6 +68,13 @@ void NimBLEAdvertising::reset() {
     m_customScanResponseData         = false;
     m_scanResp                       = true;
     m_advDataSet                     = false;
+    m_advDataLoaded                  = false;
+    m_advPayloadLen                  = 0;
+    m_scanPayloadLen                 = 0;
+    m_fastDuration                   = 0;
+    m_fastItvlMin                    = 0;
+    m_fastItvlMax                    = 0;
+    m_fastPhase                      = false;
     // Set this to non-zero to prevent auto start if host reset before started by app.
     m_duration                       = BLE_HS_FOREVER;
     m_advCompCB                      = nullptr;
@@ -229,6 +235,8 @@ void NimBLEAdvertising::setServiceData(const NimBLEUUID &uuid, const std::string
  */
 void NimBLEAdvertising::setAdvertisementType(uint8_t adv_type){
     m_advParams.conn_mode = adv_type;
+    // The AD flags depend on the connection mode
+    m_advDataSet = false;
 } // setAdvertisementType
 
 
@@ -250,6 +258,21 @@ void NimBLEAdvertising::setMaxInterval(uint16_t maxinterval) {
 } // setMaxInterval
 
 
+/**
+ * @brief Advertise at a fast interval for a while after each start, then at the configured interval.
+ * @param [in] duration Time in milliseconds to advertise fast after start(), 0 = disabled.
+ * @param [in] minInterval Minimum fast advertising interval in 0.625ms units.
+ * @param [in] maxInterval Maximum fast advertising interval in 0.625ms units.
+ * @details Lets a host find and reconnect to the device quickly while keeping the long term\n
+ * interval (setMinInterval/setMaxInterval) slow. Not used for directed advertising.
+ */
+void NimBLEAdvertising::setFastAdvertising(uint32_t duration, uint16_t minInterval, uint16_t maxInterval) {
+    m_fastDuration = duration;
+    m_fastItvlMin = minInterval;
+    m_fastItvlMax = maxInterval;
+} // setFastAdvertising
+
+
 /**
  * @brief Set the advertised min connection interval preferred by this device.
  * @param [in] mininterval the max interval value. Range = 0x0006 to 0x0C80.
@@ -260,6 +283,7 @@ void NimBLEAdvertising::setMinPreferred(uint16_t mininterval) {
     // invalid paramters, set the slave interval to null
     if(mininterval < 0x0006 || mininterval > 0x0C80) {
         m_advData.slave_itvl_range = nullptr;
+        m_advDataSet = false;
         return;
     }
 
@@ -292,6 +316,7 @@ void NimBLEAdvertising::setMaxPreferred(uint16_t maxinterval) {
     // invalid paramters, set the slave interval to null
     if(maxinterval < 0x0006 || maxinterval > 0x0C80) {
         m_advData.slave_itvl_range = nullptr;
+        m_advDataSet = false;
         return;
     }
     if(m_advData.slave_itvl_range == nullptr) {
@@ -326,6 +351,8 @@ void NimBLEAdvertising::setScanResponse(bool set) {
  * @brief Set the filtering for the scan filter.
  * @param [in] scanRequestWhitelistOnly If true, only allow scan requests from those on the white list.
  * @param [in] connectWhitelistOnly If true, only allow connections from those on the white list.
+ * @details The controller enforces the filter. Ignored addresses (NimBLEDevice::addIgnored) are left
+ * out of the controller list, so they are filtered as well.
  */
 void NimBLEAdvertising::setScanFilter(bool scanRequestWhitelistOnly, bool connectWhitelistOnly) {
     NIMBLE_LOGD(LOG_TAG, ">> setScanFilter: scanRequestWhitelistOnly: %d, connectWhitelistOnly: %d",
@@ -432,228 +459,266 @@ bool NimBLEAdvertising::start(uint32_t duration, void (*advCompleteCB)(NimBLEAdv
 
     // Save the duration incase of host reset so we can restart with the same params
     m_duration = duration;
+    m_advCompCB = advCompleteCB;
 
-    if(duration == 0){
-        duration = BLE_HS_FOREVER;
-    }
+    // The payload is only serialized again after the configuration changed, and only
+    // sent to the controller again after that or a host reset.
+    if (!m_customAdvData) {
+        if (!m_advDataSet) {
+            if (!buildPayload()) {
+                return false;
+            }
+            m_advDataSet = true;
+            m_advDataLoaded = false;
+        }
 
-    m_advCompCB = advCompleteCB;
+        if (!m_advDataLoaded && !loadPayload()) {
+            return false;
+        }
+    }
 
     m_advParams.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    m_advData.flags = (BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
-    if(m_advParams.conn_mode == BLE_GAP_CONN_MODE_NON) {
-        if(!m_scanResp) {
-            m_advParams.disc_mode = BLE_GAP_DISC_MODE_NON;
-            // non-connectable advertising does not require AD flags.
-            m_advData.flags = 0;
+    if (m_advParams.conn_mode == BLE_GAP_CONN_MODE_NON && !m_scanResp) {
+        m_advParams.disc_mode = BLE_GAP_DISC_MODE_NON;
+    }
+
+    ble_gap_adv_params params = m_advParams;
+
+    int32_t advDuration = (duration == 0) ? BLE_HS_FOREVER : duration;
+    m_fastPhase = false;
+    if (m_fastDuration > 0 && dirAddr == nullptr) {
+        params.itvl_min = m_fastItvlMin;
+        params.itvl_max = m_fastItvlMax;
+        if (duration == 0 || duration > m_fastDuration) {
+            advDuration = m_fastDuration;
+            m_fastPhase = true;
         }
     }
 
-    int rc = 0;
+    ble_addr_t peerAddr;
+    if (dirAddr != nullptr) {
+        memcpy(&peerAddr.val, dirAddr->getNative(), 6);
+        peerAddr.type = dirAddr->getType();
+    }
 
-    if (!m_customAdvData && !m_advDataSet) {
-        //start with 3 bytes for the flags data if required
-        uint8_t payloadLen = (m_advData.flags > 0) ? (2 + 1) : 0;
-        if(m_advData.mfg_data_len > 0)
-            payloadLen += (2 + m_advData.mfg_data_len);
+    int rc = startGap(advDuration, &params, (dirAddr != nullptr) ? &peerAddr : nullptr);
+    if (rc != 0) {
+        m_fastPhase = false;
+    }
 
-        if(m_advData.svc_data_uuid16_len > 0)
-            payloadLen += (2 + m_advData.svc_data_uuid16_len);
+    NIMBLE_LOGD(LOG_TAG, "<< Advertising start");
+    return (rc == 0 || rc == BLE_HS_EALREADY);
+} // start
 
-        if(m_advData.svc_data_uuid32_len > 0)
-            payloadLen += (2 + m_advData.svc_data_uuid32_len);
 
-        if(m_advData.svc_data_uuid128_len > 0)
-            payloadLen += (2 + m_advData.svc_data_uuid128_len);
+/**
+ * @brief Serializes the advertisement and scan response data into the payload buffers.
+ * @return True if the data fits.
+ */
+bool NimBLEAdvertising::buildPayload() {
+    // Work on a copy, the configured fields must survive a name being moved or truncated.
+    ble_hs_adv_fields advData = m_advData;
+    ble_hs_adv_fields scanData;
+    memset(&scanData, 0, sizeof scanData);
+
+    // Each list is bounded by the payload size, so no allocation is needed
+    ble_uuid16_t  uuids16[BLE_HS_ADV_MAX_SZ / 2];
+    ble_uuid32_t  uuids32[BLE_HS_ADV_MAX_SZ / 4];
+    ble_uuid128_t uuids128[1];
+
+    advData.flags = (BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+    if(m_advParams.conn_mode == BLE_GAP_CONN_MODE_NON && !m_scanResp) {
+        // non-connectable advertising does not require AD flags.
+        advData.flags = 0;
+    }
 
-        if(m_advData.uri_len > 0)
-            payloadLen += (2 + m_advData.uri_len);
+    //start with 3 bytes for the flags data if required
+    uint8_t payloadLen = (advData.flags > 0) ? (2 + 1) : 0;
+    if(advData.mfg_data_len > 0)
+        payloadLen += (2 + advData.mfg_data_len);
 
-        if(m_advData.appearance_is_present)
-            payloadLen += (2 + BLE_HS_ADV_APPEARANCE_LEN);
+    if(advData.svc_data_uuid16_len > 0)
+        payloadLen += (2 + advData.svc_data_uuid16_len);
 
-        if(m_advData.tx_pwr_lvl_is_present)
-            payloadLen += (2 + BLE_HS_ADV_TX_PWR_LVL_LEN);
+    if(advData.svc_data_uuid32_len > 0)
+        payloadLen += (2 + advData.svc_data_uuid32_len);
 
-        if(m_advData.slave_itvl_range != nullptr)
-            payloadLen += (2 + BLE_HS_ADV_SLAVE_ITVL_RANGE_LEN);
+    if(advData.svc_data_uuid128_len > 0)
+        payloadLen += (2 + advData.svc_data_uuid128_len);
 
-        for(auto &it : m_serviceUUIDs) {
-            if(it.getNative()->u.type == BLE_UUID_TYPE_16) {
-                int add = (m_advData.num_uuids16 > 0) ? 2 : 4;
-                if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
-                    m_advData.uuids16_is_complete = 0;
-                    continue;
-                }
-                payloadLen += add;
+    if(advData.uri_len > 0)
+        payloadLen += (2 + advData.uri_len);
 
-                if(nullptr == (m_advData.uuids16 = (ble_uuid16_t*)realloc((void*)m_advData.uuids16,
-                                                   (m_advData.num_uuids16 + 1) * sizeof(ble_uuid16_t))))
-                {
-                    NIMBLE_LOGC(LOG_TAG, "Error, no mem");
-                    abort();
-                }
-                memcpy((void*)&m_advData.uuids16[m_advData.num_uuids16],
-                       &it.getNative()->u16, sizeof(ble_uuid16_t));
-                m_advData.uuids16_is_complete = 1;
-                m_advData.num_uuids16++;
-            }
-            if(it.getNative()->u.type == BLE_UUID_TYPE_32) {
-                int add = (m_advData.num_uuids32 > 0) ? 4 : 6;
-                if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
-                    m_advData.uuids32_is_complete = 0;
-                    continue;
-                }
-                payloadLen += add;
+    if(advData.appearance_is_present)
+        payloadLen += (2 + BLE_HS_ADV_APPEARANCE_LEN);
 
-                if(nullptr == (m_advData.uuids32 = (ble_uuid32_t*)realloc((void*)m_advData.uuids32,
-                                                   (m_advData.num_uuids32 + 1) * sizeof(ble_uuid32_t))))
-                {
-                    NIMBLE_LOGC(LOG_TAG, "Error, no mem");
-                    abort();
-                }
-                memcpy((void*)&m_advData.uuids32[m_advData.num_uuids32],
-                       &it.getNative()->u32, sizeof(ble_uuid32_t));
-                m_advData.uuids32_is_complete = 1;
-                m_advData.num_uuids32++;
-            }
-            if(it.getNative()->u.type == BLE_UUID_TYPE_128){
-                int add = (m_advData.num_uuids128 > 0) ? 16 : 18;
-                if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
-                    m_advData.uuids128_is_complete = 0;
-                    continue;
-                }
-                payloadLen += add;
+    if(advData.tx_pwr_lvl_is_present)
+        payloadLen += (2 + BLE_HS_ADV_TX_PWR_LVL_LEN);
 
-                if(nullptr == (m_advData.uuids128 = (ble_uuid128_t*)realloc((void*)m_advData.uuids128,
-                              (m_advData.num_uuids128 + 1) * sizeof(ble_uuid128_t))))
-                {
-                    NIMBLE_LOGC(LOG_TAG, "Error, no mem");
-                    abort();
-                }
-                memcpy((void*)&m_advData.uuids128[m_advData.num_uuids128],
-                       &it.getNative()->u128, sizeof(ble_uuid128_t));
-                m_advData.uuids128_is_complete = 1;
-                m_advData.num_uuids128++;
+    if(advData.slave_itvl_range != nullptr)
+        payloadLen += (2 + BLE_HS_ADV_SLAVE_ITVL_RANGE_LEN);
+
+    advData.uuids16 = uuids16;
+    advData.uuids32 = uuids32;
+    advData.uuids128 = uuids128;
+    for(auto &it : m_serviceUUIDs) {
+        if(it.getNative()->u.type == BLE_UUID_TYPE_16) {
+            int add = (advData.num_uuids16 > 0) ? 2 : 4;
+            if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
+                advData.uuids16_is_complete = 0;
+                continue;
+            }
+            payloadLen += add;
+            uuids16[advData.num_uuids16++] = it.getNative()->u16;
+            advData.uuids16_is_complete = 1;
+        }
+        if(it.getNative()->u.type == BLE_UUID_TYPE_32) {
+            int add = (advData.num_uuids32 > 0) ? 4 : 6;
+            if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
+                advData.uuids32_is_complete = 0;
+                continue;
+            }
+            payloadLen += add;
+            uuids32[advData.num_uuids32++] = it.getNative()->u32;
+            advData.uuids32_is_complete = 1;
+        }
+        if(it.getNative()->u.type == BLE_UUID_TYPE_128){
+            int add = (advData.num_uuids128 > 0) ? 16 : 18;
+            if((payloadLen + add) > BLE_HS_ADV_MAX_SZ){
+                advData.uuids128_is_complete = 0;
+                continue;
             }
+            payloadLen += add;
+            uuids128[advData.num_uuids128++] = it.getNative()->u128;
+            advData.uuids128_is_complete = 1;
         }
+    }
 
-        // check if there is room for the name, if not put it in scan data
-        if((payloadLen + (2 + m_advData.name_len)) > BLE_HS_ADV_MAX_SZ) {
-            if(m_scanResp && !m_customScanResponseData){
-                m_scanData.name = m_advData.name;
-                m_scanData.name_len = m_advData.name_len;
-                if(m_scanData.name_len > BLE_HS_ADV_MAX_SZ - 2) {
-                    m_scanData.name_len = BLE_HS_ADV_MAX_SZ - 2;
-                    m_scanData.name_is_complete = 0;
-                } else {
-                    m_scanData.name_is_complete = 1;
-                }
-                m_advData.name = nullptr;
-                m_advData.name_len = 0;
-                m_advData.name_is_complete = 0;
+    // check if there is room for the name, if not put it in scan data
+    if((payloadLen + (2 + advData.name_len)) > BLE_HS_ADV_MAX_SZ) {
+        if(m_scanResp && !m_customScanResponseData){
+            scanData.name = advData.name;
+            scanData.name_len = advData.name_len;
+            if(scanData.name_len > BLE_HS_ADV_MAX_SZ - 2) {
+                scanData.name_len = BLE_HS_ADV_MAX_SZ - 2;
+                scanData.name_is_complete = 0;
             } else {
-                if(m_advData.tx_pwr_lvl_is_present) {
-                    m_advData.tx_pwr_lvl_is_present = 0;
-                    payloadLen -= (2 + 1);
-                }
-                // if not using scan response just cut the name down
-                // leaving 2 bytes for the data specifier.
-                if(m_advData.name_len > (BLE_HS_ADV_MAX_SZ - payloadLen - 2)) {
-                    m_advData.name_len = (BLE_HS_ADV_MAX_SZ - payloadLen - 2);
-                    m_advData.name_is_complete = 0;
-                }
+                scanData.name_is_complete = 1;
+            }
+            advData.name = nullptr;
+            advData.name_len = 0;
+            advData.name_is_complete = 0;
+        } else {
+            if(advData.tx_pwr_lvl_is_present) {
+                advData.tx_pwr_lvl_is_present = 0;
+                payloadLen -= (2 + 1);
+            }
+            // if not using scan response just cut the name down
+            // leaving 2 bytes for the data specifier.
+            if(advData.name_len > (BLE_HS_ADV_MAX_SZ - payloadLen - 2)) {
+                advData.name_len = (BLE_HS_ADV_MAX_SZ - payloadLen - 2);
+                advData.name_is_complete = 0;
             }
         }
+    }
 
-        if(m_scanResp && !m_customScanResponseData) {
-            rc = ble_gap_adv_rsp_set_fields(&m_scanData);
-            switch(rc) {
-                case 0:
-                    break;
+    int rc = ble_hs_adv_set_fields(&advData, m_advPayload, &m_advPayloadLen, BLE_HS_ADV_MAX_SZ);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Advertisement data too long; rc=%d, %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
 
-                case BLE_HS_EBUSY:
-                    NIMBLE_LOGE(LOG_TAG, "Already advertising");
-                    break;
+    m_scanPayloadLen = 0;
+    if(m_scanResp && !m_customScanResponseData) {
+        rc = ble_hs_adv_set_fields(&scanData, m_scanPayload, &m_scanPayloadLen, BLE_HS_ADV_MAX_SZ);
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Scan data too long; rc=%d, %s",
+                        rc, NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+    }
 
-                case BLE_HS_EMSGSIZE:
-                    NIMBLE_LOGE(LOG_TAG, "Scan data too long");
-                    break;
+    return true;
+} // buildPayload
 
-                default:
-                    NIMBLE_LOGE(LOG_TAG, "Error setting scan response data; rc=%d, %s",
-                                rc, NimBLEUtils::returnCodeToString(rc));
-                    break;
-            }
-        }
 
-        if(rc == 0) {
-            rc = ble_gap_adv_set_fields(&m_advData);
-            switch(rc) {
-                case 0:
-                    break;
+/**
+ * @brief Sends the serialized advertisement and scan response data to the controller.
+ * @return True if the controller accepted both.
+ */
+bool NimBLEAdvertising::loadPayload() {
+    int rc = 0;
 
-                case BLE_HS_EBUSY:
-                    NIMBLE_LOGE(LOG_TAG, "Already advertising");
-                    break;
+    if(m_scanResp && !m_customScanResponseData) {
+        rc = ble_gap_adv_rsp_set_data(m_scanPayload, m_scanPayloadLen);
+        switch(rc) {
+            case 0:
+                break;
 
-                case BLE_HS_EMSGSIZE:
-                    NIMBLE_LOGE(LOG_TAG, "Advertisement data too long");
-                    break;
+            case BLE_HS_EBUSY:
+                NIMBLE_LOGE(LOG_TAG, "Already advertising");
+                break;
 
-                default:
-                    NIMBLE_LOGE(LOG_TAG, "Error setting advertisement data; rc=%d, %s",
-                                rc, NimBLEUtils::returnCodeToString(rc));
-                    break;
-            }
+            default:
+                NIMBLE_LOGE(LOG_TAG, "Error setting scan response data; rc=%d, %s",
+                            rc, NimBLEUtils::returnCodeToString(rc));
+                break;
         }
+    }
 
-        if(m_advData.num_uuids128 > 0) {
-            free((void*)m_advData.uuids128);
-            m_advData.uuids128 = nullptr;
-            m_advData.num_uuids128 = 0;
-        }
+    if(rc == 0) {
+        rc = ble_gap_adv_set_data(m_advPayload, m_advPayloadLen);
+        switch(rc) {
+            case 0:
+                break;
 
-        if(m_advData.num_uuids32 > 0) {
-            free((void*)m_advData.uuids32);
-            m_advData.uuids32 = nullptr;
-            m_advData.num_uuids32 = 0;
-        }
+            case BLE_HS_EBUSY:
+                NIMBLE_LOGE(LOG_TAG, "Already advertising");
+                break;
 
-        if(m_advData.num_uuids16 > 0) {
-            free((void*)m_advData.uuids16);
-            m_advData.uuids16 = nullptr;
-            m_advData.num_uuids16 = 0;
+            default:
+                NIMBLE_LOGE(LOG_TAG, "Error setting advertisement data; rc=%d, %s",
+                            rc, NimBLEUtils::returnCodeToString(rc));
+                break;
         }
+    }
 
-        if(rc !=0) {
-            return false;
-        }
+    m_advDataLoaded = (rc == 0);
+    return m_advDataLoaded;
+} // loadPayload
 
-        m_advDataSet = true;
-    }
 
-    ble_addr_t peerAddr;
-    if (dirAddr != nullptr) {
-        memcpy(&peerAddr.val, dirAddr->getNative(), 6);
-        peerAddr.type = dirAddr->getType();
+/**
+ * @brief Enables advertising in the host with the given parameters.
+ * @param [in] duration The duration in milliseconds or BLE_HS_FOREVER.
+ * @param [in] params The advertising parameters.
+ * @param [in] peerAddr The peer to directly advertise to, nullptr for undirected advertising.
+ * @return The host return code.
+ */
+int NimBLEAdvertising::startGap(int32_t duration, const ble_gap_adv_params *params,
+                                const ble_addr_t *peerAddr) {
+    // Apply white list changes made while the controller was using the list
+    if (params->filter_policy != BLE_HCI_ADV_FILT_NONE) {
+        NimBLEDevice::whiteListSync();
     }
 
 #if defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
-    rc = ble_gap_adv_start(NimBLEDevice::m_own_addr_type,
-                           (dirAddr != nullptr) ? &peerAddr : NULL,
-                           duration,
-                           &m_advParams,
-                           (pServer != nullptr) ? NimBLEServer::handleGapEvent :
-                                                  NimBLEAdvertising::handleGapEvent,
-                           (void*)this);
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    int rc = ble_gap_adv_start(NimBLEDevice::m_own_addr_type,
+                               peerAddr,
+                               duration,
+                               params,
+                               (pServer != nullptr) ? NimBLEServer::handleGapEvent :
+                                                      NimBLEAdvertising::handleGapEvent,
+                               (void*)this);
 #else
-    rc = ble_gap_adv_start(NimBLEDevice::m_own_addr_type,
-                           (dirAddr != nullptr) ? &peerAddr : NULL,
-                           duration,
-                           &m_advParams,
-                           NimBLEAdvertising::handleGapEvent,
-                           (void*)this);
+    int rc = ble_gap_adv_start(NimBLEDevice::m_own_addr_type,
+                               peerAddr,
+                               duration,
+                               params,
+                               NimBLEAdvertising::handleGapEvent,
+                               (void*)this);
 #endif
     switch(rc) {
         case 0:
@@ -684,9 +749,8 @@ bool NimBLEAdvertising::start(uint32_t duration, void (*advCompleteCB)(NimBLEAdv
             break;
     }
 
-    NIMBLE_LOGD(LOG_TAG, "<< Advertising start");
-    return (rc == 0 || rc == BLE_HS_EALREADY);
-} // start
+    return rc;
+} // startGap
 
 
 /**
@@ -696,6 +760,7 @@ bool NimBLEAdvertising::start(uint32_t duration, void (*advCompleteCB)(NimBLEAdv
 bool NimBLEAdvertising::stop() {
     NIMBLE_LOGD(LOG_TAG, ">> stop");
 
+    m_fastPhase = false;
     int rc = ble_gap_adv_stop();
     if (rc != 0 && rc != BLE_HS_EALREADY) {
         NIMBLE_LOGE(LOG_TAG, "ble_gap_adv_stop rc=%d %s",
@@ -703,6 +768,8 @@ bool NimBLEAdvertising::stop() {
         return false;
     }
 
+    NimBLEDevice::whiteListRetry();
+
     NIMBLE_LOGD(LOG_TAG, "<< stop");
     return true;
 } // stop
@@ -712,6 +779,8 @@ bool NimBLEAdvertising::stop() {
  * @brief Handles the callback when advertising stops.
  */
 void NimBLEAdvertising::advCompleteCB() {
+    NimBLEDevice::whiteListRetry();
+
     if(m_advCompCB != nullptr) {
         m_advCompCB(this);
     }
@@ -734,7 +803,8 @@ bool NimBLEAdvertising::isAdvertising() {
 void NimBLEAdvertising::onHostSync() {
     NIMBLE_LOGD(LOG_TAG, "Host re-synced");
 
-    m_advDataSet = false;
+    // The controller lost the data, the serialized payload is still valid.
+    m_advDataLoaded = false;
     // If we were advertising forever, restart it now
     if(m_duration == 0) {
         start(m_duration, m_advCompCB);
@@ -765,6 +835,19 @@ int NimBLEAdvertising::handleGapEvent(struct ble_gap_event *event, void *arg) {
                 NIMBLE_LOGC(LOG_TAG, "host reset, rc=%d", event->adv_complete.reason);
                 NimBLEDevice::onReset(event->adv_complete.reason);
                 return 0;
+            case BLE_HS_ETIMEOUT:
+                if(pAdv->m_fastPhase) {
+                    // Fast phase over, continue at the configured interval for the rest of the duration
+                    pAdv->m_fastPhase = false;
+                    int32_t duration = BLE_HS_FOREVER;
+                    if(pAdv->m_duration > 0) {
+                        duration = pAdv->m_duration - pAdv->m_fastDuration;
+                    }
+                    if(pAdv->startGap(duration, &pAdv->m_advParams, nullptr) == 0) {
+                        return 0;
+                    }
+                }
+                break;
             default:
                 break;
         }
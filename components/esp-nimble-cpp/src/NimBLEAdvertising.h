@@ -103,6 +103,7 @@ public:
     void setAdvertisementType(uint8_t adv_type);
     void setMaxInterval(uint16_t maxinterval);
     void setMinInterval(uint16_t mininterval);
+    void setFastAdvertising(uint32_t duration, uint16_t minInterval = 32, uint16_t maxInterval = 48);
     void setAdvertisementData(NimBLEAdvertisementData& advertisementData);
     void setScanFilter(bool scanRequestWhitelistOnly, bool connectWhitelistOnly);
     void setScanResponseData(NimBLEAdvertisementData& advertisementData);
@@ -120,15 +121,27 @@ private:
 
     void                    onHostSync();
     static int              handleGapEvent(struct ble_gap_event *event, void *arg);
+    bool                    buildPayload();
+    bool                    loadPayload();
+    int                     startGap(int32_t duration, const ble_gap_adv_params *params,
+                                     const ble_addr_t *peerAddr);
 
     ble_hs_adv_fields       m_advData;
-    ble_hs_adv_fields       m_scanData;
     ble_gap_adv_params      m_advParams;
     std::vector<NimBLEUUID> m_serviceUUIDs;
     bool                    m_customAdvData;
     bool                    m_customScanResponseData;
     bool                    m_scanResp;
-    bool                    m_advDataSet;
+    bool                    m_advDataSet;     // m_advPayload/m_scanPayload match the configuration
+    bool                    m_advDataLoaded;  // The controller holds m_advPayload/m_scanPayload
+    uint8_t                 m_advPayload[BLE_HS_ADV_MAX_SZ];
+    uint8_t                 m_advPayloadLen;
+    uint8_t                 m_scanPayload[BLE_HS_ADV_MAX_SZ];
+    uint8_t                 m_scanPayloadLen;
+    uint32_t                m_fastDuration;
+    uint16_t                m_fastItvlMin;
+    uint16_t                m_fastItvlMax;
+    bool                    m_fastPhase;      // Advertising fast, restart at m_advParams intervals on timeout
     void                    (*m_advCompCB)(NimBLEAdvertising *pAdv);
     uint8_t                 m_slaveItvl[4];
     uint32_t                m_duration;
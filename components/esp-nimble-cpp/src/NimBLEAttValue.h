@@ -41,6 +41,14 @@
 #    error CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH cannot be less than 1; Range = 1 : 512
 #endif
 
+#if !defined(CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH)
+#    define CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH 10
+#elif CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH > 64
+#    error CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH cannot be larger than 64; Range = 0 : 64
+#elif CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH < 0
+#    error CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH cannot be less than 0; Range = 0 : 64
+#endif
+
 
 /* Used to determine if the type passed to a template has a c_str() and length() method. */
 template <typename T, typename = void, typename = void>
@@ -55,23 +63,41 @@ struct Has_c_str_len<T, decltype(void(std::declval<T &>().c_str())),
  * @brief A specialized container class to hold BLE attribute values.
  * @details This class is designed to be more memory efficient than using\n
  * standard container types for value storage, while being convertible to\n
- * many different container classes.
+ * many different container classes.\n
+ * Values up to CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH bytes are stored inside the\n
+ * object, larger values are moved to the heap when they are first set.
  */
 class NimBLEAttValue
 {
-    uint8_t*     m_attr_value = nullptr;
+    static constexpr uint16_t INLINE_LEN = CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH;
+    static constexpr uint8_t  FLAG_SINGLE_WRITER = 0x01;
+
+    // Heap storage while m_capacity > INLINE_LEN, otherwise the value itself (plus terminator)
+    union {
+        uint8_t*     m_heap;
+        uint8_t      m_inline[INLINE_LEN + 1];
+    };
+    uint8_t      m_flags = 0;
     uint16_t     m_attr_max_len = 0;
     uint16_t     m_attr_len = 0;
-    uint16_t     m_capacity = 0;
+    uint16_t     m_capacity = INLINE_LEN;
+    uint16_t     m_seq = 0; // Odd while a single writer update is in progress
 #if CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
     time_t       m_timestamp = 0;
 #endif
     void         deepCopy(const NimBLEAttValue & source);
+    void         takeFrom(NimBLEAttValue & source);
+    uint8_t*     reserve(uint16_t len, uint16_t & cap);
+    void         setBuffer(uint8_t* res, uint16_t cap);
+    bool         isInline()     const   { return m_capacity <= INLINE_LEN; }
+    uint8_t*     buf()                  { return isInline() ? m_inline : m_heap; }
+    const uint8_t* buf()        const   { return isInline() ? m_inline : m_heap; }
 
 public:
     /**
      * @brief Default constructor.
-     * @param[in] init_len The initial size in bytes.
+     * @param[in] init_len The size in bytes of the first heap allocation, made when a value\n
+     * larger than the inline storage is set.
      * @param[in] max_len The max size in bytes that the value can be.
      */
     NimBLEAttValue(uint16_t init_len = CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH,
@@ -130,10 +156,10 @@ public:
 #endif
 
     /** @brief Copy constructor */
-    NimBLEAttValue(const NimBLEAttValue & source) { deepCopy(source); }
+    NimBLEAttValue(const NimBLEAttValue & source) { m_inline[0] = '\0'; deepCopy(source); }
 
-    /** @brief Move constructor */
-    NimBLEAttValue(NimBLEAttValue && source) { *this = std::move(source); }
+    /** @brief Move constructor, takes over the heap buffer of the source */
+    NimBLEAttValue(NimBLEAttValue && source) { takeFrom(source); }
 
     /** @brief Destructor */
     ~NimBLEAttValue();
@@ -151,16 +177,16 @@ public:
     uint16_t        size()         const   { return m_attr_len; }
 
     /** @brief Returns a pointer to the internal buffer of the value */
-    const uint8_t*  data()         const   { return m_attr_value; }
+    const uint8_t*  data()         const   { return buf(); }
 
     /** @brief Returns a pointer to the internal buffer of the value as a const char* */
-    const char*     c_str()        const   { return (const char*)m_attr_value; }
+    const char*     c_str()        const   { return (const char*)buf(); }
 
     /** @brief Iterator begin */
-    const uint8_t*  begin()        const   { return m_attr_value; }
+    const uint8_t*  begin()        const   { return buf(); }
 
     /** @brief Iterator end */
-    const uint8_t*  end()          const   { return m_attr_value + m_attr_len; }
+    const uint8_t*  end()          const   { return buf() + m_attr_len; }
 
 #if CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
     /** @brief Returns a timestamp of when the value was last updated */
@@ -210,6 +236,29 @@ public:
      */
     NimBLEAttValue& append(const uint8_t *value, uint16_t len);
 
+    /**
+     * @brief Switch setValue() to a lock-free path for values updated by a single task.
+     * @details Updates no longer enter a critical section, instead they bump a sequence\n
+     * counter that read() uses to retry a copy that raced an update. Only values that fit\n
+     * the inline storage qualify, so the buffer can never move under a reader; setValue()\n
+     * with a longer value fails and append() is not allowed while enabled.
+     * @param[in] enable True to enable, false to go back to the locked path.
+     * @returns True if successful, false if the current value does not fit inline.
+     */
+    bool            setSingleWriter(bool enable);
+
+    /** @brief Returns true if the lock-free single writer path is enabled */
+    bool            isSingleWriter() const { return m_flags & FLAG_SINGLE_WRITER; }
+
+    /**
+     * @brief Copy a consistent snapshot of the value.
+     * @details Safe against a concurrent setValue() from another task in either mode.
+     * @param[out] out The buffer to copy to.
+     * @param[in] len The size of the buffer in bytes.
+     * @returns The number of bytes copied, at most len.
+     */
+    uint16_t        read(uint8_t *out, uint16_t len) const;
+
 
     /*********************** Template Functions ************************/
 
@@ -266,18 +315,18 @@ public:
 
     /** @brief Subscript operator */
     uint8_t operator [](int pos) const {
-        assert(pos < m_attr_len && "out of range"); return m_attr_value[pos]; }
+        assert(pos < m_attr_len && "out of range"); return buf()[pos]; }
 
     /** @brief Operator; Get the value as a std::vector<uint8_t>. */
     operator std::vector<uint8_t>() const {
-        return std::vector<uint8_t>(m_attr_value, m_attr_value + m_attr_len); }
+        return std::vector<uint8_t>(begin(), end()); }
 
     /** @brief Operator; Get the value as a std::string. */
     operator std::string() const {
-        return std::string((char*)m_attr_value, m_attr_len); }
+        return std::string(c_str(), m_attr_len); }
 
     /** @brief Operator; Get the value as a const uint8_t*. */
-    operator const uint8_t*() const { return m_attr_value; }
+    operator const uint8_t*() const { return buf(); }
 
     /** @brief Operator; Append another NimBLEAttValue. */
     NimBLEAttValue& operator  +=(const NimBLEAttValue & source) {
@@ -296,51 +345,50 @@ public:
     /** @brief Equality operator */
     bool operator  ==(const NimBLEAttValue & source) {
         return (m_attr_len == source.size()) ?
-                memcmp(m_attr_value, source.data(), m_attr_len) == 0 : false; }
+                memcmp(buf(), source.data(), m_attr_len) == 0 : false; }
 
     /** @brief Inequality operator */
     bool operator  !=(const NimBLEAttValue & source){ return !(*this == source); }
 
 #ifdef NIMBLE_CPP_ARDUINO_STRING_AVAILABLE
     /** @brief Operator; Get the value as an Arduino String value. */
-    operator String() const { return String((char*)m_attr_value); }
+    operator String() const { return String(c_str()); }
 #endif
 
 };
 
 
 inline NimBLEAttValue::NimBLEAttValue(uint16_t init_len, uint16_t max_len) {
-    m_attr_value   = (uint8_t*)calloc(init_len + 1, 1);
-    assert(m_attr_value && "No Mem");
+    // init_len is only a hint now, nothing is allocated until a value outgrows the inline storage
+    (void)init_len;
+    m_inline[0]    = '\0';
     m_attr_max_len = std::min(BLE_ATT_ATTR_MAX_LEN, (int)max_len);
-    m_attr_len     = 0;
-    m_capacity     = init_len;
     setTimeStamp(0);
 }
 
 inline NimBLEAttValue::NimBLEAttValue(const uint8_t *value, uint16_t len, uint16_t max_len)
 : NimBLEAttValue(len, max_len) {
-    memcpy(m_attr_value, value, len);
-    m_attr_value[len] = '\0';
-    m_attr_len        = len;
+    uint16_t cap;
+    uint8_t* res = reserve(len, cap);
+    assert(res && "No Mem");
+    setBuffer(res, cap);
+    memcpy(res, value, len);
+    res[len]   = '\0';
+    m_attr_len = len;
 }
 
 inline NimBLEAttValue::~NimBLEAttValue() {
-    if(m_attr_value != nullptr) {
-        free(m_attr_value);
+    if(!isInline()) {
+        free(m_heap);
     }
 }
 
 inline NimBLEAttValue& NimBLEAttValue::operator =(NimBLEAttValue && source) {
     if (this != &source){
-        free(m_attr_value);
-
-        m_attr_value   = source.m_attr_value;
-        m_attr_max_len = source.m_attr_max_len;
-        m_attr_len     = source.m_attr_len;
-        m_capacity     = source.m_capacity;
-        setTimeStamp(source.getTimeStamp());
-        source.m_attr_value = nullptr;
+        if(!isInline()) {
+            free(m_heap);
+        }
+        takeFrom(source);
     }
     return *this;
 }
@@ -352,20 +400,86 @@ inline NimBLEAttValue& NimBLEAttValue::operator =(const NimBLEAttValue & source)
     return *this;
 }
 
+/* Steals the heap buffer of the source (or copies its inline value) and leaves it empty. */
+inline void NimBLEAttValue::takeFrom(NimBLEAttValue & source) {
+    if(source.isInline()) {
+        memcpy(m_inline, source.m_inline, source.m_attr_len + 1);
+    } else {
+        m_heap = source.m_heap;
+    }
+
+    m_flags        = source.m_flags;
+    m_attr_max_len = source.m_attr_max_len;
+    m_attr_len     = source.m_attr_len;
+    m_capacity     = source.m_capacity;
+    m_seq          = 0;
+    setTimeStamp(source.getTimeStamp());
+
+    source.m_inline[0]  = '\0';
+    source.m_capacity   = INLINE_LEN;
+    source.m_attr_len   = 0;
+    source.m_flags      = 0;
+}
+
 inline void NimBLEAttValue::deepCopy(const NimBLEAttValue & source) {
-    uint8_t* res = (uint8_t*)realloc( m_attr_value, source.m_capacity + 1);
-    assert(res && "deepCopy: realloc failed");
+    if(source.isSingleWriter()) {
+        // The source may be updated while we copy, take a consistent snapshot instead
+        uint8_t tmp[INLINE_LEN + 1];
+        uint16_t len = source.read(tmp, INLINE_LEN);
+        m_attr_max_len = source.m_attr_max_len;
+        m_flags        = 0;
+        setValue(tmp, len);
+        return;
+    }
+
+    uint16_t cap;
+    uint8_t* res = reserve(source.m_attr_len, cap);
+    assert(res && "deepCopy: alloc failed");
 
     ble_npl_hw_enter_critical();
-    m_attr_value   = res;
+    setBuffer(res, cap);
+    m_flags        = 0;
     m_attr_max_len = source.m_attr_max_len;
     m_attr_len     = source.m_attr_len;
-    m_capacity     = source.m_capacity;
     setTimeStamp(source.getTimeStamp());
-    memcpy(m_attr_value, source.m_attr_value, m_attr_len + 1);
+    memcpy(res, source.buf(), m_attr_len + 1);
     ble_npl_hw_exit_critical(0);
 }
 
+/*
+ * Returns a buffer with room for len bytes and a terminator, holding the current value, and
+ * its usable size in cap. This is the current buffer if it is large enough, otherwise a new
+ * heap buffer that the caller installs with setBuffer(). The first heap buffer gets at least
+ * CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH bytes so small appends do not reallocate.
+ */
+inline uint8_t* NimBLEAttValue::reserve(uint16_t len, uint16_t & cap) {
+    if (len <= m_capacity) {
+        cap = m_capacity;
+        return buf();
+    }
+
+    if (isInline()) {
+        cap = std::max(len, (uint16_t)std::min((int)m_attr_max_len,
+                                               CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH));
+        uint8_t* res = (uint8_t*)malloc(cap + 1);
+        if (res != nullptr) {
+            memcpy(res, m_inline, m_attr_len + 1);
+        }
+        return res;
+    }
+
+    cap = len;
+    return (uint8_t*)realloc(m_heap, len + 1);
+}
+
+/* Installs a buffer returned by reserve(), must be called in a critical section. */
+inline void NimBLEAttValue::setBuffer(uint8_t* res, uint16_t cap) {
+    if (res != m_inline) {
+        m_heap     = res;
+        m_capacity = cap;
+    }
+}
+
 inline const uint8_t*  NimBLEAttValue::getValue(time_t *timestamp) {
     if(timestamp != nullptr) {
 #if CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
@@ -374,7 +488,7 @@ inline const uint8_t*  NimBLEAttValue::getValue(time_t *timestamp) {
         *timestamp = 0;
 #endif
     }
-    return m_attr_value;
+    return buf();
 }
 
 inline bool NimBLEAttValue::setValue(const uint8_t *value, uint16_t len) {
@@ -384,23 +498,38 @@ inline bool NimBLEAttValue::setValue(const uint8_t *value, uint16_t len) {
         return false;
     }
 
-    uint8_t *res = m_attr_value;
-    if (len > m_capacity) {
-        res = (uint8_t*)realloc(m_attr_value, (len + 1));
-        m_capacity = len;
-    }
-    assert(res && "setValue: realloc failed");
-
 #if CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
     time_t t = time(nullptr);
 #else
     time_t t = 0;
 #endif
 
+    if (isSingleWriter()) {
+        if (len > INLINE_LEN) {
+            NIMBLE_LOGE("NimBLEAttValue", "single writer value exceeds inline size, len=%u, max=%u",
+                         len, INLINE_LEN);
+            return false;
+        }
+
+        uint16_t seq = m_seq;
+        __atomic_store_n(&m_seq, (uint16_t)(seq + 1), __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(m_inline, value, len);
+        m_inline[len] = '\0';
+        m_attr_len = len;
+        setTimeStamp(t);
+        __atomic_store_n(&m_seq, (uint16_t)(seq + 2), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    uint16_t cap;
+    uint8_t *res = reserve(len, cap);
+    assert(res && "setValue: realloc failed");
+
     ble_npl_hw_enter_critical();
-    m_attr_value = res;
-    memcpy(m_attr_value, value, len);
-    m_attr_value[len] = '\0';
+    setBuffer(res, cap);
+    memcpy(res, value, len);
+    res[len] = '\0';
     m_attr_len = len;
     setTimeStamp(t);
     ble_npl_hw_exit_critical(0);
@@ -412,18 +541,20 @@ inline NimBLEAttValue& NimBLEAttValue::append(const uint8_t *value, uint16_t len
         return *this;
     }
 
+    if (isSingleWriter()) {
+        NIMBLE_LOGE("NimBLEAttValue", "append not allowed on a single writer value");
+        return *this;
+    }
+
     if ((m_attr_len + len) > m_attr_max_len) {
         NIMBLE_LOGE("NimBLEAttValue", "val > max, len=%u, max=%u",
                     len, m_attr_max_len);
         return *this;
     }
 
-    uint8_t* res = m_attr_value;
     uint16_t new_len = m_attr_len + len;
-    if (new_len > m_capacity) {
-        res = (uint8_t*)realloc(m_attr_value, (new_len + 1));
-        m_capacity = new_len;
-    }
+    uint16_t cap;
+    uint8_t* res = reserve(new_len, cap);
     assert(res && "append: realloc failed");
 
 #if CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
@@ -433,15 +564,62 @@ inline NimBLEAttValue& NimBLEAttValue::append(const uint8_t *value, uint16_t len
 #endif
 
     ble_npl_hw_enter_critical();
-    m_attr_value = res;
-    memcpy(m_attr_value + m_attr_len, value, len);
+    setBuffer(res, cap);
+    memcpy(res + m_attr_len, value, len);
     m_attr_len = new_len;
-    m_attr_value[m_attr_len] = '\0';
+    res[m_attr_len] = '\0';
     setTimeStamp(t);
     ble_npl_hw_exit_critical(0);
 
     return *this;
 }
 
+inline bool NimBLEAttValue::setSingleWriter(bool enable) {
+    if (!enable) {
+        m_flags &= ~FLAG_SINGLE_WRITER;
+        return true;
+    }
+
+    if (m_attr_len > INLINE_LEN) {
+        NIMBLE_LOGE("NimBLEAttValue", "value too long for single writer, len=%u, max=%u",
+                    m_attr_len, INLINE_LEN);
+        return false;
+    }
+
+    // Bring a short value back inline so the buffer never moves again
+    ble_npl_hw_enter_critical();
+    if (!isInline()) {
+        uint8_t* heap = m_heap;
+        memcpy(m_inline, heap, m_attr_len + 1);
+        m_capacity = INLINE_LEN;
+        ble_npl_hw_exit_critical(0);
+        free(heap);
+        ble_npl_hw_enter_critical();
+    }
+    m_flags |= FLAG_SINGLE_WRITER;
+    ble_npl_hw_exit_critical(0);
+    return true;
+}
+
+inline uint16_t NimBLEAttValue::read(uint8_t *out, uint16_t len) const {
+    if (!isSingleWriter()) {
+        ble_npl_hw_enter_critical();
+        len = std::min(len, m_attr_len);
+        memcpy(out, buf(), len);
+        ble_npl_hw_exit_critical(0);
+        return len;
+    }
+
+    uint16_t seq, copied;
+    do {
+        seq = __atomic_load_n(&m_seq, __ATOMIC_ACQUIRE);
+        copied = std::min(len, (uint16_t)std::min(m_attr_len, INLINE_LEN));
+        memcpy(out, m_inline, copied);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&m_seq, __ATOMIC_RELAXED) != seq);
+
+    return copied;
+}
+
 #endif /*(CONFIG_BT_ENABLED) */
 #endif /* MAIN_NIMBLEATTVALUE_H_ */
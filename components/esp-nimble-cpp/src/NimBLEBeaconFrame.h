@@ -0,0 +1,362 @@
+/*
+ * NimBLEBeaconFrame.h
+ *
+ *  Fixed layout iBeacon and Eddystone frames, encoded into and decoded from caller buffers.
+ */
+
+#ifndef MAIN_NIMBLEBEACONFRAME_H_
+#define MAIN_NIMBLEBEACONFRAME_H_
+
+#include "NimBLEUUID.h"
+
+#include <string_view>
+
+/**
+ * @brief An iBeacon frame, the manufacturer data of an iBeacon advertisement.
+ * @details Same bytes as NimBLEBeacon::getData(): company ID (little endian), type 0x02,
+ * length 0x15, proximity UUID, major and minor (big endian) and the measured power at 1 m.
+ * The fields hold host values, encode() and decode() do the byte order. All methods are
+ * constexpr and never allocate, e.g. a scanner reads a frame from the payload with
+ * NimBLEAdvertisedDevice::getBeaconFrame().
+ */
+struct NimBLEBeaconFrame {
+    static constexpr size_t   SIZE             = 25;
+    static constexpr uint16_t APPLE_COMPANY_ID = 0x004C;
+
+    uint16_t manufacturerId    = APPLE_COMPANY_ID;
+    uint8_t  proximityUUID[16] = {}; /**< Most significant byte first, as advertised. */
+    uint16_t major             = 0;
+    uint16_t minor             = 0;
+    int8_t   signalPower       = 0;  /**< Measured power at 1 m, in dBm. */
+
+    /**
+     * @brief Get the proximity UUID.
+     */
+    constexpr NimBLEUUID getProximityUUID() const {
+        uint64_t low = 0;
+        for (int i = 8; i < 16; i++) {
+            low = (low << 8) | proximityUUID[i];
+        }
+        return NimBLEUUID(uint32_t(proximityUUID[0]) << 24 | proximityUUID[1] << 16 | proximityUUID[2] << 8 | proximityUUID[3],
+                          uint16_t(proximityUUID[4] << 8 | proximityUUID[5]),
+                          uint16_t(proximityUUID[6] << 8 | proximityUUID[7]), low);
+    } // getProximityUUID
+
+    /**
+     * @brief Write the frame.
+     * @param [out] out The buffer to write to.
+     * @param [in] len The size of the buffer.
+     * @return The length of the frame, 0 if the buffer is smaller than SIZE.
+     */
+    constexpr size_t encode(uint8_t *out, size_t len) const {
+        if (len < SIZE) {
+            return 0;
+        }
+        out[0] = manufacturerId;
+        out[1] = manufacturerId >> 8;
+        out[2] = 0x02;
+        out[3] = 0x15;
+        for (int i = 0; i < 16; i++) {
+            out[4 + i] = proximityUUID[i];
+        }
+        out[20] = major >> 8;
+        out[21] = major;
+        out[22] = minor >> 8;
+        out[23] = minor;
+        out[24] = signalPower;
+        return SIZE;
+    } // encode
+
+    /**
+     * @brief Read a frame.
+     * @param [in] data The manufacturer data.
+     * @param [in] len The length of the data.
+     * @param [out] frame The frame to fill, unchanged if the data is not an iBeacon frame.
+     * @return True if the data is an iBeacon frame, of any company ID.
+     */
+    static constexpr bool decode(const uint8_t *data, size_t len, NimBLEBeaconFrame *frame) {
+        if (len != SIZE || data[2] != 0x02 || data[3] != 0x15) {
+            return false;
+        }
+        frame->manufacturerId = data[0] | data[1] << 8;
+        for (int i = 0; i < 16; i++) {
+            frame->proximityUUID[i] = data[4 + i];
+        }
+        frame->major       = data[20] << 8 | data[21];
+        frame->minor       = data[22] << 8 | data[23];
+        frame->signalPower = data[24];
+        return true;
+    } // decode
+}; // NimBLEBeaconFrame
+
+static_assert([] {
+    NimBLEBeaconFrame in{};
+    in.manufacturerId = 0x1234;
+    for (int i = 0; i < 16; i++) {
+        in.proximityUUID[i] = 0xF0 + i;
+    }
+    in.major       = 0xA1B2;
+    in.minor       = 0x0304;
+    in.signalPower = -59;
+    uint8_t buf[NimBLEBeaconFrame::SIZE] = {};
+    NimBLEBeaconFrame out{};
+    return in.encode(buf, sizeof(buf)) == NimBLEBeaconFrame::SIZE && buf[0] == 0x34 && buf[1] == 0x12 &&
+           buf[4] == 0xF0 && buf[20] == 0xA1 && buf[24] == 0xC5 && NimBLEBeaconFrame::decode(buf, sizeof(buf), &out) &&
+           out.manufacturerId == in.manufacturerId && out.proximityUUID[15] == 0xFF && out.major == in.major &&
+           out.minor == in.minor && out.signalPower == in.signalPower &&
+           in.encode(buf, NimBLEBeaconFrame::SIZE - 1) == 0 && !NimBLEBeaconFrame::decode(buf, sizeof(buf) - 1, &out);
+}(), "NimBLEBeaconFrame does not round trip");
+
+
+/**
+ * @brief An unencrypted Eddystone TLM frame, the service data of UUID 0xFEAA.
+ * @details Same bytes as NimBLEEddystoneTLM::getData(), from the frame type on. The fields hold
+ * host values, encode() and decode() do the (big endian) byte order.
+ */
+struct NimBLEEddystoneTLMFrame {
+    static constexpr size_t   SIZE         = 14;
+    static constexpr uint8_t  FRAME_TYPE   = 0x20;
+    static constexpr uint16_t SERVICE_UUID = 0xFEAA;
+
+    uint8_t  version     = 0;
+    uint16_t volt        = 0; /**< Battery voltage in mV, 0 if not supported. */
+    int16_t  temp        = 0; /**< Temperature in 8.8 fixed point degrees Celsius, -128.0 if not supported. */
+    uint32_t advCount    = 0; /**< Advertisements sent since power up. */
+    uint32_t uptime      = 0; /**< Time since power up in 0.1 s. */
+
+    /**
+     * @brief Get the temperature in degrees Celsius.
+     */
+    constexpr float getTemp() const {
+        return temp / 256.0f;
+    } // getTemp
+
+    /**
+     * @brief Write the frame.
+     * @param [out] out The buffer to write to.
+     * @param [in] len The size of the buffer.
+     * @return The length of the frame, 0 if the buffer is smaller than SIZE.
+     */
+    constexpr size_t encode(uint8_t *out, size_t len) const {
+        if (len < SIZE) {
+            return 0;
+        }
+        out[0]  = FRAME_TYPE;
+        out[1]  = version;
+        out[2]  = volt >> 8;
+        out[3]  = volt;
+        out[4]  = uint16_t(temp) >> 8;
+        out[5]  = uint16_t(temp);
+        for (int i = 0; i < 4; i++) {
+            out[6 + i]  = advCount >> (24 - 8 * i);
+            out[10 + i] = uptime >> (24 - 8 * i);
+        }
+        return SIZE;
+    } // encode
+
+    /**
+     * @brief Read a frame.
+     * @param [in] data The service data, after the UUID.
+     * @param [in] len The length of the data.
+     * @param [out] frame The frame to fill, unchanged if the data is not an unencrypted TLM frame.
+     * @return True if the data is an unencrypted (version 0) TLM frame.
+     */
+    static constexpr bool decode(const uint8_t *data, size_t len, NimBLEEddystoneTLMFrame *frame) {
+        if (len < SIZE || data[0] != FRAME_TYPE || data[1] != 0) {
+            return false;
+        }
+        frame->version  = data[1];
+        frame->volt     = data[2] << 8 | data[3];
+        frame->temp     = int16_t(data[4] << 8 | data[5]);
+        frame->advCount = 0;
+        frame->uptime   = 0;
+        for (int i = 0; i < 4; i++) {
+            frame->advCount = frame->advCount << 8 | data[6 + i];
+            frame->uptime   = frame->uptime << 8 | data[10 + i];
+        }
+        return true;
+    } // decode
+}; // NimBLEEddystoneTLMFrame
+
+static_assert([] {
+    NimBLEEddystoneTLMFrame in{};
+    in.volt     = 3300;
+    in.temp     = -0x1280; // -18.5 C
+    in.advCount = 0x01020304;
+    in.uptime   = 0xA0B0C0D0;
+    uint8_t buf[NimBLEEddystoneTLMFrame::SIZE] = {};
+    NimBLEEddystoneTLMFrame out{};
+    bool ok = in.encode(buf, sizeof(buf)) == NimBLEEddystoneTLMFrame::SIZE && buf[0] == 0x20 && buf[4] == 0xED &&
+              buf[6] == 0x01 && buf[13] == 0xD0 && NimBLEEddystoneTLMFrame::decode(buf, sizeof(buf), &out) &&
+              out.volt == in.volt && out.temp == in.temp && out.getTemp() == -18.5f &&
+              out.advCount == in.advCount && out.uptime == in.uptime;
+    buf[1] = 1; // Encrypted
+    return ok && !NimBLEEddystoneTLMFrame::decode(buf, sizeof(buf), &out);
+}(), "NimBLEEddystoneTLMFrame does not round trip");
+
+
+/**
+ * @brief An Eddystone URL frame, the service data of UUID 0xFEAA.
+ * @details Same bytes as NimBLEEddystoneURL::getData(): frame type, TX power at 0 m, the URL
+ * scheme prefix code and up to 17 bytes of URL with the expansion codes of the specification.
+ * setURL() compresses a URL into the frame, formatURL() writes it back out to a caller buffer.
+ */
+struct NimBLEEddystoneURLFrame {
+    static constexpr size_t   HEADER_SIZE  = 3;
+    static constexpr size_t   URL_MAX      = 17;
+    static constexpr size_t   MAX_SIZE     = HEADER_SIZE + URL_MAX;
+    static constexpr uint8_t  FRAME_TYPE   = 0x10;
+    static constexpr uint16_t SERVICE_UUID = 0xFEAA;
+
+    int8_t   txPower      = 0; /**< TX power at 0 m, in dBm. */
+    uint8_t  scheme       = 0; /**< URL scheme prefix code, 0-3. */
+    uint8_t  url[URL_MAX] = {};
+    uint8_t  urlLength    = 0;
+
+    /**
+     * @brief Set the URL, compressed with the scheme and expansion codes.
+     * @param [in] fullUrl The URL, starting with one of the four schemes.
+     * @return False if the URL has no known scheme or does not fit, the frame is unchanged then.
+     */
+    constexpr bool setURL(std::string_view fullUrl) {
+        uint8_t code = 0;
+        while (code < 4 && fullUrl.substr(0, schemePrefix(code).size()) != schemePrefix(code)) {
+            code++;
+        }
+        if (code == 4) {
+            return false;
+        }
+        fullUrl.remove_prefix(schemePrefix(code).size());
+
+        uint8_t encoded[URL_MAX] = {};
+        size_t  length           = 0;
+        while (!fullUrl.empty()) {
+            if (length == URL_MAX) {
+                return false;
+            }
+            uint8_t expansion = 0;
+            while (expansion < 14 && fullUrl.substr(0, expansionText(expansion).size()) != expansionText(expansion)) {
+                expansion++;
+            }
+            if (expansion < 14) {
+                encoded[length++] = expansion;
+                fullUrl.remove_prefix(expansionText(expansion).size());
+            } else {
+                encoded[length++] = fullUrl[0];
+                fullUrl.remove_prefix(1);
+            }
+        }
+
+        scheme    = code;
+        urlLength = length;
+        for (size_t i = 0; i < URL_MAX; i++) {
+            url[i] = encoded[i];
+        }
+        return true;
+    } // setURL
+
+    /**
+     * @brief Write the full URL, expanding the scheme and expansion codes.
+     * @param [out] out The buffer to write the URL and a terminator to.
+     * @param [in] len The size of the buffer.
+     * @return The length of the URL, which was truncated if it is len or more.
+     */
+    constexpr size_t formatURL(char *out, size_t len) const {
+        size_t n = 0;
+        auto put = [&](char c) {
+            if (n + 1 < len) {
+                out[n] = c;
+            }
+            n++;
+        };
+        auto append = [&](std::string_view text) {
+            for (char c : text) {
+                put(c);
+            }
+        };
+
+        append(schemePrefix(scheme));
+        for (uint8_t i = 0; i < urlLength; i++) {
+            if (url[i] < 14) {
+                append(expansionText(url[i]));
+            } else if (url[i] > 0x20 && url[i] < 0x7F) {
+                put(url[i]);
+            }
+        }
+        if (len > 0) {
+            out[n < len ? n : len - 1] = '\0';
+        }
+        return n;
+    } // formatURL
+
+    /**
+     * @brief Write the frame.
+     * @param [out] out The buffer to write to.
+     * @param [in] len The size of the buffer.
+     * @return The length of the frame, 0 if the buffer is too small.
+     */
+    constexpr size_t encode(uint8_t *out, size_t len) const {
+        if (len < HEADER_SIZE + urlLength) {
+            return 0;
+        }
+        out[0] = FRAME_TYPE;
+        out[1] = txPower;
+        out[2] = scheme;
+        for (uint8_t i = 0; i < urlLength; i++) {
+            out[HEADER_SIZE + i] = url[i];
+        }
+        return HEADER_SIZE + urlLength;
+    } // encode
+
+    /**
+     * @brief Read a frame.
+     * @param [in] data The service data, after the UUID.
+     * @param [in] len The length of the data.
+     * @param [out] frame The frame to fill, unchanged if the data is not a URL frame.
+     * @return True if the data is a URL frame.
+     */
+    static constexpr bool decode(const uint8_t *data, size_t len, NimBLEEddystoneURLFrame *frame) {
+        if (len < HEADER_SIZE || len > MAX_SIZE || data[0] != FRAME_TYPE || data[2] > 3) {
+            return false;
+        }
+        frame->txPower   = data[1];
+        frame->scheme    = data[2];
+        frame->urlLength = len - HEADER_SIZE;
+        for (size_t i = 0; i < URL_MAX; i++) {
+            frame->url[i] = i < frame->urlLength ? data[HEADER_SIZE + i] : 0;
+        }
+        return true;
+    } // decode
+
+private:
+    static constexpr std::string_view schemePrefix(uint8_t code) {
+        constexpr std::string_view prefixes[] = {"http://www.", "https://www.", "http://", "https://"};
+        return code < 4 ? prefixes[code] : std::string_view();
+    } // schemePrefix
+
+    static constexpr std::string_view expansionText(uint8_t code) {
+        constexpr std::string_view expansions[] = {".com/", ".org/", ".edu/", ".net/", ".info/", ".biz/", ".gov/",
+                                                   ".com",  ".org",  ".edu",  ".net",  ".info",  ".biz",  ".gov"};
+        return expansions[code];
+    } // expansionText
+}; // NimBLEEddystoneURLFrame
+
+static_assert([] {
+    NimBLEEddystoneURLFrame in{};
+    in.txPower = -20;
+    uint8_t buf[NimBLEEddystoneURLFrame::MAX_SIZE] = {};
+    NimBLEEddystoneURLFrame out{};
+    char text[32] = {};
+    // "example" and the ".com/" expansion code after the "https://www." scheme code
+    bool ok = in.setURL("https://www.example.com/") && in.scheme == 1 && in.urlLength == 8 && in.url[7] == 0 &&
+              in.encode(buf, sizeof(buf)) == NimBLEEddystoneURLFrame::HEADER_SIZE + 8 &&
+              NimBLEEddystoneURLFrame::decode(buf, NimBLEEddystoneURLFrame::HEADER_SIZE + 8, &out) &&
+              out.txPower == -20 && out.urlLength == 8 && out.formatURL(text, sizeof(text)) == 24 &&
+              std::string_view(text) == "https://www.example.com/";
+    // 17 bytes after the scheme fit, 18 do not and leave the frame as it was
+    return ok && in.setURL("http://abcdefghijklmnopq") && in.urlLength == 17 &&
+           !in.setURL("http://abcdefghijklmnopqr") && in.urlLength == 17 && !in.setURL("ftp://example.com") &&
+           out.formatURL(text, 8) == 24 && std::string_view(text) == "https:/";
+}(), "NimBLEEddystoneURLFrame does not round trip");
+
+#endif /* MAIN_NIMBLEBEACONFRAME_H_ */
@@ -0,0 +1,854 @@
+/*
+ * NimBLEBondStore.cpp
+ *
+ *  Bonds held in RAM, written to NVS in batches from the host task.
+ */
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_ENABLED) && defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+
+#include "NimBLEBondStore.h"
+#include "NimBLELog.h"
+
+#if defined(CONFIG_NIMBLE_CPP_IDF)
+#  include "host/ble_hs.h"
+#  include "nimble/nimble_port.h"
+#else
+#  include "nimble/nimble/host/include/host/ble_hs.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char* LOG_TAG = "NimBLEBondStore";
+
+// Not "nimble_bond", the default NimBLE NVS store writes its own records there
+static const char*       STORE_NAMESPACE = "nimcpp_bond";
+static constexpr uint8_t STORE_VERSION   = 1;
+static constexpr int     BOND_MAX        = MYNEWT_VAL(BLE_STORE_MAX_BONDS);
+static constexpr int     CCCD_MAX        = MYNEWT_VAL(BLE_STORE_MAX_CCCDS);
+
+static_assert(BOND_MAX <= 32, "Pending bond writes are tracked in a 32 bit mask");
+
+namespace {
+enum : uint8_t {
+    HAS_OUR  = 0x01,
+    HAS_PEER = 0x02,
+};
+
+/* The keys of one peer, stored as is in NVS under "bond<slot>"; a free slot has no flags. */
+struct Bond {
+    ble_addr_t          addr;
+    uint8_t             flags;
+    ble_store_value_sec our;
+    ble_store_value_sec peer;
+};
+} // namespace
+
+static const ble_addr_t ADDR_ANY = {};
+
+// Guards the tables below, the host calls the store callbacks with its own lock held
+static portMUX_TYPE         s_lock = portMUX_INITIALIZER_UNLOCKED;
+static Bond                 s_bonds[BOND_MAX];
+static uint32_t             s_lastUsed[BOND_MAX];
+static uint32_t             s_clock;
+static ble_store_value_cccd s_cccds[CCCD_MAX];
+static int                  s_cccdCount;
+static ble_addr_t           s_pins[BOND_MAX];
+static int                  s_pinCount;
+static uint32_t             s_dirtyBonds;
+static bool                 s_dirtyCccds;
+static bool                 s_dirtyPins;
+static bool                 s_dirtyLru;
+static bool                 s_flushScheduled;
+
+static bool                 s_started;
+static SemaphoreHandle_t    s_flushMutex;
+static StaticSemaphore_t    s_flushMutexBuf;
+static ble_npl_callout      s_flushTimer;
+static ble_store_read_fn*   s_defaultRead;
+static ble_store_write_fn*  s_defaultWrite;
+static ble_store_delete_fn* s_defaultDelete;
+
+
+static bool isAny(const ble_addr_t &addr) {
+    return ble_addr_cmp(&addr, &ADDR_ANY) == 0;
+} // isAny
+
+
+static ble_addr_t toNative(const NimBLEAddress &address) {
+    ble_addr_t addr;
+    memcpy(addr.val, address.getNative(), 6);
+    addr.type = address.getType();
+    return addr;
+} // toNative
+
+
+/**
+ * @brief Find the slot of a peer, call with s_lock held.
+ * @return The slot or -1 if the peer has no bond.
+ */
+static int findBond(const ble_addr_t &addr) {
+    for(int i = 0; i < BOND_MAX; i++) {
+        if(s_bonds[i].flags != 0 && ble_addr_cmp(&s_bonds[i].addr, &addr) == 0) {
+            return i;
+        }
+    }
+    return -1;
+} // findBond
+
+
+/**
+ * @brief Find the slot matching a security key the way the default store does, call with s_lock held.
+ * @param [in] flag HAS_OUR or HAS_PEER.
+ * @param [in] key The key, BLE_ADDR_ANY matches every peer and idx skips matches.
+ * @return The slot or -1 if none matches.
+ */
+static int findSec(uint8_t flag, const ble_store_key_sec &key) {
+    int skipped = 0;
+    for(int i = 0; i < BOND_MAX; i++) {
+        if(!(s_bonds[i].flags & flag)) {
+            continue;
+        }
+        if(!isAny(key.peer_addr) && ble_addr_cmp(&s_bonds[i].addr, &key.peer_addr) != 0) {
+            continue;
+        }
+        if(key.idx > skipped) {
+            skipped++;
+            continue;
+        }
+        return i;
+    }
+    return -1;
+} // findSec
+
+
+/**
+ * @brief Find the CCCD matching a key the way the default store does, call with s_lock held.
+ * @return The index or -1 if none matches.
+ */
+static int findCccd(const ble_store_key_cccd &key) {
+    int skipped = 0;
+    for(int i = 0; i < s_cccdCount; i++) {
+        if(!isAny(key.peer_addr) && ble_addr_cmp(&s_cccds[i].peer_addr, &key.peer_addr) != 0) {
+            continue;
+        }
+        if(key.chr_val_handle != 0 && s_cccds[i].chr_val_handle != key.chr_val_handle) {
+            continue;
+        }
+        if(key.idx > skipped) {
+            skipped++;
+            continue;
+        }
+        return i;
+    }
+    return -1;
+} // findCccd
+
+
+static int findPin(const ble_addr_t &addr) {
+    for(int i = 0; i < s_pinCount; i++) {
+        if(ble_addr_cmp(&s_pins[i], &addr) == 0) {
+            return i;
+        }
+    }
+    return -1;
+} // findPin
+
+
+/**
+ * @brief Store security keys, call with s_lock held.
+ * @return The slot or -1 if there is no free slot.
+ */
+static int putSec(uint8_t flag, const ble_store_value_sec &sec) {
+    int i = findBond(sec.peer_addr);
+    if(i < 0) {
+        for(i = 0; i < BOND_MAX && s_bonds[i].flags != 0; i++) {
+        }
+        if(i == BOND_MAX) {
+            return -1;
+        }
+        memset(&s_bonds[i], 0, sizeof(s_bonds[i]));
+        s_bonds[i].addr = sec.peer_addr;
+    }
+
+    s_bonds[i].flags |= flag;
+    if(flag == HAS_OUR) {
+        s_bonds[i].our = sec;
+    } else {
+        s_bonds[i].peer = sec;
+    }
+    s_lastUsed[i] = ++s_clock;
+    s_dirtyBonds |= 1u << i;
+    s_dirtyLru = true;
+    return i;
+} // putSec
+
+
+/**
+ * @brief Store a CCCD, call with s_lock held.
+ * @return 0, 1 if it did not change or BLE_HS_ESTORE_CAP if there is no room.
+ */
+static int putCccd(const ble_store_value_cccd &cccd) {
+    ble_store_key_cccd key = {};
+    key.peer_addr = cccd.peer_addr;
+    key.chr_val_handle = cccd.chr_val_handle;
+
+    int i = findCccd(key);
+    if(i < 0) {
+        if(s_cccdCount == CCCD_MAX) {
+            return BLE_HS_ESTORE_CAP;
+        }
+        i = s_cccdCount++;
+    } else if(s_cccds[i].flags == cccd.flags && s_cccds[i].value_changed == cccd.value_changed) {
+        // Written again on every reconnect, that is no reason to touch flash
+        return 1;
+    }
+
+    s_cccds[i] = cccd;
+    s_dirtyCccds = true;
+    return 0;
+} // putCccd
+
+
+/**
+ * @brief Remove the least recently used bond that is neither pinned nor connected.
+ * @param [in] except A peer that must be kept, the one the new record is for.
+ * @param [in] needCccd Only remove a bond that frees a CCCD.
+ * @return True if a bond was removed.
+ */
+static bool evictOldest(const ble_addr_t &except, bool needCccd) {
+    ble_addr_t addrs[BOND_MAX];
+    uint32_t   lastUsed[BOND_MAX];
+    int        count = 0;
+
+    portENTER_CRITICAL(&s_lock);
+    for(int i = 0; i < BOND_MAX; i++) {
+        const ble_addr_t &addr = s_bonds[i].addr;
+        if(s_bonds[i].flags == 0 || ble_addr_cmp(&addr, &except) == 0 || findPin(addr) >= 0) {
+            continue;
+        }
+        if(needCccd) {
+            ble_store_key_cccd key = {};
+            key.peer_addr = addr;
+            if(findCccd(key) < 0) {
+                continue;
+            }
+        }
+        addrs[count] = addr;
+        lastUsed[count] = s_lastUsed[i];
+        count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // Connection lookups take the host lock, they are done outside of the critical section
+    for(;;) {
+        int oldest = -1;
+        for(int i = 0; i < count; i++) {
+            if(oldest < 0 || lastUsed[i] < lastUsed[oldest]) {
+                oldest = i;
+            }
+        }
+        if(oldest < 0) {
+            NIMBLE_LOGW(LOG_TAG, "Bond store full, every bond is pinned or connected");
+            return false;
+        }
+
+        if(ble_gap_conn_find_by_addr(&addrs[oldest], NULL) != 0) {
+            // Also removes the peer from the resolving list
+            int rc = ble_gap_unpair(&addrs[oldest]);
+            if(rc == 0) {
+                char addrStr[18];
+                NIMBLE_LOGI(LOG_TAG, "Removed least recently used bond %s",
+                            NimBLEAddress(addrs[oldest]).formatTo(addrStr));
+                return true;
+            }
+            NIMBLE_LOGE(LOG_TAG, "Could not remove bond; rc=%d", rc);
+        }
+        addrs[oldest] = addrs[--count];
+        lastUsed[oldest] = lastUsed[count];
+    }
+} // evictOldest
+
+
+/**
+ * @brief Read the bonds written by a previous run.
+ * @return False if there are none, or their layout is not this version's.
+ */
+static bool load() {
+    nvs_handle_t handle;
+    if(nvs_open(STORE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+
+    uint8_t version = 0;
+    if(nvs_get_u8(handle, "ver", &version) != ESP_OK || version != STORE_VERSION) {
+        nvs_close(handle);
+        return false;
+    }
+
+    for(int i = 0; i < BOND_MAX; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "bond%d", i);
+        size_t len = sizeof(s_bonds[i]);
+        if(nvs_get_blob(handle, key, &s_bonds[i], &len) != ESP_OK || len != sizeof(s_bonds[i])) {
+            memset(&s_bonds[i], 0, sizeof(s_bonds[i]));
+        }
+    }
+
+    size_t len = sizeof(s_cccds);
+    if(nvs_get_blob(handle, "cccd", s_cccds, &len) == ESP_OK && len % sizeof(s_cccds[0]) == 0) {
+        s_cccdCount = len / sizeof(s_cccds[0]);
+    }
+
+    len = sizeof(s_pins);
+    if(nvs_get_blob(handle, "pins", s_pins, &len) == ESP_OK && len % sizeof(s_pins[0]) == 0) {
+        s_pinCount = len / sizeof(s_pins[0]);
+    }
+
+    len = sizeof(s_lastUsed);
+    if(nvs_get_blob(handle, "lru", s_lastUsed, &len) != ESP_OK || len != sizeof(s_lastUsed)) {
+        memset(s_lastUsed, 0, sizeof(s_lastUsed));
+    }
+    for(int i = 0; i < BOND_MAX; i++) {
+        if(s_lastUsed[i] > s_clock) {
+            s_clock = s_lastUsed[i];
+        }
+    }
+
+    nvs_close(handle);
+    return true;
+} // load
+
+
+/**
+ * @brief Remove the imported bonds and their CCCDs from the default store, once they are in ours.
+ */
+static void eraseDefault() {
+    for(int i = 0; i < BOND_MAX; i++) {
+        if(s_bonds[i].flags == 0) {
+            continue;
+        }
+
+        union ble_store_key key;
+        memset(&key, 0, sizeof(key));
+        key.sec.peer_addr = s_bonds[i].addr;
+        s_defaultDelete(BLE_STORE_OBJ_TYPE_OUR_SEC, &key);
+        s_defaultDelete(BLE_STORE_OBJ_TYPE_PEER_SEC, &key);
+    }
+
+    for(int i = 0; i < s_cccdCount; i++) {
+        union ble_store_key key;
+        memset(&key, 0, sizeof(key));
+        key.cccd.peer_addr = s_cccds[i].peer_addr;
+        key.cccd.chr_val_handle = s_cccds[i].chr_val_handle;
+        s_defaultDelete(BLE_STORE_OBJ_TYPE_CCCD, &key);
+    }
+} // eraseDefault
+
+
+/**
+ * @brief Take over the NimBLE store, loading the bonds from NVS or copying those of the default store.
+ * @details Called by NimBLEDevice::init after the default store is initialized.
+ */
+/* STATIC */
+void NimBLEBondStore::init() {
+    if(s_flushMutex == nullptr) {
+        s_flushMutex = xSemaphoreCreateMutexStatic(&s_flushMutexBuf);
+    }
+    memset(&s_flushTimer, 0, sizeof(s_flushTimer));
+    ble_npl_callout_init(&s_flushTimer, nimble_port_get_dflt_eventq(),
+                         NimBLEBondStore::flushTimerCb, nullptr);
+
+    memset(s_bonds, 0, sizeof(s_bonds));
+    memset(s_lastUsed, 0, sizeof(s_lastUsed));
+    s_clock = 0;
+    s_cccdCount = 0;
+    s_pinCount = 0;
+    s_dirtyBonds = 0;
+    s_dirtyCccds = false;
+    s_dirtyPins = false;
+    s_dirtyLru = false;
+    s_flushScheduled = false;
+
+    s_defaultRead = ble_hs_cfg.store_read_cb;
+    s_defaultWrite = ble_hs_cfg.store_write_cb;
+    s_defaultDelete = ble_hs_cfg.store_delete_cb;
+
+    bool imported = false;
+    if(!load()) {
+        ble_store_iterate(BLE_STORE_OBJ_TYPE_OUR_SEC, NimBLEBondStore::importCb, nullptr);
+        ble_store_iterate(BLE_STORE_OBJ_TYPE_PEER_SEC, NimBLEBondStore::importCb, nullptr);
+        ble_store_iterate(BLE_STORE_OBJ_TYPE_CCCD, NimBLEBondStore::importCb, nullptr);
+        // Written even when empty, so the default store is never copied again
+        s_dirtyBonds = UINT32_MAX >> (32 - BOND_MAX);
+        s_dirtyCccds = true;
+        s_dirtyPins = true;
+        imported = true;
+    }
+
+    ble_hs_cfg.store_read_cb = NimBLEBondStore::readCb;
+    ble_hs_cfg.store_write_cb = NimBLEBondStore::writeCb;
+    ble_hs_cfg.store_delete_cb = NimBLEBondStore::deleteCb;
+    ble_hs_cfg.store_status_cb = NimBLEBondStore::statusCb;
+    ble_hs_cfg.store_status_arg = nullptr;
+    s_started = true;
+
+    NIMBLE_LOGI(LOG_TAG, "%d bonds, %d CCCDs%s", getCount(), s_cccdCount,
+                imported ? " copied from the default store" : "");
+    if(imported) {
+        flush();
+        // Only once the copy is committed, a failed write imports again on the next start
+        portENTER_CRITICAL(&s_lock);
+        bool written = s_dirtyBonds == 0 && !s_dirtyCccds && !s_dirtyPins;
+        portEXIT_CRITICAL(&s_lock);
+        if(written && s_defaultDelete != nullptr) {
+            eraseDefault();
+        }
+    }
+} // init
+
+
+/**
+ * @brief Write the pending changes and stop, called by NimBLEDevice::deinit once the host stopped.
+ */
+/* STATIC */
+void NimBLEBondStore::deinit() {
+    if(!s_started) {
+        return;
+    }
+
+    flush();
+    ble_npl_callout_stop(&s_flushTimer);
+    ble_npl_callout_deinit(&s_flushTimer);
+    s_started = false;
+} // deinit
+
+
+/**
+ * @brief Write the pending changes to NVS now.
+ * @details Call before a deep sleep or a restart that follows a pairing, changes are otherwise
+ * written CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS after they are made.
+ */
+/* STATIC */
+void NimBLEBondStore::flush() {
+    if(!s_started) {
+        return;
+    }
+
+    xSemaphoreTake(s_flushMutex, portMAX_DELAY);
+
+    portENTER_CRITICAL(&s_lock);
+    uint32_t dirtyBonds = s_dirtyBonds;
+    bool     dirtyCccds = s_dirtyCccds;
+    bool     dirtyPins  = s_dirtyPins;
+    bool     dirtyLru   = s_dirtyLru;
+    s_dirtyBonds = 0;
+    s_dirtyCccds = false;
+    s_dirtyPins = false;
+    s_dirtyLru = false;
+    s_flushScheduled = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    if(dirtyBonds == 0 && !dirtyCccds && !dirtyPins && !dirtyLru) {
+        xSemaphoreGive(s_flushMutex);
+        return;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(STORE_NAMESPACE, NVS_READWRITE, &handle);
+    if(err == ESP_OK) {
+        err = nvs_set_u8(handle, "ver", STORE_VERSION);
+
+        for(int i = 0; i < BOND_MAX && err == ESP_OK; i++) {
+            if(!(dirtyBonds & (1u << i))) {
+                continue;
+            }
+            Bond bond;
+            portENTER_CRITICAL(&s_lock);
+            bond = s_bonds[i];
+            portEXIT_CRITICAL(&s_lock);
+
+            char key[8];
+            snprintf(key, sizeof(key), "bond%d", i);
+            if(bond.flags == 0) {
+                err = nvs_erase_key(handle, key);
+                if(err == ESP_ERR_NVS_NOT_FOUND) {
+                    err = ESP_OK;
+                }
+            } else {
+                err = nvs_set_blob(handle, key, &bond, sizeof(bond));
+            }
+        }
+
+        if(dirtyCccds && err == ESP_OK) {
+            ble_store_value_cccd cccds[CCCD_MAX];
+            portENTER_CRITICAL(&s_lock);
+            size_t len = s_cccdCount * sizeof(cccds[0]);
+            memcpy(cccds, s_cccds, len);
+            portEXIT_CRITICAL(&s_lock);
+            err = nvs_set_blob(handle, "cccd", cccds, len);
+        }
+
+        if(dirtyPins && err == ESP_OK) {
+            ble_addr_t pins[BOND_MAX];
+            portENTER_CRITICAL(&s_lock);
+            size_t len = s_pinCount * sizeof(pins[0]);
+            memcpy(pins, s_pins, len);
+            portEXIT_CRITICAL(&s_lock);
+            err = nvs_set_blob(handle, "pins", pins, len);
+        }
+
+        if(dirtyLru && err == ESP_OK) {
+            uint32_t lastUsed[BOND_MAX];
+            portENTER_CRITICAL(&s_lock);
+            memcpy(lastUsed, s_lastUsed, sizeof(lastUsed));
+            portEXIT_CRITICAL(&s_lock);
+            err = nvs_set_blob(handle, "lru", lastUsed, sizeof(lastUsed));
+        }
+
+        if(err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if(err != ESP_OK) {
+        // Keep them pending, the next change or flush() tries again
+        portENTER_CRITICAL(&s_lock);
+        s_dirtyBonds |= dirtyBonds;
+        s_dirtyCccds |= dirtyCccds;
+        s_dirtyPins |= dirtyPins;
+        s_dirtyLru |= dirtyLru;
+        portEXIT_CRITICAL(&s_lock);
+        NIMBLE_LOGE(LOG_TAG, "Could not write the bonds; err=%d", err);
+    } else {
+        NIMBLE_LOGD(LOG_TAG, "Bonds written; slots=0x%x cccds=%d pins=%d lru=%d",
+                    dirtyBonds, dirtyCccds, dirtyPins, dirtyLru);
+    }
+
+    xSemaphoreGive(s_flushMutex);
+} // flush
+
+
+/**
+ * @brief Pin or unpin a peer, a pinned peer's bond is never removed to make room for a new one.
+ * @param [in] address The identity address of the peer, see NimBLEConnInfo::getIdAddress.
+ * @param [in] pinned True to pin, false to unpin.
+ * @return False if the bond store is not running, or pinning would leave no bond to replace.
+ * @details The address does not need to be bonded yet. A repeat pairing keeps the pin,
+ * NimBLEDevice::deleteBond removes it.
+ */
+/* STATIC */
+bool NimBLEBondStore::setPinned(const NimBLEAddress &address, bool pinned) {
+    if(!s_started) {
+        return false;
+    }
+
+    ble_addr_t addr = toNative(address);
+    bool ok = true;
+    bool changed = false;
+
+    portENTER_CRITICAL(&s_lock);
+    int i = findPin(addr);
+    if(pinned && i < 0) {
+        if(s_pinCount >= BOND_MAX - 1) {
+            ok = false;
+        } else {
+            s_pins[s_pinCount++] = addr;
+            changed = true;
+        }
+    } else if(!pinned && i >= 0) {
+        s_pins[i] = s_pins[--s_pinCount];
+        changed = true;
+    }
+    s_dirtyPins |= changed;
+    portEXIT_CRITICAL(&s_lock);
+
+    if(changed) {
+        scheduleFlush();
+    }
+    return ok;
+} // setPinned
+
+
+/**
+ * @brief Check if a peer is pinned.
+ * @param [in] address The identity address of the peer.
+ */
+/* STATIC */
+bool NimBLEBondStore::isPinned(const NimBLEAddress &address) {
+    ble_addr_t addr = toNative(address);
+    portENTER_CRITICAL(&s_lock);
+    bool pinned = findPin(addr) >= 0;
+    portEXIT_CRITICAL(&s_lock);
+    return pinned;
+} // isPinned
+
+
+/**
+ * @brief Get the number of pinned peers.
+ */
+/* STATIC */
+int NimBLEBondStore::getPinnedCount() {
+    return __atomic_load_n(&s_pinCount, __ATOMIC_RELAXED);
+} // getPinnedCount
+
+
+/* STATIC */
+void NimBLEBondStore::clearPins() {
+    portENTER_CRITICAL(&s_lock);
+    s_dirtyPins |= s_pinCount != 0;
+    s_pinCount = 0;
+    portEXIT_CRITICAL(&s_lock);
+    scheduleFlush();
+} // clearPins
+
+
+/**
+ * @brief Get the number of bonded peers, those with peer keys as in ble_store_util_bonded_peers.
+ */
+/* STATIC */
+int NimBLEBondStore::getCount() {
+    int count = 0;
+    portENTER_CRITICAL(&s_lock);
+    for(int i = 0; i < BOND_MAX; i++) {
+        count += (s_bonds[i].flags & HAS_PEER) ? 1 : 0;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return count;
+} // getCount
+
+
+/* STATIC */
+bool NimBLEBondStore::isBonded(const NimBLEAddress &address) {
+    ble_store_key_sec key = {};
+    key.peer_addr = toNative(address);
+    portENTER_CRITICAL(&s_lock);
+    bool bonded = findSec(HAS_PEER, key) >= 0;
+    portEXIT_CRITICAL(&s_lock);
+    return bonded;
+} // isBonded
+
+
+/* STATIC */
+bool NimBLEBondStore::getAddress(int index, NimBLEAddress *address) {
+    if(index < 0) {
+        return false;
+    }
+
+    ble_store_key_sec key = {};
+    key.idx = index;
+    ble_addr_t addr = {};
+    portENTER_CRITICAL(&s_lock);
+    int i = findSec(HAS_PEER, key);
+    if(i >= 0) {
+        addr = s_bonds[i].addr;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if(i < 0) {
+        return false;
+    }
+    *address = NimBLEAddress(addr);
+    return true;
+} // getAddress
+
+
+/* STATIC */
+void NimBLEBondStore::scheduleFlush() {
+    if(__atomic_exchange_n(&s_flushScheduled, true, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    ble_npl_time_t ticks;
+    ble_npl_time_ms_to_ticks(CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS, &ticks);
+    ble_npl_callout_reset(&s_flushTimer, ticks);
+} // scheduleFlush
+
+
+/* STATIC */
+void NimBLEBondStore::flushTimerCb(ble_npl_event *event) {
+    flush();
+} // flushTimerCb
+
+
+/**
+ * @brief ble_hs_cfg.store_read_cb, looks the record up in RAM.
+ */
+/* STATIC */
+int NimBLEBondStore::readCb(int objType, const union ble_store_key *key, union ble_store_value *value) {
+    int rc = BLE_HS_ENOENT;
+
+    switch(objType) {
+        case BLE_STORE_OBJ_TYPE_OUR_SEC:
+        case BLE_STORE_OBJ_TYPE_PEER_SEC: {
+            uint8_t flag = objType == BLE_STORE_OBJ_TYPE_OUR_SEC ? HAS_OUR : HAS_PEER;
+            portENTER_CRITICAL(&s_lock);
+            int i = findSec(flag, key->sec);
+            if(i >= 0) {
+                value->sec = flag == HAS_OUR ? s_bonds[i].our : s_bonds[i].peer;
+                // A read for one peer restores its keys, iterations use BLE_ADDR_ANY
+                if(!isAny(key->sec.peer_addr)) {
+                    s_lastUsed[i] = ++s_clock;
+                    s_dirtyLru = true;
+                }
+                rc = 0;
+            }
+            portEXIT_CRITICAL(&s_lock);
+            return rc;
+        }
+
+        case BLE_STORE_OBJ_TYPE_CCCD: {
+            portENTER_CRITICAL(&s_lock);
+            int i = findCccd(key->cccd);
+            if(i >= 0) {
+                value->cccd = s_cccds[i];
+                rc = 0;
+            }
+            portEXIT_CRITICAL(&s_lock);
+            return rc;
+        }
+
+        default:
+            return s_defaultRead != nullptr ? s_defaultRead(objType, key, value) : BLE_HS_ENOTSUP;
+    }
+} // readCb
+
+
+/**
+ * @brief ble_hs_cfg.store_write_cb, updates RAM and schedules the NVS write.
+ * @return BLE_HS_ESTORE_CAP when full, the host then calls statusCb to make room and tries again.
+ */
+/* STATIC */
+int NimBLEBondStore::writeCb(int objType, const union ble_store_value *value) {
+    int rc;
+
+    switch(objType) {
+        case BLE_STORE_OBJ_TYPE_OUR_SEC:
+        case BLE_STORE_OBJ_TYPE_PEER_SEC:
+            portENTER_CRITICAL(&s_lock);
+            rc = putSec(objType == BLE_STORE_OBJ_TYPE_OUR_SEC ? HAS_OUR : HAS_PEER, value->sec) < 0 ?
+                 BLE_HS_ESTORE_CAP : 0;
+            portEXIT_CRITICAL(&s_lock);
+            break;
+
+        case BLE_STORE_OBJ_TYPE_CCCD:
+            portENTER_CRITICAL(&s_lock);
+            rc = putCccd(value->cccd);
+            portEXIT_CRITICAL(&s_lock);
+            if(rc == 1) {
+                return 0;
+            }
+            break;
+
+        default:
+            return s_defaultWrite != nullptr ? s_defaultWrite(objType, value) : BLE_HS_ENOTSUP;
+    }
+
+    if(rc == 0) {
+        scheduleFlush();
+    }
+    return rc;
+} // writeCb
+
+
+/**
+ * @brief ble_hs_cfg.store_delete_cb, updates RAM and schedules the NVS write.
+ */
+/* STATIC */
+int NimBLEBondStore::deleteCb(int objType, const union ble_store_key *key) {
+    int rc = BLE_HS_ENOENT;
+
+    switch(objType) {
+        case BLE_STORE_OBJ_TYPE_OUR_SEC:
+        case BLE_STORE_OBJ_TYPE_PEER_SEC: {
+            uint8_t flag = objType == BLE_STORE_OBJ_TYPE_OUR_SEC ? HAS_OUR : HAS_PEER;
+            portENTER_CRITICAL(&s_lock);
+            int i = findSec(flag, key->sec);
+            if(i >= 0) {
+                s_bonds[i].flags &= ~flag;
+                if(s_bonds[i].flags == 0) {
+                    memset(&s_bonds[i], 0, sizeof(s_bonds[i]));
+                    s_lastUsed[i] = 0;
+                    s_dirtyLru = true;
+                }
+                s_dirtyBonds |= 1u << i;
+                rc = 0;
+            }
+            portEXIT_CRITICAL(&s_lock);
+            break;
+        }
+
+        case BLE_STORE_OBJ_TYPE_CCCD: {
+            portENTER_CRITICAL(&s_lock);
+            int i = findCccd(key->cccd);
+            if(i >= 0) {
+                memmove(&s_cccds[i], &s_cccds[i + 1], (s_cccdCount - i - 1) * sizeof(s_cccds[0]));
+                s_cccdCount--;
+                s_dirtyCccds = true;
+                rc = 0;
+            }
+            portEXIT_CRITICAL(&s_lock);
+            break;
+        }
+
+        default:
+            return s_defaultDelete != nullptr ? s_defaultDelete(objType, key) : BLE_HS_ENOTSUP;
+    }
+
+    if(rc == 0) {
+        scheduleFlush();
+    }
+    return rc;
+} // deleteCb
+
+
+/**
+ * @brief ble_hs_cfg.store_status_cb, makes room for a record by removing the least recently used bond.
+ */
+/* STATIC */
+int NimBLEBondStore::statusCb(struct ble_store_status_event *event, void *arg) {
+    switch(event->event_code) {
+        case BLE_STORE_EVENT_OVERFLOW:
+            switch(event->overflow.obj_type) {
+                case BLE_STORE_OBJ_TYPE_OUR_SEC:
+                case BLE_STORE_OBJ_TYPE_PEER_SEC:
+                    return evictOldest(event->overflow.value->sec.peer_addr, false) ? 0 : BLE_HS_ESTORE_CAP;
+                case BLE_STORE_OBJ_TYPE_CCCD:
+                    return evictOldest(event->overflow.value->cccd.peer_addr, true) ? 0 : BLE_HS_ESTORE_CAP;
+                default:
+                    return BLE_HS_EUNKNOWN;
+            }
+
+        case BLE_STORE_EVENT_FULL:
+            // Pairing goes on, the write that does not fit makes room
+            return 0;
+
+        default:
+            return BLE_HS_EUNKNOWN;
+    }
+} // statusCb
+
+
+/**
+ * @brief ble_store_iterate callback copying a record of the default store.
+ */
+/* STATIC */
+int NimBLEBondStore::importCb(int objType, union ble_store_value *value, void *cookie) {
+    portENTER_CRITICAL(&s_lock);
+    if(objType == BLE_STORE_OBJ_TYPE_CCCD) {
+        putCccd(value->cccd);
+    } else {
+        putSec(objType == BLE_STORE_OBJ_TYPE_OUR_SEC ? HAS_OUR : HAS_PEER, value->sec);
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return 0;
+} // importCb
+
+#endif // CONFIG_BT_ENABLED && CONFIG_NIMBLE_CPP_BOND_STORE
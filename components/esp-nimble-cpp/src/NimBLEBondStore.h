@@ -0,0 +1,75 @@
+/*
+ * NimBLEBondStore.h
+ *
+ *  NimBLE host store keeping the bonds in RAM, with least recently used eviction
+ *  and batched NVS writes.
+ */
+
+#ifndef MAIN_NIMBLEBONDSTORE_H_
+#define MAIN_NIMBLEBONDSTORE_H_
+
+#include "nimconfig.h"
+
+#if defined(CONFIG_BT_ENABLED) && defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+
+#include "NimBLEAddress.h"
+
+#if !defined(CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS)
+#    define CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS 2000
+#elif CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS > 60000
+#    error CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS cannot be larger than 60000
+#elif CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS < 0
+#    error CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS cannot be less than 0; Range = 0 : 60000
+#endif
+
+union ble_store_key;
+union ble_store_value;
+struct ble_store_status_event;
+struct ble_npl_event;
+
+/**
+ * @brief Bond store.
+ * @details Replaces the read, write and delete callbacks of the NimBLE store for the security
+ * keys and CCCDs of bonded peers, object types it does not know go to the default store. The
+ * keys, the CCCDs and the recency of every bond are held in RAM; lookups and writes from the
+ * host never touch flash. Changes are written to NVS in one batch
+ * CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS after the first pending one, so a pairing (keys and
+ * subscriptions) or a repeat pairing (delete then pair again) costs one commit. A bond is used
+ * when it is created and when its keys are read to encrypt a connection; only the recency
+ * changes then, it is written with the next batch or flush() and does not schedule one.
+ *
+ * When a new bond does not fit, the least recently used bond is removed, except pinned
+ * addresses and connected peers; pairing fails if no bond can be removed. At least one bond
+ * is never pinned.
+ *
+ * The bonds of the default store are copied once, the first time the bond store starts, and
+ * removed from it once the copy is written.
+ */
+class NimBLEBondStore {
+public:
+    static bool setPinned(const NimBLEAddress &address, bool pinned);
+    static bool isPinned(const NimBLEAddress &address);
+    static int  getPinnedCount();
+    static void flush();
+
+private:
+    friend class NimBLEDevice;
+
+    static void init();
+    static void deinit();
+    static int  getCount();
+    static bool isBonded(const NimBLEAddress &address);
+    static bool getAddress(int index, NimBLEAddress *address);
+    static void clearPins();
+
+    static int  readCb(int objType, const union ble_store_key *key, union ble_store_value *value);
+    static int  writeCb(int objType, const union ble_store_value *value);
+    static int  deleteCb(int objType, const union ble_store_key *key);
+    static int  statusCb(struct ble_store_status_event *event, void *arg);
+    static int  importCb(int objType, union ble_store_value *value, void *cookie);
+    static void flushTimerCb(struct ble_npl_event *event);
+    static void scheduleFlush();
+};
+
+#endif // CONFIG_BT_ENABLED && CONFIG_NIMBLE_CPP_BOND_STORE
+#endif // MAIN_NIMBLEBONDSTORE_H_
@@ -245,6 +245,19 @@ NimBLEAttValue NimBLECharacteristic::getValue(time_t *timestamp) {
 } // getValue
 
 
+/**
+ * @brief Update the value from a single task without locking.
+ * @details For small values that are set often, e.g. HID input reports. Reads and notifications\n
+ * take a consistent copy instead of locking out the writer. Only one task may call setValue().
+ * @param [in] enable True to enable, false to go back to locked updates.
+ * @return True if successful, false if the value does not fit the inline attribute storage\n
+ * (CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH).
+ */
+bool NimBLECharacteristic::setSingleWriter(bool enable) {
+    return m_value.setSingleWriter(enable);
+} // setSingleWriter
+
+
 /**
  * @brief Retrieve the the current data length of the characteristic.
  * @return The length of the current characteristic data.
@@ -289,9 +302,16 @@ int NimBLECharacteristic::handleGapEvent(uint16_t conn_handle, uint16_t attr_han
                     pCharacteristic->m_pCallbacks->onRead(pCharacteristic, peerInfo);
                 }
 
-                ble_npl_hw_enter_critical();
-                rc = os_mbuf_append(ctxt->om, pCharacteristic->m_value.data(), pCharacteristic->m_value.size());
-                ble_npl_hw_exit_critical(0);
+                if(pCharacteristic->m_value.isSingleWriter()) {
+                    // Copy a snapshot so the update path never has to wait on the mbuf append
+                    uint8_t buf[CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH + 1];
+                    uint16_t len = pCharacteristic->m_value.read(buf, sizeof(buf));
+                    rc = os_mbuf_append(ctxt->om, buf, len);
+                } else {
+                    ble_npl_hw_enter_critical();
+                    rc = os_mbuf_append(ctxt->om, pCharacteristic->m_value.data(), pCharacteristic->m_value.size());
+                    ble_npl_hw_exit_critical(0);
+                }
                 return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
             }
 
@@ -420,6 +440,12 @@ void NimBLECharacteristic::indicate(const std::vector<uint8_t>& value) {
  * @param[in] conn_handle Connection handle to send individual notification, or BLE_HCI_LE_CONN_HANDLE_MAX + 1 to send notification to all subscribed clients.
  */
 void NimBLECharacteristic::notify(bool is_notification, uint16_t conn_handle) {
+    if(m_value.isSingleWriter()) {
+        uint8_t buf[CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH + 1];
+        notify(buf, m_value.read(buf, sizeof(buf)), is_notification, conn_handle);
+        return;
+    }
+
     notify(m_value.data(), m_value.length(), is_notification, conn_handle);
 } // notify
 
@@ -97,6 +97,7 @@ public:
     uint16_t          getProperties();
     NimBLEAttValue    getValue(time_t *timestamp = nullptr);
     size_t            getDataLength();
+    bool              setSingleWriter(bool enable);
     void              setValue(const uint8_t* data, size_t size);
     void              setValue(const std::vector<uint8_t>& vec);
     void              setCallbacks(NimBLECharacteristicCallbacks* pCallbacks);
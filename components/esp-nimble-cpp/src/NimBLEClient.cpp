@@ -28,8 +28,15 @@
 #include "nimble/porting/nimble/include/nimble/nimble_port.h"
 #endif
 
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+#include "nvs.h"
+#endif
+
 static const char* LOG_TAG = "NimBLEClient";
 static NimBLEClientCallbacks defaultCallbacks;
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+static constexpr NimBLEUUID DB_HASH_UUID((uint16_t)0x2B2A);
+#endif
 
 /*
  * Design
@@ -65,6 +72,9 @@ NimBLEClient::NimBLEClient(const NimBLEAddress &peerAddress) : m_peerAddress(pee
     m_pTaskData        = nullptr;
     m_connEstablished  = false;
     m_lastErr          = 0;
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    m_dbHashValid      = false;
+#endif
 #if CONFIG_BT_NIMBLE_EXT_ADV
     m_phyMask          = BLE_GAP_LE_PHY_1M_MASK |
                          BLE_GAP_LE_PHY_2M_MASK |
@@ -83,6 +93,26 @@ NimBLEClient::NimBLEClient(const NimBLEAddress &peerAddress) : m_peerAddress(pee
     memset(&m_dcTimer, 0, sizeof(m_dcTimer));
     ble_npl_callout_init(&m_dcTimer, nimble_port_get_dflt_eventq(),
                          NimBLEClient::dcTimerCb, this);
+
+    m_opHead = nullptr;
+    m_opTail = nullptr;
+    m_opBusy = false;
+    memset(&m_opTimer, 0, sizeof(m_opTimer));
+    ble_npl_callout_init(&m_opTimer, nimble_port_get_dflt_eventq(),
+                         NimBLEClient::runOpsCb, this);
+    memset(&m_opEvent, 0, sizeof(m_opEvent));
+    ble_npl_event_init(&m_opEvent, NimBLEClient::runOpsCb, this);
+
+    m_asyncData             = {};
+    m_asyncFilter           = {};
+    m_asyncState            = ASYNC_NONE;
+    m_asyncRetry            = 0;
+    m_asyncDeleteAttributes = false;
+    m_asyncService          = 0;
+    m_asyncCharacteristic   = 0;
+    memset(&m_asyncTimer, 0, sizeof(m_asyncTimer));
+    ble_npl_callout_init(&m_asyncTimer, nimble_port_get_dflt_eventq(),
+                         NimBLEClient::asyncTimerCb, this);
 } // NimBLEClient
 
 
@@ -100,6 +130,16 @@ NimBLEClient::~NimBLEClient() {
     }
 
     ble_npl_callout_deinit(&m_dcTimer);
+    ble_npl_callout_stop(&m_asyncTimer);
+    ble_npl_callout_deinit(&m_asyncTimer);
+
+    // NimBLEDevice::deleteClient() waited for the queue to drain: the host fails the operation
+    // in flight when the link drops and the rest complete with BLE_HS_ENOTCONN.
+    assert(!m_opBusy && m_opHead == nullptr && "client deleted with GATT operations pending");
+    ble_npl_callout_stop(&m_opTimer);
+    ble_npl_callout_deinit(&m_opTimer);
+    ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_opEvent);
+    ble_npl_event_deinit(&m_opEvent);
 
 } // ~NimBLEClient
 
@@ -186,14 +226,89 @@ bool NimBLEClient::connect(NimBLEAdvertisedDevice* device, bool deleteAttributes
  * @return True on success.
  */
 bool NimBLEClient::connect(const NimBLEAddress &address, bool deleteAttributes) {
-    NIMBLE_LOGD(LOG_TAG, ">> connect(%s)", address.toString().c_str());
+    char addrStr[18];
+    NIMBLE_LOGD(LOG_TAG, ">> connect(%s)", address.formatTo(addrStr));
+
+    if(!prepareConnect(address)) {
+        return false;
+    }
+
+    TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
+    m_pTaskData = &taskData;
+
+    if(startConnect() != 0) {
+        m_pTaskData = nullptr;
+        return false;
+    }
+
+#ifdef ulTaskNotifyValueClear
+    // Clear the task notification value to ensure we block
+    ulTaskNotifyValueClear(cur_task, ULONG_MAX);
+#endif
+    // Wait for the connect timeout time +1 second for the connection to complete
+    if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(m_connectTimeout + 1000)) == pdFALSE) {
+        m_pTaskData = nullptr;
+        // If a connection was made but no response from MTU exchange; disconnect
+        if(isConnected()) {
+            NIMBLE_LOGE(LOG_TAG, "Connect timeout - no response");
+            disconnect();
+        } else {
+        // workaround; if the controller doesn't cancel the connection
+        // at the timeout, cancel it here.
+            NIMBLE_LOGE(LOG_TAG, "Connect timeout - cancelling");
+            ble_gap_conn_cancel();
+        }
 
+        return false;
+
+    } else if(taskData.rc != 0){
+        m_lastErr = taskData.rc;
+        NIMBLE_LOGE(LOG_TAG, "Connection failed; status=%d %s",
+                    taskData.rc,
+                    NimBLEUtils::returnCodeToString(taskData.rc));
+        // If the failure was not a result of a disconnection
+        // make sure we disconnect now to avoid dangling connections
+        if(isConnected()) {
+            disconnect();
+        }
+        return false;
+    } else {
+        NIMBLE_LOGI(LOG_TAG, "Connection established");
+    }
+
+    if(deleteAttributes) {
+        deleteServices();
+    }
+
+    m_connEstablished = true;
+
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    m_dbHashValid = false;
+    if(m_servicesVector.empty()) {
+        loadAttributeCache();
+    }
+#endif
+    m_pClientCallbacks->onConnect(this);
+
+    NIMBLE_LOGD(LOG_TAG, "<< connect()");
+    // Check if still connected before returning
+    return isConnected();
+} // connect
+
+
+/**
+ * @brief Check that a connection to the address can be started and make it the peer address.
+ * @param [in] address The address of the server.
+ * @return True if the connection can be started.
+ */
+bool NimBLEClient::prepareConnect(const NimBLEAddress &address) {
     if(!NimBLEDevice::m_synced) {
         NIMBLE_LOGC(LOG_TAG, "Host reset, wait for sync.");
         return false;
     }
 
-    if(isConnected() || m_connEstablished || m_pTaskData != nullptr) {
+    if(isConnected() || m_connEstablished || m_pTaskData != nullptr || m_asyncState != ASYNC_NONE) {
         NIMBLE_LOGE(LOG_TAG, "Client busy, connected to %s, id=%d",
                     std::string(m_peerAddress).c_str(), getConnId());
         return false;
@@ -203,21 +318,30 @@ bool NimBLEClient::connect(const NimBLEAddress &address, bool deleteAttributes)
     memcpy(&peerAddr_t.val, address.getNative(),6);
     peerAddr_t.type = address.getType();
     if(ble_gap_conn_find_by_addr(&peerAddr_t, NULL) == 0) {
+        char addrStr[18];
         NIMBLE_LOGE(LOG_TAG, "A connection to %s already exists",
-                    address.toString().c_str());
+                    address.formatTo(addrStr));
         return false;
     }
 
-    if(address == NimBLEAddress("")) {
+    if(address == NimBLEAddress()) {
         NIMBLE_LOGE(LOG_TAG, "Invalid peer address;(NULL)");
         return false;
-    } else {
-        m_peerAddress = address;
     }
 
-    TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
-    m_pTaskData = &taskData;
+    NimBLEDevice::setClientPeerAddress(this, address);
+    return true;
+} // prepareConnect
+
+
+/**
+ * @brief Start the connection to the peer address, m_pTaskData must be set by the caller.
+ * @return 0 if the connection was started, the GAP event handler completes it.
+ */
+int NimBLEClient::startConnect() {
+    ble_addr_t peerAddr_t;
+    memcpy(&peerAddr_t.val, m_peerAddress.getNative(),6);
+    peerAddr_t.type = m_peerAddress.getType();
     int rc = 0;
 
     /* Try to connect the the advertiser.  Allow 30 seconds (30000 ms) for
@@ -276,58 +400,8 @@ bool NimBLEClient::connect(const NimBLEAddress &address, bool deleteAttributes)
     } while (rc == BLE_HS_EBUSY);
 
     m_lastErr = rc;
-
-    if(rc != 0) {
-        m_pTaskData = nullptr;
-        return false;
-    }
-
-#ifdef ulTaskNotifyValueClear
-    // Clear the task notification value to ensure we block
-    ulTaskNotifyValueClear(cur_task, ULONG_MAX);
-#endif
-    // Wait for the connect timeout time +1 second for the connection to complete
-    if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(m_connectTimeout + 1000)) == pdFALSE) {
-        m_pTaskData = nullptr;
-        // If a connection was made but no response from MTU exchange; disconnect
-        if(isConnected()) {
-            NIMBLE_LOGE(LOG_TAG, "Connect timeout - no response");
-            disconnect();
-        } else {
-        // workaround; if the controller doesn't cancel the connection
-        // at the timeout, cancel it here.
-            NIMBLE_LOGE(LOG_TAG, "Connect timeout - cancelling");
-            ble_gap_conn_cancel();
-        }
-
-        return false;
-
-    } else if(taskData.rc != 0){
-        m_lastErr = taskData.rc;
-        NIMBLE_LOGE(LOG_TAG, "Connection failed; status=%d %s",
-                    taskData.rc,
-                    NimBLEUtils::returnCodeToString(taskData.rc));
-        // If the failure was not a result of a disconnection
-        // make sure we disconnect now to avoid dangling connections
-        if(isConnected()) {
-            disconnect();
-        }
-        return false;
-    } else {
-        NIMBLE_LOGI(LOG_TAG, "Connection established");
-    }
-
-    if(deleteAttributes) {
-        deleteServices();
-    }
-
-    m_connEstablished = true;
-    m_pClientCallbacks->onConnect(this);
-
-    NIMBLE_LOGD(LOG_TAG, "<< connect()");
-    // Check if still connected before returning
-    return isConnected();
-} // connect
+    return rc;
+} // startConnect
 
 
 /**
@@ -338,7 +412,7 @@ bool NimBLEClient::connect(const NimBLEAddress &address, bool deleteAttributes)
 bool NimBLEClient::secureConnection() {
     NIMBLE_LOGD(LOG_TAG, ">> secureConnection()");
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     int retryCount = 1;
 
@@ -365,9 +439,376 @@ bool NimBLEClient::secureConnection() {
         return false;
     }
 
-    NIMBLE_LOGD(LOG_TAG, "<< secureConnection: success");
-    return true;
-} // secureConnection
+    NIMBLE_LOGD(LOG_TAG, "<< secureConnection: success");
+    return true;
+} // secureConnection
+
+
+/**
+ * @brief Connect to the BLE Server without blocking.
+ * @param [in] address The address of the server.
+ * @param [in] callback Called from the host task once the connection is established and the MTU\n
+ * exchanged, or when it failed or timed out (BLE_HS_ETIMEOUT) after the connect timeout + 1 second.
+ * @param [in] deleteAttributes If true this will delete any attribute objects this client may already\n
+ * have created and clears the vectors after successful connection.
+ * @return True if the connection was started, the callback is not called otherwise.
+ * @details Unlike connect() the attribute cache is not loaded, discoverAttributesAsync() restores the\n
+ * attributes from it once connected.
+ */
+bool NimBLEClient::connectAsync(const NimBLEAddress &address, client_op_callback callback, bool deleteAttributes) {
+    char addrStr[18];
+    NIMBLE_LOGD(LOG_TAG, ">> connectAsync(%s)", address.formatTo(addrStr));
+
+    if(!prepareConnect(address)) {
+        return false;
+    }
+
+    startAsync(ASYNC_CONNECT, callback);
+    m_asyncDeleteAttributes = deleteAttributes;
+
+    // Armed before the connection starts, the host task may complete it before we return.
+    ble_npl_time_t ticks;
+    ble_npl_time_ms_to_ticks(m_connectTimeout + 1000, &ticks);
+    ble_npl_callout_reset(&m_asyncTimer, ticks);
+
+    m_pTaskData = &m_asyncData;
+    if(startConnect() != 0) {
+        ble_npl_callout_stop(&m_asyncTimer);
+        m_pTaskData = nullptr;
+        m_asyncCallback = nullptr;
+        m_asyncState = ASYNC_NONE;
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "<< connectAsync()");
+    return true;
+} // connectAsync
+
+
+/**
+ * @brief Initiate a secure connection (pair/bond) with the server without blocking.
+ * @param [in] callback Called from the host task when the link is encrypted or pairing failed.
+ * @return True if security was initiated, the callback is not called otherwise.
+ */
+bool NimBLEClient::secureConnectionAsync(client_op_callback callback) {
+    NIMBLE_LOGD(LOG_TAG, ">> secureConnectionAsync()");
+
+    if(m_pTaskData != nullptr || m_asyncState != ASYNC_NONE) {
+        NIMBLE_LOGE(LOG_TAG, "Client busy");
+        return false;
+    }
+
+    startAsync(ASYNC_SECURE, callback);
+    m_asyncRetry = 1;
+    m_pTaskData = &m_asyncData;
+
+    int rc = NimBLEDevice::startSecurity(m_conn_id);
+    if(rc != 0 && rc != BLE_HS_EALREADY) {
+        m_lastErr = rc;
+        m_pTaskData = nullptr;
+        m_asyncCallback = nullptr;
+        m_asyncState = ASYNC_NONE;
+        return false;
+    }
+
+    return true;
+} // secureConnectionAsync
+
+
+/**
+ * @brief Retrieve the full database of attributes that the peripheral has available, without blocking.
+ * @param [in] callback Called from the host task once the services, characteristics and\n
+ * descriptors were all discovered, or when a discovery procedure failed.
+ * @return True if the discovery started, the callback is not called otherwise.
+ * @details Every procedure starts from the completion of the previous one in the host task.\n
+ * With CONFIG_NIMBLE_CPP_GATT_CACHE the database hash is read first, the attributes are restored from\n
+ * the cache when it is unchanged and stored after a full discovery. The cache is read and written\n
+ * from the host task.
+ */
+bool NimBLEClient::discoverAttributesAsync(client_op_callback callback) {
+    if(!isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Disconnected, could not retrieve services -aborting");
+        return false;
+    }
+
+    if(m_pTaskData != nullptr || m_asyncState != ASYNC_NONE) {
+        NIMBLE_LOGE(LOG_TAG, "Client busy");
+        return false;
+    }
+
+    deleteServices();
+
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    // Read the hash again, the database may have changed since we connected.
+    m_dbHashValid = false;
+    startAsync(ASYNC_DB_HASH, callback);
+    m_asyncData.rc = BLE_HS_ENOENT;
+
+    int rc = ble_gattc_read_by_uuid(m_conn_id, 1, 0xffff, &DB_HASH_UUID.getNative()->u,
+                                    NimBLEClient::dbHashReadCB, &m_asyncData);
+    if(rc == 0) {
+        return true;
+    }
+    NIMBLE_LOGE(LOG_TAG, "Database hash read failed; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    rc = discoverServicesAsync();
+#else
+    startAsync(ASYNC_SERVICES, callback);
+    int rc = discoverServicesAsync();
+#endif
+    if(rc != 0) {
+        m_lastErr = rc;
+        m_asyncCallback = nullptr;
+        m_asyncState = ASYNC_NONE;
+        return false;
+    }
+
+    return true;
+} // discoverAttributesAsync
+
+
+/**
+ * @brief Start the service discovery step of discoverAttributesAsync().
+ * @return The return code of the discovery procedure, 0 if it started.
+ */
+int NimBLEClient::discoverServicesAsync() {
+    m_asyncState = ASYNC_SERVICES;
+    m_asyncData.rc = 0;
+
+    int rc = ble_gattc_disc_all_svcs(m_conn_id, NimBLEClient::serviceDiscoveredCB, &m_asyncData);
+    if(rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_svcs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+    return rc;
+} // discoverServicesAsync
+
+
+/**
+ * @brief Prepare the task data shared by the steps of an asynchronous operation.
+ * @details buf holds the client, pATT is the attribute the discovery callbacks expect.
+ */
+void NimBLEClient::startAsync(uint8_t state, client_op_callback callback) {
+    m_asyncCallback = callback;
+    m_asyncState = state;
+    m_asyncData = {this, nullptr, 0, this, NimBLEClient::asyncResume};
+} // startAsync
+
+
+/**
+ * @brief End the asynchronous operation in progress and report its result.
+ */
+void NimBLEClient::finishAsync(int rc) {
+    if(rc != 0) {
+        m_lastErr = rc;
+    }
+
+    // Moved out first, the callback may start the next operation.
+    client_op_callback callback = std::move(m_asyncCallback);
+    m_asyncCallback = nullptr;
+    m_asyncState = ASYNC_NONE;
+
+    if(callback) {
+        callback(this, rc);
+    }
+} // finishAsync
+
+
+/**
+ * @brief STATIC Continuation of the asynchronous operations, called from the host task when a\n
+ * GAP event or a discovery procedure completes the current step.
+ */
+void NimBLEClient::asyncResume(ble_task_data_t *pTaskData) {
+    NimBLEClient *pClient = (NimBLEClient*)pTaskData->buf;
+    int rc = pTaskData->rc;
+
+    switch(pClient->m_asyncState) {
+        case ASYNC_CONNECT:
+            ble_npl_callout_stop(&pClient->m_asyncTimer);
+            if(rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Connection failed; status=%d %s",
+                            rc, NimBLEUtils::returnCodeToString(rc));
+                // If the failure was not a result of a disconnection
+                // make sure we disconnect now to avoid dangling connections
+                if(pClient->isConnected()) {
+                    pClient->disconnect();
+                }
+                pClient->finishAsync(rc);
+                return;
+            }
+
+            NIMBLE_LOGI(LOG_TAG, "Connection established");
+            if(pClient->m_asyncDeleteAttributes) {
+                pClient->deleteServices();
+            }
+            pClient->m_connEstablished = true;
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+            pClient->m_dbHashValid = false;
+#endif
+            pClient->m_pClientCallbacks->onConnect(pClient);
+            pClient->finishAsync(pClient->isConnected() ? 0 : BLE_HS_ENOTCONN);
+            return;
+
+        case ASYNC_SECURE:
+            if(rc == (BLE_HS_ERR_HCI_BASE + BLE_ERR_PINKEY_MISSING) && pClient->m_asyncRetry > 0) {
+                // The key was deleted by the GAP event handler, pair again.
+                pClient->m_asyncRetry--;
+                pClient->m_pTaskData = &pClient->m_asyncData;
+                rc = NimBLEDevice::startSecurity(pClient->m_conn_id);
+                if(rc == 0 || rc == BLE_HS_EALREADY) {
+                    return;
+                }
+                pClient->m_pTaskData = nullptr;
+            }
+
+            if(rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "secureConnection: failed rc=%d", rc);
+            }
+            pClient->finishAsync(rc);
+            return;
+
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+        case ASYNC_DB_HASH:
+            // Without a hash the attributes are discovered and not cached
+            if(rc == 0) {
+                pClient->m_dbHashValid = true;
+                if(pClient->loadAttributeCache()) {
+                    NIMBLE_LOGD(LOG_TAG, "<< discoverAttributesAsync()");
+                    pClient->finishAsync(0);
+                    return;
+                }
+            } else {
+                NIMBLE_LOGD(LOG_TAG, "No database hash; rc=%d", rc);
+            }
+            rc = pClient->discoverServicesAsync();
+            if(rc != 0) {
+                pClient->finishAsync(rc);
+            }
+            return;
+#endif
+
+        case ASYNC_SERVICES:
+            if(rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Could not retrieve services");
+                pClient->finishAsync(rc);
+                return;
+            }
+            pClient->m_asyncService = 0;
+            pClient->discoverNextService();
+            return;
+
+        case ASYNC_CHARACTERISTICS:
+            if(rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Could not retrieve characteristics");
+                pClient->finishAsync(rc);
+                return;
+            }
+            pClient->m_servicesVector[pClient->m_asyncService]->setCharacteristicEndHandles();
+            pClient->m_asyncCharacteristic = 0;
+            pClient->discoverNextCharacteristic();
+            return;
+
+        case ASYNC_DESCRIPTORS:
+            if(rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "Failed to retrieve descriptors; rc=%d", rc);
+                pClient->finishAsync(rc);
+                return;
+            }
+            pClient->m_asyncCharacteristic++;
+            pClient->discoverNextCharacteristic();
+            return;
+
+        default:
+            return;
+    }
+} // asyncResume
+
+
+/**
+ * @brief Start the characteristic discovery of the next service, or finish the discovery.
+ */
+void NimBLEClient::discoverNextService() {
+    if(m_asyncService >= m_servicesVector.size()) {
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+        // Only with the hash read at the start, storing must not read it again from the host task
+        if(m_dbHashValid) {
+            storeAttributeCache();
+        }
+#endif
+        NIMBLE_LOGD(LOG_TAG, "<< discoverAttributesAsync()");
+        finishAsync(0);
+        return;
+    }
+
+    NimBLERemoteService *pSvc = m_servicesVector[m_asyncService];
+    m_asyncState = ASYNC_CHARACTERISTICS;
+    m_asyncData.pATT = pSvc;
+    m_asyncData.rc = 0;
+
+    int rc = ble_gattc_disc_all_chrs(m_conn_id, pSvc->m_startHandle, pSvc->m_endHandle,
+                                     NimBLERemoteService::characteristicDiscCB, &m_asyncData);
+    if(rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_chrs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        finishAsync(rc);
+    }
+} // discoverNextService
+
+
+/**
+ * @brief Start the descriptor discovery of the next characteristic that can have descriptors,\n
+ * or move on to the next service.
+ */
+void NimBLEClient::discoverNextCharacteristic() {
+    NimBLERemoteService *pSvc = m_servicesVector[m_asyncService];
+
+    for(; m_asyncCharacteristic < pSvc->m_characteristicVector.size(); m_asyncCharacteristic++) {
+        NimBLERemoteCharacteristic *pChr = pSvc->m_characteristicVector[m_asyncCharacteristic];
+        // The value handle is the last handle, there are no descriptors
+        if(pChr->m_handle == pChr->m_endHandle) {
+            continue;
+        }
+
+        m_asyncState = ASYNC_DESCRIPTORS;
+        m_asyncData.pATT = pChr;
+        m_asyncData.rc = 0;
+        m_asyncFilter = {nullptr, &m_asyncData};
+
+        int rc = ble_gattc_disc_all_dscs(m_conn_id, pChr->m_handle, pChr->m_endHandle,
+                                         NimBLERemoteCharacteristic::descriptorDiscCB, &m_asyncFilter);
+        if(rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_dscs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+            finishAsync(rc);
+        }
+        return;
+    }
+
+    // Only returns here when a whole service had no descriptors, the depth is bounded by the services.
+    m_asyncService++;
+    discoverNextService();
+} // discoverNextCharacteristic
+
+
+/**
+ * @brief STATIC The asynchronous connection did not complete within the connect timeout + 1 second.
+ */
+void NimBLEClient::asyncTimerCb(ble_npl_event *event) {
+    NimBLEClient *pClient = (NimBLEClient*)ble_npl_event_get_arg(event);
+    if(pClient->m_asyncState != ASYNC_CONNECT) {
+        return;
+    }
+
+    pClient->m_pTaskData = nullptr;
+    // If a connection was made but no response from MTU exchange; disconnect
+    if(pClient->isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Connect timeout - no response");
+        pClient->disconnect();
+    } else {
+        // workaround; if the controller doesn't cancel the connection
+        // at the timeout, cancel it here.
+        NIMBLE_LOGE(LOG_TAG, "Connect timeout - cancelling");
+        ble_gap_conn_cancel();
+    }
+
+    pClient->finishAsync(BLE_HS_ETIMEOUT);
+} // asyncTimerCb
 
 
 /**
@@ -571,7 +1012,7 @@ void NimBLEClient::setPeerAddress(const NimBLEAddress &address) {
         return;
     }
 
-    m_peerAddress = address;
+    NimBLEDevice::setClientPeerAddress(this, address);
     NIMBLE_LOGD(LOG_TAG, "Peer address set: %s", std::string(m_peerAddress).c_str());
 } // setPeerAddress
 
@@ -711,6 +1152,14 @@ std::vector<NimBLERemoteService*>* NimBLEClient::getServices(bool refresh) {
 bool NimBLEClient::discoverAttributes() {
     deleteServices();
 
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    // Read the hash again, the database may have changed since we connected.
+    m_dbHashValid = false;
+    if (loadAttributeCache()) {
+        return true;
+    }
+#endif
+
     if (!retrieveServices()){
         return false;
     }
@@ -728,10 +1177,366 @@ bool NimBLEClient::discoverAttributes() {
         }
     }
 
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    storeAttributeCache();
+#endif
+
     return true;
 } // discoverAttributes
 
 
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+/*
+ * Attribute cache
+ * ---------------
+ * Each cached peer is an NVS blob named by its identity address (12 hex digits + address type)
+ * in the "nimble_gattc" namespace. The blob holds a version byte and the 16 byte database hash
+ * followed by the attributes in discovery order, each starting with a kind byte and its UUID:
+ *   'S' uuid start_handle end_handle
+ *   'C' uuid def_handle val_handle end_handle properties
+ *   'D' uuid handle
+ * A UUID is its size in bytes (2, 4 or 16) followed by the little endian value.
+ * The "index" blob lists the cached addresses (7 bytes each), most recently used first.
+ */
+static const char*   CACHE_NAMESPACE = "nimble_gattc";
+static const char*   CACHE_INDEX_KEY = "index";
+static const uint8_t CACHE_VERSION   = 1;
+
+static void cacheKey(const uint8_t *val, uint8_t type, char (&key)[16]) {
+    snprintf(key, sizeof(key), "%02x%02x%02x%02x%02x%02x%02x",
+             val[5], val[4], val[3], val[2], val[1], val[0], type);
+}
+
+static void cachePut16(std::vector<uint8_t> &blob, uint16_t val) {
+    blob.push_back(val & 0xff);
+    blob.push_back(val >> 8);
+}
+
+static uint16_t cacheGet16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void cachePutUUID(std::vector<uint8_t> &blob, const NimBLEUUID &uuid) {
+    const ble_uuid_any_t *u = uuid.getNative();
+    switch(u->u.type) {
+        case BLE_UUID_TYPE_16:
+            blob.push_back(2);
+            cachePut16(blob, u->u16.value);
+            break;
+        case BLE_UUID_TYPE_32:
+            blob.push_back(4);
+            cachePut16(blob, u->u32.value & 0xffff);
+            cachePut16(blob, u->u32.value >> 16);
+            break;
+        default:
+            blob.push_back(16);
+            blob.insert(blob.end(), u->u128.value, u->u128.value + 16);
+            break;
+    }
+}
+
+/* Reads a UUID at p, returns the number of bytes used or 0 if malformed. */
+static size_t cacheGetUUID(const uint8_t *p, const uint8_t *end, ble_uuid_any_t *u) {
+    if(p >= end || p + 1 + p[0] > end) {
+        return 0;
+    }
+
+    switch(p[0]) {
+        case 2:
+            u->u.type = BLE_UUID_TYPE_16;
+            u->u16.value = cacheGet16(p + 1);
+            return 3;
+        case 4:
+            u->u.type = BLE_UUID_TYPE_32;
+            u->u32.value = cacheGet16(p + 1) | ((uint32_t)cacheGet16(p + 3) << 16);
+            return 5;
+        case 16:
+            u->u.type = BLE_UUID_TYPE_128;
+            memcpy(u->u128.value, p + 1, 16);
+            return 17;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * @brief Remove cached attributes.
+ * @param [in] address The identity address of the peer to remove, nullptr removes all peers.
+ */
+void NimBLEClient::clearAttributeCache(const NimBLEAddress *address) {
+    nvs_handle_t handle;
+    if(nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        return;
+    }
+
+    if(address == nullptr) {
+        nvs_erase_all(handle);
+    } else {
+        char key[16];
+        cacheKey(address->getNative(), address->getType(), key);
+        nvs_erase_key(handle, key);
+
+        uint8_t index[CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS * 7];
+        size_t len = sizeof(index);
+        if(nvs_get_blob(handle, CACHE_INDEX_KEY, index, &len) == ESP_OK) {
+            for(size_t i = 0; i + 7 <= len; i += 7) {
+                if(memcmp(index + i, address->getNative(), 6) == 0 && index[i + 6] == address->getType()) {
+                    memmove(index + i, index + i + 7, len - i - 7);
+                    nvs_set_blob(handle, CACHE_INDEX_KEY, index, len - 7);
+                    break;
+                }
+            }
+        }
+    }
+
+    nvs_commit(handle);
+    nvs_close(handle);
+} // clearAttributeCache
+
+
+/**
+ * @brief STATIC Callback for the database hash read.
+ */
+int NimBLEClient::dbHashReadCB(uint16_t conn_handle,
+                               const struct ble_gatt_error *error,
+                               struct ble_gatt_attr *attr, void *arg)
+{
+    ble_task_data_t *pTaskData = (ble_task_data_t*)arg;
+    NimBLEClient *client = (NimBLEClient*)pTaskData->pATT;
+
+    if(client->getConnId() != conn_handle) {
+        return 0;
+    }
+
+    if(error->status == 0) {
+        if(OS_MBUF_PKTLEN(attr->om) == sizeof(client->m_dbHash)) {
+            os_mbuf_copydata(attr->om, 0, sizeof(client->m_dbHash), client->m_dbHash);
+            pTaskData->rc = 0;
+        }
+        return 0;
+    }
+
+    if(error->status != BLE_HS_EDONE) {
+        pTaskData->rc = error->status;
+    }
+
+    NimBLEUtils::taskRelease(pTaskData);
+    return error->status;
+} // dbHashReadCB
+
+
+/**
+ * @brief Read the database hash of the peer into m_dbHash.
+ * @return True if the peer has a database hash and it was read.
+ */
+bool NimBLEClient::readDatabaseHash() {
+    if(m_dbHashValid) {
+        return true;
+    }
+
+    TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
+    ble_task_data_t taskData = {this, cur_task, BLE_HS_ENOENT, nullptr, nullptr};
+
+    int rc = ble_gattc_read_by_uuid(m_conn_id, 1, 0xffff, &DB_HASH_UUID.getNative()->u,
+                                    NimBLEClient::dbHashReadCB, &taskData);
+    if(rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Database hash read failed; rc=%d %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+#ifdef ulTaskNotifyValueClear
+    // Clear the task notification value to ensure we block
+    ulTaskNotifyValueClear(cur_task, ULONG_MAX);
+#endif
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if(taskData.rc != 0) {
+        NIMBLE_LOGD(LOG_TAG, "No database hash; rc=%d", taskData.rc);
+        return false;
+    }
+
+    m_dbHashValid = true;
+    return true;
+} // readDatabaseHash
+
+
+/**
+ * @brief Restore the attributes of the peer from the cache if its database hash is unchanged.
+ * @return True if the attributes were restored, false if they need to be discovered.
+ */
+bool NimBLEClient::loadAttributeCache() {
+    if(!readDatabaseHash()) {
+        return false;
+    }
+
+    nvs_handle_t handle;
+    if(nvs_open(CACHE_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+
+    char key[16];
+    NimBLEAddress idAddr = getConnInfo().getIdAddress();
+    cacheKey(idAddr.getNative(), idAddr.getType(), key);
+
+    size_t len = 0;
+    std::vector<uint8_t> blob;
+    if(nvs_get_blob(handle, key, nullptr, &len) == ESP_OK && len > 17) {
+        blob.resize(len);
+        if(nvs_get_blob(handle, key, blob.data(), &len) != ESP_OK) {
+            blob.clear();
+        }
+    }
+    nvs_close(handle);
+
+    if(blob.empty() || blob[0] != CACHE_VERSION || memcmp(&blob[1], m_dbHash, 16) != 0) {
+        NIMBLE_LOGD(LOG_TAG, "Attribute cache miss for %s", key);
+        return false;
+    }
+
+    const uint8_t *p   = blob.data() + 17;
+    const uint8_t *end = blob.data() + blob.size();
+    NimBLERemoteService        *pSvc = nullptr;
+    NimBLERemoteCharacteristic *pChr = nullptr;
+
+    while(p < end) {
+        uint8_t kind = *p++;
+        ble_uuid_any_t uuid;
+        size_t used = cacheGetUUID(p, end, &uuid);
+        if(used == 0) {
+            break;
+        }
+        p += used;
+
+        if(kind == 'S' && p + 4 <= end) {
+            ble_gatt_svc svc;
+            svc.start_handle = cacheGet16(p);
+            svc.end_handle   = cacheGet16(p + 2);
+            svc.uuid         = uuid;
+            pSvc = new NimBLERemoteService(this, &svc);
+            m_servicesVector.push_back(pSvc);
+            pChr = nullptr;
+            p += 4;
+        } else if(kind == 'C' && pSvc != nullptr && p + 7 <= end) {
+            ble_gatt_chr chr;
+            chr.def_handle = cacheGet16(p);
+            chr.val_handle = cacheGet16(p + 2);
+            chr.properties = p[6];
+            chr.uuid       = uuid;
+            pChr = new NimBLERemoteCharacteristic(pSvc, &chr);
+            pChr->m_endHandle = cacheGet16(p + 4);
+            pSvc->m_characteristicVector.push_back(pChr);
+            p += 7;
+        } else if(kind == 'D' && pChr != nullptr && p + 2 <= end) {
+            ble_gatt_dsc dsc;
+            dsc.handle = cacheGet16(p);
+            dsc.uuid   = uuid;
+            pChr->m_descriptorVector.push_back(new NimBLERemoteDescriptor(pChr, &dsc));
+            p += 2;
+        } else {
+            break;
+        }
+    }
+
+    if(p != end) {
+        NIMBLE_LOGE(LOG_TAG, "Attribute cache for %s is corrupt", key);
+        deleteServices();
+        return false;
+    }
+
+    NIMBLE_LOGI(LOG_TAG, "Restored %d services from the attribute cache", m_servicesVector.size());
+    return true;
+} // loadAttributeCache
+
+
+/**
+ * @brief Save the discovered attributes of the peer to the cache, if it has a database hash.
+ */
+void NimBLEClient::storeAttributeCache() {
+    if(!readDatabaseHash()) {
+        return;
+    }
+
+    std::vector<uint8_t> blob;
+    blob.push_back(CACHE_VERSION);
+    blob.insert(blob.end(), m_dbHash, m_dbHash + sizeof(m_dbHash));
+
+    for(auto svc: m_servicesVector) {
+        blob.push_back('S');
+        cachePutUUID(blob, svc->m_uuid);
+        cachePut16(blob, svc->m_startHandle);
+        cachePut16(blob, svc->m_endHandle);
+
+        for(auto chr: svc->m_characteristicVector) {
+            blob.push_back('C');
+            cachePutUUID(blob, chr->m_uuid);
+            cachePut16(blob, chr->m_defHandle);
+            cachePut16(blob, chr->m_handle);
+            cachePut16(blob, chr->m_endHandle);
+            blob.push_back(chr->m_charProp);
+
+            for(auto dsc: chr->m_descriptorVector) {
+                blob.push_back('D');
+                cachePutUUID(blob, dsc->m_uuid);
+                cachePut16(blob, dsc->m_handle);
+            }
+        }
+    }
+
+    nvs_handle_t handle;
+    if(nvs_open(CACHE_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Could not open the attribute cache");
+        return;
+    }
+
+    NimBLEAddress idAddr = getConnInfo().getIdAddress();
+    char key[16];
+    cacheKey(idAddr.getNative(), idAddr.getType(), key);
+
+    // Move this peer to the front of the index, evicting the least recently used peer if full.
+    uint8_t index[(CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS + 1) * 7];
+    size_t len = sizeof(index) - 7;
+    if(nvs_get_blob(handle, CACHE_INDEX_KEY, index + 7, &len) != ESP_OK) {
+        len = 0;
+    }
+    memcpy(index, idAddr.getNative(), 6);
+    index[6] = idAddr.getType();
+    len += 7;
+
+    for(size_t i = 7; i + 7 <= len; i += 7) {
+        if(memcmp(index + i, index, 7) == 0) {
+            memmove(index + i, index + i + 7, len - i - 7);
+            len -= 7;
+            break;
+        }
+    }
+
+    if(len > CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS * 7) {
+        len -= 7;
+        char evictKey[16];
+        cacheKey(index + len, index[len + 6], evictKey);
+        nvs_erase_key(handle, evictKey);
+    }
+
+    esp_err_t err = nvs_set_blob(handle, key, blob.data(), blob.size());
+    if(err == ESP_OK) {
+        err = nvs_set_blob(handle, CACHE_INDEX_KEY, index, len);
+    }
+    if(err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if(err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Could not store the attribute cache; err=%d", err);
+    } else {
+        NIMBLE_LOGD(LOG_TAG, "Cached %d bytes of attributes for %s", blob.size(), key);
+    }
+} // storeAttributeCache
+#endif // CONFIG_NIMBLE_CPP_GATT_CACHE
+
+
 /**
  * @brief Ask the remote %BLE server for its services.\n
  * Here we ask the server for its set of services and wait until we have received them all.
@@ -754,7 +1559,7 @@ bool NimBLEClient::retrieveServices(const NimBLEUUID *uuid_filter) {
 
     int rc = 0;
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     if(uuid_filter == nullptr) {
         rc = ble_gattc_disc_all_svcs(m_conn_id, NimBLEClient::serviceDiscoveredCB, &taskData);
@@ -826,7 +1631,7 @@ int NimBLEClient::serviceDiscoveredCB(
         pTaskData->rc = error->status;
     }
 
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     NIMBLE_LOGD(LOG_TAG,"<< Service Discovered");
     return error->status;
@@ -913,6 +1718,271 @@ NimBLERemoteCharacteristic* NimBLEClient::getCharacteristic(const uint16_t handl
     return nullptr;
 }
 
+/**
+ * @brief Queue a read of a remote attribute without blocking.
+ * @param [in] handle The handle of the attribute to read.
+ * @param [in] callback Called from the host task with the result, values longer than the MTU\n
+ * are read with as many requests as needed.
+ * @return True if the operation was queued.
+ * @details Operations run one after another in the order queued, a single request is\n
+ * outstanding on the link at a time as required by ATT.
+ */
+bool NimBLEClient::readValueAsync(uint16_t handle, gatt_op_callback callback) {
+    GattOp *op = new GattOp();
+    op->type       = GattOp::READ;
+    op->count      = 1;
+    op->handles[0] = handle;
+    op->callback   = callback;
+    return queueOp(op);
+} // readValueAsync
+
+
+/**
+ * @brief Queue a read of several remote attributes with a single Read Multiple request.
+ * @param [in] handles The handles of the attributes to read.
+ * @param [in] count The number of handles, at most MAX_READ_MULT.
+ * @param [in] callback Called from the host task with the values concatenated in handle order.\n
+ * Only the last value may be variable length, the response holds at most MTU - 1 bytes.
+ * @return True if the operation was queued.
+ */
+bool NimBLEClient::readValuesAsync(const uint16_t *handles, uint8_t count, gatt_op_callback callback) {
+    if(count == 0 || count > MAX_READ_MULT) {
+        NIMBLE_LOGE(LOG_TAG, "Read multiple of %u handles, max=%u", count, MAX_READ_MULT);
+        return false;
+    }
+
+    GattOp *op = new GattOp();
+    op->type     = GattOp::READ_MULT;
+    op->count    = count;
+    op->callback = callback;
+    memcpy(op->handles, handles, count * sizeof(uint16_t));
+    return queueOp(op);
+} // readValuesAsync
+
+
+/**
+ * @brief Queue a write to a remote attribute without blocking.
+ * @param [in] handle The handle of the attribute to write.
+ * @param [in] data A pointer to the data to write, it is copied.
+ * @param [in] length The length of the data.
+ * @param [in] response True to write with response, values longer than the MTU allow are always\n
+ * written with a long write.
+ * @param [in] callback Optional, called from the host task once the peer responded, or once the\n
+ * write without response was handed to the host.
+ * @return True if the operation was queued.
+ * @details Consecutive writes without response are sent back to back without waiting for\n
+ * a response, when the host runs out of buffers they are retried shortly after.
+ */
+bool NimBLEClient::writeValueAsync(uint16_t handle, const uint8_t *data, size_t length,
+                                   bool response, gatt_op_callback callback)
+{
+    if(length > BLE_ATT_ATTR_MAX_LEN) {
+        NIMBLE_LOGE(LOG_TAG, "Write of %u bytes, max=%d", length, BLE_ATT_ATTR_MAX_LEN);
+        return false;
+    }
+
+    GattOp *op = new GattOp();
+    op->type       = response ? GattOp::WRITE : GattOp::WRITE_NO_RSP;
+    op->count      = 1;
+    op->handles[0] = handle;
+    op->callback   = callback;
+    op->value.setValue(data, length);
+    return queueOp(op);
+} // writeValueAsync
+
+
+/**
+ * @brief Get the number of queued GATT operations that have not completed.
+ */
+size_t NimBLEClient::getPendingOpCount() {
+    size_t count = 0;
+    ble_npl_hw_enter_critical();
+    for(GattOp *op = m_opHead; op != nullptr; op = op->next) {
+        count++;
+    }
+    ble_npl_hw_exit_critical(0);
+    return count;
+} // getPendingOpCount
+
+
+/**
+ * @brief Append an operation to the queue and start it if nothing is running.
+ */
+bool NimBLEClient::queueOp(GattOp *op) {
+    if(!isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "Disconnected");
+        delete op;
+        return false;
+    }
+
+    op->next = nullptr;
+    bool start = false;
+
+    ble_npl_hw_enter_critical();
+    if(m_opTail != nullptr) {
+        m_opTail->next = op;
+    } else {
+        m_opHead = op;
+    }
+    m_opTail = op;
+
+    if(!m_opBusy) {
+        m_opBusy = start = true;
+    }
+    ble_npl_hw_exit_critical(0);
+
+    // Run the queue in the host task so every callback is made from there.
+    if(start) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_opEvent);
+    }
+
+    return true;
+} // queueOp
+
+
+/**
+ * @brief Start operations from the head of the queue until one has to wait for the peer.
+ * @details The caller must own m_opBusy, it is released when the queue is empty.
+ */
+void NimBLEClient::runOps() {
+    for(;;) {
+        ble_npl_hw_enter_critical();
+        GattOp *op = m_opHead;
+        if(op == nullptr) {
+            m_opBusy = false;
+        }
+        ble_npl_hw_exit_critical(0);
+
+        if(op == nullptr) {
+            return;
+        }
+
+        if(m_conn_id == BLE_HS_CONN_HANDLE_NONE) {
+            finishOp(BLE_HS_ENOTCONN);
+            continue;
+        }
+
+        int rc;
+        uint16_t mtu = ble_att_mtu(m_conn_id) - 3;
+
+        switch(op->type) {
+            case GattOp::READ:
+                op->value = NimBLEAttValue();
+                rc = ble_gattc_read_long(m_conn_id, op->handles[0], 0, NimBLEClient::opCB, this);
+                break;
+
+            case GattOp::READ_MULT:
+                rc = ble_gattc_read_mult(m_conn_id, op->handles, op->count, NimBLEClient::opCB, this);
+                break;
+
+            case GattOp::WRITE_NO_RSP:
+                if(op->value.size() <= mtu) {
+                    rc = ble_gattc_write_no_rsp_flat(m_conn_id, op->handles[0],
+                                                     op->value.data(), op->value.size());
+                    if(rc == BLE_HS_ENOMEM) {
+                        // Out of mbufs, try again once the host had a chance to send some.
+                        ble_npl_callout_reset(&m_opTimer, 1);
+                        return;
+                    }
+
+                    finishOp(rc);
+                    continue;
+                }
+                // Too long for a single packet, fall back to a long write like writeValue().
+                /* falls through */
+
+            case GattOp::WRITE:
+                if(op->value.size() > mtu) {
+                    os_mbuf *om = ble_hs_mbuf_from_flat(op->value.data(), op->value.size());
+                    rc = ble_gattc_write_long(m_conn_id, op->handles[0], 0, om, NimBLEClient::opCB, this);
+                } else {
+                    rc = ble_gattc_write_flat(m_conn_id, op->handles[0], op->value.data(),
+                                              op->value.size(), NimBLEClient::opCB, this);
+                }
+                break;
+
+            default:
+                rc = BLE_HS_EINVAL;
+                break;
+        }
+
+        if(rc == 0) {
+            // opCB continues the queue when the peer responds.
+            return;
+        }
+
+        NIMBLE_LOGE(LOG_TAG, "GATT operation on handle %d failed; rc=%d %s",
+                    op->handles[0], rc, NimBLEUtils::returnCodeToString(rc));
+        finishOp(rc);
+    }
+} // runOps
+
+
+/**
+ * @brief Remove the head operation from the queue and report its result.
+ */
+void NimBLEClient::finishOp(int rc) {
+    ble_npl_hw_enter_critical();
+    GattOp *op = m_opHead;
+    m_opHead = op->next;
+    if(m_opHead == nullptr) {
+        m_opTail = nullptr;
+    }
+    ble_npl_hw_exit_critical(0);
+
+    if(op->callback != nullptr) {
+        op->callback(rc, op->value);
+    }
+
+    delete op;
+} // finishOp
+
+
+/**
+ * @brief STATIC Callback for the GATT procedure of the operation at the head of the queue.
+ */
+int NimBLEClient::opCB(uint16_t conn_handle, const struct ble_gatt_error *error,
+                       struct ble_gatt_attr *attr, void *arg)
+{
+    NimBLEClient *pClient = (NimBLEClient*)arg;
+    GattOp *op = pClient->m_opHead;
+    int rc = error->status;
+
+    if(rc == 0 && attr != nullptr && (op->type == GattOp::READ || op->type == GattOp::READ_MULT)) {
+        if(op->value.size() + OS_MBUF_PKTLEN(attr->om) > BLE_ATT_ATTR_MAX_LEN) {
+            rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        } else {
+            for(os_mbuf *om = attr->om; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+                op->value.append(om->om_data, om->om_len);
+            }
+
+            // Long reads call back once per part and then with BLE_HS_EDONE.
+            if(op->type == GattOp::READ) {
+                return 0;
+            }
+        }
+    }
+
+    if(rc == BLE_HS_EDONE || rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG)) {
+        rc = 0;
+    }
+
+    pClient->finishOp(rc);
+    pClient->runOps();
+    return rc;
+} // opCB
+
+
+/**
+ * @brief STATIC Run the queue in the host task, once an operation was queued or after the host\n
+ * ran out of buffers for the writes without response.
+ */
+void NimBLEClient::runOpsCb(ble_npl_event *event) {
+    NimBLEClient *pClient = (NimBLEClient*)ble_npl_event_get_arg(event);
+    pClient->runOps();
+} // runOpsCb
+
+
 /**
  * @brief Get the current mtu of this connection.
  * @returns The MTU value.
@@ -963,7 +2033,7 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event *event, void *arg) {
             NimBLEDevice::removeIgnored(pClient->m_peerAddress);
 
             // No longer connected, clear the connection ID.
-            pClient->m_conn_id = BLE_HS_CONN_HANDLE_NONE;
+            NimBLEDevice::setClientConnId(pClient, BLE_HS_CONN_HANDLE_NONE);
 
             // If we received a connected event but did not get established (no PDU)
             // then a disconnect event will be sent but we should not send it to the
@@ -992,7 +2062,7 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event *event, void *arg) {
             if (rc == 0) {
                 NIMBLE_LOGI(LOG_TAG, "Connected event");
 
-                pClient->m_conn_id = event->connect.conn_handle;
+                NimBLEDevice::setClientConnId(pClient, event->connect.conn_handle);
 
                 rc = ble_gattc_exchange_mtu(pClient->m_conn_id, NULL,NULL);
                 if(rc != 0) {
@@ -1005,7 +2075,7 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event *event, void *arg) {
                 // scanning since we are already connected to it
                 NimBLEDevice::addIgnored(pClient->m_peerAddress);
             } else {
-                pClient->m_conn_id = BLE_HS_CONN_HANDLE_NONE;
+                NimBLEDevice::setClientConnId(pClient, BLE_HS_CONN_HANDLE_NONE);
                 break;
             }
 
@@ -1188,11 +2258,11 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event *event, void *arg) {
     } // Switch
 
     if(pClient->m_pTaskData != nullptr) {
-        pClient->m_pTaskData->rc = rc;
-        if(pClient->m_pTaskData->task) {
-            xTaskNotifyGive(pClient->m_pTaskData->task);
-        }
+        // Cleared first, an asynchronous continuation may start the next operation.
+        ble_task_data_t *pTaskData = pClient->m_pTaskData;
         pClient->m_pTaskData = nullptr;
+        pTaskData->rc = rc;
+        NimBLEUtils::taskRelease(pTaskData);
     }
 
     return 0;
@@ -23,11 +23,52 @@
 #include "NimBLEConnInfo.h"
 #include "NimBLEAttValue.h"
 #include "NimBLEAdvertisedDevice.h"
+
+#include <functional>
+
+/**
+ * @brief Completion callback of a queued GATT operation.
+ * @param [in] rc 0 on success, otherwise the NimBLE error code.
+ * @param [in] value The value read, or the value written for write operations.
+ * @details Called from the NimBLE host task, do not block. Reads and writes with response\n
+ * complete when the peer responds, writes without response once handed to the host.\n
+ * Defined before the remote attribute headers are included, they use it too.
+ */
+typedef std::function<void (int rc, const NimBLEAttValue &value)> gatt_op_callback;
+
+class NimBLEClient;
+
+/**
+ * @brief Completion callback of the asynchronous connect, security and discovery calls.
+ * @param [in] pClient The client that ran the operation.
+ * @param [in] rc 0 on success, otherwise the NimBLE error code.
+ * @details Called from the NimBLE host task, do not block. It may start the next operation.
+ */
+typedef std::function<void (NimBLEClient* pClient, int rc)> client_op_callback;
+
+/**
+ * @brief Descriptor discovery filter, the client keeps one for its asynchronous discovery.
+ */
+typedef struct {
+    const NimBLEUUID *uuid;
+    void *task_data;
+} desc_filter_t;
+
 #include "NimBLERemoteService.h"
 
 #include <vector>
 #include <string>
 
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+#  if !defined(CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS)
+#    define CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS 4
+#  elif CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS > 16
+#    error CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS cannot be larger than 16
+#  elif CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS < 1
+#    error CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS cannot be less than 1; Range = 1 : 16
+#  endif
+#endif
+
 class NimBLERemoteService;
 class NimBLERemoteCharacteristic;
 class NimBLEClientCallbacks;
@@ -41,6 +82,8 @@ public:
     bool                                        connect(NimBLEAdvertisedDevice* device, bool deleteAttributes = true);
     bool                                        connect(const NimBLEAddress &address, bool deleteAttributes = true);
     bool                                        connect(bool deleteAttributes = true);
+    bool                                        connectAsync(const NimBLEAddress &address, client_op_callback callback,
+                                                             bool deleteAttributes = true);
     int                                         disconnect(uint8_t reason = BLE_ERR_REM_USER_CONN_TERM);
     NimBLEAddress                               getPeerAddress();
     void                                        setPeerAddress(const NimBLEAddress &address);
@@ -63,6 +106,7 @@ public:
     uint16_t                                    getConnId();
     uint16_t                                    getMTU();
     bool                                        secureConnection();
+    bool                                        secureConnectionAsync(client_op_callback callback);
     void                                        setConnectTimeout(uint32_t timeout);
     void                                        setConnectionParams(uint16_t minInterval, uint16_t maxInterval,
                                                                     uint16_t latency, uint16_t timeout,
@@ -71,16 +115,45 @@ public:
                                                                  uint16_t latency, uint16_t timeout);
     void                                        setDataLen(uint16_t tx_octets);
     bool                                        discoverAttributes();
+    bool                                        discoverAttributesAsync(client_op_callback callback);
+    bool                                        readValueAsync(uint16_t handle, gatt_op_callback callback);
+    bool                                        readValuesAsync(const uint16_t *handles, uint8_t count,
+                                                                gatt_op_callback callback);
+    bool                                        writeValueAsync(uint16_t handle, const uint8_t *data, size_t length,
+                                                                bool response = false,
+                                                                gatt_op_callback callback = nullptr);
+    size_t                                      getPendingOpCount();
     NimBLEConnInfo                              getConnInfo();
     int                                         getLastError();
 #if CONFIG_BT_NIMBLE_EXT_ADV
     void                                        setConnectPhy(uint8_t mask);
 #endif
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    static void                                 clearAttributeCache(const NimBLEAddress *address = nullptr);
+#endif
+
+    /** @brief Maximum number of handles read by one readValuesAsync() call. */
+    static constexpr uint8_t MAX_READ_MULT = 8;
 
 private:
     NimBLEClient(const NimBLEAddress &peerAddress);
     ~NimBLEClient();
 
+    /* A queued GATT operation; only the head of the queue has a procedure running in the host. */
+    struct GattOp {
+        enum : uint8_t { READ, READ_MULT, WRITE, WRITE_NO_RSP };
+        GattOp*             next;
+        uint8_t             type;
+        uint8_t             count;
+        uint16_t            handles[MAX_READ_MULT];
+        NimBLEAttValue      value;
+        gatt_op_callback    callback;
+    };
+
+    /* Step of the asynchronous operation in progress, they run one at a time. */
+    enum : uint8_t { ASYNC_NONE, ASYNC_CONNECT, ASYNC_SECURE, ASYNC_DB_HASH, ASYNC_SERVICES,
+                     ASYNC_CHARACTERISTICS, ASYNC_DESCRIPTORS };
+
     friend class            NimBLEDevice;
     friend class            NimBLERemoteService;
 
@@ -90,20 +163,63 @@ private:
                                                 const struct ble_gatt_svc *service,
                                                 void *arg);
     static void             dcTimerCb(ble_npl_event *event);
+    static void             runOpsCb(ble_npl_event *event);
+    static int              opCB(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                 struct ble_gatt_attr *attr, void *arg);
+    bool                    queueOp(GattOp *op);
+    void                    runOps();
+    void                    finishOp(int rc);
+    bool                    prepareConnect(const NimBLEAddress &address);
+    int                     startConnect();
+    static void             asyncResume(ble_task_data_t *pTaskData);
+    static void             asyncTimerCb(ble_npl_event *event);
+    void                    startAsync(uint8_t state, client_op_callback callback);
+    void                    finishAsync(int rc);
+    int                     discoverServicesAsync();
+    void                    discoverNextService();
+    void                    discoverNextCharacteristic();
     bool                    retrieveServices(const NimBLEUUID *uuid_filter = nullptr);
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    static int              dbHashReadCB(uint16_t conn_handle,
+                                         const struct ble_gatt_error *error,
+                                         struct ble_gatt_attr *attr,
+                                         void *arg);
+    bool                    readDatabaseHash();
+    bool                    loadAttributeCache();
+    void                    storeAttributeCache();
+#endif
 
     NimBLEAddress           m_peerAddress;
     int                     m_lastErr;
     uint16_t                m_conn_id;
+    uint8_t                 m_clientSlot;
     bool                    m_connEstablished;
     bool                    m_deleteCallbacks;
     int32_t                 m_connectTimeout;
     NimBLEClientCallbacks*  m_pClientCallbacks;
     ble_task_data_t*        m_pTaskData;
     ble_npl_callout         m_dcTimer;
+    ble_npl_callout         m_opTimer;
+    ble_npl_event           m_opEvent;
+    GattOp*                 m_opHead;
+    GattOp*                 m_opTail;
+    bool                    m_opBusy;
+    ble_task_data_t         m_asyncData;
+    desc_filter_t           m_asyncFilter;
+    client_op_callback      m_asyncCallback;
+    ble_npl_callout         m_asyncTimer;
+    uint8_t                 m_asyncState;
+    uint8_t                 m_asyncRetry;
+    bool                    m_asyncDeleteAttributes;
+    size_t                  m_asyncService;
+    size_t                  m_asyncCharacteristic;
 #if CONFIG_BT_NIMBLE_EXT_ADV
     uint8_t                 m_phyMask;
 #endif
+#if defined(CONFIG_NIMBLE_CPP_GATT_CACHE)
+    uint8_t                 m_dbHash[16];
+    bool                    m_dbHashValid;
+#endif
 
     std::vector<NimBLERemoteService*> m_servicesVector;
 
@@ -0,0 +1,276 @@
+/*
+ * NimBLEClientRegistry.cpp
+ *
+ *  The NimBLEDevice client slots and their connection handle / peer address indexes.
+ *  Kept apart from NimBLEDevice.cpp, it only needs the client class, not the host stack.
+ */
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_ENABLED) && defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL)
+
+#include "NimBLEDevice.h"
+#include "NimBLEClient.h"
+#include "NimBLELog.h"
+
+#include <cstring>
+
+static const char* LOG_TAG = "NimBLEDevice";
+
+NimBLEClient*               NimBLEDevice::m_pClients[NIMBLE_MAX_CONNECTIONS] = {};
+uint8_t                     NimBLEDevice::m_clientCount = 0;
+uint8_t                     NimBLEDevice::m_clientHandleIndex[CLIENT_INDEX_SIZE];
+uint8_t                     NimBLEDevice::m_clientAddressIndex[CLIENT_INDEX_SIZE];
+
+
+/**
+ * @brief Creates a new client object and maintains a list of all client objects
+ * each client can connect to 1 peripheral device.
+ * @param [in] peerAddress An optional peer address that is copied to the new client
+ * object, allows for calling NimBLEClient::connect(bool) without a device or address parameter.
+ * @return A reference to the new client object, or nullptr if there are already
+ * NIMBLE_MAX_CONNECTIONS clients.
+ */
+/* STATIC */
+NimBLEClient* NimBLEDevice::createClient(NimBLEAddress peerAddress) {
+    static_assert(NIMBLE_MAX_CONNECTIONS < CLIENT_NONE, "Client slots must fit the index entries");
+
+    if(m_clientCount == 0) {
+        memset(m_clientHandleIndex, CLIENT_NONE, sizeof(m_clientHandleIndex));
+        memset(m_clientAddressIndex, CLIENT_NONE, sizeof(m_clientAddressIndex));
+    }
+
+    uint8_t slot = 0;
+    while(slot < NIMBLE_MAX_CONNECTIONS && m_pClients[slot] != nullptr) {
+        slot++;
+    }
+    if(slot == NIMBLE_MAX_CONNECTIONS) {
+        NIMBLE_LOGE(LOG_TAG, "Cannot create client, all %d in use", NIMBLE_MAX_CONNECTIONS);
+        return nullptr;
+    }
+
+    NimBLEClient* pClient = new NimBLEClient(peerAddress);
+    pClient->m_clientSlot = slot;
+    m_pClients[slot] = pClient;
+    m_clientCount++;
+    clientIndexInsert(m_clientAddressIndex, clientAddressHome(slot), slot);
+
+    return pClient;
+} // createClient
+
+
+/**
+ * @brief Free the slot of a client that is neither connected nor connecting, and delete it.
+ * @param [in] pClient The client, created by createClient.
+ */
+/* STATIC */
+void NimBLEDevice::removeClient(NimBLEClient* pClient) {
+    uint8_t slot = pClient->m_clientSlot;
+    if(pClient->m_conn_id != BLE_HS_CONN_HANDLE_NONE) {
+        clientIndexRemove(m_clientHandleIndex, clientHandleHome, slot);
+    }
+    clientIndexRemove(m_clientAddressIndex, clientAddressHome, slot);
+    m_pClients[slot] = nullptr;
+    m_clientCount--;
+    delete pClient;
+} // removeClient
+
+
+/**
+ * @brief Get the created client objects.
+ * @return A vector of the clients, in slot order.
+ */
+/* STATIC */
+std::vector<NimBLEClient*> NimBLEDevice::getClients() {
+    std::vector<NimBLEClient*> clients;
+    clients.reserve(m_clientCount);
+    for(uint8_t i = 0; i < NIMBLE_MAX_CONNECTIONS; i++) {
+        if(m_pClients[i] != nullptr) {
+            clients.push_back(m_pClients[i]);
+        }
+    }
+    return clients;
+} // getClients
+
+
+/**
+ * @brief Get the number of created client objects.
+ * @return Number of client objects created.
+ */
+/* STATIC */
+size_t NimBLEDevice::getClientListSize() {
+    return m_clientCount;
+} // getClientList
+
+
+/**
+ * @brief Get a reference to a client by connection ID.
+ * @param [in] conn_id The client connection ID to search for.
+ * @return A pointer to the client object with the spcified connection ID or nullptr if not found.
+ */
+/* STATIC */
+NimBLEClient* NimBLEDevice::getClientByID(uint16_t conn_id) {
+    if(m_clientCount == 0 || conn_id == BLE_HS_CONN_HANDLE_NONE) {
+        return nullptr;
+    }
+
+    for(uint16_t i = conn_id & (CLIENT_INDEX_SIZE - 1); m_clientHandleIndex[i] != CLIENT_NONE;
+        i = (i + 1) & (CLIENT_INDEX_SIZE - 1)) {
+        NimBLEClient* pClient = m_pClients[m_clientHandleIndex[i]];
+        if(pClient->m_conn_id == conn_id) {
+            return pClient;
+        }
+    }
+    return nullptr;
+} // getClientByID
+
+
+/**
+ * @brief Get a reference to a client by peer address.
+ * @param [in] peer_addr The address of the peer to search for.
+ * @return A pointer to the client object with the peer address.
+ */
+/* STATIC */
+NimBLEClient* NimBLEDevice::getClientByPeerAddress(const NimBLEAddress &peer_addr) {
+    if(m_clientCount == 0) {
+        return nullptr;
+    }
+
+    for(uint16_t i = clientAddressHash(peer_addr); m_clientAddressIndex[i] != CLIENT_NONE; i = (i + 1) & (CLIENT_INDEX_SIZE - 1)) {
+        NimBLEClient* pClient = m_pClients[m_clientAddressIndex[i]];
+        if(pClient->m_peerAddress == peer_addr) {
+            return pClient;
+        }
+    }
+    return nullptr;
+} // getClientPeerAddress
+
+
+/**
+ * @brief Finds the first disconnected client in the list.
+ * @return A pointer to the first client object that is not connected to a peer.
+ */
+/* STATIC */
+NimBLEClient* NimBLEDevice::getDisconnectedClient() {
+    for(uint8_t i = 0; i < NIMBLE_MAX_CONNECTIONS; i++) {
+        if(m_pClients[i] != nullptr && !m_pClients[i]->isConnected()) {
+            return m_pClients[i];
+        }
+    }
+    return nullptr;
+} // getDisconnectedClient
+
+
+/**
+ * @brief Position the client in a slot starts probing from in the handle index.
+ */
+/* STATIC */
+uint16_t NimBLEDevice::clientHandleHome(uint8_t slot) {
+    // Handles are small and sequential, they spread well without hashing
+    return m_pClients[slot]->m_conn_id & (CLIENT_INDEX_SIZE - 1);
+} // clientHandleHome
+
+
+/**
+ * @brief Hash a peer address into a starting position in the address index.
+ */
+/* STATIC */
+uint16_t NimBLEDevice::clientAddressHash(const NimBLEAddress &address) {
+    return address.hash() & (CLIENT_INDEX_SIZE - 1);
+} // clientAddressHash
+
+
+/**
+ * @brief Position the client in a slot starts probing from in the address index.
+ */
+/* STATIC */
+uint16_t NimBLEDevice::clientAddressHome(uint8_t slot) {
+    return clientAddressHash(m_pClients[slot]->m_peerAddress);
+} // clientAddressHome
+
+
+/**
+ * @brief Add a client slot to a client index.
+ * @param [in] index The index to add to.
+ * @param [in] home The position of the slot's key in the index.
+ * @param [in] slot The client slot.
+ */
+/* STATIC */
+void NimBLEDevice::clientIndexInsert(uint8_t *index, uint16_t home, uint8_t slot) {
+    // Never full, it has at least twice as many entries as there are clients
+    while(index[home] != CLIENT_NONE) {
+        home = (home + 1) & (CLIENT_INDEX_SIZE - 1);
+    }
+    index[home] = slot;
+} // clientIndexInsert
+
+
+/**
+ * @brief Remove a client slot from a client index, while its key is still the indexed one.
+ * @param [in] index The index to remove from.
+ * @param [in] homeOf Returns the position of the key of a slot in this index.
+ * @param [in] slot The client slot.
+ */
+/* STATIC */
+void NimBLEDevice::clientIndexRemove(uint8_t *index, uint16_t (*homeOf)(uint8_t), uint8_t slot) {
+    const uint16_t mask = CLIENT_INDEX_SIZE - 1;
+    uint16_t i = homeOf(slot);
+    while(index[i] != slot) {
+        if(index[i] == CLIENT_NONE) {
+            NIMBLE_LOGE(LOG_TAG, "Client %u missing from index", slot);
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // Backward shift deletion, as in NimBLEScan::freeDevice.
+    uint16_t j = i;
+    for(;;) {
+        j = (j + 1) & mask;
+        if(index[j] == CLIENT_NONE) {
+            break;
+        }
+        uint16_t home = homeOf(index[j]);
+        if(((j - home) & mask) >= ((j - i) & mask)) {
+            index[i] = index[j];
+            i = j;
+        }
+    }
+    index[i] = CLIENT_NONE;
+} // clientIndexRemove
+
+
+/**
+ * @brief Change the connection handle of a client and keep the handle index in step.
+ * @param [in] pClient The client.
+ * @param [in] conn_id The new handle, BLE_HS_CONN_HANDLE_NONE when disconnected.
+ */
+/* STATIC */
+void NimBLEDevice::setClientConnId(NimBLEClient* pClient, uint16_t conn_id) {
+    uint8_t slot = pClient->m_clientSlot;
+    if(pClient->m_conn_id != BLE_HS_CONN_HANDLE_NONE) {
+        clientIndexRemove(m_clientHandleIndex, clientHandleHome, slot);
+    }
+    pClient->m_conn_id = conn_id;
+    if(conn_id != BLE_HS_CONN_HANDLE_NONE) {
+        clientIndexInsert(m_clientHandleIndex, clientHandleHome(slot), slot);
+    }
+} // setClientConnId
+
+
+/**
+ * @brief Change the peer address of a client and keep the address index in step.
+ * @param [in] pClient The client.
+ * @param [in] address The new peer address.
+ */
+/* STATIC */
+void NimBLEDevice::setClientPeerAddress(NimBLEClient* pClient, const NimBLEAddress &address) {
+    uint8_t slot = pClient->m_clientSlot;
+    if(pClient->m_peerAddress == address) {
+        return;
+    }
+    clientIndexRemove(m_clientAddressIndex, clientAddressHome, slot);
+    pClient->m_peerAddress = address;
+    clientIndexInsert(m_clientAddressIndex, clientAddressHome(slot), slot);
+} // setClientPeerAddress
+
+#endif // CONFIG_BT_ENABLED && CONFIG_BT_NIMBLE_ROLE_CENTRAL
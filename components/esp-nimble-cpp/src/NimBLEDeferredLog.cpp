@@ -0,0 +1,376 @@
+/*
+ * NimBLEDeferredLog.cpp
+ *
+ *  Lock-free per-core ring buffers holding the deferred log records.
+ */
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_ENABLED) && defined(CONFIG_NIMBLE_CPP_LOG_DEFERRED)
+
+#include "NimBLEDeferredLog.h"
+#include "NimBLELog.h"
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+static const char* LOG_TAG = "NimBLEDeferredLog";
+
+namespace {
+/*
+ * Writers on one core reserve space by advancing head with a CAS, so a record written from an
+ * interrupt may be reserved inside a record of a preempted task; the reader stops at the first
+ * record that is not committed yet. A record never wraps, the end of the buffer is filled with
+ * a pad record instead. Released space is zeroed so a header only gets the commit bit from commit().
+ */
+struct Ring {
+    uint32_t head;
+    uint32_t tail;
+    alignas(4) uint8_t buf[CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE];
+};
+} // namespace
+
+static constexpr uint32_t RING_SIZE = CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE;
+static constexpr uint32_t RING_MASK = RING_SIZE - 1;
+
+static Ring     s_rings[portNUM_PROCESSORS];
+static uint32_t s_dropped;
+static bool     s_reading;
+static bool     s_taskStarted;
+
+
+/**
+ * @brief Reserves a record in the ring of the calling core.
+ * @param [in] len The record length, a multiple of 4.
+ * @return A pointer to the record header or nullptr if the record was dropped.
+ */
+uint32_t* NimBLEDeferredLog::reserve(size_t len) {
+    // Large records would make the ring mostly padding, they are not worth deferring
+    if (len > RECORD_MAX || len > RING_SIZE / 4) {
+        __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+        return nullptr;
+    }
+
+    Ring& ring = s_rings[xPortGetCoreID()];
+    uint32_t head = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+    uint32_t pos;
+    uint32_t pad;
+    do {
+        pos = head & RING_MASK;
+        pad = (pos + len > RING_SIZE) ? RING_SIZE - pos : 0;
+        if (head + pad + len - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) > RING_SIZE) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return nullptr;
+        }
+    } while (!__atomic_compare_exchange_n(&ring.head, &head, head + pad + len, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    if (pad > 0) {
+        __atomic_store_n(reinterpret_cast<uint32_t*>(&ring.buf[pos]), REC_COMMIT | REC_PAD | pad,
+                         __ATOMIC_RELEASE);
+        pos = 0;
+    }
+    return reinterpret_cast<uint32_t*>(&ring.buf[pos]);
+} // reserve
+
+
+/**
+ * @brief Publishes a record filled after reserve().
+ */
+void NimBLEDeferredLog::commit(uint32_t* hdr, uint8_t level, size_t len) {
+    __atomic_store_n(hdr, REC_COMMIT | (uint32_t)(level & 0x7) << 16 | len, __ATOMIC_RELEASE);
+} // commit
+
+
+/**
+ * @brief Hands the committed records to a handler, oldest first across the cores.
+ * @details Waits while another task reads, readers are tasks and never hold the flag for long.
+ * @param [in] handle Called as handle(core, header, record), returns false to stop reading
+ * and keep that record.
+ * @return The number of records handled.
+ */
+template<typename F>
+size_t NimBLEDeferredLog::read(F&& handle) {
+    while (__atomic_test_and_set(&s_reading, __ATOMIC_ACQUIRE)) {
+        vTaskDelay(1);
+    }
+
+    size_t count = 0;
+    for (;;) {
+        int      best = -1;
+        uint32_t bestTime = 0;
+
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            Ring& ring = s_rings[core];
+            uint32_t tail = ring.tail;
+            uint32_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+            while (tail != head) {
+                uint8_t* rec = &ring.buf[tail & RING_MASK];
+                uint32_t hdr = __atomic_load_n(reinterpret_cast<uint32_t*>(rec), __ATOMIC_ACQUIRE);
+                if (!(hdr & REC_COMMIT)) {
+                    break;
+                }
+                if (!(hdr & REC_PAD)) {
+                    uint32_t time;
+                    memcpy(&time, rec + 12, sizeof time);
+                    if (best < 0 || (int32_t)(time - bestTime) < 0) {
+                        best = core;
+                        bestTime = time;
+                    }
+                    break;
+                }
+                tail += hdr & 0xFFFF;
+                memset(rec, 0, hdr & 0xFFFF);
+                __atomic_store_n(&ring.tail, tail, __ATOMIC_RELEASE);
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        Ring& ring = s_rings[best];
+        uint8_t* rec = &ring.buf[ring.tail & RING_MASK];
+        uint32_t hdr = *reinterpret_cast<uint32_t*>(rec);
+        if (!handle((uint8_t)best, hdr, rec)) {
+            break;
+        }
+        memset(rec, 0, hdr & 0xFFFF);
+        __atomic_store_n(&ring.tail, ring.tail + (hdr & 0xFFFF), __ATOMIC_RELEASE);
+        count++;
+    }
+
+    __atomic_clear(&s_reading, __ATOMIC_RELEASE);
+    return count;
+} // read
+
+
+/**
+ * @brief Moves the pending records into a buffer in the dump layout for the host decoder.
+ * @param [in] out The buffer, at least RECORD_MAX bytes to be sure the oldest record fits.
+ * @param [in] len The size of the buffer.
+ * @return The number of bytes written, records that do not fit stay queued. A record larger than
+ * the whole buffer can never be dumped, it is dropped and counted instead of stalling the reader.
+ */
+size_t NimBLEDeferredLog::dump(uint8_t* out, size_t len) {
+    size_t used = 0;
+    read([&](uint8_t core, uint32_t hdr, const uint8_t* rec) {
+        // The dump header has the same length as the ring header, the arguments are copied as is
+        uint16_t size = hdr & 0xFFFF;
+        if (size > len) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+        if (used + size > len) {
+            return false;
+        }
+
+        uint8_t* d = out + used;
+        memcpy(d, &size, sizeof size);
+        d[2] = (hdr >> 16) & 0x7;
+        d[3] = core;
+        memcpy(d + 4, rec + 12, 4);
+        memcpy(d + 8, rec + 4, 8);
+        memcpy(d + DUMP_HEADER_LEN, rec + RECORD_HEADER_LEN, size - RECORD_HEADER_LEN);
+        used += size;
+        return true;
+    });
+    return used;
+} // dump
+
+
+/**
+ * @brief Formats and prints the pending records through esp_log_write.
+ * @return The number of records printed.
+ */
+size_t NimBLEDeferredLog::print() {
+    static const char levels[] = "NEWIDV";
+    char line[128];
+
+    return read([&](uint8_t core, uint32_t hdr, const uint8_t* rec) {
+        uint32_t    words[3];
+        memcpy(words, rec + 4, sizeof words);
+        const char* fmt  = reinterpret_cast<const char*>(static_cast<uintptr_t>(words[0]));
+        const char* tag  = reinterpret_cast<const char*>(static_cast<uintptr_t>(words[1]));
+        uint8_t     level = (hdr >> 16) & 0x7;
+
+        format(line, sizeof line, fmt, rec + RECORD_HEADER_LEN, (hdr & 0xFFFF) - RECORD_HEADER_LEN);
+        // Same layout as ESP_LOG, with the microseconds of the record since it may be printed much later
+        esp_log_write((esp_log_level_t)level, tag, "%c (%" PRIu32 ".%03" PRIu32 ") %s: %s\n",
+                      levels[level < 6 ? level : 0], words[2] / 1000, words[2] % 1000, tag, line);
+        return true;
+    });
+} // print
+
+
+/**
+ * @brief Formats the arguments of one record.
+ * @param [in] out The output buffer, always terminated.
+ * @param [in] outLen The size of the output buffer.
+ * @param [in] format The printf format the record was made with.
+ * @param [in] args The recorded arguments.
+ * @param [in] argsLen The length of the recorded arguments, including the padding.
+ * @return The length of the formatted text.
+ */
+size_t NimBLEDeferredLog::format(char* out, size_t outLen, const char* format,
+                                 const uint8_t* args, size_t argsLen) {
+    const uint8_t* end = args + argsLen;
+    size_t o = 0;
+
+    if (outLen == 0) {
+        return 0;
+    }
+
+    auto append = [&](int n) {
+        if (n > 0) {
+            o += ((size_t)n < outLen - o) ? (size_t)n : outLen - o - 1;
+        }
+    };
+
+    while (*format != '\0' && o + 1 < outLen) {
+        if (*format != '%') {
+            out[o++] = *format++;
+            continue;
+        }
+        format++;
+        if (*format == '%') {
+            out[o++] = '%';
+            format++;
+            continue;
+        }
+
+        // Keep flags, width and precision, the length modifier is rebuilt from the stored size
+        char spec[24];
+        size_t n = 0;
+        spec[n++] = '%';
+        while (*format != '\0' && strchr("-+ #0", *format) && n < 8) {
+            spec[n++] = *format++;
+        }
+        while ((isdigit((unsigned char)*format) || *format == '.') && n < 16) {
+            spec[n++] = *format++;
+        }
+        bool wide = false;
+        while (*format != '\0' && strchr("hlLqjzt", *format)) {
+            if (*format == 'j' || *format == 'q' || (format[0] == 'l' && format[1] == 'l')) {
+                wide = true;
+                format++;
+            } else if (*format == 'l') {
+                wide = sizeof(long) > 4;
+            } else if (*format == 'z' || *format == 't') {
+                wide = sizeof(size_t) > 4;
+            }
+            format++;
+        }
+
+        char conv = *format;
+        if (conv == '\0') {
+            break;
+        }
+        format++;
+
+        if (strchr("diuoxXc", conv)) {
+            size_t size = (wide && conv != 'c') ? 8 : 4;
+            if (args + size > end) {
+                break;
+            }
+            if (size == 8) {
+                uint64_t v;
+                memcpy(&v, args, 8);
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append(snprintf(out + o, outLen - o, spec, v));
+            } else {
+                uint32_t v;
+                memcpy(&v, args, 4);
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append(snprintf(out + o, outLen - o, spec, (unsigned int)v));
+            }
+            args += size;
+        } else if (strchr("fFeEgGaA", conv)) {
+            if (args + sizeof(double) > end) {
+                break;
+            }
+            double v;
+            memcpy(&v, args, sizeof v);
+            spec[n++] = conv;
+            spec[n] = '\0';
+            append(snprintf(out + o, outLen - o, spec, v));
+            args += sizeof v;
+        } else if (conv == 's') {
+            if (args >= end || args + 1 + *args > end) {
+                break;
+            }
+            char str[STRING_MAX + 1];
+            memcpy(str, args + 1, *args);
+            str[*args] = '\0';
+            spec[n++] = 's';
+            spec[n] = '\0';
+            append(snprintf(out + o, outLen - o, spec, str));
+            args += 1 + *args;
+        } else if (conv == 'p') {
+            if (args + 4 > end) {
+                break;
+            }
+            uint32_t v;
+            memcpy(&v, args, 4);
+            append(snprintf(out + o, outLen - o, "0x%08" PRIx32, v));
+            args += 4;
+        } else {
+            // Unknown conversion, the remaining arguments cannot be located
+            break;
+        }
+    }
+
+    out[o] = '\0';
+    return o;
+} // format
+
+
+/**
+ * @brief Get the number of records dropped because the buffer was full or they were too large.
+ */
+uint32_t NimBLEDeferredLog::getDropped() {
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+} // getDropped
+
+
+void NimBLEDeferredLog::taskLoop(void* arg) {
+    TickType_t period = pdMS_TO_TICKS(reinterpret_cast<uintptr_t>(arg));
+    uint32_t   dropped = 0;
+
+    for (;;) {
+        print();
+        uint32_t now = getDropped();
+        if (now != dropped) {
+            NIMBLE_LOGW(LOG_TAG, "%" PRIu32 " records dropped", now - dropped);
+            dropped = now;
+        }
+        vTaskDelay(period > 0 ? period : 1);
+    }
+} // taskLoop
+
+
+/**
+ * @brief Starts the task printing the records.
+ * @param [in] priority The task priority, keep it below the tasks that log.
+ * @param [in] periodMs How often the buffer is emptied.
+ * @return False if the task is already running or could not be created.
+ */
+bool NimBLEDeferredLog::startTask(UBaseType_t priority, uint32_t periodMs) {
+    if (__atomic_test_and_set(&s_taskStarted, __ATOMIC_RELAXED)) {
+        return false;
+    }
+
+    if (xTaskCreate(taskLoop, "nimble_log", 3072, reinterpret_cast<void*>((uintptr_t)periodMs),
+                    priority, nullptr) != pdPASS) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create the log task");
+        __atomic_clear(&s_taskStarted, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+} // startTask
+
+#endif /* CONFIG_BT_ENABLED && CONFIG_NIMBLE_CPP_LOG_DEFERRED */
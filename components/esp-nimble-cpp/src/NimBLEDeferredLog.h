@@ -0,0 +1,182 @@
+/*
+ * NimBLEDeferredLog.h
+ *
+ *  Records log calls as the format string address and the raw arguments,
+ *  they are formatted later by a low priority task or on the host from a dump.
+ */
+
+#ifndef MAIN_NIMBLEDEFERREDLOG_H_
+#define MAIN_NIMBLEDEFERREDLOG_H_
+
+#include "nimconfig.h"
+#include "esp_log.h"
+
+#if defined(CONFIG_NIMBLE_CPP_LOG_DEFERRED)
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include <string.h>
+#include <type_traits>
+
+#if !defined(CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE)
+#    define CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE 4096
+#elif (CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE & (CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE - 1)) != 0
+#    error CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE must be a power of two
+#elif CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE < 512
+#    error CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE cannot be less than 512; Range = 512 : 65536
+#elif CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE > 65536
+#    error CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE cannot be larger than 65536; Range = 512 : 65536
+#endif
+
+/**
+ * @brief Deferred binary log.
+ * @details A call costs a reservation in the ring buffer of the calling core and a copy of the
+ * arguments, nothing is formatted and the caller never blocks; when the buffer is full the record
+ * is dropped and counted. Integers are stored as 4 bytes (8 for 64 bit types), floating point as
+ * a double and strings are copied (up to STRING_MAX characters) since they may not outlive the
+ * call. Only the addresses of the format string and tag are stored, so both must be string
+ * literals. Warnings and errors are not deferred.
+ *
+ * Records are printed by the task started with startTask(), or read with dump() and decoded with
+ * tools/decode_deferred_log.py against the application ELF file. Both drain the same records, so an
+ * application that dumps them should disable CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT. Readers take
+ * turns, a reader waits while another one drains. A record is at most RECORD_MAX bytes, larger
+ * ones are dropped and counted. Dump record layout (little endian):
+ * ```
+ * uint16_t size; uint8_t level; uint8_t core; uint32_t time_us; uint32_t format; uint32_t tag; args
+ * ```
+ */
+class NimBLEDeferredLog {
+public:
+    static constexpr size_t STRING_MAX      = 63;
+    static constexpr size_t DUMP_HEADER_LEN = 16;
+    static constexpr size_t RECORD_MAX      = 256;
+
+    /**
+     * @brief Records a log call.
+     * @param [in] level The esp_log_level_t of the message.
+     * @param [in] tag The log tag, must be a string literal.
+     * @param [in] format The printf format, must be a string literal.
+     * @param [in] args The arguments of the format.
+     */
+    template<typename... Args>
+    static void log(uint8_t level, const char* tag, const char* format, const Args&... args) {
+        size_t len = RECORD_HEADER_LEN + (argLen(args) + ... + 0);
+        len = (len + 3) & ~size_t(3);
+
+        uint32_t* hdr = reserve(len);
+        if (hdr == nullptr) {
+            return;
+        }
+
+        uint8_t* p = reinterpret_cast<uint8_t*>(hdr) + sizeof(uint32_t);
+        uint32_t word = reinterpret_cast<uintptr_t>(format);
+        memcpy(p, &word, 4);
+        word = reinterpret_cast<uintptr_t>(tag);
+        memcpy(p + 4, &word, 4);
+        word = static_cast<uint32_t>(esp_timer_get_time());
+        memcpy(p + 8, &word, 4);
+        p += 12;
+        ((p = putArg(p, args)), ...);
+
+        commit(hdr, level, len);
+    }
+
+    /** @brief Never called, lets the compiler check the format against the arguments. */
+    __attribute__((format(printf, 1, 2))) static void checkFormat(const char* format, ...) {}
+
+    static size_t   dump(uint8_t* out, size_t len);
+    static size_t   print();
+    static bool     startTask(UBaseType_t priority = 1, uint32_t periodMs = 100);
+    static uint32_t getDropped();
+    static size_t   format(char* out, size_t outLen, const char* format, const uint8_t* args, size_t argsLen);
+
+private:
+    static constexpr size_t   RECORD_HEADER_LEN = 16;
+    static constexpr uint32_t REC_COMMIT        = 1u << 31;
+    static constexpr uint32_t REC_PAD           = 1u << 30;
+
+    template<typename T>
+    static size_t argLen(const T& v) {
+        using D = std::decay_t<const T>;
+        if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+            return 1 + strLen(v);
+        } else if constexpr (std::is_floating_point_v<D>) {
+            return sizeof(double);
+        } else if constexpr (std::is_pointer_v<D>) {
+            return 4;
+        } else {
+            static_assert(std::is_integral_v<D> || std::is_enum_v<D>, "Unsupported deferred log argument");
+            return sizeof(D) > 4 ? 8 : 4;
+        }
+    }
+
+    template<typename T>
+    static uint8_t* putArg(uint8_t* p, const T& v) {
+        using D = std::decay_t<const T>;
+        const D d = v;
+        if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+            uint8_t n = strLen(d);
+            *p = n;
+            memcpy(p + 1, d ? d : "(null)", n);
+            return p + 1 + n;
+        } else if constexpr (std::is_floating_point_v<D>) {
+            double f = d;
+            memcpy(p, &f, sizeof f);
+            return p + sizeof f;
+        } else if constexpr (std::is_pointer_v<D>) {
+            uint32_t w = reinterpret_cast<uintptr_t>(d);
+            memcpy(p, &w, 4);
+            return p + 4;
+        } else if constexpr (sizeof(D) > 4) {
+            uint64_t w = static_cast<uint64_t>(d);
+            memcpy(p, &w, 8);
+            return p + 8;
+        } else {
+            // Sign extended, the formatter picks the signedness from the conversion
+            uint32_t w = static_cast<uint32_t>(static_cast<std::conditional_t<std::is_signed_v<D>, int32_t, uint32_t>>(d));
+            memcpy(p, &w, 4);
+            return p + 4;
+        }
+    }
+
+    static uint8_t strLen(const char* s) {
+        if (s == nullptr) {
+            return 6;
+        }
+        return strnlen(s, STRING_MAX);
+    }
+
+    static uint32_t* reserve(size_t len);
+    static void      commit(uint32_t* hdr, uint8_t level, size_t len);
+    static void      taskLoop(void* arg);
+
+    template<typename F>
+    static size_t    read(F&& handle);
+};
+
+/*
+ * Defers a log call when the level is enabled. The dead printf style call keeps the format checked.
+ */
+#  define NIMBLE_CPP_LOG_DEFER(level, tag, format, ...) do { \
+    if (CONFIG_NIMBLE_CPP_LOG_LEVEL >= level) \
+      NimBLEDeferredLog::log(level, tag, format, ##__VA_ARGS__); \
+    if (0) \
+      NimBLEDeferredLog::checkFormat(format, ##__VA_ARGS__); \
+    } while(0)
+
+/* For application hot paths: deferred when enabled, otherwise an ordinary info log. */
+#  define NIMBLE_DEFERRED_LOGI(tag, format, ...) do { \
+    NimBLEDeferredLog::log(ESP_LOG_INFO, tag, format, ##__VA_ARGS__); \
+    if (0) \
+      NimBLEDeferredLog::checkFormat(format, ##__VA_ARGS__); \
+    } while(0)
+
+#else
+
+#  define NIMBLE_DEFERRED_LOGI(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+
+#endif /* CONFIG_NIMBLE_CPP_LOG_DEFERRED */
+#endif /* MAIN_NIMBLEDEFERREDLOG_H_ */
@@ -56,6 +56,8 @@
 
 #include "NimBLELog.h"
 
+#include <cstring>
+
 static const char* LOG_TAG = "NimBLEDevice";
 
 /**
@@ -80,11 +82,6 @@ NimBLEAdvertising* NimBLEDevice::m_bleAdvertising = nullptr;
 
 gap_event_handler           NimBLEDevice::m_customGapHandler = nullptr;
 ble_gap_event_listener      NimBLEDevice::m_listener;
-#if defined( CONFIG_BT_NIMBLE_ROLE_CENTRAL)
-std::list <NimBLEClient*>   NimBLEDevice::m_cList;
-#endif
-std::list <NimBLEAddress>   NimBLEDevice::m_ignoreList;
-std::vector<NimBLEAddress>  NimBLEDevice::m_whiteList;
 uint8_t                     NimBLEDevice::m_own_addr_type = BLE_OWN_ADDR_PUBLIC;
 #ifdef ESP_PLATFORM
 #  ifdef CONFIG_BTDM_BLE_SCAN_DUPL
@@ -208,28 +205,7 @@ NimBLEScan* NimBLEDevice::getScan() {
 #endif // #if defined(CONFIG_BT_NIMBLE_ROLE_OBSERVER)
 
 
-/**
- * @brief Creates a new client object and maintains a list of all client objects
- * each client can connect to 1 peripheral device.
- * @param [in] peerAddress An optional peer address that is copied to the new client
- * object, allows for calling NimBLEClient::connect(bool) without a device or address parameter.
- * @return A reference to the new client object.
- */
 #if defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL)
-/* STATIC */
-NimBLEClient* NimBLEDevice::createClient(NimBLEAddress peerAddress) {
-    if(m_cList.size() >= NIMBLE_MAX_CONNECTIONS) {
-        NIMBLE_LOGW(LOG_TAG,"Number of clients exceeds Max connections. Cur=%d Max=%d",
-                    m_cList.size(), NIMBLE_MAX_CONNECTIONS);
-    }
-
-    NimBLEClient* pClient = new NimBLEClient(peerAddress);
-    m_cList.push_back(pClient);
-
-    return pClient;
-} // createClient
-
-
 /**
  * @brief Delete the client object and remove it from the list.\n
  * Checks if it is connected or trying to connect and disconnects/stops it first.
@@ -237,7 +213,7 @@ NimBLEClient* NimBLEDevice::createClient(NimBLEAddress peerAddress) {
  */
 /* STATIC */
 bool NimBLEDevice::deleteClient(NimBLEClient* pClient) {
-    if(pClient == nullptr) {
+    if(pClient == nullptr || m_pClients[pClient->m_clientSlot] != pClient) {
         return false;
     }
 
@@ -269,80 +245,15 @@ bool NimBLEDevice::deleteClient(NimBLEClient* pClient) {
         }
     }
 
-    m_cList.remove(pClient);
-    delete pClient;
+    // The host failed the queued GATT operation in flight when the link dropped, wait until its
+    // callback ran and the rest of the queue completed with BLE_HS_ENOTCONN.
+    while(pClient->m_opBusy) {
+        taskYIELD();
+    }
 
+    removeClient(pClient);
     return true;
 } // deleteClient
-
-
-/**
- * @brief Get the list of created client objects.
- * @return A pointer to the list of clients.
- */
-/* STATIC */
-std::list<NimBLEClient*>* NimBLEDevice::getClientList() {
-    return &m_cList;
-} // getClientList
-
-
-/**
- * @brief Get the number of created client objects.
- * @return Number of client objects created.
- */
-/* STATIC */
-size_t NimBLEDevice::getClientListSize() {
-    return m_cList.size();
-} // getClientList
-
-
-/**
- * @brief Get a reference to a client by connection ID.
- * @param [in] conn_id The client connection ID to search for.
- * @return A pointer to the client object with the spcified connection ID.
- */
-/* STATIC */
-NimBLEClient* NimBLEDevice::getClientByID(uint16_t conn_id) {
-    for(auto it = m_cList.cbegin(); it != m_cList.cend(); ++it) {
-        if((*it)->getConnId() == conn_id) {
-            return (*it);
-        }
-    }
-    assert(0);
-    return nullptr;
-} // getClientByID
-
-
-/**
- * @brief Get a reference to a client by peer address.
- * @param [in] peer_addr The address of the peer to search for.
- * @return A pointer to the client object with the peer address.
- */
-/* STATIC */
-NimBLEClient* NimBLEDevice::getClientByPeerAddress(const NimBLEAddress &peer_addr) {
-    for(auto it = m_cList.cbegin(); it != m_cList.cend(); ++it) {
-        if((*it)->getPeerAddress().equals(peer_addr)) {
-            return (*it);
-        }
-    }
-    return nullptr;
-} // getClientPeerAddress
-
-
-/**
- * @brief Finds the first disconnected client in the list.
- * @return A pointer to the first client object that is not connected to a peer.
- */
-/* STATIC */
-NimBLEClient* NimBLEDevice::getDisconnectedClient() {
-    for(auto it = m_cList.cbegin(); it != m_cList.cend(); ++it) {
-        if(!(*it)->isConnected()) {
-            return (*it);
-        }
-    }
-    return nullptr;
-} // getDisconnectedClient
-
 #endif // #if defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL)
 
 #ifdef ESP_PLATFORM
@@ -553,6 +464,9 @@ void NimBLEDevice::setScanFilterMode(uint8_t mode) {
  */
 /*STATIC*/
 int NimBLEDevice::getNumBonds() {
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    return NimBLEBondStore::getCount();
+#else
     ble_addr_t peer_id_addrs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
     int num_peers, rc;
 
@@ -562,6 +476,7 @@ int NimBLEDevice::getNumBonds() {
     }
 
     return num_peers;
+#endif
 }
 
 
@@ -571,6 +486,9 @@ int NimBLEDevice::getNumBonds() {
 /*STATIC*/
 void NimBLEDevice::deleteAllBonds() {
     ble_store_clear();
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    NimBLEBondStore::clearPins();
+#endif
 }
 
 
@@ -590,6 +508,9 @@ bool NimBLEDevice::deleteBond(const NimBLEAddress &address) {
         return false;
     }
 
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    NimBLEBondStore::setPinned(address, false);
+#endif
     return true;
 }
 
@@ -601,6 +522,9 @@ bool NimBLEDevice::deleteBond(const NimBLEAddress &address) {
  */
 /*STATIC*/
 bool NimBLEDevice::isBonded(const NimBLEAddress &address) {
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    return NimBLEBondStore::isBonded(address);
+#else
     ble_addr_t peer_id_addrs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
     int num_peers, rc;
 
@@ -617,146 +541,40 @@ bool NimBLEDevice::isBonded(const NimBLEAddress &address) {
     }
 
     return false;
+#endif
 }
 
 
 /**
  * @brief Get the address of a bonded peer device by index.
  * @param [in] index The index to retrieve the peer address of.
- * @returns NimBLEAddress of the found bonded peer or nullptr if not found.
+ * @returns NimBLEAddress of the found bonded peer or a null address if not found.
  */
 /*STATIC*/
 NimBLEAddress NimBLEDevice::getBondedAddress(int index) {
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+    NimBLEAddress address;
+    if (!NimBLEBondStore::getAddress(index, &address)) {
+        return NimBLEAddress();
+    }
+    return address;
+#else
     ble_addr_t peer_id_addrs[MYNEWT_VAL(BLE_STORE_MAX_BONDS)];
     int num_peers, rc;
 
     rc = ble_store_util_bonded_peers(&peer_id_addrs[0], &num_peers, MYNEWT_VAL(BLE_STORE_MAX_BONDS));
     if (rc != 0) {
-        return nullptr;
+        return NimBLEAddress();
     }
 
-    if (index > num_peers || index < 0) {
-        return nullptr;
+    if (index >= num_peers || index < 0) {
+        return NimBLEAddress();
     }
 
     return NimBLEAddress(peer_id_addrs[index]);
-}
 #endif
-
-/**
- * @brief Checks if a peer device is whitelisted.
- * @param [in] address The address to check for in the whitelist.
- * @returns true if the address is in the whitelist.
- */
-/*STATIC*/
-bool NimBLEDevice::onWhiteList(const NimBLEAddress & address) {
-    for (auto &it : m_whiteList) {
-        if (it == address) {
-            return true;
-        }
-    }
-
-    return false;
 }
-
-
-/**
- * @brief Add a peer address to the whitelist.
- * @param [in] address The address to add to the whitelist.
- * @returns true if successful.
- */
-/*STATIC*/
-bool NimBLEDevice::whiteListAdd(const NimBLEAddress & address) {
-    if (NimBLEDevice::onWhiteList(address)) {
-        return true;
-    }
-
-    m_whiteList.push_back(address);
-    std::vector<ble_addr_t> wlVec;
-    wlVec.reserve(m_whiteList.size());
-
-    for (auto &it : m_whiteList) {
-        ble_addr_t wlAddr;
-        memcpy(&wlAddr.val, it.getNative(), 6);
-        wlAddr.type = it.getType();
-        wlVec.push_back(wlAddr);
-    }
-
-    int rc = ble_gap_wl_set(&wlVec[0], wlVec.size());
-    if (rc != 0) {
-        NIMBLE_LOGE(LOG_TAG, "Failed adding to whitelist rc=%d", rc);
-        return false;
-    }
-
-    return true;
-}
-
-
-/**
- * @brief Remove a peer address from the whitelist.
- * @param [in] address The address to remove from the whitelist.
- * @returns true if successful.
- */
-/*STATIC*/
-bool NimBLEDevice::whiteListRemove(const NimBLEAddress & address) {
-    if (!NimBLEDevice::onWhiteList(address)) {
-        return true;
-    }
-
-    std::vector<ble_addr_t> wlVec;
-    wlVec.reserve(m_whiteList.size());
-
-    for (auto &it : m_whiteList) {
-        if (it != address) {
-            ble_addr_t wlAddr;
-            memcpy(&wlAddr.val, it.getNative(), 6);
-            wlAddr.type = it.getType();
-            wlVec.push_back(wlAddr);
-        }
-    }
-
-    int rc = ble_gap_wl_set(&wlVec[0], wlVec.size());
-    if (rc != 0) {
-        NIMBLE_LOGE(LOG_TAG, "Failed removing from whitelist rc=%d", rc);
-        return false;
-    }
-
-    // Don't remove from the list unless NimBLE returned success
-    for (auto it = m_whiteList.begin(); it < m_whiteList.end(); ++it) {
-        if ((*it) == address) {
-            m_whiteList.erase(it);
-            break;
-        }
-    }
-
-    return true;
-}
-
-
-/**
- * @brief Gets the count of addresses in the whitelist.
- * @returns The number of addresses in the whitelist.
- */
-/*STATIC*/
-size_t NimBLEDevice::getWhiteListCount() {
-    return m_whiteList.size();
-}
-
-
-/**
- * @brief Gets the address at the vector index.
- * @param [in] index The vector index to retrieve the address from.
- * @returns the NimBLEAddress at the whitelist index or nullptr if not found.
- */
-/*STATIC*/
-NimBLEAddress NimBLEDevice::getWhiteListAddress(size_t index) {
-    if (index > m_whiteList.size()) {
-        NIMBLE_LOGE(LOG_TAG, "Invalid index; %u", index);
-        return nullptr;
-    }
-    return m_whiteList[index];
-}
-
+#endif
 
 /**
  * @brief Host reset, we pass the message so we don't make calls until resynced.
@@ -770,6 +588,8 @@ void NimBLEDevice::onReset(int reason)
     }
 
     m_synced = false;
+    // The controller filter accept list is cleared by the reset
+    m_ctrlWhiteListSynced = false;
 
     NIMBLE_LOGC(LOG_TAG, "Resetting state; reason=%d, %s", reason,
                         NimBLEUtils::returnCodeToString(reason));
@@ -816,6 +636,8 @@ void NimBLEDevice::onSync(void)
     m_synced = true;
 
     if(initialized) {
+        whiteListSync();
+
 #if defined(CONFIG_BT_NIMBLE_ROLE_OBSERVER)
         if(m_pScan != nullptr) {
             m_pScan->onHostSync();
@@ -912,8 +734,15 @@ void NimBLEDevice::init(const std::string &deviceName) {
         assert(rc == 0);
 
         ble_store_config_init();
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+        NimBLEBondStore::init();
+#endif
 
         nimble_port_freertos_init(NimBLEDevice::host_task);
+
+#if defined(CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT)
+        NimBLEDeferredLog::startTask();
+#endif
     }
 
     // Wait for host and controller to sync before returning and accepting new tasks
@@ -934,6 +763,9 @@ void NimBLEDevice::init(const std::string &deviceName) {
 void NimBLEDevice::deinit(bool clearAll) {
     int ret = nimble_port_stop();
     if (ret == 0) {
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+        NimBLEBondStore::deinit();
+#endif
         nimble_port_deinit();
 #ifdef ESP_PLATFORM
 #if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
@@ -969,13 +801,13 @@ void NimBLEDevice::deinit(bool clearAll) {
 #endif
 
 #if defined( CONFIG_BT_NIMBLE_ROLE_CENTRAL)
-            for(auto &it : m_cList) {
-                deleteClient(it);
-                m_cList.clear();
+            for(uint8_t i = 0; i < NIMBLE_MAX_CONNECTIONS; i++) {
+                deleteClient(m_pClients[i]);
             }
 #endif
 
-            m_ignoreList.clear();
+            m_ignoreListCount = 0;
+            m_ctrlWhiteListSynced = false;
         }
     }
 } // deinit
@@ -1150,48 +982,6 @@ int NimBLEDevice::startSecurity(uint16_t conn_id) {
 } // startSecurity
 
 
-/**
- * @brief Check if the device address is on our ignore list.
- * @param [in] address The address to look for.
- * @return True if ignoring.
- */
-/*STATIC*/
-bool NimBLEDevice::isIgnored(const NimBLEAddress &address) {
-    for(auto &it : m_ignoreList) {
-        if(it.equals(address)){
-            return true;
-        }
-    }
-
-    return false;
-}
-
-
-/**
- * @brief Add a device to the ignore list.
- * @param [in] address The address of the device we want to ignore.
- */
-/*STATIC*/
-void NimBLEDevice::addIgnored(const NimBLEAddress &address) {
-    m_ignoreList.push_back(address);
-}
-
-
-/**
- * @brief Remove a device from the ignore list.
- * @param [in] address The address of the device we want to remove from the list.
- */
-/*STATIC*/
-void  NimBLEDevice::removeIgnored(const NimBLEAddress &address) {
-    for(auto it = m_ignoreList.begin(); it != m_ignoreList.end(); ++it) {
-        if((*it).equals(address)){
-            m_ignoreList.erase(it);
-            return;
-        }
-    }
-}
-
-
 /**
  * @brief Set a custom callback for gap events.
  * @param [in] handler The function to call when gap events occur.
@@ -41,13 +41,17 @@
 #include "NimBLEUtils.h"
 #include "NimBLEAddress.h"
 
+#if defined(CONFIG_NIMBLE_CPP_BOND_STORE)
+#include "NimBLEBondStore.h"
+#endif
+
 #ifdef ESP_PLATFORM
 #  include "esp_bt.h"
 #endif
 
 #include <map>
 #include <string>
-#include <list>
+#include <vector>
 
 #define BLEDevice                       NimBLEDevice
 #define BLEClient                       NimBLEClient
@@ -80,6 +84,14 @@
 #define BLEEddystoneURL                 NimBLEEddystoneURL
 #define BLEConnInfo                     NimBLEConnInfo
 
+#if !defined(CONFIG_NIMBLE_CPP_FILTER_LIST_MAX)
+#    define CONFIG_NIMBLE_CPP_FILTER_LIST_MAX 16
+#elif CONFIG_NIMBLE_CPP_FILTER_LIST_MAX > 64
+#    error CONFIG_NIMBLE_CPP_FILTER_LIST_MAX cannot be larger than 64
+#elif CONFIG_NIMBLE_CPP_FILTER_LIST_MAX < 1
+#    error CONFIG_NIMBLE_CPP_FILTER_LIST_MAX cannot be less than 1; Range = 1 : 64
+#endif
+
 #ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
 #define NIMBLE_MAX_CONNECTIONS          CONFIG_BT_NIMBLE_MAX_CONNECTIONS
 #else
@@ -139,7 +151,7 @@ public:
     static int              setMTU(uint16_t mtu);
     static uint16_t         getMTU();
     static bool             isIgnored(const NimBLEAddress &address);
-    static void             addIgnored(const NimBLEAddress &address);
+    static bool             addIgnored(const NimBLEAddress &address);
     static void             removeIgnored(const NimBLEAddress &address);
 
 #if defined(CONFIG_BT_NIMBLE_ROLE_BROADCASTER)
@@ -159,13 +171,13 @@ public:
 #endif
 
 #if defined( CONFIG_BT_NIMBLE_ROLE_CENTRAL)
-    static NimBLEClient*    createClient(NimBLEAddress peerAddress = NimBLEAddress(""));
+    static NimBLEClient*    createClient(NimBLEAddress peerAddress = NimBLEAddress());
     static bool             deleteClient(NimBLEClient* pClient);
     static NimBLEClient*    getClientByID(uint16_t conn_id);
     static NimBLEClient*    getClientByPeerAddress(const NimBLEAddress &peer_addr);
     static NimBLEClient*    getDisconnectedClient();
     static size_t           getClientListSize();
-    static std::list<NimBLEClient*>* getClientList();
+    static std::vector<NimBLEClient*> getClients();
 #endif
 
 #if defined(CONFIG_BT_NIMBLE_ROLE_CENTRAL) || defined(CONFIG_BT_NIMBLE_ROLE_PERIPHERAL)
@@ -200,6 +212,9 @@ private:
 
     static void        onReset(int reason);
     static void        onSync(void);
+    static bool        whiteListSync();
+    static void        whiteListRetry();
+    static bool        isFiltered(const ble_addr_t &address, bool acceptListOnly);
     static void        host_task(void *param);
     static bool        m_synced;
 
@@ -220,9 +235,31 @@ private:
 #endif
 
 #if defined( CONFIG_BT_NIMBLE_ROLE_CENTRAL)
-    static std::list <NimBLEClient*>  m_cList;
+    static constexpr uint8_t  CLIENT_NONE       = 0xFF;
+    static constexpr uint16_t CLIENT_INDEX_SIZE = NIMBLE_MAX_CONNECTIONS > 64 ? 256 :
+                                                  NIMBLE_MAX_CONNECTIONS > 32 ? 128 :
+                                                  NIMBLE_MAX_CONNECTIONS > 16 ? 64  :
+                                                  NIMBLE_MAX_CONNECTIONS > 8  ? 32  : 16;
+
+    static uint16_t   clientAddressHash(const NimBLEAddress &address);
+    static uint16_t   clientHandleHome(uint8_t slot);
+    static uint16_t   clientAddressHome(uint8_t slot);
+    static void       clientIndexInsert(uint8_t *index, uint16_t home, uint8_t slot);
+    static void       clientIndexRemove(uint8_t *index, uint16_t (*homeOf)(uint8_t), uint8_t slot);
+    static void       removeClient(NimBLEClient* pClient);
+    static void       setClientConnId(NimBLEClient* pClient, uint16_t conn_id);
+    static void       setClientPeerAddress(NimBLEClient* pClient, const NimBLEAddress &address);
+
+    // Clients by slot, a slot keeps its client until it is deleted.
+    static NimBLEClient*              m_pClients[NIMBLE_MAX_CONNECTIONS];
+    static uint8_t                    m_clientCount;
+    // Open addressing (linear probing) connection handle / peer address -> client slot,
+    // CLIENT_NONE when empty. Only connected clients are in the handle index.
+    static uint8_t                    m_clientHandleIndex[CLIENT_INDEX_SIZE];
+    static uint8_t                    m_clientAddressIndex[CLIENT_INDEX_SIZE];
 #endif
-    static std::list <NimBLEAddress>  m_ignoreList;
+    static ble_addr_t                 m_ignoreList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t                    m_ignoreListCount;
     static uint32_t                   m_passkey;
     static ble_gap_event_listener     m_listener;
     static gap_event_handler          m_customGapHandler;
@@ -233,7 +270,12 @@ private:
     static uint8_t                    m_scanFilterMode;
 #  endif
 #endif
-    static std::vector<NimBLEAddress> m_whiteList;
+    static ble_addr_t                 m_whiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t                    m_whiteListCount;
+    static ble_addr_t                 m_ctrlWhiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t                    m_ctrlWhiteListCount;
+    static bool                       m_ctrlWhiteListSynced;
+    static bool                       m_ctrlWhiteListPending;
 };
 
 
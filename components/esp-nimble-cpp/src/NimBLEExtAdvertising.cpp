@@ -100,7 +100,7 @@ bool NimBLEExtAdvertising::setInstanceData(uint8_t inst_id, NimBLEExtAdvertiseme
             if (rc != 0) {
                 NIMBLE_LOGE(LOG_TAG, "Invalid advertisement data: rc = %d", rc);
             } else {
-                if (adv.m_advAddress != NimBLEAddress("")) {
+                if (adv.m_advAddress != NimBLEAddress()) {
                     ble_addr_t addr;
                     memcpy(&addr.val, adv.m_advAddress.getNative(), 6);
                     // Custom advertising address must be random.
@@ -160,6 +160,9 @@ bool NimBLEExtAdvertising::start(uint8_t inst_id, int duration, int max_events)
         return false;
     }
 
+    // Apply white list changes made while the controller was using the list
+    NimBLEDevice::whiteListSync();
+
     int rc = ble_gap_ext_adv_start(inst_id, duration / 10, max_events);
 
     switch (rc) {
@@ -246,6 +249,7 @@ bool NimBLEExtAdvertising::stop(uint8_t inst_id) {
     }
 
     m_advStatus[inst_id] = false;
+    NimBLEDevice::whiteListRetry();
     return true;
 } // stop
 
@@ -266,6 +270,7 @@ bool NimBLEExtAdvertising::stop() {
         it = false;
     }
 
+    NimBLEDevice::whiteListRetry();
     return true;
 } // stop
 
@@ -310,6 +315,118 @@ bool NimBLEExtAdvertising::isAdvertising() {
 } // isAdvertising
 
 
+#if CONFIG_BT_NIMBLE_ENABLE_PERIODIC_ADV
+/**
+ * @brief Configure periodic advertising on an instance.
+ * @param [in] inst_id The extended advertisement instance ID, its data must be set with setInstanceData first.
+ * @param [in] minInterval The minimum periodic advertising interval in 1.25ms units, 6 (7.5ms) or more.
+ * @param [in] maxInterval The maximum periodic advertising interval in 1.25ms units.
+ * @param [in] includeTxPower Include the transmit power in the periodic advertising PDUs.
+ * @return True if successful.
+ * @details The instance must be neither connectable nor scannable and must not use legacy PDUs.
+ * The periodic train only goes out while the instance itself is advertising, observers find it
+ * through the extended advertisement and then follow it without scanning.
+ */
+bool NimBLEExtAdvertising::setPeriodicParams(uint8_t inst_id, uint16_t minInterval,
+                                             uint16_t maxInterval, bool includeTxPower) {
+    ble_gap_periodic_adv_params params = {};
+    params.include_tx_power = includeTxPower;
+    params.itvl_min = minInterval;
+    params.itvl_max = maxInterval;
+
+    int rc = ble_gap_periodic_adv_configure(inst_id, &params);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gap_periodic_adv_configure rc = %d %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+    return true;
+} // setPeriodicParams
+
+
+/**
+ * @brief Set the periodic advertising data of an instance.
+ * @param [in] inst_id The extended advertisement instance ID.
+ * @param [in] data The AD structures to broadcast.
+ * @param [in] length The length of the data.
+ * @return True if successful.
+ * @details Can be called while periodic advertising is running, the controller sends the new data
+ * from the next periodic event on.
+ */
+bool NimBLEExtAdvertising::setPeriodicData(uint8_t inst_id, const uint8_t* data, size_t length) {
+    os_mbuf *buf = os_msys_get_pkthdr(length, 0);
+    if (!buf) {
+        NIMBLE_LOGE(LOG_TAG, "Data buffer allocation failed");
+        return false;
+    }
+
+    int rc = os_mbuf_append(buf, data, length);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Unable to copy periodic data: rc = %d", rc);
+        os_mbuf_free_chain(buf);
+        return false;
+    }
+
+    // The host takes the buffer in every case
+#if CONFIG_BT_NIMBLE_PERIODIC_ADV_ENH
+    ble_gap_periodic_adv_set_data_params params = {};
+    rc = ble_gap_periodic_adv_set_data(inst_id, buf, &params);
+#else
+    rc = ble_gap_periodic_adv_set_data(inst_id, buf);
+#endif
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gap_periodic_adv_set_data rc = %d %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+    return true;
+} // setPeriodicData
+
+
+/**
+ * @brief Start periodic advertising on an instance.
+ * @param [in] inst_id The extended advertisement instance ID.
+ * @return True if successful.
+ * @details Start the instance itself with start() as well, before or after this.
+ */
+bool NimBLEExtAdvertising::startPeriodic(uint8_t inst_id) {
+    if(!NimBLEDevice::m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host reset, wait for sync.");
+        return false;
+    }
+
+#if CONFIG_BT_NIMBLE_PERIODIC_ADV_ENH
+    ble_gap_periodic_adv_start_params params = {};
+    int rc = ble_gap_periodic_adv_start(inst_id, &params);
+#else
+    int rc = ble_gap_periodic_adv_start(inst_id);
+#endif
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gap_periodic_adv_start rc = %d %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+    return true;
+} // startPeriodic
+
+
+/**
+ * @brief Stop periodic advertising on an instance, the instance itself keeps advertising.
+ * @param [in] inst_id The extended advertisement instance ID.
+ * @return True if successful.
+ */
+bool NimBLEExtAdvertising::stopPeriodic(uint8_t inst_id) {
+    int rc = ble_gap_periodic_adv_stop(inst_id);
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gap_periodic_adv_stop rc = %d %s",
+                    rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+    return true;
+} // stopPeriodic
+#endif
+
+
 /*
  * Host reset seems to clear advertising data,
  * we need clear the flag so it reloads it.
@@ -348,6 +465,7 @@ int NimBLEExtAdvertising::handleGapEvent(struct ble_gap_event *event, void *arg)
                     break;
             }
             pAdv->m_advStatus[event->adv_complete.instance] = false;
+            NimBLEDevice::whiteListRetry();
             pAdv->m_pCallbacks->onStopped(pAdv, event->adv_complete.reason,
                                           event->adv_complete.instance);
             break;
@@ -107,6 +107,13 @@ public:
     bool isAdvertising();
     void setCallbacks(NimBLEExtAdvertisingCallbacks* callbacks,
                       bool deleteCallbacks = true);
+#if CONFIG_BT_NIMBLE_ENABLE_PERIODIC_ADV || defined(_DOXYGEN_)
+    bool setPeriodicParams(uint8_t inst_id, uint16_t minInterval, uint16_t maxInterval,
+                           bool includeTxPower = false);
+    bool setPeriodicData(uint8_t inst_id, const uint8_t* data, size_t length);
+    bool startPeriodic(uint8_t inst_id);
+    bool stopPeriodic(uint8_t inst_id);
+#endif
 
 private:
     friend class NimBLEDevice;
@@ -0,0 +1,347 @@
+/*
+ * NimBLEFilterList.cpp
+ *
+ *  The NimBLEDevice ignore list and white list, and the controller filter accept list they load.
+ *  Kept apart from NimBLEDevice.cpp, it only needs ble_gap_wl_set, not the rest of the host stack.
+ */
+
+#include "nimconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include "NimBLEDevice.h"
+#include "NimBLEUtils.h"
+#include "NimBLELog.h"
+
+#include <cstring>
+
+static const char* LOG_TAG = "NimBLEDevice";
+
+ble_addr_t                  NimBLEDevice::m_ignoreList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+uint8_t                     NimBLEDevice::m_ignoreListCount = 0;
+ble_addr_t                  NimBLEDevice::m_whiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+uint8_t                     NimBLEDevice::m_whiteListCount = 0;
+ble_addr_t                  NimBLEDevice::m_ctrlWhiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+uint8_t                     NimBLEDevice::m_ctrlWhiteListCount = 0;
+bool                        NimBLEDevice::m_ctrlWhiteListSynced = false;
+bool                        NimBLEDevice::m_ctrlWhiteListPending = false;
+
+
+/**
+ * @brief Orders addresses by value, then by type.
+ * @details A public and a random address with the same value are different devices. An identity
+ * address the controller resolved (type 2 or 3) is the public or random address it resolved to.
+ * @return Less than, equal to or greater than 0 as a is ordered before, equal to or after b.
+ */
+static int compareAddress(const ble_addr_t &a, const ble_addr_t &b) {
+    int cmp = memcmp(a.val, b.val, sizeof(a.val));
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (a.type & BLE_ADDR_RANDOM) - (b.type & BLE_ADDR_RANDOM);
+} // compareAddress
+
+
+/**
+ * @brief Makes the host form of an address for the list functions.
+ */
+static ble_addr_t nativeAddress(const NimBLEAddress &address) {
+    ble_addr_t addr;
+    memcpy(addr.val, address.getNative(), sizeof(addr.val));
+    addr.type = address.getType();
+    return addr;
+} // nativeAddress
+
+
+/**
+ * @brief Finds an address in a sorted address list.
+ * @param [in] list The list, sorted by compareAddress.
+ * @param [in] count The number of addresses in the list.
+ * @param [in] addr The address to look for.
+ * @param [out] found Set to true if the address is in the list.
+ * @return The index of the address, or where it would be inserted.
+ */
+static uint8_t findAddress(const ble_addr_t* list, uint8_t count, const ble_addr_t &addr, bool* found) {
+    uint8_t lo = 0;
+    uint8_t hi = count;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        int cmp = compareAddress(list[mid], addr);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *found = false;
+    return lo;
+} // findAddress
+
+
+/**
+ * @brief Inserts an address in a sorted address list.
+ * @return False if the list is full, true if inserted or already present.
+ */
+static bool insertAddress(ble_addr_t* list, uint8_t* count, const NimBLEAddress &address) {
+    ble_addr_t addr = nativeAddress(address);
+    bool found;
+    uint8_t index = findAddress(list, *count, addr, &found);
+    if (found) {
+        return true;
+    }
+    if (*count >= CONFIG_NIMBLE_CPP_FILTER_LIST_MAX) {
+        return false;
+    }
+
+    memmove(&list[index + 1], &list[index], (*count - index) * sizeof(ble_addr_t));
+    list[index] = addr;
+    (*count)++;
+    return true;
+} // insertAddress
+
+
+/**
+ * @brief Removes an address from a sorted address list.
+ * @return True if the address was in the list.
+ */
+static bool eraseAddress(ble_addr_t* list, uint8_t* count, const NimBLEAddress &address) {
+    bool found;
+    uint8_t index = findAddress(list, *count, nativeAddress(address), &found);
+    if (!found) {
+        return false;
+    }
+
+    (*count)--;
+    memmove(&list[index], &list[index + 1], (*count - index) * sizeof(ble_addr_t));
+    return true;
+} // eraseAddress
+
+
+/**
+ * @brief Loads the white list, less the ignored addresses, into the controller filter accept list.
+ * @details The controller list is only written when its content changes. The controller refuses
+ * changes while scanning, advertising or connecting with a filter policy that uses the list, in that
+ * case the update is kept pending and applied when scanning or advertising stops, or by the next
+ * start; until then scan results are filtered in software.\n
+ * An empty list clears the controller list. Host versions that refuse an empty list leave the old
+ * entries in the controller, they are then filtered in software as well.
+ * @return False if the controller does not hold the current list.
+ */
+/*STATIC*/
+bool NimBLEDevice::whiteListSync() {
+    ble_addr_t list[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    uint8_t count = 0;
+
+    // Both lists are sorted, the difference is a single merge pass
+    uint8_t ign = 0;
+    for (uint8_t i = 0; i < m_whiteListCount; i++) {
+        while (ign < m_ignoreListCount && compareAddress(m_ignoreList[ign], m_whiteList[i]) < 0) {
+            ign++;
+        }
+        if (ign < m_ignoreListCount && compareAddress(m_ignoreList[ign], m_whiteList[i]) == 0) {
+            continue;
+        }
+        list[count++] = m_whiteList[i];
+    }
+
+    if (m_ctrlWhiteListSynced && count == m_ctrlWhiteListCount &&
+        memcmp(list, m_ctrlWhiteList, count * sizeof(ble_addr_t)) == 0) {
+        return true;
+    }
+
+    m_ctrlWhiteListSynced = false;
+    m_ctrlWhiteListPending = false;
+    if (!m_synced) {
+        return false;
+    }
+
+    int rc = ble_gap_wl_set(count > 0 ? list : nullptr, count);
+    if (rc != 0) {
+        if (rc == BLE_HS_EBUSY || rc == (BLE_HS_ERR_HCI_BASE + BLE_ERR_CMD_DISALLOWED)) {
+            NIMBLE_LOGD(LOG_TAG, "Filter accept list in use, update pending");
+            m_ctrlWhiteListPending = true;
+        } else if (count == 0 && rc == BLE_HS_EINVAL) {
+            NIMBLE_LOGD(LOG_TAG, "Empty filter accept list refused, filtering in software");
+        } else {
+            NIMBLE_LOGE(LOG_TAG, "Failed to set the filter accept list rc=%d %s",
+                        rc, NimBLEUtils::returnCodeToString(rc));
+        }
+        return false;
+    }
+
+    memcpy(m_ctrlWhiteList, list, count * sizeof(ble_addr_t));
+    m_ctrlWhiteListCount = count;
+    m_ctrlWhiteListSynced = true;
+    return true;
+} // whiteListSync
+
+
+/**
+ * @brief Applies a filter accept list update the controller refused while it was using the list.
+ * @details Called when scanning or advertising stops and when a connection is established.
+ */
+/*STATIC*/
+void NimBLEDevice::whiteListRetry() {
+    if (m_ctrlWhiteListPending) {
+        whiteListSync();
+    }
+} // whiteListRetry
+
+
+/**
+ * @brief Checks if a scan report must be dropped by the host.
+ * @param [in] address The advertiser address.
+ * @param [in] acceptListOnly True if the scan filter policy uses the filter accept list.
+ * @return True if the address is ignored, or not on the white list when acceptListOnly is set.
+ */
+/*STATIC*/
+bool NimBLEDevice::isFiltered(const ble_addr_t &address, bool acceptListOnly) {
+    bool found;
+
+    // The controller list is the white list less the ignored addresses, nothing else gets here
+    if (acceptListOnly && m_ctrlWhiteListSynced) {
+        return false;
+    }
+
+    if (m_ignoreListCount > 0) {
+        findAddress(m_ignoreList, m_ignoreListCount, address, &found);
+        if (found) {
+            return true;
+        }
+    }
+
+    if (acceptListOnly) {
+        findAddress(m_whiteList, m_whiteListCount, address, &found);
+        return !found;
+    }
+
+    return false;
+} // isFiltered
+
+
+/**
+ * @brief Checks if a peer device is whitelisted.
+ * @param [in] address The address to check for in the whitelist.
+ * @returns true if the address is in the whitelist.
+ */
+/*STATIC*/
+bool NimBLEDevice::onWhiteList(const NimBLEAddress & address) {
+    bool found;
+    findAddress(m_whiteList, m_whiteListCount, nativeAddress(address), &found);
+    return found;
+}
+
+
+/**
+ * @brief Add a peer address to the whitelist.
+ * @param [in] address The address to add to the whitelist.
+ * @returns true if successful.
+ * @details Only the change is applied to the controller list. If the controller is using the
+ * list the change is applied when it stops, scan results are filtered in software until then.
+ */
+/*STATIC*/
+bool NimBLEDevice::whiteListAdd(const NimBLEAddress & address) {
+    if (NimBLEDevice::onWhiteList(address)) {
+        return true;
+    }
+
+    if (!insertAddress(m_whiteList, &m_whiteListCount, address)) {
+        NIMBLE_LOGE(LOG_TAG, "Whitelist full");
+        return false;
+    }
+
+    whiteListSync();
+    return true;
+}
+
+
+/**
+ * @brief Remove a peer address from the whitelist.
+ * @param [in] address The address to remove from the whitelist.
+ * @returns true if successful.
+ */
+/*STATIC*/
+bool NimBLEDevice::whiteListRemove(const NimBLEAddress & address) {
+    if (eraseAddress(m_whiteList, &m_whiteListCount, address)) {
+        whiteListSync();
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Gets the count of addresses in the whitelist.
+ * @returns The number of addresses in the whitelist.
+ */
+/*STATIC*/
+size_t NimBLEDevice::getWhiteListCount() {
+    return m_whiteListCount;
+}
+
+
+/**
+ * @brief Gets the address at the index.
+ * @param [in] index The index to retrieve the address from, the list is sorted by address.
+ * @returns the NimBLEAddress at the whitelist index or a null address if not found.
+ */
+/*STATIC*/
+NimBLEAddress NimBLEDevice::getWhiteListAddress(size_t index) {
+    if (index >= m_whiteListCount) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid index; %u", index);
+        return NimBLEAddress();
+    }
+    return NimBLEAddress(m_whiteList[index]);
+}
+
+
+/**
+ * @brief Check if the device address is on our ignore list.
+ * @param [in] address The address to look for.
+ * @return True if ignoring.
+ */
+/*STATIC*/
+bool NimBLEDevice::isIgnored(const NimBLEAddress &address) {
+    bool found;
+    findAddress(m_ignoreList, m_ignoreListCount, nativeAddress(address), &found);
+    return found;
+}
+
+
+/**
+ * @brief Add a device to the ignore list.
+ * @param [in] address The address of the device we want to ignore.
+ * @details A whitelisted address is also removed from the controller filter accept list,
+ * so a scan using the list no longer reports it. The list holds at most
+ * CONFIG_NIMBLE_CPP_FILTER_LIST_MAX addresses.
+ * @return True if the address is on the list, false if the list is full.
+ */
+/*STATIC*/
+bool NimBLEDevice::addIgnored(const NimBLEAddress &address) {
+    if (!insertAddress(m_ignoreList, &m_ignoreListCount, address)) {
+        NIMBLE_LOGE(LOG_TAG, "Ignore list full, max %d addresses", CONFIG_NIMBLE_CPP_FILTER_LIST_MAX);
+        return false;
+    }
+
+    if (onWhiteList(address)) {
+        whiteListSync();
+    }
+    return true;
+}
+
+
+/**
+ * @brief Remove a device from the ignore list.
+ * @param [in] address The address of the device we want to remove from the list.
+ */
+/*STATIC*/
+void  NimBLEDevice::removeIgnored(const NimBLEAddress &address) {
+    if (eraseAddress(m_ignoreList, &m_ignoreListCount, address) && onWhiteList(address)) {
+        whiteListSync();
+    }
+}
+
+#endif // CONFIG_BT_ENABLED
@@ -123,10 +123,16 @@ void NimBLEHIDDevice::hidInfo(uint8_t country, uint8_t flags) {
 /**
  * @brief Create input report characteristic
  * @param [in] reportID input report ID, the same as in report map for input object related to the characteristic
+ * @param [in] indicate also allow indications, which HID hosts do not use; a client subscribed to them
+ * confirms each report, e.g. to measure the delivery latency.
  * @return pointer to new input report characteristic
  */
-NimBLECharacteristic* NimBLEHIDDevice::inputReport(uint8_t reportID) {
-	NimBLECharacteristic* inputReportCharacteristic = m_hidService->createCharacteristic((uint16_t) 0x2a4d, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ_ENC);
+NimBLECharacteristic* NimBLEHIDDevice::inputReport(uint8_t reportID, bool indicate) {
+	uint32_t properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ_ENC;
+	if (indicate) {
+		properties |= NIMBLE_PROPERTY::INDICATE;
+	}
+	NimBLECharacteristic* inputReportCharacteristic = m_hidService->createCharacteristic((uint16_t) 0x2a4d, properties);
 	NimBLEDescriptor* inputReportDescriptor = inputReportCharacteristic->createDescriptor((uint16_t) 0x2908, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::READ_ENC);
 
 	uint8_t desc1_val[] = { reportID, 0x01 };
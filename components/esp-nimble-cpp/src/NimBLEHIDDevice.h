@@ -61,7 +61,7 @@ public:
 
 	//NimBLECharacteristic* 	reportMap();
 	NimBLECharacteristic* 	hidControl();
-	NimBLECharacteristic* 	inputReport(uint8_t reportID);
+	NimBLECharacteristic* 	inputReport(uint8_t reportID, bool indicate = false);
 	NimBLECharacteristic* 	outputReport(uint8_t reportID);
 	NimBLECharacteristic* 	featureReport(uint8_t reportID);
 	NimBLECharacteristic* 	protocolMode();
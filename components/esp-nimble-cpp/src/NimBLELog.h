@@ -23,11 +23,20 @@
       ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__); \
     } while(0)
 
-#  define NIMBLE_LOGD(tag, format, ...) \
-     NIMBLE_CPP_LOG_PRINT(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#  if defined(CONFIG_NIMBLE_CPP_LOG_DEFERRED)
+#    include "NimBLEDeferredLog.h"
+#    define NIMBLE_LOGD(tag, format, ...) \
+       NIMBLE_CPP_LOG_DEFER(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
 
-#  define NIMBLE_LOGI(tag, format, ...) \
-     NIMBLE_CPP_LOG_PRINT(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#    define NIMBLE_LOGI(tag, format, ...) \
+       NIMBLE_CPP_LOG_DEFER(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#  else
+#    define NIMBLE_LOGD(tag, format, ...) \
+       NIMBLE_CPP_LOG_PRINT(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+#    define NIMBLE_LOGI(tag, format, ...) \
+       NIMBLE_CPP_LOG_PRINT(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#  endif
 
 #  define NIMBLE_LOGW(tag, format, ...) \
      NIMBLE_CPP_LOG_PRINT(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
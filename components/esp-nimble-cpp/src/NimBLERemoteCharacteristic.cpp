@@ -181,11 +181,11 @@ int NimBLERemoteCharacteristic::descriptorDiscCB(uint16_t conn_handle,
      */
     if (rc == BLE_HS_EDONE) {
         pTaskData->rc = 0;
-        xTaskNotifyGive(pTaskData->task);
+        NimBLEUtils::taskRelease(pTaskData);
     } else if(rc != 0) {
         // Error; abort discovery.
         pTaskData->rc = rc;
-        xTaskNotifyGive(pTaskData->task);
+        NimBLEUtils::taskRelease(pTaskData);
     }
 
     NIMBLE_LOGD(LOG_TAG,"<< Descriptor Discovered. status: %d", pTaskData->rc);
@@ -220,7 +220,7 @@ int NimBLERemoteCharacteristic::nextCharCB(uint16_t conn_handle,
         pTaskData->rc = rc;
     }
 
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
     return rc;
 }
 
@@ -239,7 +239,7 @@ bool NimBLERemoteCharacteristic::retrieveDescriptors(const NimBLEUUID *uuid_filt
 
     int rc = 0;
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     // If we don't know the end handle of this characteristic retrieve the next one in the service
     // The end handle is the next characteristic definition handle -1.
@@ -463,7 +463,7 @@ NimBLEAttValue NimBLERemoteCharacteristic::readValue(time_t *timestamp) {
     int rc = 0;
     int retryCount = 1;
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, &value};
+    ble_task_data_t taskData = {this, cur_task, 0, &value, nullptr};
 
     do {
         rc = ble_gattc_read_long(pClient->getConnId(), m_handle, 0,
@@ -550,7 +550,7 @@ int NimBLERemoteCharacteristic::onReadCB(uint16_t conn_handle,
     }
 
     pTaskData->rc = rc;
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     return rc;
 } // onReadCB
@@ -608,6 +608,33 @@ bool NimBLERemoteCharacteristic::unsubscribe(bool response) {
 } // unsubscribe
 
 
+/**
+ * @brief Subscribe for notifications or indications without blocking.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @param [in] notifyCallback A callback to be invoked for a notification.
+ * @param [in] callback Optional, called from the host task once the peer confirmed the descriptor write.
+ * @return True if the descriptor write was queued.
+ * @details The descriptors must already be known, from NimBLEClient::discoverAttributes() or\n
+ * NimBLEClient::discoverAttributesAsync(), they are not discovered here.
+ */
+bool NimBLERemoteCharacteristic::subscribeAsync(bool notifications, notify_callback notifyCallback,
+                                                gatt_op_callback callback)
+{
+    const NimBLEUUID cccdUUID((uint16_t)0x2902);
+    for(auto &it: m_descriptorVector) {
+        if(it->getUUID() == cccdUUID) {
+            m_notifyCallback = notifyCallback;
+            uint16_t val = notifications ? 0x01 : 0x02;
+            return getRemoteService()->getClient()->writeValueAsync(it->getHandle(), (uint8_t*)&val, 2,
+                                                                    true, callback);
+        }
+    }
+
+    NIMBLE_LOGE(LOG_TAG, "subscribeAsync(): CCCD of %s not discovered", toString().c_str());
+    return false;
+} // subscribeAsync
+
+
 /**
  * @brief Delete the descriptors in the descriptor vector.
  * @details We maintain a vector called m_descriptorVector that contains pointers to NimBLERemoteDescriptors
@@ -725,7 +752,7 @@ bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length,
     }
 
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     do {
         if(length > mtu) {
@@ -780,6 +807,33 @@ bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length,
 } // writeValue
 
 
+/**
+ * @brief Read the value of the remote characteristic without blocking.
+ * @param [in] callback Called from the host task with the result.
+ * @return True if the read was queued.
+ * @details The value of this object is not updated, see NimBLEClient::readValueAsync.
+ */
+bool NimBLERemoteCharacteristic::readValueAsync(gatt_op_callback callback) {
+    return getRemoteService()->getClient()->readValueAsync(m_handle, callback);
+} // readValueAsync
+
+
+/**
+ * @brief Write a value to the remote characteristic without blocking.
+ * @param [in] data A pointer to the data to write, it is copied.
+ * @param [in] length The length of the data.
+ * @param [in] response True to write with response.
+ * @param [in] callback Optional, called from the host task when the write completed.
+ * @return True if the write was queued.
+ * @details See NimBLEClient::writeValueAsync.
+ */
+bool NimBLERemoteCharacteristic::writeValueAsync(const uint8_t* data, size_t length,
+                                                 bool response, gatt_op_callback callback)
+{
+    return getRemoteService()->getClient()->writeValueAsync(m_handle, data, length, response, callback);
+} // writeValueAsync
+
+
 /**
  * @brief Callback for characteristic write operation.
  * @return success == 0 or error code.
@@ -798,7 +852,7 @@ int NimBLERemoteCharacteristic::onWriteCB(uint16_t conn_handle,
     NIMBLE_LOGI(LOG_TAG, "Write complete; status=%d conn_handle=%d", error->status, conn_handle);
 
     pTaskData->rc = error->status;
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     return 0;
 }
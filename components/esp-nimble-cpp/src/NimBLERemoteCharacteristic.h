@@ -32,11 +32,6 @@ class NimBLERemoteDescriptor;
 typedef std::function<void (NimBLERemoteCharacteristic* pBLERemoteCharacteristic,
                                 uint8_t* pData, size_t length, bool isNotify)> notify_callback;
 
-typedef struct {
-    const NimBLEUUID *uuid;
-    void *task_data;
-} desc_filter_t;
-
 
 /**
  * @brief A model of a remote %BLE characteristic.
@@ -74,6 +69,12 @@ public:
                                                               bool response = false);
     bool                                           writeValue(const std::vector<uint8_t>& v, bool response = false);
     bool                                           writeValue(const char* s, bool response = false);
+    bool                                           readValueAsync(gatt_op_callback callback);
+    bool                                           writeValueAsync(const uint8_t* data, size_t length,
+                                                                   bool response = false,
+                                                                   gatt_op_callback callback = nullptr);
+    bool                                           subscribeAsync(bool notifications, notify_callback notifyCallback,
+                                                                  gatt_op_callback callback = nullptr);
 
 
     /*********************** Template Functions ************************/
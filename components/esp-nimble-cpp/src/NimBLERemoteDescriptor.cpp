@@ -98,7 +98,7 @@ NimBLEAttValue NimBLERemoteDescriptor::readValue() {
     int rc = 0;
     int retryCount = 1;
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, &value};
+    ble_task_data_t taskData = {this, cur_task, 0, &value, nullptr};
 
     do {
         rc = ble_gattc_read_long(pClient->getConnId(), m_handle, 0,
@@ -179,7 +179,7 @@ int NimBLERemoteDescriptor::onReadCB(uint16_t conn_handle,
     }
 
     pTaskData->rc = rc;
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     return rc;
 }
@@ -218,7 +218,7 @@ int NimBLERemoteDescriptor::onWriteCB(uint16_t conn_handle,
     NIMBLE_LOGI(LOG_TAG, "Write complete; status=%d conn_handle=%d", error->status, conn_handle);
 
     pTaskData->rc = error->status;
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     return 0;
 }
@@ -277,7 +277,7 @@ bool NimBLERemoteDescriptor::writeValue(const uint8_t* data, size_t length, bool
     }
 
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     do {
         if(length > mtu) {
@@ -87,6 +87,7 @@ public:
 
 private:
     friend class                NimBLERemoteCharacteristic;
+    friend class                NimBLEClient;
 
     NimBLERemoteDescriptor      (NimBLERemoteCharacteristic* pRemoteCharacteristic,
                                 const struct ble_gatt_dsc *dsc);
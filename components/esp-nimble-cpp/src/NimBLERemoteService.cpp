@@ -199,7 +199,7 @@ int NimBLERemoteService::characteristicDiscCB(uint16_t conn_handle,
         pTaskData->rc = error->status;
     }
 
-    xTaskNotifyGive(pTaskData->task);
+    NimBLEUtils::taskRelease(pTaskData);
 
     NIMBLE_LOGD(LOG_TAG,"<< Characteristic Discovered");
     return error->status;
@@ -216,7 +216,7 @@ bool NimBLERemoteService::retrieveCharacteristics(const NimBLEUUID *uuid_filter)
 
     int rc = 0;
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {this, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {this, cur_task, 0, nullptr, nullptr};
 
     if(uuid_filter == nullptr) {
         rc = ble_gattc_disc_all_chrs(m_pClient->getConnId(),
@@ -246,19 +246,7 @@ bool NimBLERemoteService::retrieveCharacteristics(const NimBLEUUID *uuid_filter)
 
     if(taskData.rc == 0){
         if (uuid_filter == nullptr) {
-            if (m_characteristicVector.size() > 1) {
-                for (auto it = m_characteristicVector.begin(); it != m_characteristicVector.end(); ++it ) {
-                    auto nx = std::next(it, 1);
-                    if (nx == m_characteristicVector.end()) {
-                        break;
-                    }
-                    (*it)->m_endHandle = (*nx)->m_defHandle - 1;
-                }
-            }
-
-            if (m_characteristicVector.size() > 0) {
-                m_characteristicVector.back()->m_endHandle = getEndHandle();
-            }
+            setCharacteristicEndHandles();
         }
 
         NIMBLE_LOGD(LOG_TAG, "<< retrieveCharacteristics()");
@@ -271,6 +259,28 @@ bool NimBLERemoteService::retrieveCharacteristics(const NimBLEUUID *uuid_filter)
 } // retrieveCharacteristics
 
 
+/**
+ * @brief Set the end handle of each characteristic once all of them were discovered.
+ * @details The end handle is the definition handle of the next characteristic - 1,\n
+ * or the end handle of the service for the last one.
+ */
+void NimBLERemoteService::setCharacteristicEndHandles() {
+    if (m_characteristicVector.size() > 1) {
+        for (auto it = m_characteristicVector.begin(); it != m_characteristicVector.end(); ++it ) {
+            auto nx = std::next(it, 1);
+            if (nx == m_characteristicVector.end()) {
+                break;
+            }
+            (*it)->m_endHandle = (*nx)->m_defHandle - 1;
+        }
+    }
+
+    if (m_characteristicVector.size() > 0) {
+        m_characteristicVector.back()->m_endHandle = getEndHandle();
+    }
+} // setCharacteristicEndHandles
+
+
 /**
  * @brief Get the client associated with this service.
  * @return A reference to the client associated with this service.
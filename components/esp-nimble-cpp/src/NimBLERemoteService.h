@@ -61,6 +61,7 @@ private:
 
     // Private methods
     bool                retrieveCharacteristics(const NimBLEUUID *uuid_filter = nullptr);
+    void                setCharacteristicEndHandles();
     static int          characteristicDiscCB(uint16_t conn_handle,
                                              const struct ble_gatt_error *error,
                                              const struct ble_gatt_chr *chr,
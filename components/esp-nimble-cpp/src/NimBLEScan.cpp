@@ -21,6 +21,8 @@
 
 #include <string>
 #include <climits>
+#include <cstring>
+#include <algorithm>
 
 static const char* LOG_TAG = "NimBLEScan";
 
@@ -38,8 +40,11 @@ NimBLEScan::NimBLEScan() {
     m_pScanCallbacks                 = nullptr;
     m_ignoreResults                  = false;
     m_pTaskData                      = nullptr;
+    m_asyncData                      = {};
     m_duration                       = BLE_HS_FOREVER; // make sure this is non-zero in the event of a host reset
     m_maxResults                     = 0xFF;
+    m_scanResults.m_advertisedDevicesVector.reserve(CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX);
+    resetPool();
 }
 
 
@@ -78,26 +83,26 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
             const auto event_type = disc.event_type;
 #endif
             NimBLEAddress advertisedAddress(disc.addr);
+            char addrStr[18];
 
-            // Examine our list of ignored addresses and stop processing if we don't want to see it or are already connected
-            if(NimBLEDevice::isIgnored(advertisedAddress)) {
-                NIMBLE_LOGI(LOG_TAG, "Ignoring device: address: %s", advertisedAddress.toString().c_str());
+            // Examine our list of ignored addresses and stop processing if we don't want to see it or are already connected.
+            // With a filter policy using the accept list the controller already did this, unless its list is out of date.
+            if(NimBLEDevice::isFiltered(disc.addr, pScan->m_scan_params.filter_policy & BLE_HCI_SCAN_FILT_USE_WL)) {
+                NIMBLE_LOGI(LOG_TAG, "Ignoring device: address: %s", advertisedAddress.formatTo(addrStr));
                 return 0;
             }
 
-            NimBLEAdvertisedDevice* advertisedDevice = nullptr;
-
-            // If we've seen this device before get a pointer to it from the vector
-            for(auto &it: pScan->m_scanResults.m_advertisedDevicesVector) {
+            // If we've seen this device before get a pointer to it from the index
 #if CONFIG_BT_NIMBLE_EXT_ADV
-                // Same address but different set ID should create a new advertised device.
-                if (it->getAddress() == advertisedAddress && it->getSetId() == disc.sid) {
+            // Same address but different set ID should create a new advertised device.
+            uint8_t slot = pScan->findDevice(advertisedAddress, disc.sid);
 #else
-                if (it->getAddress() == advertisedAddress) {
+            uint8_t slot = pScan->findDevice(advertisedAddress);
 #endif
-                    advertisedDevice = it;
-                    break;
-                }
+            NimBLEAdvertisedDevice* advertisedDevice = nullptr;
+            if (slot != POOL_NONE) {
+                advertisedDevice = &pScan->m_devicePool[slot];
+                pScan->touchDevice(slot);
             }
 
             // If we haven't seen this device before; create a new instance and insert it in the vector.
@@ -105,14 +110,15 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
             if (advertisedDevice == nullptr &&
                 (!isLegacyAdv || event_type != BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP)) {
                 // Check if we have reach the scan results limit, ignore this one if so.
-                // We still need to store each device when maxResults is 0 to be able to append the scan results
+                // We still need to store each device when maxResults is 0 to be able to append the scan results.
+                // A limit larger than the pool evicts the least recently seen device instead.
                 if (pScan->m_maxResults > 0 && pScan->m_maxResults < 0xFF &&
+                    pScan->m_maxResults <= CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX &&
                    (pScan->m_scanResults.m_advertisedDevicesVector.size() >= pScan->m_maxResults)) {
                     return 0;
                 }
 
-                advertisedDevice = new NimBLEAdvertisedDevice();
-                advertisedDevice->setAddress(advertisedAddress);
+                advertisedDevice = pScan->allocDevice(advertisedAddress);
                 advertisedDevice->setAdvType(event_type, isLegacyAdv);
 #if CONFIG_BT_NIMBLE_EXT_ADV
                 advertisedDevice->setSetId(disc.sid);
@@ -120,10 +126,9 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
                 advertisedDevice->setSecondaryPhy(disc.sec_phy);
                 advertisedDevice->setPeriodicInterval(disc.periodic_adv_itvl);
 #endif
-                pScan->m_scanResults.m_advertisedDevicesVector.push_back(advertisedDevice);
-                NIMBLE_LOGI(LOG_TAG, "New advertiser: %s", advertisedAddress.toString().c_str());
+                NIMBLE_LOGI(LOG_TAG, "New advertiser: %s", advertisedAddress.formatTo(addrStr));
             } else if (advertisedDevice != nullptr) {
-                NIMBLE_LOGI(LOG_TAG, "Updated advertiser: %s", advertisedAddress.toString().c_str());
+                NIMBLE_LOGI(LOG_TAG, "Updated advertiser: %s", advertisedAddress.formatTo(addrStr));
             } else {
                 // Scan response from unknown device
                 return 0;
@@ -160,7 +165,7 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
                 }
                 // If not storing results and we have invoked the callback, delete the device.
                 if(pScan->m_maxResults == 0 && advertisedDevice->m_callbackSent >= 2) {
-                    pScan->erase(advertisedAddress);
+                    pScan->freeDevice((uint8_t)(advertisedDevice - pScan->m_devicePool));
                 }
             }
 
@@ -170,6 +175,8 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
             NIMBLE_LOGD(LOG_TAG, "discovery complete; reason=%d",
                         event->disc_complete.reason);
 
+            NimBLEDevice::whiteListRetry();
+
             if(pScan->m_maxResults == 0) {
                 pScan->clearResults();
             }
@@ -180,7 +187,7 @@ int NimBLEScan::handleGapEvent(ble_gap_event* event, void* arg) {
 
             if(pScan->m_pTaskData != nullptr) {
                 pScan->m_pTaskData->rc = event->disc_complete.reason;
-                xTaskNotifyGive(pScan->m_pTaskData->task);
+                NimBLEUtils::taskRelease(pScan->m_pTaskData);
             }
 
             return 0;
@@ -241,6 +248,8 @@ void NimBLEScan::setLimitedOnly(bool enabled) {
  *      Scanner process advertisements from white list only. A connectable,\n
  *      directed advertisement shall not be ignored if the InitA is a
  *      resolvable private address.
+ * @details With the white list policies the controller drops the reports of devices that are not
+ * whitelisted or are ignored (NimBLEDevice::addIgnored), they never reach the host.
  */
 void NimBLEScan::setFilterPolicy(uint8_t filter) {
     m_scan_params.filter_policy = filter;
@@ -251,6 +260,9 @@ void NimBLEScan::setFilterPolicy(uint8_t filter) {
  * @brief Sets the max number of results to store.
  * @param [in] maxResults The number of results to limit storage to\n
  * 0 == none (callbacks only) 0xFF == unlimited, any other value is the limit.
+ * @details Results live in a pool of CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX entries. When the limit is
+ * unlimited or larger than the pool and the pool is full, the least recently seen device is evicted
+ * and its NimBLEAdvertisedDevice object is reused for the new one.
  */
 void NimBLEScan::setMaxResults(uint8_t maxResults) {
     m_maxResults = maxResults;
@@ -317,6 +329,9 @@ bool NimBLEScan::start(uint32_t duration, bool is_continue) {
         m_ignoreResults = true;
     }
 
+    // Apply accept list changes made while the controller was using the list
+    NimBLEDevice::whiteListSync();
+
 # if CONFIG_BT_NIMBLE_EXT_ADV
     ble_gap_ext_disc_params scan_params;
     scan_params.passive = m_scan_params.passive;
@@ -391,6 +406,8 @@ bool NimBLEScan::stop() {
         return false;
     }
 
+    NimBLEDevice::whiteListRetry();
+
     if(m_maxResults == 0) {
         clearResults();
     }
@@ -400,7 +417,7 @@ bool NimBLEScan::stop() {
     }
 
     if(m_pTaskData != nullptr) {
-        xTaskNotifyGive(m_pTaskData->task);
+        NimBLEUtils::taskRelease(m_pTaskData);
     }
 
     NIMBLE_LOGD(LOG_TAG, "<< stop()");
@@ -424,16 +441,188 @@ void NimBLEScan::clearDuplicateCache() {
  * @details After disconnecting, it may be required in the case we were connected to a device without a public address.
  */
 void NimBLEScan::erase(const NimBLEAddress &address) {
-    NIMBLE_LOGD(LOG_TAG, "erase device: %s", address.toString().c_str());
+    char addrStr[18];
+    NIMBLE_LOGD(LOG_TAG, "erase device: %s", address.formatTo(addrStr));
+
+    uint8_t slot = findDevice(address);
+    if(slot != POOL_NONE) {
+        freeDevice(slot);
+    }
+}
+
 
-    for(auto it = m_scanResults.m_advertisedDevicesVector.begin(); it != m_scanResults.m_advertisedDevicesVector.end(); ++it) {
-        if((*it)->getAddress() == address) {
-            delete *it;
-            m_scanResults.m_advertisedDevicesVector.erase(it);
+/**
+ * @brief Hash an address into a starting position in the index.
+ * @param [in] address The address.
+ * @return The index position to start probing from.
+ */
+/*STATIC*/
+uint16_t NimBLEScan::hashAddress(const NimBLEAddress &address) {
+    return address.hash() & (INDEX_SIZE - 1);
+} // hashAddress
+
+
+/**
+ * @brief Find a stored device by address.
+ * @param [in] address The address of the device.
+ * @param [in] sid The advertising set ID to match, or -1 to match any.
+ * @return The pool slot of the device or POOL_NONE if not found.
+ */
+uint8_t NimBLEScan::findDevice(const NimBLEAddress &address, int sid) {
+    for(uint16_t i = hashAddress(address); m_index[i] != POOL_NONE; i = (i + 1) & (INDEX_SIZE - 1)) {
+        NimBLEAdvertisedDevice* pDev = &m_devicePool[m_index[i]];
+        if(pDev->m_address != address) {
+            continue;
+        }
+#if CONFIG_BT_NIMBLE_EXT_ADV
+        if(sid >= 0 && pDev->m_sid != sid) {
+            continue;
+        }
+#endif
+        return m_index[i];
+    }
+
+    return POOL_NONE;
+} // findDevice
+
+
+/**
+ * @brief Take a device from the pool for a new address, evicting the least recently seen one if full.
+ * @param [in] address The address of the new device.
+ * @return A pointer to the device, already indexed and added to the results.
+ */
+NimBLEAdvertisedDevice* NimBLEScan::allocDevice(const NimBLEAddress &address) {
+    if(m_freeHead == POOL_NONE) {
+        char addrStr[18];
+        NIMBLE_LOGD(LOG_TAG, "Scan results full, evicting: %s",
+                    m_devicePool[m_lruHead].m_address.formatTo(addrStr));
+        freeDevice(m_lruHead);
+    }
+
+    uint8_t slot = m_freeHead;
+    m_freeHead = m_lruNext[slot];
+
+    NimBLEAdvertisedDevice* pDev = &m_devicePool[slot];
+    pDev->setAddress(address);
+    pDev->m_callbackSent = 0;
+
+    uint16_t i = hashAddress(address);
+    while(m_index[i] != POOL_NONE) {
+        i = (i + 1) & (INDEX_SIZE - 1);
+    }
+    m_index[i] = slot;
+
+    lruAppend(slot);
+    m_scanResults.m_advertisedDevicesVector.push_back(pDev);
+    return pDev;
+} // allocDevice
+
+
+/**
+ * @brief Remove a device from the index and results and return it to the pool.
+ * @param [in] slot The pool slot of the device.
+ */
+void NimBLEScan::freeDevice(uint8_t slot) {
+    const uint16_t mask = INDEX_SIZE - 1;
+    uint16_t i = hashAddress(m_devicePool[slot].m_address);
+    while(m_index[i] != slot) {
+        if(m_index[i] == POOL_NONE) {
+            NIMBLE_LOGE(LOG_TAG, "Scan result %u missing from index", slot);
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // Backward shift deletion: pull later members of the probe run into the hole so no
+    // tombstones are needed. An entry may move back to i only if i is not before its home.
+    uint16_t j = i;
+    for(;;) {
+        j = (j + 1) & mask;
+        if(m_index[j] == POOL_NONE) {
             break;
         }
+        uint16_t home = hashAddress(m_devicePool[m_index[j]].m_address);
+        if(((j - home) & mask) >= ((j - i) & mask)) {
+            m_index[i] = m_index[j];
+            i = j;
+        }
     }
-}
+    m_index[i] = POOL_NONE;
+
+    lruUnlink(slot);
+    m_lruNext[slot] = m_freeHead;
+    m_freeHead = slot;
+
+    auto &vec = m_scanResults.m_advertisedDevicesVector;
+    auto it = std::find(vec.begin(), vec.end(), &m_devicePool[slot]);
+    if(it != vec.end()) {
+        vec.erase(it);
+    }
+} // freeDevice
+
+
+/**
+ * @brief Mark a device as the most recently seen.
+ * @param [in] slot The pool slot of the device.
+ */
+void NimBLEScan::touchDevice(uint8_t slot) {
+    if(m_lruTail != slot) {
+        lruUnlink(slot);
+        lruAppend(slot);
+    }
+} // touchDevice
+
+
+/**
+ * @brief Link a device at the most recently seen end of the recency list.
+ * @param [in] slot The pool slot of the device.
+ */
+void NimBLEScan::lruAppend(uint8_t slot) {
+    m_lruPrev[slot] = m_lruTail;
+    m_lruNext[slot] = POOL_NONE;
+    if(m_lruTail != POOL_NONE) {
+        m_lruNext[m_lruTail] = slot;
+    } else {
+        m_lruHead = slot;
+    }
+    m_lruTail = slot;
+} // lruAppend
+
+
+/**
+ * @brief Unlink a device from the recency list.
+ * @param [in] slot The pool slot of the device.
+ */
+void NimBLEScan::lruUnlink(uint8_t slot) {
+    uint8_t prev = m_lruPrev[slot];
+    uint8_t next = m_lruNext[slot];
+
+    if(prev != POOL_NONE) {
+        m_lruNext[prev] = next;
+    } else {
+        m_lruHead = next;
+    }
+    if(next != POOL_NONE) {
+        m_lruPrev[next] = prev;
+    } else {
+        m_lruTail = prev;
+    }
+} // lruUnlink
+
+
+/**
+ * @brief Return every device to the pool and empty the index.
+ */
+void NimBLEScan::resetPool() {
+    m_scanResults.m_advertisedDevicesVector.clear();
+    memset(m_index, POOL_NONE, sizeof(m_index));
+    for(uint8_t i = 0; i < CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX; i++) {
+        m_lruNext[i] = i + 1 < CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX ? i + 1 : POOL_NONE;
+    }
+    m_freeHead = 0;
+    m_lruHead  = POOL_NONE;
+    m_lruTail  = POOL_NONE;
+} // resetPool
 
 
 /**
@@ -461,7 +650,8 @@ void NimBLEScan::onHostSync() {
  * @brief Start scanning and block until scanning has been completed.
  * @param [in] duration The duration in seconds for which to scan.
  * @param [in] is_continue Set to true to save previous scan results, false to clear them.
- * @return The scan results.
+ * @return The scan results. The device pointers in them are only valid until the next scan
+ * evicts or clears the devices, see NimBLEScanResults.
  */
 NimBLEScanResults NimBLEScan::getResults(uint32_t duration, bool is_continue) {
     if(duration == 0) {
@@ -469,7 +659,7 @@ NimBLEScanResults NimBLEScan::getResults(uint32_t duration, bool is_continue) {
     }
 
     TaskHandle_t cur_task = xTaskGetCurrentTaskHandle();
-    ble_task_data_t taskData = {nullptr, cur_task, 0, nullptr};
+    ble_task_data_t taskData = {nullptr, cur_task, 0, nullptr, nullptr};
     m_pTaskData = &taskData;
 
     if(start(duration, is_continue)) {
@@ -485,9 +675,54 @@ NimBLEScanResults NimBLEScan::getResults(uint32_t duration, bool is_continue) {
 } // getResults
 
 
+/**
+ * @brief Start scanning and call back with the results once scanning has been completed.
+ * @param [in] duration The duration in milliseconds for which to scan, 0 scans until stop() is called.
+ * @param [in] callback Called with the results from the host task when the scan times out, or from\n
+ * the task calling stop(). It must not block, it may start the next scan or connection. The device\n
+ * pointers in the results are only valid until the next scan evicts or clears the devices.
+ * @param [in] is_continue Set to true to save previous scan results, false to clear them.
+ * @return True if the scan started, the callback is not called otherwise.
+ */
+bool NimBLEScan::getResultsAsync(uint32_t duration, scan_results_callback callback, bool is_continue) {
+    if(m_pTaskData != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Scan results already awaited");
+        return false;
+    }
+
+    m_resultsCallback = callback;
+    m_asyncData = {this, nullptr, 0, nullptr, NimBLEScan::asyncResume};
+    m_pTaskData = &m_asyncData;
+
+    if(!start(duration, is_continue)) {
+        m_pTaskData = nullptr;
+        m_resultsCallback = nullptr;
+        return false;
+    }
+    return true;
+} // getResultsAsync
+
+
+/**
+ * @brief STATIC Continuation of getResultsAsync(), hands the results to the callback.
+ */
+void NimBLEScan::asyncResume(ble_task_data_t *pTaskData) {
+    NimBLEScan *pScan = (NimBLEScan*)pTaskData->pATT;
+    pScan->m_pTaskData = nullptr;
+
+    // Moved out first, the callback may start the next scan.
+    scan_results_callback callback = std::move(pScan->m_resultsCallback);
+    pScan->m_resultsCallback = nullptr;
+    if(callback) {
+        callback(pScan->m_scanResults);
+    }
+} // asyncResume
+
+
 /**
  * @brief Get the results of the scan.
- * @return NimBLEScanResults object.
+ * @return NimBLEScanResults object. The device pointers in it are only valid until the scan
+ * evicts or clears the devices, see NimBLEScanResults.
  */
 NimBLEScanResults NimBLEScan::getResults() {
     return m_scanResults;
@@ -498,10 +733,7 @@ NimBLEScanResults NimBLEScan::getResults() {
  * @brief Clear the results of the scan.
  */
 void NimBLEScan::clearResults() {
-    for(auto &it: m_scanResults.m_advertisedDevicesVector) {
-        delete it;
-    }
-    m_scanResults.m_advertisedDevicesVector.clear();
+    resetPool();
     clearDuplicateCache();
 }
 
@@ -27,6 +27,15 @@
 #endif
 
 #include <vector>
+#include <functional>
+
+#if !defined(CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX)
+#    define CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX 32
+#elif CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX > 254
+#    error CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX cannot be larger than 254
+#elif CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX < 1
+#    error CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX cannot be less than 1; Range = 1 : 254
+#endif
 
 class NimBLEDevice;
 class NimBLEScan;
@@ -40,6 +49,13 @@ class NimBLEAddress;
  * by a NimBLEAdvertisedDevice object.  The number of items in the set is given by
  * getCount().  We can retrieve a device by calling getDevice() passing in the
  * index (starting at 0) of the desired device.
+ *
+ * The devices live in the scan's fixed pool of CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX slots. A
+ * NimBLEAdvertisedDevice pointer from begin()/end() or getDevice(address) stays valid only until
+ * the scan drops that device: when a new address evicts the least recently seen device from a full
+ * pool, on erase(), clearResults() or a scan started with is_continue = false. The slot is then
+ * reused for another address, so the old pointer silently refers to a different device. Copy the
+ * address, or the device itself, before scanning again.
  */
 class NimBLEScanResults {
 public:
@@ -55,6 +71,12 @@ private:
     std::vector<NimBLEAdvertisedDevice*> m_advertisedDevicesVector;
 };
 
+/**
+ * @brief Completion callback of NimBLEScan::getResultsAsync().
+ * @param [in] results The results of the scan, valid until the next scan clears them.
+ */
+typedef std::function<void (NimBLEScanResults &results)> scan_results_callback;
+
 /**
  * @brief Perform and manage %BLE scans.
  *
@@ -76,6 +98,8 @@ public:
     void                clearResults();
     NimBLEScanResults   getResults();
     NimBLEScanResults   getResults(uint32_t duration, bool is_continue = false);
+    bool                getResultsAsync(uint32_t duration, scan_results_callback callback,
+                                        bool is_continue = false);
     void                setMaxResults(uint8_t maxResults);
     void                erase(const NimBLEAddress &address);
 
@@ -86,16 +110,46 @@ private:
     NimBLEScan();
     ~NimBLEScan();
     static int  handleGapEvent(ble_gap_event*  event, void* arg);
+    static void asyncResume(ble_task_data_t *pTaskData);
     void        onHostReset();
     void        onHostSync();
 
+    static constexpr uint8_t  POOL_NONE  = 0xFF;
+    static constexpr uint16_t INDEX_SIZE = CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX > 128 ? 512 :
+                                           CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX > 64  ? 256 :
+                                           CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX > 32  ? 128 :
+                                           CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX > 16  ? 64  : 32;
+
+    static uint16_t         hashAddress(const NimBLEAddress &address);
+    uint8_t                 findDevice(const NimBLEAddress &address, int sid = -1);
+    NimBLEAdvertisedDevice* allocDevice(const NimBLEAddress &address);
+    void                    freeDevice(uint8_t slot);
+    void                    touchDevice(uint8_t slot);
+    void                    lruAppend(uint8_t slot);
+    void                    lruUnlink(uint8_t slot);
+    void                    resetPool();
+
     NimBLEScanCallbacks*  m_pScanCallbacks;
     ble_gap_disc_params   m_scan_params;
     bool                  m_ignoreResults;
     NimBLEScanResults     m_scanResults;
     uint32_t              m_duration;
     ble_task_data_t       *m_pTaskData;
+    ble_task_data_t       m_asyncData;
+    scan_results_callback m_resultsCallback;
     uint8_t               m_maxResults;
+
+    // Fixed pool of result objects; never reallocated while the scanner exists.
+    NimBLEAdvertisedDevice m_devicePool[CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX];
+    // Open addressing (linear probing) address -> pool slot index, POOL_NONE when empty.
+    uint8_t               m_index[INDEX_SIZE];
+    // Doubly linked recency list through the pool, head is the least recently seen.
+    // Free slots are chained through m_lruNext from m_freeHead.
+    uint8_t               m_lruPrev[CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX];
+    uint8_t               m_lruNext[CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX];
+    uint8_t               m_lruHead;
+    uint8_t               m_lruTail;
+    uint8_t               m_freeHead;
 };
 
 /**
@@ -27,6 +27,8 @@
 #include "nimble/nimble/host/services/gatt/include/services/gatt/ble_svc_gatt.h"
 #endif
 
+#define NULL_HANDLE (0xffff)
+
 static const char* LOG_TAG = "NimBLEServer";
 static NimBLEServerCallbacks defaultCallbacks;
 
@@ -47,6 +49,7 @@ NimBLEServer::NimBLEServer() {
 #endif
     m_svcChanged            = false;
     m_deleteCallbacks       = true;
+    m_attrBaseHandle        = 0;
 } // NimBLEServer
 
 
@@ -133,6 +136,11 @@ NimBLEService* NimBLEServer::getServiceByUUID(const NimBLEUUID &uuid, uint16_t i
  * @return A pointer to the service object or nullptr if not found.
  */
 NimBLEService *NimBLEServer::getServiceByHandle(uint16_t handle) {
+    if (m_gattsStarted) {
+        const AttrEntry* attr = findAttr(handle);
+        return (attr != nullptr && attr->chr == nullptr) ? attr->svc : nullptr;
+    }
+
     for (auto &it : m_svcVec) {
         if (it->getHandle() == handle) {
             return it;
@@ -142,6 +150,94 @@ NimBLEService *NimBLEServer::getServiceByHandle(uint16_t handle) {
 }
 
 
+/**
+ * @brief Get a %BLE Characteristic of any service by its value handle.
+ * @param handle The handle of the characteristic.
+ * @return A pointer to the characteristic object or nullptr if not found.
+ */
+NimBLECharacteristic *NimBLEServer::getCharacteristicByHandle(uint16_t handle) {
+    if (m_gattsStarted) {
+        const AttrEntry* attr = findAttr(handle);
+        return attr != nullptr ? attr->chr : nullptr;
+    }
+
+    for (auto &it : m_svcVec) {
+        NimBLECharacteristic* pChr = it->getCharacteristicByHandle(handle);
+        if (pChr != nullptr) {
+            return pChr;
+        }
+    }
+    return nullptr;
+}
+
+
+/**
+ * @brief Find the attribute table entry of a handle.
+ * @param [in] handle The attribute handle.
+ * @return The entry, or nullptr if the handle is not one of our services or characteristics.
+ */
+const NimBLEServer::AttrEntry* NimBLEServer::findAttr(uint16_t handle) const {
+    // Handles below the base wrap around to large values and fail the size check
+    uint16_t index = handle - m_attrBaseHandle;
+    if (index >= m_attrTable.size() || m_attrTable[index].svc == nullptr) {
+        return nullptr;
+    }
+
+    return &m_attrTable[index];
+} // findAttr
+
+
+/**
+ * @brief Build the handle indexed table of our services and characteristics.
+ * @details Called once the handles are assigned in start(), the table spans from the lowest
+ * to the highest handle we own so lookups are a single index. Handles in between that are
+ * not a service or characteristic value (declarations, descriptors) are left empty.
+ * Removed attributes are left out: they are not in the GATT database and their handle is
+ * stale, it may belong to another attribute or to nothing after the reset.
+ */
+void NimBLEServer::buildAttrTable() {
+    uint16_t minHandle = 0xffff;
+    uint16_t maxHandle = 0;
+
+    for (auto &svc : m_svcVec) {
+        if (svc->m_removed > 0 || svc->m_handle == NULL_HANDLE) {
+            continue;
+        }
+        minHandle = std::min(minHandle, svc->m_handle);
+        maxHandle = std::max(maxHandle, svc->m_handle);
+        for (auto &chr : svc->m_chrVec) {
+            if (chr->m_removed == 0 && chr->m_handle != NULL_HANDLE) {
+                minHandle = std::min(minHandle, chr->m_handle);
+                maxHandle = std::max(maxHandle, chr->m_handle);
+            }
+        }
+    }
+
+    m_attrTable.clear();
+    if (minHandle > maxHandle) {
+        return;
+    }
+
+    m_attrBaseHandle = minHandle;
+    m_attrTable.assign(maxHandle - minHandle + 1, AttrEntry{nullptr, nullptr});
+    m_attrTable.shrink_to_fit();
+
+    for (auto &svc : m_svcVec) {
+        if (svc->m_removed > 0 || svc->m_handle == NULL_HANDLE) {
+            continue;
+        }
+        m_attrTable[svc->m_handle - minHandle] = AttrEntry{svc, nullptr};
+        for (auto &chr : svc->m_chrVec) {
+            if (chr->m_removed == 0 && chr->m_handle != NULL_HANDLE) {
+                m_attrTable[chr->m_handle - minHandle] = AttrEntry{svc, chr};
+            }
+        }
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "Attribute table: handles %u-%u", minHandle, maxHandle);
+} // buildAttrTable
+
+
 #if CONFIG_BT_NIMBLE_EXT_ADV
 /**
  * @brief Retrieve the advertising object that can be used to advertise the existence of the server.
@@ -209,8 +305,8 @@ void NimBLEServer::start() {
 
     NIMBLE_LOGI(LOG_TAG, "Service changed characterisic handle: %d", m_svcChgChrHdl);
 */
-    // Get the assigned service handles and build a vector of characteristics
-    // with Notify / Indicate capabilities for event handling
+    // Get the assigned service handles and build the handle indexed
+    // attribute table used for lookups and event dispatch
     for(auto &svc : m_svcVec) {
         if(svc->m_removed == 0) {
             rc = ble_gatts_find_svc(&svc->getUUID().getNative()->u, &svc->m_handle);
@@ -218,17 +314,9 @@ void NimBLEServer::start() {
                 abort();
             }
         }
-
-        for(auto &chr : svc->m_chrVec) {
-            // if Notify / Indicate is enabled but we didn't create the descriptor
-            // we do it now.
-            if((chr->m_properties & BLE_GATT_CHR_F_INDICATE) ||
-                (chr->m_properties & BLE_GATT_CHR_F_NOTIFY)) {
-                m_notifyChrVec.push_back(chr);
-            }
-        }
     }
 
+    buildAttrTable();
     m_gattsStarted = true;
 } // start
 
@@ -348,6 +436,9 @@ int NimBLEServer::handleGapEvent(struct ble_gap_event *event, void *arg) {
     switch(event->type) {
 
         case BLE_GAP_EVENT_CONNECT: {
+            // Advertising stopped, a filter accept list update may be waiting for it
+            NimBLEDevice::whiteListRetry();
+
             if (event->connect.status != 0) {
                 /* Connection failed; resume advertising */
                 NIMBLE_LOGE(LOG_TAG, "Connection failed");
@@ -410,27 +501,27 @@ int NimBLEServer::handleGapEvent(struct ble_gap_event *event, void *arg) {
                                  event->subscribe.attr_handle,
                                  (event->subscribe.cur_notify ? "true":"false"));
 
-            for(auto &it : pServer->m_notifyChrVec) {
-                if(it->getHandle() == event->subscribe.attr_handle) {
-                    if((it->getProperties() & BLE_GATT_CHR_F_READ_AUTHEN) ||
-                       (it->getProperties() & BLE_GATT_CHR_F_READ_AUTHOR) ||
-                       (it->getProperties() & BLE_GATT_CHR_F_READ_ENC))
-                    {
-                        rc = ble_gap_conn_find(event->subscribe.conn_handle, &peerInfo.m_desc);
-                        if (rc != 0) {
-                            break;
-                        }
-
-                        if(!peerInfo.isEncrypted()) {
-                            NimBLEDevice::startSecurity(event->subscribe.conn_handle);
-                        }
-                    }
-
-                    it->setSubscribe(event);
-                    break;
+            NimBLECharacteristic *pChar = pServer->getCharacteristicByHandle(event->subscribe.attr_handle);
+            if(pChar == nullptr ||
+               !(pChar->getProperties() & (BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE))) {
+                return 0;
+            }
+
+            if((pChar->getProperties() & BLE_GATT_CHR_F_READ_AUTHEN) ||
+               (pChar->getProperties() & BLE_GATT_CHR_F_READ_AUTHOR) ||
+               (pChar->getProperties() & BLE_GATT_CHR_F_READ_ENC))
+            {
+                rc = ble_gap_conn_find(event->subscribe.conn_handle, &peerInfo.m_desc);
+                if (rc != 0) {
+                    return 0;
+                }
+
+                if(!peerInfo.isEncrypted()) {
+                    NimBLEDevice::startSecurity(event->subscribe.conn_handle);
                 }
             }
 
+            pChar->setSubscribe(event);
             return 0;
         } // BLE_GAP_EVENT_SUBSCRIBE
 
@@ -449,14 +540,7 @@ int NimBLEServer::handleGapEvent(struct ble_gap_event *event, void *arg) {
         } // BLE_GAP_EVENT_MTU
 
         case BLE_GAP_EVENT_NOTIFY_TX: {
-            NimBLECharacteristic *pChar = nullptr;
-
-            for(auto &it : pServer->m_notifyChrVec) {
-                if(it->getHandle() == event->notify_tx.attr_handle) {
-                    pChar = it;
-                }
-            }
-
+            NimBLECharacteristic *pChar = pServer->getCharacteristicByHandle(event->notify_tx.attr_handle);
             if(pChar == nullptr) {
                 return 0;
             }
@@ -485,6 +569,16 @@ int NimBLEServer::handleGapEvent(struct ble_gap_event *event, void *arg) {
 
         case BLE_GAP_EVENT_CONN_UPDATE: {
             NIMBLE_LOGD(LOG_TAG, "Connection parameters updated.");
+            if(event->conn_update.status != 0) {
+                return 0;
+            }
+
+            rc = ble_gap_conn_find(event->conn_update.conn_handle, &peerInfo.m_desc);
+            if (rc != 0) {
+                return 0;
+            }
+
+            pServer->m_pServerCallbacks->onConnParamsUpdate(peerInfo);
             return 0;
         } // BLE_GAP_EVENT_CONN_UPDATE
 
@@ -699,6 +793,7 @@ void NimBLEServer::resetGATT() {
         ++it;
     }
 
+    m_attrTable.clear();
     m_svcChanged = false;
     m_gattsStarted = false;
 }
@@ -851,6 +946,10 @@ void NimBLEServerCallbacks::onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo)
     NIMBLE_LOGD("NimBLEServerCallbacks", "onMTUChange(): Default");
 } // onMTUChange
 
+void NimBLEServerCallbacks::onConnParamsUpdate(NimBLEConnInfo& connInfo) {
+    NIMBLE_LOGD("NimBLEServerCallbacks", "onConnParamsUpdate(): Default");
+} // onConnParamsUpdate
+
 uint32_t NimBLEServerCallbacks::onPassKeyRequest(){
     NIMBLE_LOGD("NimBLEServerCallbacks", "onPassKeyRequest: default: 123456");
     return 123456;
@@ -67,6 +67,7 @@ public:
     NimBLEService*         getServiceByUUID(const char* uuid, uint16_t instanceId = 0);
     NimBLEService*         getServiceByUUID(const NimBLEUUID &uuid, uint16_t instanceId = 0);
     NimBLEService*         getServiceByHandle(uint16_t handle);
+    NimBLECharacteristic*  getCharacteristicByHandle(uint16_t handle);
     int                    disconnect(uint16_t connID,
                                       uint8_t reason = BLE_ERR_REM_USER_CONN_TERM);
     void                   updateConnParams(uint16_t conn_handle,
@@ -107,11 +108,22 @@ private:
 //    uint16_t               m_svcChgChrHdl; // Future use
 
     std::vector<NimBLEService*> m_svcVec;
-    std::vector<NimBLECharacteristic*> m_notifyChrVec;
+
+    /**
+     * @brief An attribute table entry, the table is indexed by handle - m_attrBaseHandle.
+     */
+    struct AttrEntry {
+        NimBLEService*        svc; // nullptr for handles that are not ours or not looked up
+        NimBLECharacteristic* chr; // nullptr for the service declaration
+    };
+    uint16_t               m_attrBaseHandle;
+    std::vector<AttrEntry> m_attrTable;
 
     static int             handleGapEvent(struct ble_gap_event *event, void *arg);
     void                   serviceChanged();
     void                   resetGATT();
+    void                   buildAttrTable();
+    const AttrEntry*       findAttr(uint16_t handle) const;
     bool                   setIndicateWait(uint16_t conn_handle);
     void                   clearIndicateWait(uint16_t conn_handle);
 }; // NimBLEServer
@@ -151,6 +163,13 @@ public:
      */
     virtual void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo);
 
+    /**
+     * @brief Called when the connection parameters have been updated.
+     * @param [in] connInfo A reference to a NimBLEConnInfo instance with the
+     * updated connection parameters.
+     */
+    virtual void onConnParamsUpdate(NimBLEConnInfo& connInfo);
+
     /**
      * @brief Called when a client requests a passkey for pairing.
      * @return The passkey to be sent to the client.
@@ -374,6 +374,12 @@ NimBLECharacteristic* NimBLEService::getCharacteristic(const NimBLEUUID &uuid, u
  * @return A pointer to the characteristic object or nullptr if not found.
  */
 NimBLECharacteristic *NimBLEService::getCharacteristicByHandle(uint16_t handle) {
+    NimBLEServer* pServer = getServer();
+    if (pServer->m_gattsStarted) {
+        NimBLECharacteristic* pChr = pServer->getCharacteristicByHandle(handle);
+        return (pChr != nullptr && pChr->getService() == this) ? pChr : nullptr;
+    }
+
     for (auto &it : m_chrVec) {
         if (it->getHandle() == handle) {
             return it;
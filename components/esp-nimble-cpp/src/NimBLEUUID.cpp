@@ -41,33 +41,9 @@ static const char* LOG_TAG = "NimBLEUUID";
  *
  * @param [in] value The string to build a UUID from.
  */
- NimBLEUUID::NimBLEUUID(const std::string &value) {
-    m_valueSet = true;
-    if (value.length() == 4) {
-        m_uuid.u.type         = BLE_UUID_TYPE_16;
-        m_uuid.u16.value = strtoul(value.c_str(), NULL, 16);
-    }
-    else if (value.length() == 8) {
-        m_uuid.u.type         = BLE_UUID_TYPE_32;
-        m_uuid.u32.value = strtoul(value.c_str(), NULL, 16);
-    }
-    else if (value.length() == 16) {
-        *this = NimBLEUUID((uint8_t*)value.data(), 16, true);
-    }
-    else if (value.length() == 36) {
-        // If the length of the string is 36 bytes then we will assume it is a long hex string in
-        // UUID format.
-        char * position = const_cast<char *>(value.c_str());
-        uint32_t first =    strtoul(position, &position, 16);
-        uint16_t second =   strtoul(position + 1, &position, 16);
-        uint16_t third =    strtoul(position + 1, &position, 16);
-        uint16_t fourth =   strtoul(position + 1, &position, 16);
-        uint64_t fifth =    strtoull(position + 1, NULL, 16);
-        *this = NimBLEUUID(first, second, third, (uint64_t(fourth) << 48) + fifth);
-    }
-    else {
-        m_valueSet = false;
-    }
+NimBLEUUID::NimBLEUUID(const std::string &value)
+: m_uuid{} {
+    parse(value.data(), value.length());
 } // NimBLEUUID(std::string)
 
 
@@ -103,29 +79,9 @@ NimBLEUUID::NimBLEUUID(const uint8_t* pData, size_t size, bool msbFirst) {
     } else {
         memcpy(uuidValue, pData, size);
     }
-    m_valueSet = true;
-} // NimBLEUUID
-
-
-/**
- * @brief Create a UUID from the 16bit value.
- * @param [in] uuid The 16bit short form UUID.
- */
-NimBLEUUID::NimBLEUUID(uint16_t uuid) {
-    m_uuid.u.type        = BLE_UUID_TYPE_16;
-    m_uuid.u16.value     = uuid;
-    m_valueSet           = true;
-} // NimBLEUUID
 
-
-/**
- * @brief Create a UUID from the 32bit value.
- * @param [in] uuid The 32bit short form UUID.
- */
-NimBLEUUID::NimBLEUUID(uint32_t uuid) {
-    m_uuid.u.type        = BLE_UUID_TYPE_32;
-    m_uuid.u32.value     = uuid;
-    m_valueSet           = true;
+    m_type     = m_uuid.u.type;
+    m_valueSet = true;
 } // NimBLEUUID
 
 
@@ -136,35 +92,8 @@ NimBLEUUID::NimBLEUUID(uint32_t uuid) {
 NimBLEUUID::NimBLEUUID(const ble_uuid128_t* uuid) {
     m_uuid.u.type        = BLE_UUID_TYPE_128;
     memcpy(m_uuid.u128.value, uuid->value, 16);
-    m_valueSet = true;
-} // NimBLEUUID
-
-
-/**
- * @brief Create a UUID from the 128bit value using hex parts instead of string,
- * instead of NimBLEUUID("ebe0ccb0-7a0a-4b0c-8a1a-6ff2997da3a6"), it becomes
- * NimBLEUUID(0xebe0ccb0, 0x7a0a, 0x4b0c, 0x8a1a6ff2997da3a6)
- *
- * @param [in] first  The first 32bit of the UUID.
- * @param [in] second The next 16bit of the UUID.
- * @param [in] third  The next 16bit of the UUID.
- * @param [in] fourth The last 64bit of the UUID, combining the last 2 parts of the string equivalent
- */
-NimBLEUUID::NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t fourth) {
-    m_uuid.u.type        = BLE_UUID_TYPE_128;
-    memcpy(m_uuid.u128.value + 12, &first,  4);
-    memcpy(m_uuid.u128.value + 10, &second, 2);
-    memcpy(m_uuid.u128.value + 8,  &third,  2);
-    memcpy(m_uuid.u128.value,      &fourth, 8);
-    m_valueSet = true;
-}
-
-
-/**
- * @brief Creates an empty UUID.
- */
-NimBLEUUID::NimBLEUUID() {
-    m_valueSet = false;
+    m_type               = BLE_UUID_TYPE_128;
+    m_valueSet           = true;
 } // NimBLEUUID
 
 
@@ -189,37 +118,6 @@ bool NimBLEUUID::equals(const NimBLEUUID &uuid) const {
 }
 
 
-/**
- * Create a NimBLEUUID from a string of the form:
- * 0xNNNN
- * 0xNNNNNNNN
- * 0x<UUID\>
- * NNNN
- * NNNNNNNN
- * <UUID\>
- *
- * @param [in] uuid The string to create the UUID from.
- */
-NimBLEUUID NimBLEUUID::fromString(const std::string &uuid) {
-    uint8_t start = 0;
-    if (strstr(uuid.c_str(), "0x") != nullptr) { // If the string starts with 0x, skip those characters.
-        start = 2;
-    }
-    uint8_t len = uuid.length() - start; // Calculate the length of the string we are going to use.
-
-    if(len == 4) {
-        uint16_t x = strtoul(uuid.substr(start, len).c_str(), NULL, 16);
-        return NimBLEUUID(x);
-    } else if (len == 8) {
-        uint32_t x = strtoul(uuid.substr(start, len).c_str(), NULL, 16);
-        return NimBLEUUID(x);
-    } else if (len == 36) {
-        return NimBLEUUID(uuid);
-    }
-    return NimBLEUUID();
-} // fromString
-
-
 /**
  * @brief Get the native UUID value.
  * @return The native UUID value or nullptr if not set.
@@ -296,53 +194,6 @@ std::string NimBLEUUID::toString() const {
 } // toString
 
 
-/**
- * @brief Convenience operator to check if this UUID is equal to another.
- */
-bool NimBLEUUID::operator ==(const NimBLEUUID & rhs) const {
-    if(m_valueSet && rhs.m_valueSet) {
-        if(m_uuid.u.type != rhs.m_uuid.u.type) {
-            uint8_t uuidBase[16] = {
-                0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80,
-                0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-            };
-
-            if(m_uuid.u.type == BLE_UUID_TYPE_128){
-                if(rhs.m_uuid.u.type == BLE_UUID_TYPE_16){
-                    memcpy(uuidBase+12, &rhs.m_uuid.u16.value, 2);
-                } else if (rhs.m_uuid.u.type == BLE_UUID_TYPE_32){
-                    memcpy(uuidBase+12, &rhs.m_uuid.u32.value, 4);
-                }
-                return memcmp(m_uuid.u128.value,uuidBase,16) == 0;
-
-            } else if(rhs.m_uuid.u.type == BLE_UUID_TYPE_128) {
-                if(m_uuid.u.type == BLE_UUID_TYPE_16){
-                    memcpy(uuidBase+12, &m_uuid.u16.value, 2);
-                } else if (m_uuid.u.type == BLE_UUID_TYPE_32){
-                    memcpy(uuidBase+12, &m_uuid.u32.value, 4);
-                }
-                return memcmp(rhs.m_uuid.u128.value,uuidBase,16) == 0;
-
-            } else {
-                return false;
-            }
-        }
-
-        return ble_uuid_cmp(&m_uuid.u, &rhs.m_uuid.u) == 0;
-    }
-
-    return m_valueSet == rhs.m_valueSet;
-}
-
-
-/**
- * @brief Convenience operator to check if this UUID is not equal to another.
- */
-bool NimBLEUUID::operator !=(const NimBLEUUID & rhs) const {
-    return !this->operator==(rhs);
-}
-
-
 /**
  * @brief Convenience operator to convert this UUID to string representation.
  * @details This allows passing NimBLEUUID to functions
@@ -30,35 +30,296 @@
 /**************************/
 
 #include <string>
+#include <string_view>
+#include <algorithm>
+#include <functional>
 
 /**
  * @brief A model of a %BLE UUID.
+ * @details UUIDs of the same size compare their values directly; a 16 or 32 bit UUID equals a
+ * 128 bit UUID holding it in the Bluetooth base UUID. The integer and string literal
+ * constructors are constexpr, e.g. `static constexpr NimBLEUUID hidService("1812");`
  */
 class NimBLEUUID {
 public:
     NimBLEUUID(const std::string &uuid);
-    NimBLEUUID(uint16_t uuid);
-    NimBLEUUID(uint32_t uuid);
+    constexpr NimBLEUUID(const char* uuid);
+    constexpr NimBLEUUID(uint16_t uuid);
+    constexpr NimBLEUUID(uint32_t uuid);
     NimBLEUUID(const ble_uuid128_t* uuid);
     NimBLEUUID(const uint8_t* pData, size_t size, bool msbFirst);
-    NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t fourth);
-    NimBLEUUID();
+    constexpr NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t fourth);
+    constexpr NimBLEUUID();
 
     uint8_t               bitSize() const;
     bool                  equals(const NimBLEUUID &uuid) const;
+    constexpr uint32_t    hash() const;
     const ble_uuid_any_t* getNative() const;
     const NimBLEUUID &    to128();
     const NimBLEUUID&     to16();
     std::string           toString() const;
-    static NimBLEUUID     fromString(const std::string &uuid);
+    static constexpr NimBLEUUID fromString(std::string_view uuid);
 
-    bool operator ==(const NimBLEUUID & rhs) const;
-    bool operator !=(const NimBLEUUID & rhs) const;
+    constexpr bool operator ==(const NimBLEUUID & rhs) const;
+    constexpr bool operator !=(const NimBLEUUID & rhs) const;
     operator std::string() const;
 
 private:
+    static constexpr int hexValue(char c);
+    constexpr void       parse(const char* uuid, size_t length);
+    constexpr bool       shortValue(uint32_t* value) const;
+
+    // The type is also kept outside the union, in its padding, so constexpr code reads only the active member
     ble_uuid_any_t m_uuid;
+    uint8_t        m_type     = 0;
     bool           m_valueSet = false;
 }; // NimBLEUUID
+
+// NimBLEUUID is embedded in every attribute, keep it at the size of the native UUID plus the flags
+static_assert(sizeof(NimBLEUUID) == sizeof(ble_uuid_any_t) + 4, "NimBLEUUID grew");
+
+
+/**
+ * @brief Create a UUID from a string literal without going through std::string.
+ * @details Accepts the same forms as NimBLEUUID(const std::string&): 4 or 8 hex digits,
+ * 16 bytes of binary data or a 36 character UUID string.
+ * @param [in] uuid The null terminated string to build a UUID from.
+ */
+constexpr NimBLEUUID::NimBLEUUID(const char* uuid)
+: m_uuid{} {
+    if (uuid != nullptr) {
+        parse(uuid, std::char_traits<char>::length(uuid));
+    }
+} // NimBLEUUID(const char*)
+
+
+/**
+ * @brief Create a UUID from the 16bit value.
+ * @param [in] uuid The 16bit short form UUID.
+ */
+constexpr NimBLEUUID::NimBLEUUID(uint16_t uuid)
+: m_uuid{.u16 = {{BLE_UUID_TYPE_16}, uuid}}, m_type(BLE_UUID_TYPE_16), m_valueSet(true) {
+} // NimBLEUUID
+
+
+/**
+ * @brief Create a UUID from the 32bit value.
+ * @param [in] uuid The 32bit short form UUID.
+ */
+constexpr NimBLEUUID::NimBLEUUID(uint32_t uuid)
+: m_uuid{.u32 = {{BLE_UUID_TYPE_32}, uuid}}, m_type(BLE_UUID_TYPE_32), m_valueSet(true) {
+} // NimBLEUUID
+
+
+/**
+ * @brief Create a UUID from the 128bit value using hex parts instead of string,
+ * instead of NimBLEUUID("ebe0ccb0-7a0a-4b0c-8a1a-6ff2997da3a6"), it becomes
+ * NimBLEUUID(0xebe0ccb0, 0x7a0a, 0x4b0c, 0x8a1a6ff2997da3a6)
+ *
+ * @param [in] first  The first 32bit of the UUID.
+ * @param [in] second The next 16bit of the UUID.
+ * @param [in] third  The next 16bit of the UUID.
+ * @param [in] fourth The last 64bit of the UUID, combining the last 2 parts of the string equivalent
+ */
+constexpr NimBLEUUID::NimBLEUUID(uint32_t first, uint16_t second, uint16_t third, uint64_t fourth)
+: m_uuid{.u128 = {{BLE_UUID_TYPE_128}, {}}}, m_type(BLE_UUID_TYPE_128), m_valueSet(true) {
+    // Little endian, as stored by NimBLE
+    for (int i = 0; i < 8; i++) {
+        m_uuid.u128.value[i] = fourth >> (8 * i);
+    }
+    for (int i = 0; i < 2; i++) {
+        m_uuid.u128.value[8 + i]  = third >> (8 * i);
+        m_uuid.u128.value[10 + i] = second >> (8 * i);
+    }
+    for (int i = 0; i < 4; i++) {
+        m_uuid.u128.value[12 + i] = first >> (8 * i);
+    }
+} // NimBLEUUID
+
+
+/**
+ * @brief Creates an empty UUID.
+ */
+constexpr NimBLEUUID::NimBLEUUID()
+: m_uuid{} {
+} // NimBLEUUID
+
+
+/**
+ * Create a NimBLEUUID from a string of the form:
+ * 0xNNNN
+ * 0xNNNNNNNN
+ * 0x<UUID\>
+ * NNNN
+ * NNNNNNNN
+ * <UUID\>
+ *
+ * @param [in] uuid The string to create the UUID from.
+ */
+constexpr NimBLEUUID NimBLEUUID::fromString(std::string_view uuid) {
+    if (uuid.substr(0, 2) == "0x") { // If the string starts with 0x, skip those characters.
+        uuid.remove_prefix(2);
+    }
+
+    NimBLEUUID ret;
+    if (uuid.length() == 4 || uuid.length() == 8 || uuid.length() == 36) {
+        ret.parse(uuid.data(), uuid.length());
+    }
+    return ret;
+} // fromString
+
+
+/**
+ * @brief Convenience operator to check if this UUID is equal to another.
+ * @details 16 and 32 bit UUIDs are equal to their 128 bit form.
+ */
+constexpr bool NimBLEUUID::operator ==(const NimBLEUUID & rhs) const {
+    if (!m_valueSet || !rhs.m_valueSet) {
+        return m_valueSet == rhs.m_valueSet;
+    }
+
+    if (m_type == BLE_UUID_TYPE_128 && rhs.m_type == BLE_UUID_TYPE_128) {
+        return std::equal(m_uuid.u128.value, m_uuid.u128.value + 16, rhs.m_uuid.u128.value);
+    }
+
+    uint32_t value = 0, rhsValue = 0;
+    return shortValue(&value) && rhs.shortValue(&rhsValue) && value == rhsValue;
+}
+
+
+/**
+ * @brief Get a hash of the UUID, for hashed indexes and std::unordered containers.
+ * @details UUIDs that compare equal have equal hashes: a 128 bit UUID in the Bluetooth base
+ * UUID hashes its 16 or 32 bit value.
+ */
+constexpr uint32_t NimBLEUUID::hash() const {
+    uint32_t value = 0;
+    if (!m_valueSet) {
+        return 0;
+    }
+
+    if (!shortValue(&value)) {
+        // FNV-1a of the 128 bits
+        value = 2166136261u;
+        for (int i = 0; i < 16; i++) {
+            value = (value ^ m_uuid.u128.value[i]) * 16777619u;
+        }
+    }
+    return (value * 0x9e3779b1u) ^ (value >> 16);
+} // hash
+
+
+/**
+ * @brief Convenience operator to check if this UUID is not equal to another.
+ */
+constexpr bool NimBLEUUID::operator !=(const NimBLEUUID & rhs) const {
+    return !this->operator==(rhs);
+}
+
+
+/**
+ * @brief Get the value of a hex digit.
+ * @return The value 0-15, or -1 if c is not a hex digit.
+ */
+constexpr int NimBLEUUID::hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+} // hexValue
+
+
+/**
+ * @brief Set the UUID from its string form.
+ * @details Leaves the UUID unset if the length is not 4, 8, 16 or 36, or a hex digit is invalid.
+ * 16 characters are taken as binary data, most significant byte first.
+ * @param [in] uuid The string, need not be null terminated.
+ * @param [in] length The length of the string.
+ */
+constexpr void NimBLEUUID::parse(const char* uuid, size_t length) {
+    m_valueSet = false;
+
+    if (length == 4 || length == 8) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < length; i++) {
+            int nibble = hexValue(uuid[i]);
+            if (nibble < 0) {
+                return;
+            }
+            value = (value << 4) | nibble;
+        }
+
+        *this = length == 4 ? NimBLEUUID((uint16_t)value) : NimBLEUUID(value);
+    }
+    else if (length == 16) {
+        m_uuid.u128 = ble_uuid128_t{{BLE_UUID_TYPE_128}, {}};
+        for (size_t i = 0; i < 16; i++) {
+            m_uuid.u128.value[15 - i] = uuid[i];
+        }
+        m_type     = BLE_UUID_TYPE_128;
+        m_valueSet = true;
+    }
+    else if (length == 36) {
+        // "beb5483e-36e1-4688-b7f5-ea07361b26a8", most significant byte first
+        ble_uuid128_t value{{BLE_UUID_TYPE_128}, {}};
+        size_t pos = 0;
+        for (int i = 15; i >= 0; i--) {
+            if (pos == 8 || pos == 13 || pos == 18 || pos == 23) {
+                if (uuid[pos++] != '-') {
+                    return;
+                }
+            }
+
+            int high = hexValue(uuid[pos++]);
+            int low  = hexValue(uuid[pos++]);
+            if (high < 0 || low < 0) {
+                return;
+            }
+            value.value[i] = (high << 4) | low;
+        }
+
+        m_uuid.u128 = value;
+        m_type     = BLE_UUID_TYPE_128;
+        m_valueSet = true;
+    }
+} // parse
+
+
+/**
+ * @brief Get the 16 or 32 bit value of the UUID, also from a 128 bit UUID in the Bluetooth base UUID.
+ * @param [out] value The short UUID, from 0000xxxx-0000-1000-8000-00805f9b34fb for a 128 bit UUID.
+ * @return False if the UUID is a 128 bit UUID outside the base UUID.
+ */
+constexpr bool NimBLEUUID::shortValue(uint32_t* value) const {
+    constexpr uint8_t base[12] = {0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00,
+                                  0x00, 0x80, 0x00, 0x10, 0x00, 0x00};
+
+    switch (m_type) {
+        case BLE_UUID_TYPE_16:
+            *value = m_uuid.u16.value;
+            return true;
+        case BLE_UUID_TYPE_32:
+            *value = m_uuid.u32.value;
+            return true;
+        default:
+            if (!std::equal(base, base + 12, m_uuid.u128.value)) {
+                return false;
+            }
+            *value = 0;
+            for (int i = 3; i >= 0; i--) {
+                *value = (*value << 8) | m_uuid.u128.value[12 + i];
+            }
+            return true;
+    }
+} // shortValue
+
+
+/**
+ * @brief Hash of a UUID, equal for UUIDs of different sizes that compare equal.
+ */
+template<>
+struct std::hash<NimBLEUUID> {
+    size_t operator()(const NimBLEUUID &uuid) const { return uuid.hash(); }
+};
 #endif /* CONFIG_BT_ENABLED */
 #endif /* COMPONENTS_NIMBLEUUID_H_ */
@@ -17,6 +17,21 @@
 static const char* LOG_TAG = "NimBLEUtils";
 
 
+/**
+ * @brief Complete an operation from the host task.
+ * @param [in] pTaskData The operation, rc holds its result.
+ * @details Wakes the task blocked on the operation, or runs its continuation when it was\n
+ * started asynchronously. The continuation runs in the host task and must not block.
+ */
+void NimBLEUtils::taskRelease(ble_task_data_t *pTaskData) {
+    if(pTaskData->task != nullptr) {
+        xTaskNotifyGive(pTaskData->task);
+    } else if(pTaskData->resume != nullptr) {
+        pTaskData->resume(pTaskData);
+    }
+} // taskRelease
+
+
 /**
  * @brief A function for checking validity of connection parameters.
  * @param [in] params A pointer to the structure containing the parameters to check.
@@ -25,11 +25,17 @@
 
 #include <string>
 
-typedef struct {
+/**
+ * @brief State of an operation that completes in the host task.
+ * @details A blocking call sets task and waits for a notification. An asynchronous call leaves\n
+ * task null and sets resume, which the host task calls with the result in rc instead.
+ */
+typedef struct ble_task_data_s {
     void *pATT;
     TaskHandle_t task;
     int rc;
     void *buf;
+    void (*resume)(struct ble_task_data_s *pTaskData);
 } ble_task_data_t;
 
 
@@ -44,6 +50,7 @@ public:
     static const char*          advTypeToString(uint8_t advType);
     static const char*          returnCodeToString(int rc);
     static int                  checkConnParams(ble_gap_conn_params* params);
+    static void                 taskRelease(ble_task_data_t *pTaskData);
 };
 
 
@@ -50,11 +50,53 @@
 /** @brief Uncomment to set the default allocation size (bytes) for each attribute if\n
  *  not specified when the constructor is called. This is also the size used when a remote\n
  *  characteristic or descriptor is constructed before a value is read/notifed.\n
+ *  Nothing is allocated until a value outgrows CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH.\n
  *  Increasing this will reduce reallocations but increase memory footprint.\n
  *  Default value is 20. Range: 1 : 512 (BLE_ATT_ATTR_MAX_LEN)
  */
 #define CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH 20
 
+/** @brief Un-comment to change the size (bytes) of the storage inside each attribute value.\n
+ *  Values up to this size do not need a heap allocation, the first value set that is larger\n
+ *  moves to a heap buffer of at least CONFIG_NIMBLE_CPP_ATT_VALUE_INIT_LENGTH bytes.\n
+ *  Default value is 10. Range: 0 : 64
+ */
+#define CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH 10
+
+/** @brief Un-comment to change the number of scan results stored.\n
+ *  Results are kept in a fixed pool allocated with the scanner, the least recently\n
+ *  seen device is evicted when it is full.\n
+ *  Default value is 32. Range: 1 : 254
+ */
+#define CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX 32
+
+/** @brief Un-comment to cache the attributes found by NimBLEClient::discoverAttributes in NVS.\n
+ *  On reconnect the peer database hash is read and the attributes are restored without\n
+ *  discovery if it has not changed. Peers without a database hash are always discovered.
+ */
+#define CONFIG_NIMBLE_CPP_GATT_CACHE
+
+/** @brief Un-comment to change the number of peers kept in the attribute cache.\n
+ *  The least recently connected peer is removed when it is full.\n
+ *  Default value is 4. Range: 1 : 16
+ */
+#define CONFIG_NIMBLE_CPP_GATT_CACHE_MAX_PEERS 4
+
+/** @brief Un-comment to keep bonds in RAM with least recently used eviction and batched NVS writes.\n
+ *  The bonds of the default store are copied the first time.
+ */
+#define CONFIG_NIMBLE_CPP_BOND_STORE
+
+/** @brief Un-comment to change the delay before pending bond changes are written to NVS.\n
+ *  Default value is 2000. Range: 0 : 60000
+ */
+#define CONFIG_NIMBLE_CPP_BOND_STORE_FLUSH_MS 2000
+
+/** @brief Un-comment to change the number of addresses the white list and the ignore list can hold.\n
+ *  Default value is 16. Range: 1 : 64
+ */
+#define CONFIG_NIMBLE_CPP_FILTER_LIST_MAX 16
+
 /** @brief Un-comment to change the default MTU size */
 #define CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU 255
 
@@ -73,6 +115,22 @@
  */
 #define CONFIG_NIMBLE_CPP_LOG_LEVEL 0
 
+/** @brief Un-comment to defer the debug and info logs of the wrapper.\n
+ *  Only the format string address and the arguments are recorded, they are formatted later\n
+ *  by a low priority task or on the host with tools/decode_deferred_log.py.
+ */
+#define CONFIG_NIMBLE_CPP_LOG_DEFERRED
+
+/** @brief Un-comment to change the size of the deferred log buffer of each core.\n
+ *  Must be a power of two. Default value is 4096. Range: 512 : 65536
+ */
+#define CONFIG_NIMBLE_CPP_LOG_DEFERRED_BUFFER_SIZE 4096
+
+/** @brief Un-comment to print the deferred logs from a task started by NimBLEDevice::init.\n
+ *  The task drains the records NimBLEDeferredLog::dump would return, use one or the other.
+ */
+#define CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT
+
 /** @brief Un-comment to see NimBLE host return codes as text debug log messages.
  *  Uses approx. 7kB of flash memory.
  */
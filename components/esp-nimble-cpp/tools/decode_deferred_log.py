@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Decodes a NimBLEDeferredLog dump against the ELF file of the application that made it.
+
+The dump only holds the addresses of the format strings and tags, the strings are read from
+the allocated sections of the ELF file. Usage:
+
+    curl -s http://<device>/log > log.bin
+    decode_deferred_log.py build/app.elf log.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LEVELS = 'NEWIDV'
+HEADER = struct.Struct('<HBBIII')
+
+# Same conversions as NimBLEDeferredLog::format, the target is 32 bit
+SPEC = re.compile(r'%([-+ #0]*)([0-9]*(?:\.[0-9]*)?)(hh|h|ll|l|L|q|j|z|t)?([diuoxXcfFeEgGaAsp%])')
+
+
+class Elf:
+    """Maps addresses of allocated sections to their contents."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF':
+            raise ValueError(f'{path} is not an ELF file')
+
+        is64 = data[4] == 2
+        endian = '<' if data[5] == 1 else '>'
+        if is64:
+            shoff, = struct.unpack_from(endian + 'Q', data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', data, 0x3A)
+            section = struct.Struct(endian + 'IIQQQQIIQQ')
+        else:
+            shoff, = struct.unpack_from(endian + 'I', data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + 'HH', data, 0x2E)
+            section = struct.Struct(endian + 'IIIIIIIIII')
+
+        SHT_PROGBITS = 1
+        SHF_ALLOC = 2
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = section.unpack_from(data, shoff + i * shentsize)[:6]
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and addr != 0:
+                self.sections.append((addr, size, data[offset:offset + size]))
+
+    def string(self, addr):
+        for start, size, content in self.sections:
+            if start <= addr < start + size:
+                end = content.find(b'\0', addr - start)
+                return content[addr - start:end if end >= 0 else size].decode('utf-8', 'replace')
+        return f'<0x{addr:08x}>'
+
+
+def format_record(fmt, args):
+    """Formats the recorded arguments like NimBLEDeferredLog::format."""
+    out = []
+    pos = 0
+    offset = 0
+
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+
+        spec = '%' + flags + width
+        try:
+            if conv in 'diuoxXc':
+                wide = length in ('ll', 'q', 'j') and conv != 'c'
+                size = 8 if wide else 4
+                if len(args) < offset + size:
+                    raise IndexError
+                value = int.from_bytes(args[offset:offset + size], 'little', signed=conv in 'di')
+                offset += size
+                out.append((spec + ('d' if conv == 'i' else 'd' if conv == 'u' else conv)) % value)
+            elif conv in 'fFeEgGaA':
+                value, = struct.unpack_from('<d', args, offset)
+                offset += 8
+                out.append((spec + ('f' if conv == 'a' else 'F' if conv == 'A' else conv)) % value)
+            elif conv == 's':
+                n = args[offset]
+                value = args[offset + 1:offset + 1 + n].decode('utf-8', 'replace')
+                offset += 1 + n
+                out.append((spec + 's') % value)
+            else:
+                value, = struct.unpack_from('<I', args, offset)
+                offset += 4
+                out.append(f'0x{value:08x}')
+        except (IndexError, struct.error):
+            out.append('<truncated>')
+            return ''.join(out)
+
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('elf', help='application ELF file')
+    parser.add_argument('dump', nargs='?', help='dump file, standard input if omitted')
+    options = parser.parse_args()
+
+    elf = Elf(options.elf)
+    if options.dump:
+        with open(options.dump, 'rb') as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        size, level, core, time_us, fmt, tag = HEADER.unpack_from(data, pos)
+        if size < HEADER.size or pos + size > len(data):
+            print(f'Corrupt record at offset {pos}', file=sys.stderr)
+            return 1
+
+        text = format_record(elf.string(fmt), data[pos + HEADER.size:pos + size])
+        level_char = LEVELS[level] if level < len(LEVELS) else 'N'
+        print(f'{level_char} ({time_us // 1000}.{time_us % 1000:03}) [{core}] {elf.string(tag)}: {text}')
+        pos += size
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -55,6 +55,8 @@ static const char *TAG = "mdns";
 
 static volatile TaskHandle_t _mdns_service_task_handle = NULL;
 static SemaphoreHandle_t _mdns_service_semaphore = NULL;
+// Posted by the timer whenever scheduled packets are due, at most once in action_queue (tx_action_queued)
+static mdns_action_t _mdns_tx_action = { .type = ACTION_TX_HANDLE };
 
 static void _mdns_search_finish_done(void);
 static mdns_search_once_t *_mdns_search_find_from(mdns_search_once_t *search, mdns_name_t *name, uint16_t type, mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol);
@@ -1522,9 +1524,97 @@ static void _mdns_free_tx_packet(mdns_tx_packet_t *packet)
     free(packet);
 }
 
+/**
+ * @brief  compare two scheduled packets, earlier send_at first, then the order of scheduling
+ *
+ * send_at wraps with the tick count, so the difference is compared, as in _mdns_scheduler_run()
+ */
+static inline bool _mdns_tx_packet_before(const mdns_tx_packet_t *a, const mdns_tx_packet_t *b)
+{
+    int32_t diff = (int32_t)(a->send_at - b->send_at);
+    return diff < 0 || (diff == 0 && (int32_t)(a->seq - b->seq) < 0);
+}
+
+static void _mdns_tx_queue_sift_up(size_t i)
+{
+    mdns_tx_packet_t **heap = _mdns_server->tx_queue;
+    mdns_tx_packet_t *p = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!_mdns_tx_packet_before(p, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = p;
+}
+
+static void _mdns_tx_queue_sift_down(size_t i)
+{
+    mdns_tx_packet_t **heap = _mdns_server->tx_queue;
+    size_t len = _mdns_server->tx_queue_len;
+    mdns_tx_packet_t *p = heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= len) {
+            break;
+        }
+        if (child + 1 < len && _mdns_tx_packet_before(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!_mdns_tx_packet_before(heap[child], p)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = p;
+}
+
+/**
+ * @brief  drop the NULL slots left by removals and restore the heap order, O(n)
+ */
+static void _mdns_tx_queue_compact(void)
+{
+    mdns_tx_packet_t **heap = _mdns_server->tx_queue;
+    size_t i, len = 0;
+    for (i = 0; i < _mdns_server->tx_queue_len; i++) {
+        if (heap[i]) {
+            heap[len++] = heap[i];
+        }
+    }
+    _mdns_server->tx_queue_len = len;
+    for (i = len / 2; i > 0; i--) {
+        _mdns_tx_queue_sift_down(i - 1);
+    }
+}
+
+/**
+ * @brief  remove the earliest scheduled packet
+ *
+ * @return the packet or NULL if none is due at given time
+ */
+static mdns_tx_packet_t *_mdns_tx_queue_pop_due(uint32_t now)
+{
+    if (!_mdns_server->tx_queue_len || (int32_t)(_mdns_server->tx_queue[0]->send_at - now) >= 0) {
+        return NULL;
+    }
+    mdns_tx_packet_t *p = _mdns_server->tx_queue[0];
+    _mdns_server->tx_queue_len--;
+    if (_mdns_server->tx_queue_len) {
+        _mdns_server->tx_queue[0] = _mdns_server->tx_queue[_mdns_server->tx_queue_len];
+        _mdns_tx_queue_sift_down(0);
+    }
+    return p;
+}
+
 /**
  * @brief  schedules a packet to be sent after given milliseconds
  *
+ * The packet is owned by the scheduler and freed if it cannot be queued. Rescheduling a packet
+ * that was just taken from the queue never allocates.
+ *
  * @param  packet       the packet
  * @param  ms_after     number of milliseconds after which the packet should be dispatched
  */
@@ -1533,19 +1623,21 @@ static void _mdns_schedule_tx_packet(mdns_tx_packet_t *packet, uint32_t ms_after
     if (!packet) {
         return;
     }
-    packet->send_at = (xTaskGetTickCount() * portTICK_PERIOD_MS) + ms_after;
-    packet->next = NULL;
-    if (!_mdns_server->tx_queue_head || _mdns_server->tx_queue_head->send_at > packet->send_at) {
-        packet->next = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = packet;
-        return;
-    }
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q->next && q->next->send_at <= packet->send_at) {
-        q = q->next;
+    if (_mdns_server->tx_queue_len == _mdns_server->tx_queue_size) {
+        size_t size = _mdns_server->tx_queue_size ? _mdns_server->tx_queue_size * 2 : MDNS_TX_QUEUE_INIT_SIZE;
+        mdns_tx_packet_t **queue = (mdns_tx_packet_t **)realloc(_mdns_server->tx_queue, size * sizeof(mdns_tx_packet_t *));
+        if (!queue) {
+            HOOK_MALLOC_FAILED;
+            _mdns_free_tx_packet(packet);
+            return;
+        }
+        _mdns_server->tx_queue = queue;
+        _mdns_server->tx_queue_size = size;
     }
-    packet->next = q->next;
-    q->next = packet;
+    packet->send_at = (xTaskGetTickCount() * portTICK_PERIOD_MS) + ms_after;
+    packet->seq = _mdns_server->tx_queue_seq++;
+    _mdns_server->tx_queue[_mdns_server->tx_queue_len++] = packet;
+    _mdns_tx_queue_sift_up(_mdns_server->tx_queue_len - 1);
 }
 
 /**
@@ -1553,12 +1645,11 @@ static void _mdns_schedule_tx_packet(mdns_tx_packet_t *packet, uint32_t ms_after
  */
 static void _mdns_clear_tx_queue_head(void)
 {
-    mdns_tx_packet_t *q;
-    while (_mdns_server->tx_queue_head) {
-        q = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = _mdns_server->tx_queue_head->next;
-        _mdns_free_tx_packet(q);
+    size_t i;
+    for (i = 0; i < _mdns_server->tx_queue_len; i++) {
+        _mdns_free_tx_packet(_mdns_server->tx_queue[i]);
     }
+    _mdns_server->tx_queue_len = 0;
 }
 
 /**
@@ -1569,24 +1660,19 @@ static void _mdns_clear_tx_queue_head(void)
  */
 static void _mdns_clear_pcb_tx_queue_head(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *q, * p;
-    while (_mdns_server->tx_queue_head && _mdns_server->tx_queue_head->tcpip_if == tcpip_if && _mdns_server->tx_queue_head->ip_protocol == ip_protocol) {
-        q = _mdns_server->tx_queue_head;
-        _mdns_server->tx_queue_head = _mdns_server->tx_queue_head->next;
-        _mdns_free_tx_packet(q);
-    }
-    if (_mdns_server->tx_queue_head) {
-        q = _mdns_server->tx_queue_head;
-        while (q->next) {
-            if (q->next->tcpip_if == tcpip_if && q->next->ip_protocol == ip_protocol) {
-                p = q->next;
-                q->next = p->next;
-                _mdns_free_tx_packet(p);
-            } else {
-                q = q->next;
-            }
+    size_t i;
+    bool removed = false;
+    for (i = 0; i < _mdns_server->tx_queue_len; i++) {
+        mdns_tx_packet_t *q = _mdns_server->tx_queue[i];
+        if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol) {
+            _mdns_free_tx_packet(q);
+            _mdns_server->tx_queue[i] = NULL;
+            removed = true;
         }
     }
+    if (removed) {
+        _mdns_tx_queue_compact();
+    }
 }
 
 /**
@@ -1597,14 +1683,16 @@ static void _mdns_clear_pcb_tx_queue_head(mdns_if_t tcpip_if, mdns_ip_protocol_t
  */
 static mdns_tx_packet_t *_mdns_get_next_pcb_packet(mdns_if_t tcpip_if, mdns_ip_protocol_t ip_protocol)
 {
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q) {
-        if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol) {
-            return q;
+    mdns_tx_packet_t *next = NULL;
+    size_t i;
+    for (i = 0; i < _mdns_server->tx_queue_len; i++) {
+        mdns_tx_packet_t *q = _mdns_server->tx_queue[i];
+        if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol
+                && (!next || _mdns_tx_packet_before(q, next))) {
+            next = q;
         }
-        q = q->next;
     }
-    return NULL;
+    return next;
 }
 
 /**
@@ -1616,8 +1704,9 @@ static void _mdns_remove_scheduled_answer(mdns_if_t tcpip_if, mdns_ip_protocol_t
     if (!service) {
         service = &s;
     }
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q) {
+    size_t i;
+    for (i = 0; i < _mdns_server->tx_queue_len; i++) {
+        mdns_tx_packet_t *q = _mdns_server->tx_queue[i];
         if (q->tcpip_if == tcpip_if && q->ip_protocol == ip_protocol && q->distributed) {
             mdns_out_answer_t *a = q->answers;
             if (a) {
@@ -1637,7 +1726,6 @@ static void _mdns_remove_scheduled_answer(mdns_if_t tcpip_if, mdns_ip_protocol_t
                 }
             }
         }
-        q = q->next;
     }
 }
 
@@ -2627,9 +2715,10 @@ static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
     if (!service) {
         return;
     }
-    mdns_tx_packet_t *p = NULL;
-    mdns_tx_packet_t *q = _mdns_server->tx_queue_head;
-    while (q) {
+    size_t index;
+    bool removed = false;
+    for (index = 0; index < _mdns_server->tx_queue_len; index++) {
+        mdns_tx_packet_t *q = _mdns_server->tx_queue[index];
         bool had_answers = (q->answers != NULL);
 
         _mdns_dealloc_scheduled_service_answers(&(q->answers), service);
@@ -2694,13 +2783,15 @@ static void _mdns_remove_scheduled_service_packets(mdns_service_t *service)
             }
         }
 
-        p = q;
-        q = q->next;
-        if (!p->questions && !p->answers && !p->additional && !p->servers) {
-            queueDetach(mdns_tx_packet_t, _mdns_server->tx_queue_head, p);
-            _mdns_free_tx_packet(p);
+        if (!q->questions && !q->answers && !q->additional && !q->servers) {
+            _mdns_free_tx_packet(q);
+            _mdns_server->tx_queue[index] = NULL;
+            removed = true;
         }
     }
+    if (removed) {
+        _mdns_tx_queue_compact();
+    }
 }
 
 /**
@@ -4870,8 +4961,9 @@ static void _mdns_free_action(mdns_action_t *action)
         _mdns_search_free(action->data.search_add.search);
         break;
     case ACTION_TX_HANDLE:
-        _mdns_free_tx_packet(action->data.tx_handle.packet);
-        break;
+        // preallocated, the packets stay in the tx queue
+        _mdns_server->tx_action_queued = false;
+        return;
     case ACTION_RX_HANDLE:
         _mdns_packet_free(action->data.rx_handle.packet);
         break;
@@ -5074,17 +5166,16 @@ static void _mdns_execute_action(mdns_action_t *action)
         _mdns_search_finish(action->data.search_add.search);
         break;
     case ACTION_TX_HANDLE: {
-        mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
-        // packet to be handled should be at tx head, but must be consistent with the one pushed to action queue
-        if (p && p == action->data.tx_handle.packet && p->queued) {
-            p->queued = false; // clearing, as the packet might be reused (pushed and transmitted again)
-            _mdns_server->tx_queue_head = p->next;
+        // packets rescheduled while handling are due at now or later, so they wait for the next tick
+        uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        mdns_tx_packet_t *p;
+        _mdns_server->tx_action_queued = false;
+        while ((p = _mdns_tx_queue_pop_due(now)) != NULL) {
             _mdns_tx_handle_packet(p);
-        } else {
-            ESP_LOGD(TAG, "Skipping transmit of an unexpected packet!");
         }
     }
-    break;
+    // preallocated, not freed
+    return;
     case ACTION_RX_HANDLE:
         mdns_parse_packet(action->data.rx_handle.packet);
         _mdns_packet_free(action->data.rx_handle.packet);
@@ -5138,37 +5229,22 @@ static esp_err_t _mdns_send_search_action(mdns_action_type_t type, mdns_search_o
 /**
  * @brief  Called from timer task to run mDNS responder
  *
- * periodically checks first unqueued packet (from tx head).
- * if it is scheduled to be transmitted, then pushes the packet to action queue to be handled.
+ * checks the earliest scheduled packet (top of the tx queue).
+ * if it is due, posts the preallocated tx action, which transmits all due packets from the service task.
  *
  */
 static void _mdns_scheduler_run(void)
 {
     MDNS_SERVICE_LOCK();
-    mdns_tx_packet_t *p = _mdns_server->tx_queue_head;
-    mdns_action_t *action = NULL;
-
-    // find first unqueued packet
-    while (p && p->queued) {
-        p = p->next;
-    }
-    if (!p) {
+    if (_mdns_server->tx_action_queued || !_mdns_server->tx_queue_len) {
         MDNS_SERVICE_UNLOCK();
         return;
     }
-    if ((int32_t)(p->send_at - (xTaskGetTickCount() * portTICK_PERIOD_MS)) < 0) {
-        action = (mdns_action_t *)malloc(sizeof(mdns_action_t));
-        if (action) {
-            action->type = ACTION_TX_HANDLE;
-            action->data.tx_handle.packet = p;
-            p->queued = true;
-            if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
-                free(action);
-                p->queued = false;
-            }
-        } else {
-            HOOK_MALLOC_FAILED;
-            // continue
+    if ((int32_t)(_mdns_server->tx_queue[0]->send_at - (xTaskGetTickCount() * portTICK_PERIOD_MS)) < 0) {
+        mdns_action_t *action = &_mdns_tx_action;
+        _mdns_server->tx_action_queued = true;
+        if (xQueueSend(_mdns_server->action_queue, &action, (TickType_t)0) != pdPASS) {
+            _mdns_server->tx_action_queued = false;
         }
     }
     MDNS_SERVICE_UNLOCK();
@@ -5555,6 +5631,7 @@ void mdns_free(void)
         vQueueDelete(_mdns_server->action_queue);
     }
     _mdns_clear_tx_queue_head();
+    free(_mdns_server->tx_queue);
     while (_mdns_server->search_once) {
         mdns_search_once_t *h = _mdns_server->search_once;
         _mdns_server->search_once = h->next;
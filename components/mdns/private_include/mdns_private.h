@@ -93,6 +93,7 @@
 #define MDNS_SERVICE_ADD_TIMEOUT_MS CONFIG_MDNS_SERVICE_ADD_TIMEOUT_MS
 
 #define MDNS_PACKET_QUEUE_LEN       16                      // Maximum packets that can be queued for parsing
+#define MDNS_TX_QUEUE_INIT_SIZE     16                      // Initial capacity of the TX scheduler heap, doubled when full
 #define MDNS_ACTION_QUEUE_LEN       CONFIG_MDNS_ACTION_QUEUE_LEN  // Maximum actions pending to the server
 #define MDNS_TXT_MAX_LEN            1024                    // Maximum string length of text data in TXT record
 #if defined(CONFIG_LWIP_IPV6) && defined(CONFIG_MDNS_RESPOND_REVERSE_QUERIES)
@@ -330,8 +331,8 @@ typedef struct mdns_out_answer_s {
 } mdns_out_answer_t;
 
 typedef struct mdns_tx_packet_s {
-    struct mdns_tx_packet_s *next;
     uint32_t send_at;
+    uint32_t seq;                       // scheduling order, keeps packets with the same send_at in FIFO order
     mdns_if_t tcpip_if;
     mdns_ip_protocol_t ip_protocol;
     esp_ip_addr_t dst;
@@ -342,7 +343,6 @@ typedef struct mdns_tx_packet_s {
     mdns_out_answer_t *answers;
     mdns_out_answer_t *servers;
     mdns_out_answer_t *additional;
-    bool queued;
     uint16_t id;
 } mdns_tx_packet_t;
 
@@ -390,7 +390,11 @@ typedef struct mdns_server_s {
     mdns_srv_item_t *services;
     QueueHandle_t action_queue;
     SemaphoreHandle_t action_sema;
-    mdns_tx_packet_t *tx_queue_head;
+    mdns_tx_packet_t **tx_queue;        // min-heap of scheduled packets, ordered by send_at and seq
+    size_t tx_queue_len;
+    size_t tx_queue_size;
+    uint32_t tx_queue_seq;
+    bool tx_action_queued;              // the ACTION_TX_HANDLE action is waiting in action_queue
     mdns_search_once_t *search_once;
     esp_timer_handle_t timer_handle;
 } mdns_server_t;
@@ -441,9 +445,6 @@ typedef struct {
         struct {
             mdns_search_once_t *search;
         } search_add;
-        struct {
-            mdns_tx_packet_t *packet;
-        } tx_handle;
         struct {
             mdns_rx_packet_t *packet;
         } rx_handle;
@@ -0,0 +1,195 @@
+/**
+ * @file bulk_frame.h
+ * @brief Framed bulk transfer protocol with credit based flow control.
+ *
+ * Transport independent core of the bulk transfer service. Every frame is one L2CAP SDU and
+ * starts with a 12 byte little-endian header:
+ *
+ *     uint8_t type; uint8_t resource; uint16_t seq; uint32_t offset; uint32_t value; payload
+ *
+ * The companion pulls a resource with OPEN_GET (value = credits it grants) and receives DATA
+ * frames followed by END (offset = total length, value = CRC-32 of the data). It pushes one with
+ * OPEN_PUT (offset = total length); the device answers with CREDIT or STATUS, the companion
+ * sends DATA and END, and the device answers with STATUS once the resource accepted the data.
+ *
+ * Each DATA frame consumes one credit of the sender, the receiver hands credits back with CREDIT
+ * frames as it frees its buffers, so neither side ever receives more frames than it can hold.
+ * Control frames (OPEN, END, CREDIT, STATUS) need no credit. A STATUS frame from either side
+ * ends the transfer in progress.
+ */
+
+#ifndef BULK_FRAME_H
+#define BULK_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BULK_FRAME_HEADER_LEN 12 /**< Bytes before the payload of every frame. */
+#define BULK_FRAME_MIN_SDU 64    /**< Smallest SDU size a session works with. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Frame types.
+     */
+    typedef enum
+    {
+        BULK_FRAME_OPEN_GET = 1, /**< Companion: read the resource, value = initial credits. */
+        BULK_FRAME_OPEN_PUT,     /**< Companion: write the resource, offset = total length. */
+        BULK_FRAME_DATA,         /**< Data at offset, seq counts DATA frames from 0. */
+        BULK_FRAME_END,          /**< End of data, offset = total length, value = CRC-32. */
+        BULK_FRAME_CREDIT,       /**< value = DATA frames the receiver can take in addition. */
+        BULK_FRAME_STATUS,       /**< value = bulk_status_t, ends the transfer. */
+    } bulk_frame_type_t;
+
+    /**
+     * @brief Result carried by a STATUS frame.
+     */
+    typedef enum
+    {
+        BULK_STATUS_OK = 0,           /**< PUT stored. */
+        BULK_STATUS_UNKNOWN_RESOURCE, /**< No such resource, or it cannot be read or written. */
+        BULK_STATUS_BUSY,             /**< Another transfer is in progress. */
+        BULK_STATUS_TOO_LARGE,        /**< PUT larger than the resource accepts. */
+        BULK_STATUS_SEQUENCE,         /**< DATA frame lost, repeated or out of place. */
+        BULK_STATUS_CRC,              /**< END CRC does not match the data. */
+        BULK_STATUS_NO_CREDIT,        /**< DATA frame sent without credit. */
+        BULK_STATUS_WRITE_FAILED,     /**< The resource rejected the data. */
+        BULK_STATUS_PROTOCOL,         /**< Malformed or unexpected frame. */
+    } bulk_status_t;
+
+    /**
+     * @brief Decoded frame. The payload points into the SDU it was decoded from.
+     */
+    typedef struct
+    {
+        uint8_t type;
+        uint8_t resource;
+        uint16_t seq;
+        uint32_t offset;
+        uint32_t value;
+        const uint8_t *payload;
+        size_t payload_len;
+    } bulk_frame_t;
+
+    /**
+     * @brief A blob the companion can read or write.
+     */
+    typedef struct
+    {
+        uint8_t id;        /**< Resource id used in the OPEN frames. */
+        uint32_t max_size; /**< Largest accepted PUT, 0 if the resource cannot be written. */
+        /**
+         * @brief GET: copies up to len bytes of the resource starting at offset. NULL if it cannot be read.
+         * @return Bytes copied, 0 at the end of the resource.
+         */
+        size_t (*read)(uint32_t offset, uint8_t *buf, size_t len, void *ctx);
+        /**
+         * @brief PUT: called once with the complete, CRC checked data.
+         * @return BULK_STATUS_OK if stored, otherwise the status sent to the companion.
+         */
+        bulk_status_t (*write)(const uint8_t *data, size_t len, void *ctx);
+        void *ctx; /**< Passed to read and write. */
+    } bulk_resource_t;
+
+    /**
+     * @brief Hands one SDU to the transport.
+     * @return false if the transport cannot take it now; the session keeps the frame and sends it
+     *         again from the next bulk_session_pump().
+     */
+    typedef bool (*bulk_send_t)(const uint8_t *sdu, size_t len, void *ctx);
+
+    /**
+     * @brief Session setup, the buffers must stay valid while the session is used.
+     */
+    typedef struct
+    {
+        const bulk_resource_t *resources;
+        uint8_t count;
+        bulk_send_t send;
+        void *send_ctx;
+        uint8_t *tx_buf;    /**< Frame being sent, tx_len bytes. */
+        size_t tx_len;      /**< Largest SDU sent, at least BULK_FRAME_MIN_SDU. */
+        uint8_t *put_buf;   /**< Assembles PUT data before the resource sees it. */
+        size_t put_len;     /**< Size of put_buf, caps every resource's max_size. */
+        uint8_t window;     /**< Credits granted to the companion for a PUT, at least 1. */
+    } bulk_session_config_t;
+
+    /**
+     * @brief Transfer counters.
+     */
+    typedef struct
+    {
+        uint32_t transfers; /**< Transfers completed. */
+        uint32_t aborted;   /**< Transfers ended by a STATUS other than OK. */
+        uint32_t bytes_tx;  /**< DATA payload bytes sent. */
+        uint32_t bytes_rx;  /**< DATA payload bytes received. */
+    } bulk_stats_t;
+
+    /**
+     * @brief Session state. All calls must come from one task.
+     */
+    typedef struct
+    {
+        bulk_session_config_t config;
+        size_t sdu_max;                  /**< Frames sent are at most this long (peer MTU). */
+        uint8_t state;                   /**< Idle, GET or PUT. */
+        const bulk_resource_t *resource; /**< Resource of the transfer in progress. */
+        uint16_t seq;                    /**< Next DATA seq, sent or expected. */
+        uint32_t offset;                 /**< Bytes sent or received so far. */
+        uint32_t total;                  /**< PUT: announced length. */
+        uint32_t crc;                    /**< Running CRC-32 of the data sent. */
+        uint32_t credits;                /**< GET: DATA frames we may still send. PUT: frames the companion may still send. */
+        uint32_t grant;                  /**< PUT: credits to hand back with the next CREDIT frame. */
+        size_t tx_frame;                 /**< Length of a frame in tx_buf that the transport refused, 0 if none. */
+        uint32_t tx_data;                /**< Payload bytes of that frame if it is DATA. */
+        int16_t status;                  /**< STATUS waiting to be sent, -1 if none. */
+        uint8_t status_resource;
+        bool end;                        /**< GET: the resource is exhausted, END goes next. */
+        bulk_stats_t stats;
+    } bulk_session_t;
+
+    /**
+     * @brief Encodes a frame.
+     * @return Frame length, or 0 if it does not fit in len bytes.
+     */
+    size_t bulk_frame_encode(const bulk_frame_t *frame, uint8_t *buf, size_t len);
+
+    /**
+     * @brief Decodes a frame.
+     * @return false if the SDU is shorter than the header.
+     */
+    bool bulk_frame_decode(const uint8_t *sdu, size_t len, bulk_frame_t *frame);
+
+    /**
+     * @brief Prepares a session.
+     * @return false if the configuration is invalid.
+     */
+    bool bulk_session_init(bulk_session_t *session, const bulk_session_config_t *config);
+
+    /**
+     * @brief Drops any transfer in progress, for a new channel.
+     * @param peer_mtu Largest SDU the peer accepts.
+     */
+    void bulk_session_reset(bulk_session_t *session, size_t peer_mtu);
+
+    /**
+     * @brief Handles one received SDU and sends what it allows.
+     */
+    void bulk_session_receive(bulk_session_t *session, const uint8_t *sdu, size_t len);
+
+    /**
+     * @brief Sends pending frames until the credits, the data or the transport run out.
+     * @return true if frames are still waiting for the transport.
+     */
+    bool bulk_session_pump(bulk_session_t *session);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BULK_FRAME_H
@@ -0,0 +1,54 @@
+/**
+ * @file bulk_transfer.h
+ * @brief L2CAP connection-oriented channel for bulk transfers with the companion tool.
+ *
+ * Listens on an LE L2CAP CoC PSM. The companion opens one channel on its existing
+ * connection, which must be encrypted. It then reads or writes the registered resources
+ * with the framed protocol of bulk_frame.h, using one SDU per frame, so a config blob or a
+ * telemetry dump moves as SDUs of up to CONFIG_BULK_XFER_MTU bytes rather than as
+ * 20 byte GATT writes, and without Wi-Fi.
+ *
+ * Opening the channel counts as a UI access for the coexistence policy, so a companion can
+ * bring Wi-Fi back while it is suspended during play.
+ *
+ * The NimBLE host task only moves SDUs. Framing, CRC checks and the resource callbacks run in
+ * the bulk transfer task, so a slow resource (an NVS write) never stalls the host.
+ */
+
+#ifndef BULK_TRANSFER_H
+#define BULK_TRANSFER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "bulk_frame.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Resource ids served by this firmware.
+     */
+    typedef enum
+    {
+        BULK_RESOURCE_CONFIG = 1,  /**< GET/PUT: configuration record in the config_store layout. */
+        BULK_RESOURCE_LATENCY = 2, /**< GET: coex_mode_stats_t of every coex mode, little-endian. */
+        BULK_RESOURCE_LOG = 3,     /**< GET: pending deferred log records in the NimBLEDeferredLog dump layout, without the print task. */
+    } bulk_resource_id_t;
+
+    /**
+     * @brief Starts the bulk transfer task, which registers the L2CAP server. Call once
+     *        BleGamepad::waitForStart() returned, the host must be running.
+     * @param resources Resource table, must stay valid while the service runs.
+     * @param count Number of resources.
+     * @return ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM if the task or queue
+     *         cannot be created.
+     */
+    esp_err_t bulk_transfer_start(const bulk_resource_t *resources, uint8_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BULK_TRANSFER_H
@@ -0,0 +1,126 @@
+/**
+ * @file coex_policy.h
+ * @brief Activity driven Wi-Fi/BLE coexistence policy.
+ *
+ * Wi-Fi and BLE share one radio. While a host is connected and inputs are changing the policy
+ * backs Wi-Fi off (modem power save, or stopped entirely). It restores Wi-Fi when the web UI or
+ * the bulk transfer channel is used, when the host disconnects or when the inputs go idle.
+ * Notification latency and jitter are measured separately for each radio mode so the effect can
+ * be compared.
+ */
+
+#ifndef COEX_POLICY_H
+#define COEX_POLICY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief What happens to Wi-Fi during active play. Stored in the configuration.
+     */
+    typedef enum
+    {
+        COEX_POLICY_ALWAYS_ON = 0,  /**< Never touch Wi-Fi (previous behaviour). */
+        COEX_POLICY_POWER_SAVE = 1, /**< Switch the station to maximum modem sleep. */
+        COEX_POLICY_SUSPEND = 2,    /**< Stop Wi-Fi. The web UI is unreachable until the gamepad idles or disconnects, or the companion opens the bulk transfer channel. */
+        COEX_POLICY_MAX
+    } coex_policy_t;
+
+    /**
+     * @brief Radio mode currently applied to Wi-Fi.
+     */
+    typedef enum
+    {
+        COEX_MODE_FULL = 0,       /**< Wi-Fi fully on, minimum modem sleep. */
+        COEX_MODE_POWER_SAVE = 1, /**< Wi-Fi on, maximum modem sleep. */
+        COEX_MODE_SUSPENDED = 2,  /**< Wi-Fi stopped. */
+        COEX_MODE_MAX
+    } coex_mode_t;
+
+    /**
+     * @brief Report latency measured while in one mode, from report generation to the ATT confirmation
+     *        when the host subscribed to indications, otherwise to NOTIFY_TX.
+     */
+    typedef struct
+    {
+        uint32_t samples;    /**< Number of notifications measured. */
+        uint32_t mean_us;    /**< Smoothed latency (1/16 exponential average). */
+        uint32_t max_us;     /**< Largest latency seen. */
+        uint32_t jitter_us;  /**< Smoothed variation between consecutive latencies (RFC 3550 estimator). */
+        uint32_t time_ms;    /**< Total time spent in the mode. */
+    } coex_mode_stats_t;
+
+    /**
+     * @brief Reports whether a BLE host is currently connected.
+     */
+    typedef bool (*coex_host_connected_t)(void);
+
+    /**
+     * @brief Starts the policy task. Wi-Fi must already be started.
+     * @param policy Initial policy.
+     * @param host_connected Connection state query.
+     */
+    void coex_policy_start(coex_policy_t policy, coex_host_connected_t host_connected);
+
+    /**
+     * @brief Changes the policy. The new policy is applied on the next evaluation.
+     * @param policy New policy.
+     */
+    void coex_policy_set(coex_policy_t policy);
+
+    /**
+     * @brief Gets the active policy.
+     */
+    coex_policy_t coex_policy_get(void);
+
+    /**
+     * @brief Gets the radio mode currently applied.
+     */
+    coex_mode_t coex_policy_get_mode(void);
+
+    /**
+     * @brief Records an input change. Lock-free, call from the tasks that feed the gamepad (buttons, sensor aggregator).
+     */
+    void coex_policy_note_input(void);
+
+    /**
+     * @brief Records a web UI or companion access, which restores full Wi-Fi for CONFIG_COEX_UI_HOLD_MS.
+     */
+    void coex_policy_note_ui_access(void);
+
+    /**
+     * @brief Records the latency of one notification against the current mode.
+     *
+     * Called from the NimBLE host task only (single writer).
+     *
+     * @param latency_us Time from generating the report to its ATT confirmation or NOTIFY_TX event.
+     */
+    void coex_policy_record_notify_latency(uint32_t latency_us);
+
+    /**
+     * @brief Copies the measurements for one mode.
+     * @param mode Mode to query.
+     * @param stats Output statistics.
+     */
+    void coex_policy_get_stats(coex_mode_t mode, coex_mode_stats_t *stats);
+
+    /**
+     * @brief Short name of a mode, for logs and metrics.
+     */
+    const char *coex_mode_name(coex_mode_t mode);
+
+    /**
+     * @brief Short name of a policy, for logs and metrics.
+     */
+    const char *coex_policy_name(coex_policy_t policy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COEX_POLICY_H
@@ -0,0 +1,147 @@
+/**
+ * @file config_store.h
+ * @brief Versioned binary configuration record persisted to NVS.
+ *
+ * The full gamepad/input/axis configuration is serialised into a compact little-endian
+ * record (header + payload + CRC32) and written alternately to two NVS slots. The slot
+ * holding the newest valid record wins at boot, so a power loss in the middle of a write
+ * always leaves the previous configuration readable. Any task may call the store, saves and
+ * loads are serialised.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define CONFIG_STORE_NAMESPACE "gp_cfg"        /**< NVS namespace used by the store. */
+#define CONFIG_STORE_VERSION 2                 /**< Current record layout version. */
+#define CONFIG_STORE_MAX_GPIOS 48              /**< Maximum number of button GPIOs. */
+#define CONFIG_STORE_MAX_HATS 4                /**< Maximum number of hat switches. */
+#define CONFIG_STORE_MAX_BUTTONS 128           /**< Maximum number of buttons. */
+#define CONFIG_STORE_CHIP_SERIES_LEN 64        /**< Size of the chip series string, including terminator. */
+#define CONFIG_STORE_AXIS_COUNT (8 + 5)        /**< Axes (X..SLIDER2) followed by simulation controls (RUDDER..STEERING). */
+#define CONFIG_STORE_ADC_UNUSED 0xFF           /**< adc_channel value for an axis without an analog source. */
+#define CONFIG_STORE_AXIS_FLAG_INVERTED (1 << 0) /**< Axis raw range is reversed. */
+#define CONFIG_STORE_RECORD_MAX (14 + 256)       /**< Largest serialised record (header + payload + CRC). */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Analog source and calibration for one HID axis.
+     */
+    typedef struct
+    {
+        uint8_t adc_channel; /**< ADC1 channel feeding the axis, or CONFIG_STORE_ADC_UNUSED. */
+        uint8_t flags;       /**< CONFIG_STORE_AXIS_FLAG_* bits. */
+        uint16_t raw_min;    /**< Raw ADC reading mapped to the logical minimum. */
+        uint16_t raw_max;    /**< Raw ADC reading mapped to the logical maximum. */
+    } axis_config_t;
+
+    /**
+     * @brief Everything the web UI can change, in its in-memory form.
+     */
+    typedef struct
+    {
+        /* Gamepad (mirrors BleGamepadConfiguration) */
+        uint8_t controller_type;     /**< CONTROLLER_TYPE_* value. */
+        uint8_t hid_report_id;       /**< HID input report id. */
+        uint8_t auto_report;         /**< Non-zero to send a report on every setter. */
+        uint8_t hat_switch_count;    /**< Number of hat switches (0-4). */
+        uint16_t button_count;       /**< Number of buttons (0-128). */
+        uint8_t special_buttons;     /**< Bitmask indexed by START_BUTTON..VOLUME_MUTE_BUTTON. */
+        uint8_t axes;                /**< Bitmask indexed by X_AXIS..SLIDER2. */
+        uint8_t simulation_controls; /**< Bitmask indexed by RUDDER..STEERING. */
+        uint16_t vid;                /**< USB vendor id reported in the PnP characteristic. */
+        uint16_t pid;                /**< USB product id reported in the PnP characteristic. */
+        int16_t axes_min;            /**< Logical minimum of the generic axes. */
+        int16_t axes_max;            /**< Logical maximum of the generic axes. */
+        int16_t simulation_min;      /**< Logical minimum of the simulation controls. */
+        int16_t simulation_max;      /**< Logical maximum of the simulation controls. */
+
+        /* Inputs */
+        uint8_t gpio_count;                         /**< Number of valid entries in gpios. */
+        uint8_t gpios[CONFIG_STORE_MAX_GPIOS];      /**< Button GPIO numbers, in button order. */
+        char chip_series[CONFIG_STORE_CHIP_SERIES_LEN]; /**< Chip series selected in the UI. */
+
+        /* Axes */
+        axis_config_t axis[CONFIG_STORE_AXIS_COUNT]; /**< Per-axis analog source and calibration. */
+
+        /* Radio */
+        uint8_t coex_policy; /**< Wi-Fi behaviour during play, a coex_policy_t (version 2). */
+    } app_config_t;
+
+    /**
+     * @brief Upgrades a serialised payload from version N to N + 1 in place.
+     * @param payload Payload bytes, sized to hold the largest supported layout.
+     * @param len Length of the version N payload.
+     * @param capacity Size of the payload buffer.
+     * @return Length of the version N + 1 payload, or 0 if the payload cannot be migrated.
+     */
+    typedef size_t (*config_store_migration_t)(uint8_t *payload, size_t len, size_t capacity);
+
+    /**
+     * @brief Fills a configuration with the firmware defaults.
+     * @param cfg Configuration to initialise.
+     */
+    void config_store_defaults(app_config_t *cfg);
+
+    /**
+     * @brief Loads the newest valid record from NVS.
+     *
+     * Both slots are read once; the record with a valid CRC and the highest sequence number
+     * is migrated to CONFIG_STORE_VERSION and decoded. If that record cannot be migrated, or
+     * holds values out of range, the other slot is used. nvs_flash_init() must have succeeded.
+     *
+     * @param cfg Output configuration. Set to defaults if nothing valid is stored.
+     * @return ESP_OK if a stored record was loaded, ESP_ERR_NOT_FOUND if defaults were used,
+     *         or another error code from NVS.
+     */
+    esp_err_t config_store_load(app_config_t *cfg);
+
+    /**
+     * @brief Serialises and commits a configuration to the inactive slot.
+     * @param cfg Configuration to persist.
+     * @return ESP_OK on success, ESP_ERR_INVALID_ARG for values out of range, otherwise the NVS error code.
+     *         The previous record is left intact on failure.
+     */
+    esp_err_t config_store_save(const app_config_t *cfg);
+
+    /**
+     * @brief Serialises a configuration into a record, in the layout stored in NVS.
+     * @param cfg Configuration to serialise.
+     * @param record Output buffer, CONFIG_STORE_RECORD_MAX bytes are always enough.
+     * @param len Size of the output buffer.
+     * @return Record length, or 0 if the buffer is too small.
+     */
+    size_t config_store_export(const app_config_t *cfg, uint8_t *record, size_t len);
+
+    /**
+     * @brief Validates, migrates and decodes a record made by config_store_export(), possibly by older firmware.
+     *
+     * Nothing is written to NVS, call config_store_save() to keep the result.
+     *
+     * @param record Record bytes.
+     * @param len Record length.
+     * @param cfg Output configuration, left untouched on failure.
+     * @return ESP_OK on success, ESP_ERR_INVALID_CRC for a damaged record, ESP_ERR_NOT_SUPPORTED for an
+     *         unknown version, ESP_ERR_INVALID_SIZE for a malformed payload or values out of range.
+     */
+    esp_err_t config_store_import(const uint8_t *record, size_t len, app_config_t *cfg);
+
+    /**
+     * @brief Erases both slots, so the next load returns defaults.
+     * @return ESP_OK on success, otherwise the NVS error code.
+     */
+    esp_err_t config_store_erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_STORE_H
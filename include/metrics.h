@@ -0,0 +1,59 @@
+/**
+ * @file metrics.h
+ * @brief Runtime metrics exposed over HTTP at /metrics.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Application counters. Add new entries before METRICS_COUNTER_MAX and give them a name in metrics.cpp.
+     */
+    typedef enum
+    {
+        METRICS_BUTTON_EVENTS, /**< Debounced button press/release edges. */
+        METRICS_HTTP_POSTS,    /**< Settings posted from the web UI. */
+        METRICS_CONFIG_SAVES,  /**< Configuration records committed to NVS. */
+        METRICS_COUNTER_MAX
+    } metrics_counter_t;
+
+    extern uint32_t metrics_counters[METRICS_COUNTER_MAX]; /**< Counter storage, only touch through metrics_inc(). */
+
+    /**
+     * @brief Increments a counter. Lock-free and safe from any task.
+     * @param counter Counter to increment.
+     */
+    static inline void metrics_inc(metrics_counter_t counter)
+    {
+        __atomic_fetch_add(&metrics_counters[counter], 1, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * @brief Registers the GET /metrics handler (and GET /log).
+     *
+     * Serves Prometheus text format by default, or compact JSON with ?format=json. Includes per-task
+     * CPU share and stack high-water marks, heap statistics, NimBLE msys mbuf usage, notification
+     * results, the current connection parameters and the Wi-Fi coexistence mode with the notification
+     * latency and jitter measured under each mode. With CONFIG_NIMBLE_CPP_LOG_DEFERRED and without
+     * CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT, whose task would drain the same records, GET /log returns
+     * the pending deferred log records as a binary dump.
+     *
+     * @param server Running HTTP server.
+     * @return ESP_OK if successful, otherwise the httpd error code.
+     */
+    esp_err_t metrics_register_handlers(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
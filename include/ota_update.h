@@ -0,0 +1,54 @@
+/**
+ * @file ota_update.h
+ * @brief Streaming firmware update over HTTP into the inactive OTA slot.
+ */
+
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Health check used to confirm a freshly updated image.
+     * @return true once the application is known to work.
+     */
+    typedef bool (*ota_health_check_t)(void);
+
+    /**
+     * @brief Registers the POST /ota upload handler.
+     *
+     * The request body is the raw application image. It is streamed straight into the next
+     * OTA partition in CONFIG_OTA_RECV_BUFFER_SIZE chunks while a SHA-256 is computed. If the
+     * client sends an X-Image-SHA256 header (64 hex chars) the digest must match. On success
+     * the boot partition is switched and the device restarts.
+     *
+     * @param server Running HTTP server.
+     * @return ESP_OK if successful, otherwise the httpd error code.
+     */
+    esp_err_t ota_register_handlers(httpd_handle_t server);
+
+    /**
+     * @brief Confirms or rolls back an image that is booting for the first time.
+     *
+     * Does nothing unless the running image is pending verification. Otherwise a short-lived
+     * task polls is_healthy until it returns true, then marks the image valid. If it does not
+     * within timeout_ms, the image is marked invalid and the previous one is booted.
+     *
+     * @param is_healthy Health check, e.g. "BLE is advertising or connected".
+     * @param timeout_ms Time allowed for the check to pass.
+     */
+    void ota_start_rollback_check(ota_health_check_t is_healthy, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OTA_UPDATE_H
@@ -0,0 +1,55 @@
+/**
+ * @file sensor_aggregator.h
+ * @brief BLE central that merges remote wireless sensors into the HID gamepad.
+ *
+ * A timer scans for the configured sensors that are not connected. Connecting, discovering and
+ * subscribing to their value characteristic are chained from the completion callbacks in the
+ * NimBLE host task, without a task of their own. Notifications are queued from the host task and
+ * applied by the aggregator task, which updates the gamepad and sends the report. While the aggregator runs
+ * it must be the only task calling sendReport(), otherwise the two tasks race on the report, so the gamepad
+ * must be begun with auto report off. A sensor that disconnects is returned to rest (sensor_map_t::raw_rest,
+ * buttons released) and the report is sent at once.
+ */
+
+#ifndef SENSOR_AGGREGATOR_H
+#define SENSOR_AGGREGATOR_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor_merge.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief One remote sensor.
+     */
+    typedef struct
+    {
+        const char *name;                /**< Name used in the log. */
+        const char *service_uuid;        /**< Advertised service that identifies the sensor. */
+        const char *characteristic_uuid; /**< Characteristic notifying the value. */
+        sensor_map_t map;                /**< Where the value goes in the gamepad report. */
+    } sensor_config_t;
+
+    /**
+     * @brief Starts the aggregator task and the sensor scans. Call once BleGamepad::waitForStart()
+     *        returned, the scans need the host running.
+     * @param sensors Sensor table, must stay valid while the aggregator runs.
+     * @param count Number of sensors, at most SENSOR_MERGE_MAX_SENSORS.
+     * @return ESP_ERR_INVALID_ARG for an invalid table, ESP_ERR_INVALID_STATE if already started.
+     */
+    esp_err_t sensor_aggregator_start(const sensor_config_t *sensors, uint8_t count);
+
+    /**
+     * @brief Copies the merge statistics (values, drops, reports and push to report latency).
+     */
+    void sensor_aggregator_get_stats(sensor_merge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_AGGREGATOR_H
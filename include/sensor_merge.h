@@ -0,0 +1,167 @@
+/**
+ * @file sensor_merge.h
+ * @brief Merges values from remote BLE sensors into gamepad report updates.
+ *
+ * Transport independent core of the sensor aggregator. The NimBLE host task pushes raw
+ * notifications with sensor_merge_push(), which only decodes the configured field and queues
+ * it. The aggregator task calls sensor_merge_drain(), which applies the queued values in
+ * arrival order and hands out as few report updates as possible: axis changes are coalesced,
+ * but a button edge is never overwritten before it was reported. sensor_merge_release() returns
+ * a sensor that went away to rest, so a lost link never leaves a pedal pressed or a gear engaged.
+ */
+
+#ifndef SENSOR_MERGE_H
+#define SENSOR_MERGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SENSOR_MERGE_MAX_SENSORS 8  /**< Sensors one merger can serve. */
+#define SENSOR_MERGE_QUEUE_LEN 32   /**< Queued values, must be a power of two. */
+#define SENSOR_MERGE_AXIS_COUNT (8 + 5) /**< Axes (X..SLIDER2) followed by simulation controls (RUDDER..STEERING). */
+#define SENSOR_MERGE_BUTTONS 0xFF   /**< sensor_map_t::axis value for a sensor that drives buttons. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Encoding of the value inside a notification.
+     */
+    typedef enum
+    {
+        SENSOR_FORMAT_U8 = 0,
+        SENSOR_FORMAT_I8,
+        SENSOR_FORMAT_U16_LE,
+        SENSOR_FORMAT_I16_LE,
+        SENSOR_FORMAT_U32_LE,
+        SENSOR_FORMAT_I32_LE,
+        SENSOR_FORMAT_MAX
+    } sensor_format_t;
+
+    /**
+     * @brief Where one sensor value goes in the gamepad report.
+     */
+    typedef struct
+    {
+        uint8_t format;       /**< sensor_format_t of the value. */
+        uint8_t offset;       /**< Byte offset of the value in the notification. */
+        uint8_t axis;         /**< Axis index (X_AXIS..SLIDER2, then 8 + RUDDER..STEERING) or SENSOR_MERGE_BUTTONS. */
+        uint8_t first_button; /**< Buttons only: button number (1-128) driven by bit 0 of the value. */
+        uint8_t button_count; /**< Buttons only: number of value bits used, at most 32. */
+        int32_t raw_min;      /**< Axes only: raw value mapped to out_min. */
+        int32_t raw_max;      /**< Axes only: raw value mapped to out_max, may be below raw_min to invert. */
+        int16_t out_min;      /**< Axes only: logical minimum. */
+        int16_t out_max;      /**< Axes only: logical maximum. */
+        int32_t raw_rest;     /**< Axes only: raw value applied when the sensor is released. Buttons rest released. */
+    } sensor_map_t;
+
+    /**
+     * @brief Merged report state handed to the emit callback.
+     */
+    typedef struct
+    {
+        uint32_t axis_mask;                      /**< Bit n set if axis[n] changed since the last update. */
+        int16_t axis[SENSOR_MERGE_AXIS_COUNT];   /**< Current axis values. */
+        uint8_t buttons[16];                     /**< Current button states, button n at bit n - 1. */
+        uint8_t button_mask[16];                 /**< Buttons changed since the last update. */
+    } sensor_report_t;
+
+    /**
+     * @brief Merge statistics. Latency runs from sensor_merge_push() to the emit callback.
+     */
+    typedef struct
+    {
+        uint32_t values;         /**< Values queued. */
+        uint32_t dropped;        /**< Values dropped because the queue was full or too short. */
+        uint32_t reports;        /**< Report updates emitted. */
+        uint32_t latency_mean_us; /**< Smoothed latency (1/16 exponential average). */
+        uint32_t latency_max_us; /**< Largest latency seen. */
+    } sensor_merge_stats_t;
+
+    /**
+     * @brief Queued value.
+     */
+    typedef struct
+    {
+        uint8_t sensor;
+        int32_t raw;
+        uint32_t time_us;
+    } sensor_value_t;
+
+    /**
+     * @brief Merger state. Single producer (sensor_merge_push) and single consumer (sensor_merge_drain).
+     */
+    typedef struct
+    {
+        const sensor_map_t *maps;
+        uint8_t count;
+        uint32_t head; /**< Written by the producer only. */
+        uint32_t tail; /**< Written by the consumer only. */
+        sensor_value_t queue[SENSOR_MERGE_QUEUE_LEN];
+        sensor_report_t report;
+        uint32_t oldest_us; /**< Push time of the oldest value not yet emitted. */
+        bool pending;       /**< report holds changes that were not emitted yet. */
+        sensor_merge_stats_t stats;
+        uint32_t dropped;   /**< Producer side drop counter, folded into stats by the consumer. */
+        uint32_t release;   /**< Sensors to return to rest, set by the producer and cleared by the consumer. */
+    } sensor_merge_t;
+
+    /**
+     * @brief Receives a merged report update. The masks say what changed.
+     */
+    typedef void (*sensor_merge_emit_t)(const sensor_report_t *report, void *ctx);
+
+    /**
+     * @brief Prepares a merger.
+     * @param merge Merger to initialise.
+     * @param maps Per-sensor mapping, must stay valid while the merger is used.
+     * @param count Number of sensors, at most SENSOR_MERGE_MAX_SENSORS.
+     * @return false if the mapping is invalid.
+     */
+    bool sensor_merge_init(sensor_merge_t *merge, const sensor_map_t *maps, uint8_t count);
+
+    /**
+     * @brief Decodes and queues one notification. Producer side, never blocks.
+     * @param merge Merger.
+     * @param sensor Index of the sensor in the mapping.
+     * @param data Notification payload.
+     * @param len Payload length.
+     * @param now_us Current time in microseconds.
+     * @return false if the value was dropped.
+     */
+    bool sensor_merge_push(sensor_merge_t *merge, uint8_t sensor, const uint8_t *data, size_t len, uint32_t now_us);
+
+    /**
+     * @brief Returns a sensor to rest, for example when its connection drops. Producer side, never blocks.
+     *
+     * Unlike a pushed value the release cannot be dropped when the queue is full. It is applied by
+     * the next sensor_merge_drain(), after the values already queued, so only push the sensor's
+     * values again once it is back.
+     * @param merge Merger.
+     * @param sensor Index of the sensor in the mapping.
+     */
+    void sensor_merge_release(sensor_merge_t *merge, uint8_t sensor);
+
+    /**
+     * @brief Applies all queued values and releases, then emits the resulting report updates. Consumer side.
+     * @param merge Merger.
+     * @param emit Called for every report update, from the calling task.
+     * @param ctx Passed to emit.
+     * @param now_us Current time in microseconds, used for the latency statistics.
+     * @return Number of report updates emitted.
+     */
+    uint32_t sensor_merge_drain(sensor_merge_t *merge, sensor_merge_emit_t emit, void *ctx, uint32_t now_us);
+
+    /**
+     * @brief Copies the statistics. Consumer side.
+     */
+    void sensor_merge_get_stats(const sensor_merge_t *merge, sensor_merge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_MERGE_H
@@ -0,0 +1,41 @@
+/**
+ * @file telemetry_broadcast.h
+ * @brief Connectionless broadcast of the gamepad state with periodic advertising.
+ *
+ * The HID gamepad keeps advertising on extended advertising instance 0. Instance 1 is a
+ * non-connectable extended advertisement carrying the device name and the manufacturer data
+ * (company id, TELEMETRY_FRAME_VERSION) that identifies the train, and its periodic advertising
+ * carries one manufacturer data AD structure with a telemetry_frame.h frame. Overlays and data
+ * loggers sync to the train and follow the pedals and shifter without connecting, so the host
+ * connection sees no extra traffic; the controller schedules the periodic events between the
+ * connection events.
+ *
+ * The broadcast task samples the gamepad state once per periodic interval and only hands the
+ * controller new data when the encoder produced a frame.
+ */
+
+#ifndef TELEMETRY_BROADCAST_H
+#define TELEMETRY_BROADCAST_H
+
+#include "esp_err.h"
+#include "telemetry_frame.h"
+
+#define TELEMETRY_ADV_INSTANCE 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Starts the broadcast task, which sets up the advertising instance. Call once
+     *        BleGamepad::waitForStart() returned, instance 0 must be set up first.
+     * @return ESP_ERR_INVALID_STATE if already started, ESP_ERR_NO_MEM if the task cannot be created.
+     */
+    esp_err_t telemetry_broadcast_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_BROADCAST_H
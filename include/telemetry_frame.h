@@ -0,0 +1,126 @@
+/**
+ * @file telemetry_frame.h
+ * @brief Compact gamepad state frames for the connectionless telemetry broadcast.
+ *
+ * Transport independent core of the telemetry broadcast. Every frame starts with a header byte
+ * (version in the high nibble, TELEMETRY_FLAG_x in the low one), its sequence number and the
+ * sequence number of the key frame it refers to. All values are little-endian.
+ *
+ *     key:   hdr seq base_seq axis_mask:u16 axis:i16[] n:u8 buttons[n] [special] [hats:2]
+ *     delta: hdr seq base_seq axis_mask:u16 diff:varint[] n:u8 button[n] [special] [hats:2]
+ *
+ * A key frame holds the axes that are not 0 and the button bytes up to the last one with a
+ * button pressed. A delta frame holds what differs from key frame base_seq: zigzag varint
+ * differences of the axes in axis_mask and the numbers (0-127) of the buttons that toggled.
+ * Special buttons and hats (two per byte, low nibble first) follow when their flag is set.
+ *
+ * Deltas refer to a base key frame rather than to the previous frame, so an observer that misses
+ * periodic events only loses the events in between, never the state. The base only changes when
+ * a delta would no longer be shorter than a key frame. Every key_interval ticks the encoder sends
+ * the base again (seq != base_seq, the state in it is the old one), so an observer that synced to
+ * the train late, or missed the base, decodes the deltas from then on.
+ */
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_FRAME_VERSION 1
+#define TELEMETRY_AXIS_COUNT 13 /**< Axes in BleGamepad report order, x..steering. */
+#define TELEMETRY_BUTTON_BYTES 16
+#define TELEMETRY_HAT_COUNT 4
+#define TELEMETRY_FRAME_MAX (3 + 2 + 2 * TELEMETRY_AXIS_COUNT + 1 + TELEMETRY_BUTTON_BYTES + 1 + TELEMETRY_HAT_COUNT / 2) /**< Largest frame, a key frame with everything set. */
+
+#define TELEMETRY_FLAG_DELTA 0x01   /**< Delta frame, otherwise key frame. */
+#define TELEMETRY_FLAG_SPECIAL 0x02 /**< The special buttons byte is present. */
+#define TELEMETRY_FLAG_HATS 0x04    /**< The hats are present. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Gamepad state carried by the frames.
+     */
+    typedef struct
+    {
+        int16_t axis[TELEMETRY_AXIS_COUNT];
+        uint8_t buttons[TELEMETRY_BUTTON_BYTES]; /**< Button n at bit n - 1. */
+        uint8_t special;                         /**< Special buttons (start, select...). */
+        int8_t hat[TELEMETRY_HAT_COUNT];         /**< 0 centered, 1-8 clockwise from up. */
+    } telemetry_state_t;
+
+    /**
+     * @brief Encoder state. All calls must come from one task.
+     */
+    typedef struct
+    {
+        telemetry_state_t base; /**< State of the base key frame. */
+        telemetry_state_t sent; /**< Current state as last sent. */
+        uint8_t seq;            /**< Sequence number of the last frame. */
+        uint8_t base_seq;       /**< Sequence number of the base key frame. */
+        uint8_t key_interval;   /**< Ticks between repeats of the base. */
+        uint8_t since_key;      /**< Ticks since the base was last on air. */
+        bool started;           /**< A frame was encoded. */
+        bool current;           /**< The frame on air carries the current state, not a repeated base. */
+    } telemetry_encoder_t;
+
+    /**
+     * @brief Decode results.
+     */
+    typedef enum
+    {
+        TELEMETRY_DECODE_OK = 0,  /**< New state in telemetry_decoder_t::state. */
+        TELEMETRY_DECODE_BASE,    /**< Repeated base: stored for the next deltas, the state did not change. */
+        TELEMETRY_DECODE_REPEAT,  /**< Same frame as the last one, the periodic train repeats unchanged data. */
+        TELEMETRY_DECODE_NO_KEY,  /**< Delta against a base this decoder has not seen yet. */
+        TELEMETRY_DECODE_INVALID, /**< Truncated frame or unknown version. */
+    } telemetry_decode_result_t;
+
+    /**
+     * @brief Decoder state of an observer.
+     */
+    typedef struct
+    {
+        telemetry_state_t base;  /**< State of the base key frame. */
+        telemetry_state_t state; /**< Last decoded state. */
+        uint8_t base_seq;
+        uint8_t seq;
+        bool has_base;
+        bool has_seq;
+        uint32_t missed; /**< Frames skipped between two decoded ones, by sequence number. */
+    } telemetry_decoder_t;
+
+    /**
+     * @brief Prepares an encoder.
+     * @param key_interval Ticks between repeats of the base, at least 2.
+     */
+    void telemetry_encoder_init(telemetry_encoder_t *encoder, uint8_t key_interval);
+
+    /**
+     * @brief Called once per broadcast tick with the current state.
+     * @param out TELEMETRY_FRAME_MAX bytes.
+     * @return Length of the new frame, 0 if the frame on air is still current. A tick that
+     *         repeats the base sends the state of that tick with the next one.
+     */
+    size_t telemetry_encode(telemetry_encoder_t *encoder, const telemetry_state_t *state, uint8_t *out);
+
+    /**
+     * @brief Prepares a decoder.
+     */
+    void telemetry_decoder_init(telemetry_decoder_t *decoder);
+
+    /**
+     * @brief Decodes a frame received from the periodic advertising train.
+     */
+    telemetry_decode_result_t telemetry_decode(telemetry_decoder_t *decoder, const uint8_t *frame, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_FRAME_H
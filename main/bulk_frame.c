@@ -0,0 +1,401 @@
+#include <string.h>
+
+#include "esp_rom_crc.h"
+
+#include "bulk_frame.h"
+
+enum
+{
+    STATE_IDLE,
+    STATE_GET,
+    STATE_PUT,
+};
+
+#define CREDIT_MAX 0xFFFF // Caps what a companion can grant, so the counter never wraps
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Writes a frame header, the payload (if any) is already in place behind it.
+ */
+static void put_header(uint8_t *buf, uint8_t type, uint8_t resource, uint16_t seq, uint32_t offset, uint32_t value)
+{
+    buf[0] = type;
+    buf[1] = resource;
+    put_u16(buf + 2, seq);
+    put_u32(buf + 4, offset);
+    put_u32(buf + 8, value);
+}
+
+size_t bulk_frame_encode(const bulk_frame_t *frame, uint8_t *buf, size_t len)
+{
+    if (BULK_FRAME_HEADER_LEN + frame->payload_len > len)
+    {
+        return 0;
+    }
+
+    put_header(buf, frame->type, frame->resource, frame->seq, frame->offset, frame->value);
+    if (frame->payload_len > 0)
+    {
+        memmove(buf + BULK_FRAME_HEADER_LEN, frame->payload, frame->payload_len);
+    }
+    return BULK_FRAME_HEADER_LEN + frame->payload_len;
+}
+
+bool bulk_frame_decode(const uint8_t *sdu, size_t len, bulk_frame_t *frame)
+{
+    if (len < BULK_FRAME_HEADER_LEN)
+    {
+        return false;
+    }
+
+    frame->type = sdu[0];
+    frame->resource = sdu[1];
+    frame->seq = get_u16(sdu + 2);
+    frame->offset = get_u32(sdu + 4);
+    frame->value = get_u32(sdu + 8);
+    frame->payload = sdu + BULK_FRAME_HEADER_LEN;
+    frame->payload_len = len - BULK_FRAME_HEADER_LEN;
+    return true;
+}
+
+bool bulk_session_init(bulk_session_t *session, const bulk_session_config_t *config)
+{
+    if (config->send == NULL || config->tx_buf == NULL || config->tx_len < BULK_FRAME_MIN_SDU || config->window == 0)
+    {
+        return false;
+    }
+
+    memset(session, 0, sizeof(*session));
+    session->config = *config;
+    bulk_session_reset(session, config->tx_len);
+    return true;
+}
+
+void bulk_session_reset(bulk_session_t *session, size_t peer_mtu)
+{
+    session->sdu_max = peer_mtu < session->config.tx_len ? peer_mtu : session->config.tx_len;
+    session->state = STATE_IDLE;
+    session->resource = NULL;
+    session->credits = 0;
+    session->grant = 0;
+    session->tx_frame = 0;
+    session->tx_data = 0;
+    session->status = -1;
+    session->end = false;
+}
+
+/**
+ * @brief Ends the transfer in progress and queues a STATUS frame for the companion.
+ */
+static void finish(bulk_session_t *session, uint8_t resource, bulk_status_t status)
+{
+    if (status == BULK_STATUS_OK)
+    {
+        session->stats.transfers++;
+    }
+    else
+    {
+        session->stats.aborted++;
+    }
+
+    session->state = STATE_IDLE;
+    session->resource = NULL;
+    session->credits = 0;
+    session->grant = 0;
+    session->end = false;
+    session->status = status;
+    session->status_resource = resource;
+}
+
+static const bulk_resource_t *find_resource(const bulk_session_t *session, uint8_t id)
+{
+    for (uint8_t i = 0; i < session->config.count; i++)
+    {
+        if (session->config.resources[i].id == id)
+        {
+            return &session->config.resources[i];
+        }
+    }
+    return NULL;
+}
+
+static void open_get(bulk_session_t *session, const bulk_frame_t *frame)
+{
+    const bulk_resource_t *resource = find_resource(session, frame->resource);
+    if (resource == NULL || resource->read == NULL)
+    {
+        finish(session, frame->resource, BULK_STATUS_UNKNOWN_RESOURCE);
+        return;
+    }
+
+    session->state = STATE_GET;
+    session->resource = resource;
+    session->seq = 0;
+    session->offset = 0;
+    session->crc = 0;
+    session->credits = frame->value < CREDIT_MAX ? frame->value : CREDIT_MAX;
+    session->end = false;
+}
+
+static void open_put(bulk_session_t *session, const bulk_frame_t *frame)
+{
+    const bulk_resource_t *resource = find_resource(session, frame->resource);
+    if (resource == NULL || resource->write == NULL || resource->max_size == 0)
+    {
+        finish(session, frame->resource, BULK_STATUS_UNKNOWN_RESOURCE);
+        return;
+    }
+    if (frame->offset > resource->max_size || frame->offset > session->config.put_len)
+    {
+        finish(session, frame->resource, BULK_STATUS_TOO_LARGE);
+        return;
+    }
+
+    session->state = STATE_PUT;
+    session->resource = resource;
+    session->seq = 0;
+    session->offset = 0;
+    session->total = frame->offset;
+    session->credits = 0;
+    session->grant = session->config.window; // The first CREDIT frame accepts the PUT
+}
+
+static void put_data(bulk_session_t *session, const bulk_frame_t *frame)
+{
+    if (session->credits == 0)
+    {
+        finish(session, frame->resource, BULK_STATUS_NO_CREDIT);
+        return;
+    }
+    if (frame->seq != session->seq || frame->offset != session->offset)
+    {
+        finish(session, frame->resource, BULK_STATUS_SEQUENCE);
+        return;
+    }
+    if (frame->payload_len > session->total - session->offset)
+    {
+        finish(session, frame->resource, BULK_STATUS_TOO_LARGE);
+        return;
+    }
+
+    memcpy(session->config.put_buf + session->offset, frame->payload, frame->payload_len);
+    session->offset += frame->payload_len;
+    session->seq++;
+    session->stats.bytes_rx += frame->payload_len;
+
+    // The SDU buffer is free again once the frame is copied, pump() hands the credit back
+    session->credits--;
+    session->grant++;
+}
+
+static void put_end(bulk_session_t *session, const bulk_frame_t *frame)
+{
+    const bulk_resource_t *resource = session->resource;
+
+    if (frame->offset != session->total || session->offset != session->total)
+    {
+        finish(session, frame->resource, BULK_STATUS_SEQUENCE);
+        return;
+    }
+    if (esp_rom_crc32_le(0, session->config.put_buf, session->total) != frame->value)
+    {
+        finish(session, frame->resource, BULK_STATUS_CRC);
+        return;
+    }
+
+    finish(session, frame->resource, resource->write(session->config.put_buf, session->total, resource->ctx));
+}
+
+void bulk_session_receive(bulk_session_t *session, const uint8_t *sdu, size_t len)
+{
+    bulk_frame_t frame;
+
+    if (!bulk_frame_decode(sdu, len, &frame))
+    {
+        finish(session, 0, BULK_STATUS_PROTOCOL);
+        bulk_session_pump(session);
+        return;
+    }
+
+    switch (frame.type)
+    {
+    case BULK_FRAME_OPEN_GET:
+    case BULK_FRAME_OPEN_PUT:
+        if (session->state != STATE_IDLE)
+        {
+            // Busy: the transfer in progress goes on, only the new one is refused
+            session->status = BULK_STATUS_BUSY;
+            session->status_resource = frame.resource;
+        }
+        else if (frame.type == BULK_FRAME_OPEN_GET)
+        {
+            open_get(session, &frame);
+        }
+        else
+        {
+            open_put(session, &frame);
+        }
+        break;
+    case BULK_FRAME_DATA:
+    case BULK_FRAME_END:
+        if (session->state == STATE_IDLE)
+        {
+            // Still in flight when the transfer was aborted, the STATUS already went out
+            break;
+        }
+        if (session->state != STATE_PUT || frame.resource != session->resource->id)
+        {
+            finish(session, frame.resource, BULK_STATUS_PROTOCOL);
+        }
+        else if (frame.type == BULK_FRAME_DATA)
+        {
+            put_data(session, &frame);
+        }
+        else
+        {
+            put_end(session, &frame);
+        }
+        break;
+    case BULK_FRAME_CREDIT:
+        if (session->state == STATE_GET)
+        {
+            session->credits = frame.value < CREDIT_MAX - session->credits ? session->credits + frame.value : CREDIT_MAX;
+        }
+        break;
+    case BULK_FRAME_STATUS:
+        // The companion gave up, nothing to answer
+        if (session->state != STATE_IDLE)
+        {
+            session->stats.aborted++;
+        }
+        session->state = STATE_IDLE;
+        session->resource = NULL;
+        session->grant = 0;
+        session->end = false;
+        session->tx_frame = 0;
+        session->tx_data = 0;
+        break;
+    default:
+        finish(session, frame.resource, BULK_STATUS_PROTOCOL);
+        break;
+    }
+
+    bulk_session_pump(session);
+}
+
+/**
+ * @brief Sends the frame in tx_buf, or keeps it for the next pump.
+ */
+static bool transmit(bulk_session_t *session, size_t len)
+{
+    if (!session->config.send(session->config.tx_buf, len, session->config.send_ctx))
+    {
+        session->tx_frame = len;
+        return false;
+    }
+
+    session->tx_frame = 0;
+    return true;
+}
+
+bool bulk_session_pump(bulk_session_t *session)
+{
+    uint8_t *buf = session->config.tx_buf;
+
+    // A refused frame goes first, it may hold data the resource cannot produce again
+    if (session->tx_frame > 0)
+    {
+        if (!transmit(session, session->tx_frame))
+        {
+            return true;
+        }
+        session->stats.bytes_tx += session->tx_data;
+        session->tx_data = 0;
+    }
+
+    if (session->status >= 0)
+    {
+        put_header(buf, BULK_FRAME_STATUS, session->status_resource, 0, 0, session->status);
+        if (!transmit(session, BULK_FRAME_HEADER_LEN))
+        {
+            return true;
+        }
+        session->status = -1;
+    }
+
+    // Credits go back in batches of half the window: fewer CREDIT frames, and the companion
+    // still holds credits while one is in flight. It never waits for a batch with none left.
+    if (session->state == STATE_PUT && session->grant > 0 &&
+        (session->credits == 0 || session->grant >= (session->config.window + 1u) / 2))
+    {
+        put_header(buf, BULK_FRAME_CREDIT, session->resource->id, 0, 0, session->grant);
+        session->credits += session->grant;
+        session->grant = 0;
+        if (!transmit(session, BULK_FRAME_HEADER_LEN))
+        {
+            return true;
+        }
+    }
+
+    while (session->state == STATE_GET)
+    {
+        const bulk_resource_t *resource = session->resource;
+
+        if (session->end)
+        {
+            put_header(buf, BULK_FRAME_END, resource->id, session->seq, session->offset, session->crc);
+            session->stats.transfers++;
+            session->state = STATE_IDLE;
+            session->resource = NULL;
+            session->end = false;
+            return !transmit(session, BULK_FRAME_HEADER_LEN);
+        }
+        if (session->credits == 0)
+        {
+            break;
+        }
+
+        size_t n = resource->read(session->offset, buf + BULK_FRAME_HEADER_LEN, session->sdu_max - BULK_FRAME_HEADER_LEN, resource->ctx);
+        if (n == 0)
+        {
+            session->end = true;
+            continue;
+        }
+
+        put_header(buf, BULK_FRAME_DATA, resource->id, session->seq, session->offset, 0);
+        session->crc = esp_rom_crc32_le(session->crc, buf + BULK_FRAME_HEADER_LEN, n);
+        session->offset += n;
+        session->seq++;
+        session->credits--;
+        if (!transmit(session, BULK_FRAME_HEADER_LEN + n))
+        {
+            session->tx_data = n;
+            return true;
+        }
+        session->stats.bytes_tx += n;
+    }
+    return false;
+}
@@ -0,0 +1,297 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "NimBLEDevice.h"
+#include "host/ble_l2cap.h"
+
+#include "bulk_transfer.h"
+#include "coex_policy.h"
+
+static const char *TAG = "BULK_XFER";
+
+// One SDU per mbuf: the block holds the mbuf and packet headers plus a full SDU
+#define BULK_MBUF_BLOCK (CONFIG_BULK_XFER_MTU + sizeof(struct os_mbuf) + sizeof(struct os_mbuf_pkthdr))
+// Receive window, the buffer posted to the stack, and two for the SDU being sent
+#define BULK_MBUF_COUNT (CONFIG_BULK_XFER_WINDOW + 3)
+#define BULK_RETRY_MS 10
+
+enum
+{
+    EVENT_CONNECTED,
+    EVENT_DISCONNECTED,
+    EVENT_RECEIVED,
+    EVENT_UNSTALLED,
+};
+
+typedef struct
+{
+    uint8_t type;
+    uint16_t mtu;        /**< Connected: peer SDU size. */
+    struct os_mbuf *sdu; /**< Received: the SDU, freed by the bulk task. */
+} bulk_event_t;
+
+static os_membuf_t s_mbuf_mem[OS_MEMPOOL_SIZE(BULK_MBUF_COUNT, BULK_MBUF_BLOCK)];
+static struct os_mempool s_mempool;
+static struct os_mbuf_pool s_mbuf_pool;
+
+static QueueHandle_t s_events;
+static TaskHandle_t s_task;
+static bulk_session_t s_session;
+static uint8_t s_tx_buf[CONFIG_BULK_XFER_MTU];
+static uint8_t s_rx_buf[CONFIG_BULK_XFER_MTU];
+static uint8_t s_put_buf[CONFIG_BULK_XFER_PUT_MAX];
+
+// Shared with the NimBLE host task
+static struct ble_l2cap_chan *s_chan;
+static bool s_stalled;
+static bool s_rx_starved;
+
+/**
+ * @brief Gives the stack a buffer for the next SDU, which also returns its L2CAP credits.
+ * @return false if the pool is empty; the bulk task posts one when it frees an SDU.
+ */
+static bool post_rx_buffer(struct ble_l2cap_chan *chan)
+{
+    struct os_mbuf *sdu = os_mbuf_get_pkthdr(&s_mbuf_pool, 0);
+    if (sdu == NULL)
+    {
+        __atomic_store_n(&s_rx_starved, true, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if (ble_l2cap_recv_ready(chan, sdu) != 0)
+    {
+        os_mbuf_free_chain(sdu);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief L2CAP events, in the NimBLE host task: only hand SDUs over to the bulk task.
+ */
+static int l2cap_event(struct ble_l2cap_event *event, void *arg)
+{
+    bulk_event_t ev = {};
+    struct ble_gap_conn_desc desc;
+    struct ble_l2cap_chan_info info;
+
+    switch (event->type)
+    {
+    case BLE_L2CAP_EVENT_COC_ACCEPT:
+        // Configs are pushed through this channel, only a paired host may open it
+        if (ble_gap_conn_find(event->accept.conn_handle, &desc) != 0 || !desc.sec_state.encrypted)
+        {
+            return BLE_HS_EAUTHEN;
+        }
+        if (__atomic_load_n(&s_chan, __ATOMIC_ACQUIRE) != NULL)
+        {
+            return BLE_HS_ENOMEM;
+        }
+        return post_rx_buffer(event->accept.chan) ? 0 : BLE_HS_ENOMEM;
+
+    case BLE_L2CAP_EVENT_COC_CONNECTED:
+        if (event->connect.status != 0)
+        {
+            ESP_LOGW(TAG, "Channel setup failed (%d)", event->connect.status);
+            return 0;
+        }
+        ble_l2cap_get_chan_info(event->connect.chan, &info);
+        ESP_LOGI(TAG, "Channel open, SDU %u/%u bytes", info.our_coc_mtu, info.peer_coc_mtu);
+        // The companion counts as UI access, the only way back to Wi-Fi under the suspend policy
+        coex_policy_note_ui_access();
+        __atomic_store_n(&s_stalled, false, __ATOMIC_RELAXED);
+        __atomic_store_n(&s_chan, event->connect.chan, __ATOMIC_RELEASE);
+        ev.type = EVENT_CONNECTED;
+        ev.mtu = info.peer_coc_mtu;
+        break;
+
+    case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+        __atomic_store_n(&s_chan, NULL, __ATOMIC_RELEASE);
+        ev.type = EVENT_DISCONNECTED;
+        break;
+
+    case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+        ev.type = EVENT_RECEIVED;
+        ev.sdu = event->receive.sdu_rx;
+        if (xQueueSend(s_events, &ev, 0) != pdTRUE)
+        {
+            // The companion's credits bound the queue, so this is a protocol violation; the
+            // missing DATA frame ends the transfer with BULK_STATUS_SEQUENCE
+            os_mbuf_free_chain(ev.sdu);
+        }
+        post_rx_buffer(event->receive.chan);
+        return 0;
+
+    case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+        __atomic_store_n(&s_stalled, false, __ATOMIC_RELAXED);
+        ev.type = EVENT_UNSTALLED;
+        break;
+
+    default:
+        return 0;
+    }
+
+    if (xQueueSend(s_events, &ev, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Event queue full, event %u lost", ev.type);
+    }
+    return 0;
+}
+
+/**
+ * @brief bulk_send_t over the channel. ble_l2cap_send() takes one SDU at a time; a stalled
+ * SDU (out of peer credits) is kept by the stack and TX_UNSTALLED tells when the next may go.
+ */
+static bool send_sdu(const uint8_t *data, size_t len, void *ctx)
+{
+    struct ble_l2cap_chan *chan = __atomic_load_n(&s_chan, __ATOMIC_ACQUIRE);
+    if (chan == NULL || __atomic_load_n(&s_stalled, __ATOMIC_RELAXED))
+    {
+        return false;
+    }
+
+    struct os_mbuf *sdu = os_mbuf_get_pkthdr(&s_mbuf_pool, 0);
+    if (sdu == NULL)
+    {
+        return false;
+    }
+    if (os_mbuf_append(sdu, data, len) != 0)
+    {
+        os_mbuf_free_chain(sdu);
+        return false;
+    }
+
+    // Set first, so an UNSTALLED event racing with the return value is never lost
+    __atomic_store_n(&s_stalled, true, __ATOMIC_RELAXED);
+    int rc = ble_l2cap_send(chan, sdu);
+    if (rc == 0)
+    {
+        __atomic_store_n(&s_stalled, false, __ATOMIC_RELAXED);
+        return true;
+    }
+    if (rc == BLE_HS_ESTALLED)
+    {
+        return true;
+    }
+
+    os_mbuf_free_chain(sdu);
+    if (rc != BLE_HS_EBUSY)
+    {
+        __atomic_store_n(&s_stalled, false, __ATOMIC_RELAXED);
+        ESP_LOGW(TAG, "ble_l2cap_send failed (%d)", rc);
+    }
+    return false;
+}
+
+/**
+ * @brief Runs the protocol for the open channel.
+ */
+static void bulk_task(void *arg)
+{
+    int rc = ble_l2cap_create_server(CONFIG_BULK_XFER_PSM, CONFIG_BULK_XFER_MTU, l2cap_event, NULL);
+    if (rc != 0)
+    {
+        ESP_LOGE(TAG, "ble_l2cap_create_server failed (%d), is BT_NIMBLE_L2CAP_COC_MAX_NUM 0?", rc);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Listening on PSM 0x%02x", CONFIG_BULK_XFER_PSM);
+
+    bool retry = false;
+    for (;;)
+    {
+        bulk_event_t ev;
+        if (xQueueReceive(s_events, &ev, retry ? pdMS_TO_TICKS(BULK_RETRY_MS) : portMAX_DELAY) != pdTRUE)
+        {
+            // Out of mbufs for the SDU to send, try again
+            retry = bulk_session_pump(&s_session);
+            continue;
+        }
+
+        switch (ev.type)
+        {
+        case EVENT_CONNECTED:
+            bulk_session_reset(&s_session, ev.mtu);
+            memset(&s_session.stats, 0, sizeof(s_session.stats));
+            break;
+
+        case EVENT_DISCONNECTED:
+            ESP_LOGI(TAG, "Channel closed: %" PRIu32 " transfers, %" PRIu32 " aborted, %" PRIu32 " B sent, %" PRIu32 " B received",
+                     s_session.stats.transfers, s_session.stats.aborted, s_session.stats.bytes_tx, s_session.stats.bytes_rx);
+            bulk_session_reset(&s_session, CONFIG_BULK_XFER_MTU);
+            retry = false;
+            continue;
+
+        case EVENT_RECEIVED:
+        {
+            // The stack never accepts an SDU above our MTU, which is the size of s_rx_buf
+            uint16_t len = OS_MBUF_PKTLEN(ev.sdu);
+            os_mbuf_copydata(ev.sdu, 0, len, s_rx_buf);
+            os_mbuf_free_chain(ev.sdu);
+
+            struct ble_l2cap_chan *chan = __atomic_load_n(&s_chan, __ATOMIC_ACQUIRE);
+            if (chan != NULL && __atomic_exchange_n(&s_rx_starved, false, __ATOMIC_RELAXED))
+            {
+                post_rx_buffer(chan);
+            }
+
+            bulk_session_receive(&s_session, s_rx_buf, len);
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        retry = bulk_session_pump(&s_session);
+    }
+}
+
+esp_err_t bulk_transfer_start(const bulk_resource_t *resources, uint8_t count)
+{
+    if (s_task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bulk_session_config_t config = {};
+    config.resources = resources;
+    config.count = count;
+    config.send = send_sdu;
+    config.tx_buf = s_tx_buf;
+    config.tx_len = sizeof(s_tx_buf);
+    config.put_buf = s_put_buf;
+    config.put_len = sizeof(s_put_buf);
+    config.window = CONFIG_BULK_XFER_WINDOW;
+    if (!bulk_session_init(&s_session, &config))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (os_mempool_init(&s_mempool, BULK_MBUF_COUNT, BULK_MBUF_BLOCK, s_mbuf_mem, "bulk_sdu") != 0 ||
+        os_mbuf_pool_init(&s_mbuf_pool, &s_mempool, BULK_MBUF_BLOCK, BULK_MBUF_COUNT) != 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Every SDU the companion's credits allow, plus channel events
+    s_events = xQueueCreate(CONFIG_BULK_XFER_WINDOW + 4, sizeof(bulk_event_t));
+    if (s_events == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Below the gamepad server and sensor aggregator, a transfer only uses idle airtime
+    if (xTaskCreate(bulk_task, "bulk_xfer", 4096, NULL, 2, &s_task) != pdPASS)
+    {
+        vQueueDelete(s_events);
+        s_events = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "coex_policy.h"
+
+static const char *TAG = "COEX";
+
+static coex_host_connected_t s_host_connected;
+
+// Written by one task and read by others, so every access goes through the relaxed __atomic builtins
+static uint8_t s_policy = COEX_POLICY_POWER_SAVE;
+static uint8_t s_mode = COEX_MODE_FULL;
+static uint32_t s_last_input_ms;
+static uint32_t s_ui_hold_until_ms;
+
+// Notify statistics, written only from the NimBLE host task
+static coex_mode_stats_t s_stats[COEX_MODE_MAX];
+static uint32_t s_last_latency_us;
+
+// Mode s_last_latency_us was measured in, COEX_MODE_MAX after a policy change (atomic, also written by coex_policy_set)
+static uint8_t s_last_latency_mode = COEX_MODE_MAX;
+
+// Time spent in previous visits to each mode, and when the current mode was entered (policy task only)
+static uint32_t s_mode_time_ms[COEX_MODE_MAX];
+static uint32_t s_mode_entered_ms;
+
+static const char *s_mode_names[COEX_MODE_MAX] = {"full", "power_save", "suspended"};
+static const char *s_policy_names[COEX_POLICY_MAX] = {"always_on", "power_save", "suspend"};
+
+static inline uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+/**
+ * @brief Applies a radio mode to Wi-Fi.
+ * @return true if the mode is now in effect.
+ */
+static bool apply_mode(coex_mode_t from, coex_mode_t to)
+{
+    esp_err_t err = ESP_OK;
+
+    if (from == COEX_MODE_SUSPENDED)
+    {
+        // The STA reconnects from the WIFI_EVENT_STA_START handler
+        err = esp_wifi_start();
+    }
+
+    if (err == ESP_OK)
+    {
+        switch (to)
+        {
+        case COEX_MODE_FULL:
+            // WIFI_PS_NONE is not allowed while BLE is enabled, minimum modem sleep is the closest to "always on"
+            err = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+            break;
+        case COEX_MODE_POWER_SAVE:
+            err = esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+            break;
+        case COEX_MODE_SUSPENDED:
+            err = esp_wifi_stop();
+            break;
+        default:
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Switching Wi-Fi from %s to %s failed (%s)", s_mode_names[from], s_mode_names[to], esp_err_to_name(err));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Wi-Fi %s -> %s", s_mode_names[from], s_mode_names[to]);
+    return true;
+}
+
+/**
+ * @brief Picks the radio mode for the current activity and policy.
+ */
+static coex_mode_t select_mode(uint32_t now)
+{
+    coex_policy_t policy = (coex_policy_t)__atomic_load_n(&s_policy, __ATOMIC_RELAXED);
+    if (policy == COEX_POLICY_ALWAYS_ON || s_host_connected == NULL || !s_host_connected())
+    {
+        return COEX_MODE_FULL;
+    }
+
+    // Serial number arithmetic, so both windows survive the 49 day wrap of the millisecond clock
+    if ((int32_t)(__atomic_load_n(&s_ui_hold_until_ms, __ATOMIC_RELAXED) - now) > 0)
+    {
+        return COEX_MODE_FULL;
+    }
+    if (now - __atomic_load_n(&s_last_input_ms, __ATOMIC_RELAXED) >= CONFIG_COEX_IDLE_TIMEOUT_MS)
+    {
+        return COEX_MODE_FULL;
+    }
+
+    return policy == COEX_POLICY_SUSPEND ? COEX_MODE_SUSPENDED : COEX_MODE_POWER_SAVE;
+}
+
+/**
+ * @brief Re-evaluates the radio mode every CONFIG_COEX_EVAL_PERIOD_MS.
+ * @param pvParameters Unused.
+ */
+static void coex_policy_task(void *pvParameters)
+{
+    while (1)
+    {
+        uint32_t now = now_ms();
+        coex_mode_t current = (coex_mode_t)s_mode;
+        coex_mode_t target = select_mode(now);
+
+        if (target != current && apply_mode(current, target))
+        {
+            s_mode_time_ms[current] += now - s_mode_entered_ms;
+            s_mode_entered_ms = now;
+            __atomic_store_n(&s_mode, target, __ATOMIC_RELAXED);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_COEX_EVAL_PERIOD_MS));
+    }
+}
+
+void coex_policy_start(coex_policy_t policy, coex_host_connected_t host_connected)
+{
+    s_host_connected = host_connected;
+    coex_policy_set(policy);
+
+    s_mode_entered_ms = now_ms();
+    apply_mode(COEX_MODE_FULL, COEX_MODE_FULL);
+
+    xTaskCreate(coex_policy_task, "coex_policy", 2560, NULL, 1, NULL);
+}
+
+void coex_policy_set(coex_policy_t policy)
+{
+    if (policy >= COEX_POLICY_MAX)
+    {
+        ESP_LOGE(TAG, "Unknown policy %d", policy);
+        return;
+    }
+    __atomic_store_n(&s_policy, policy, __ATOMIC_RELAXED);
+    __atomic_store_n(&s_last_latency_mode, COEX_MODE_MAX, __ATOMIC_RELAXED);
+    ESP_LOGI(TAG, "Policy %s", s_policy_names[policy]);
+}
+
+coex_policy_t coex_policy_get(void)
+{
+    return (coex_policy_t)__atomic_load_n(&s_policy, __ATOMIC_RELAXED);
+}
+
+coex_mode_t coex_policy_get_mode(void)
+{
+    return (coex_mode_t)__atomic_load_n(&s_mode, __ATOMIC_RELAXED);
+}
+
+void coex_policy_note_input(void)
+{
+    __atomic_store_n(&s_last_input_ms, now_ms(), __ATOMIC_RELAXED);
+}
+
+void coex_policy_note_ui_access(void)
+{
+    __atomic_store_n(&s_ui_hold_until_ms, now_ms() + CONFIG_COEX_UI_HOLD_MS, __ATOMIC_RELAXED);
+}
+
+void coex_policy_record_notify_latency(uint32_t latency_us)
+{
+    coex_mode_t mode = coex_policy_get_mode();
+    coex_mode_stats_t *stats = &s_stats[mode];
+
+    if (stats->samples == 0)
+    {
+        stats->mean_us = latency_us;
+    }
+    else
+    {
+        // 1/16 exponential averages in integer arithmetic
+        stats->mean_us += ((int32_t)latency_us - (int32_t)stats->mean_us) / 16;
+    }
+
+    // Jitter compares consecutive latencies, a latency from another mode or policy would show up as jitter here
+    if (__atomic_load_n(&s_last_latency_mode, __ATOMIC_RELAXED) == mode)
+    {
+        int32_t delta = (int32_t)latency_us - (int32_t)s_last_latency_us;
+        if (delta < 0)
+        {
+            delta = -delta;
+        }
+        stats->jitter_us += (delta - (int32_t)stats->jitter_us) / 16;
+    }
+
+    if (latency_us > stats->max_us)
+    {
+        stats->max_us = latency_us;
+    }
+    stats->samples++;
+    s_last_latency_us = latency_us;
+    __atomic_store_n(&s_last_latency_mode, mode, __ATOMIC_RELAXED);
+}
+
+void coex_policy_get_stats(coex_mode_t mode, coex_mode_stats_t *stats)
+{
+    if (mode >= COEX_MODE_MAX)
+    {
+        return;
+    }
+
+    // Fields are read individually; a sample landing mid-copy only skews one reading
+    *stats = s_stats[mode];
+    stats->time_ms = s_mode_time_ms[mode];
+    if (mode == coex_policy_get_mode())
+    {
+        stats->time_ms += now_ms() - s_mode_entered_ms;
+    }
+}
+
+const char *coex_mode_name(coex_mode_t mode)
+{
+    return mode < COEX_MODE_MAX ? s_mode_names[mode] : "unknown";
+}
+
+const char *coex_policy_name(coex_policy_t policy)
+{
+    return policy < COEX_POLICY_MAX ? s_policy_names[policy] : "unknown";
+}
@@ -0,0 +1,656 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+#include "config_store.h"
+#include "metrics.h"
+#include "coex_policy.h"
+#include "BleGamepadConfiguration.h"
+
+static const char *TAG = "CONFIG";
+
+#define CONFIG_STORE_MAGIC 0x4347 // "GC"
+#define CONFIG_STORE_HEADER_SIZE 14
+#define CONFIG_STORE_CRC_OFFSET 10
+#define CONFIG_STORE_MAX_PAYLOAD (CONFIG_STORE_RECORD_MAX - CONFIG_STORE_HEADER_SIZE)
+#define CONFIG_STORE_GPIO_MAX 48      // Highest GPIO number of the supported chips (ESP32-S3)
+#define CONFIG_STORE_ADC1_CHANNELS 10 // ADC1 channels of the ESP32-S3
+#define CONFIG_STORE_ADC_RAW_MAX 4095 // 12 bit ADC readings
+
+// Two slots written alternately, so the last good record survives an interrupted write
+static const char *s_slot_keys[2] = {"cfg_a", "cfg_b"};
+
+// Slot holding the newest valid record and its sequence number (-1 when nothing is stored)
+static int s_active_slot = -1;
+static uint32_t s_sequence = 0;
+
+// The web UI and bulk transfer tasks both save, every public call holds this while it reads or
+// writes the slots and the two variables above. Created before app_main() runs.
+static StaticSemaphore_t s_lock_buffer;
+static SemaphoreHandle_t s_lock = xSemaphoreCreateMutexStatic(&s_lock_buffer);
+
+/**
+ * @brief Migration hooks. s_migrations[v] upgrades a version v payload to version v + 1.
+ *
+ * Entry 0 is unused. When the layout changes, bump CONFIG_STORE_VERSION, append a hook here
+ * and update encode_payload()/decode_payload() for the new layout only.
+ */
+static size_t migrate_v1_to_v2(uint8_t *payload, size_t len, size_t capacity);
+
+static const config_store_migration_t s_migrations[CONFIG_STORE_VERSION] = {
+    NULL,
+    migrate_v1_to_v2,
+};
+
+/**
+ * @brief Little-endian cursor over a byte buffer. Any overrun latches ok to false.
+ */
+typedef struct
+{
+    uint8_t *data;
+    size_t len;
+    size_t pos;
+    bool ok;
+} cursor_t;
+
+static void put_u8(cursor_t *c, uint8_t value)
+{
+    if (c->pos + 1 > c->len)
+    {
+        c->ok = false;
+        return;
+    }
+    c->data[c->pos++] = value;
+}
+
+static void put_u16(cursor_t *c, uint16_t value)
+{
+    put_u8(c, value & 0xFF);
+    put_u8(c, value >> 8);
+}
+
+static void put_u32(cursor_t *c, uint32_t value)
+{
+    put_u16(c, value & 0xFFFF);
+    put_u16(c, value >> 16);
+}
+
+static void put_bytes(cursor_t *c, const void *src, size_t len)
+{
+    if (c->pos + len > c->len)
+    {
+        c->ok = false;
+        return;
+    }
+    memcpy(c->data + c->pos, src, len);
+    c->pos += len;
+}
+
+static uint8_t get_u8(cursor_t *c)
+{
+    if (c->pos + 1 > c->len)
+    {
+        c->ok = false;
+        return 0;
+    }
+    return c->data[c->pos++];
+}
+
+static uint16_t get_u16(cursor_t *c)
+{
+    uint16_t lo = get_u8(c);
+    return lo | (uint16_t)(get_u8(c) << 8);
+}
+
+static uint32_t get_u32(cursor_t *c)
+{
+    uint32_t lo = get_u16(c);
+    return lo | ((uint32_t)get_u16(c) << 16);
+}
+
+static void get_bytes(cursor_t *c, void *dst, size_t len)
+{
+    if (c->pos + len > c->len)
+    {
+        c->ok = false;
+        return;
+    }
+    memcpy(dst, c->data + c->pos, len);
+    c->pos += len;
+}
+
+/**
+ * @brief Serialises the current (CONFIG_STORE_VERSION) payload layout.
+ * @return Payload length, or 0 if the buffer is too small.
+ */
+static size_t encode_payload(const app_config_t *cfg, uint8_t *buf, size_t len)
+{
+    cursor_t c = {buf, len, 0, true};
+
+    put_u8(&c, cfg->controller_type);
+    put_u8(&c, cfg->hid_report_id);
+    put_u8(&c, cfg->auto_report);
+    put_u8(&c, cfg->hat_switch_count);
+    put_u16(&c, cfg->button_count);
+    put_u8(&c, cfg->special_buttons);
+    put_u8(&c, cfg->axes);
+    put_u8(&c, cfg->simulation_controls);
+    put_u16(&c, cfg->vid);
+    put_u16(&c, cfg->pid);
+    put_u16(&c, cfg->axes_min);
+    put_u16(&c, cfg->axes_max);
+    put_u16(&c, cfg->simulation_min);
+    put_u16(&c, cfg->simulation_max);
+
+    uint8_t gpio_count = cfg->gpio_count > CONFIG_STORE_MAX_GPIOS ? CONFIG_STORE_MAX_GPIOS : cfg->gpio_count;
+    put_u8(&c, gpio_count);
+    put_bytes(&c, cfg->gpios, gpio_count);
+
+    uint8_t chip_len = strnlen(cfg->chip_series, CONFIG_STORE_CHIP_SERIES_LEN - 1);
+    put_u8(&c, chip_len);
+    put_bytes(&c, cfg->chip_series, chip_len);
+
+    put_u8(&c, CONFIG_STORE_AXIS_COUNT);
+    for (int i = 0; i < CONFIG_STORE_AXIS_COUNT; i++)
+    {
+        put_u8(&c, cfg->axis[i].adc_channel);
+        put_u8(&c, cfg->axis[i].flags);
+        put_u16(&c, cfg->axis[i].raw_min);
+        put_u16(&c, cfg->axis[i].raw_max);
+    }
+
+    put_u8(&c, cfg->coex_policy);
+
+    return c.ok ? c.pos : 0;
+}
+
+/**
+ * @brief Rejects values the gamepad, GPIO and coexistence setup cannot use.
+ */
+static bool config_valid(const app_config_t *cfg)
+{
+    if (cfg->gpio_count > CONFIG_STORE_MAX_GPIOS ||
+        cfg->hat_switch_count > CONFIG_STORE_MAX_HATS ||
+        cfg->button_count > CONFIG_STORE_MAX_BUTTONS ||
+        cfg->coex_policy >= COEX_POLICY_MAX)
+    {
+        return false;
+    }
+
+    // Records also come from the companion, over a link any nearby host can pair with
+    if ((cfg->controller_type != CONTROLLER_TYPE_JOYSTICK && cfg->controller_type != CONTROLLER_TYPE_GAMEPAD &&
+         cfg->controller_type != CONTROLLER_TYPE_MULTI_AXIS) ||
+        cfg->hid_report_id == 0 ||
+        cfg->simulation_controls >= (1 << (STEERING + 1)) ||
+        cfg->axes_min >= cfg->axes_max ||
+        cfg->simulation_min >= cfg->simulation_max)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < cfg->gpio_count; i++)
+    {
+        if (cfg->gpios[i] > CONFIG_STORE_GPIO_MAX)
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; cfg->chip_series[i] != 0; i++)
+    {
+        if (cfg->chip_series[i] < 0x20 || cfg->chip_series[i] > 0x7E)
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < CONFIG_STORE_AXIS_COUNT; i++)
+    {
+        const axis_config_t *axis = &cfg->axis[i];
+        if ((axis->adc_channel != CONFIG_STORE_ADC_UNUSED && axis->adc_channel >= CONFIG_STORE_ADC1_CHANNELS) ||
+            (axis->flags & ~CONFIG_STORE_AXIS_FLAG_INVERTED) != 0 ||
+            axis->raw_min >= axis->raw_max || axis->raw_max > CONFIG_STORE_ADC_RAW_MAX)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes a CONFIG_STORE_VERSION payload on top of the defaults already in cfg.
+ * @return true if the payload was well formed.
+ */
+static bool decode_payload(uint8_t *buf, size_t len, app_config_t *cfg)
+{
+    cursor_t c = {buf, len, 0, true};
+
+    cfg->controller_type = get_u8(&c);
+    cfg->hid_report_id = get_u8(&c);
+    cfg->auto_report = get_u8(&c);
+    cfg->hat_switch_count = get_u8(&c);
+    cfg->button_count = get_u16(&c);
+    cfg->special_buttons = get_u8(&c);
+    cfg->axes = get_u8(&c);
+    cfg->simulation_controls = get_u8(&c);
+    cfg->vid = get_u16(&c);
+    cfg->pid = get_u16(&c);
+    cfg->axes_min = (int16_t)get_u16(&c);
+    cfg->axes_max = (int16_t)get_u16(&c);
+    cfg->simulation_min = (int16_t)get_u16(&c);
+    cfg->simulation_max = (int16_t)get_u16(&c);
+
+    uint8_t gpio_count = get_u8(&c);
+    if (gpio_count > CONFIG_STORE_MAX_GPIOS)
+    {
+        return false;
+    }
+    cfg->gpio_count = gpio_count;
+    get_bytes(&c, cfg->gpios, gpio_count);
+
+    uint8_t chip_len = get_u8(&c);
+    if (chip_len >= CONFIG_STORE_CHIP_SERIES_LEN)
+    {
+        return false;
+    }
+    get_bytes(&c, cfg->chip_series, chip_len);
+    cfg->chip_series[chip_len] = 0;
+
+    // Records written with fewer axes keep the defaults for the rest
+    uint8_t axis_count = get_u8(&c);
+    for (int i = 0; i < axis_count; i++)
+    {
+        axis_config_t axis;
+        axis.adc_channel = get_u8(&c);
+        axis.flags = get_u8(&c);
+        axis.raw_min = get_u16(&c);
+        axis.raw_max = get_u16(&c);
+        if (i < CONFIG_STORE_AXIS_COUNT)
+        {
+            cfg->axis[i] = axis;
+        }
+    }
+
+    cfg->coex_policy = get_u8(&c);
+
+    return c.ok && config_valid(cfg);
+}
+
+/**
+ * @brief Version 2 appends the coexistence policy, version 1 records get the default.
+ */
+static size_t migrate_v1_to_v2(uint8_t *payload, size_t len, size_t capacity)
+{
+    if (len + 1 > capacity)
+    {
+        return 0;
+    }
+    payload[len] = COEX_POLICY_POWER_SAVE;
+    return len + 1;
+}
+
+/**
+ * @brief Validates a raw slot blob and extracts its header fields.
+ * @return true if the magic, length and CRC all check out.
+ */
+static bool parse_record(uint8_t *blob, size_t blob_len, uint8_t *version, uint32_t *sequence, size_t *payload_len)
+{
+    if (blob_len < CONFIG_STORE_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    cursor_t c = {blob, blob_len, 0, true};
+    uint16_t magic = get_u16(&c);
+    *version = get_u8(&c);
+    get_u8(&c); // reserved
+    *sequence = get_u32(&c);
+    *payload_len = get_u16(&c);
+    uint32_t crc = get_u32(&c);
+
+    if (magic != CONFIG_STORE_MAGIC || *version == 0 || *version > CONFIG_STORE_VERSION)
+    {
+        return false;
+    }
+    if (CONFIG_STORE_HEADER_SIZE + *payload_len != blob_len)
+    {
+        return false;
+    }
+
+    uint32_t actual = esp_rom_crc32_le(0, blob, CONFIG_STORE_CRC_OFFSET);
+    actual = esp_rom_crc32_le(actual, blob + CONFIG_STORE_HEADER_SIZE, *payload_len);
+    return actual == crc;
+}
+
+/**
+ * @brief Reads one slot in a single NVS access.
+ * @param valid Set to true if the slot holds a valid record.
+ * @return ESP_OK once the slot was read, even if it is empty or invalid; the NVS error otherwise.
+ */
+static esp_err_t read_slot(nvs_handle_t handle, int slot, uint8_t *blob, size_t capacity,
+                           uint8_t *version, uint32_t *sequence, size_t *payload_len, bool *valid)
+{
+    size_t blob_len = capacity;
+    *valid = false;
+    esp_err_t err = nvs_get_blob(handle, s_slot_keys[slot], blob, &blob_len);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Slot %s unreadable (%s)", s_slot_keys[slot], esp_err_to_name(err));
+        return err;
+    }
+
+    *valid = parse_record(blob, blob_len, version, sequence, payload_len);
+    if (!*valid)
+    {
+        ESP_LOGW(TAG, "Slot %s failed validation", s_slot_keys[slot]);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Brings a validated payload up to CONFIG_STORE_VERSION and decodes it.
+ * @param payload Payload bytes, in a buffer of CONFIG_STORE_MAX_PAYLOAD bytes.
+ * @return ESP_ERR_NOT_SUPPORTED without a migration path, ESP_ERR_INVALID_SIZE if malformed.
+ */
+static esp_err_t migrate_and_decode(uint8_t *payload, size_t payload_len, uint8_t version, app_config_t *cfg)
+{
+    for (uint8_t v = version; v < CONFIG_STORE_VERSION; v++)
+    {
+        if (s_migrations[v] == NULL ||
+            (payload_len = s_migrations[v](payload, payload_len, CONFIG_STORE_MAX_PAYLOAD)) == 0)
+        {
+            ESP_LOGE(TAG, "No migration from version %u", v);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    return decode_payload(payload, payload_len, cfg) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+void config_store_defaults(app_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+
+    cfg->controller_type = CONTROLLER_TYPE_JOYSTICK;
+    cfg->hid_report_id = 3;
+    cfg->auto_report = 0;
+    cfg->hat_switch_count = 0;
+    cfg->button_count = 14;
+    cfg->special_buttons = 0;
+    cfg->axes = 0;
+    cfg->simulation_controls = (1 << THROTTLE) | (1 << BRAKE);
+    cfg->vid = 0xe502;
+    cfg->pid = 0xbbab;
+    cfg->axes_min = 0x0000;
+    cfg->axes_max = 0x7FFF;
+    cfg->simulation_min = 0x0000;
+    cfg->simulation_max = 0x0FFF;
+
+    cfg->gpio_count = 1;
+    cfg->gpios[0] = 0;
+    strcpy(cfg->chip_series, "ESP32_S3");
+
+    for (int i = 0; i < CONFIG_STORE_AXIS_COUNT; i++)
+    {
+        cfg->axis[i].adc_channel = CONFIG_STORE_ADC_UNUSED;
+        cfg->axis[i].raw_min = 0;
+        cfg->axis[i].raw_max = 0x0FFF;
+    }
+
+    cfg->coex_policy = COEX_POLICY_POWER_SAVE;
+}
+
+/**
+ * @brief Loads the newest usable record.
+ *
+ * The slot state (s_active_slot, s_sequence) only changes once both slots were read: after an
+ * NVS error it keeps what the last successful load or save found, so the next save still
+ * writes the other slot than the newest record.
+ */
+static esp_err_t load(app_config_t *cfg)
+{
+    config_store_defaults(cfg);
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGI(TAG, "No stored configuration, using defaults");
+        s_active_slot = -1;
+        s_sequence = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "nvs_open failed (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t blobs[2][CONFIG_STORE_RECORD_MAX];
+    uint8_t versions[2];
+    uint32_t sequences[2];
+    size_t payload_lens[2];
+    bool valid[2];
+
+    for (int slot = 0; slot < 2 && err == ESP_OK; slot++)
+    {
+        err = read_slot(handle, slot, blobs[slot], sizeof(blobs[slot]),
+                        &versions[slot], &sequences[slot], &payload_lens[slot], &valid[slot]);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    s_active_slot = -1;
+    s_sequence = 0;
+
+    // Newest record first, the other valid slot is the fallback when its payload cannot be used
+    int order[2];
+    int count = 0;
+    if (valid[0] && valid[1])
+    {
+        // Serial number arithmetic, so the comparison survives sequence wrap-around
+        order[0] = (int32_t)(sequences[1] - sequences[0]) > 0 ? 1 : 0;
+        order[1] = 1 - order[0];
+        count = 2;
+    }
+    else if (valid[0] || valid[1])
+    {
+        order[0] = valid[0] ? 0 : 1;
+        count = 1;
+    }
+    else
+    {
+        ESP_LOGI(TAG, "No valid configuration record, using defaults");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int slot = order[i];
+        app_config_t loaded;
+        config_store_defaults(&loaded);
+        err = migrate_and_decode(blobs[slot] + CONFIG_STORE_HEADER_SIZE, payload_lens[slot], versions[slot], &loaded);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Slot %s payload not usable", s_slot_keys[slot]);
+            continue;
+        }
+
+        *cfg = loaded;
+        s_active_slot = slot;
+        s_sequence = sequences[slot];
+        ESP_LOGI(TAG, "Loaded configuration v%u seq %" PRIu32 " from %s",
+                 versions[slot], s_sequence, s_slot_keys[slot]);
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "No usable configuration record, using defaults");
+    return err;
+}
+
+/**
+ * @brief Serialises a configuration into a complete record (header, payload and CRC).
+ * @return Record length, or 0 if the buffer is too small.
+ */
+static size_t build_record(const app_config_t *cfg, uint32_t sequence, uint8_t *blob, size_t capacity)
+{
+    if (capacity < CONFIG_STORE_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    size_t payload_len = encode_payload(cfg, blob + CONFIG_STORE_HEADER_SIZE, capacity - CONFIG_STORE_HEADER_SIZE);
+    if (payload_len == 0)
+    {
+        return 0;
+    }
+
+    cursor_t c = {blob, CONFIG_STORE_HEADER_SIZE, 0, true};
+    put_u16(&c, CONFIG_STORE_MAGIC);
+    put_u8(&c, CONFIG_STORE_VERSION);
+    put_u8(&c, 0);
+    put_u32(&c, sequence);
+    put_u16(&c, payload_len);
+
+    uint32_t crc = esp_rom_crc32_le(0, blob, CONFIG_STORE_CRC_OFFSET);
+    crc = esp_rom_crc32_le(crc, blob + CONFIG_STORE_HEADER_SIZE, payload_len);
+    put_u32(&c, crc);
+    return CONFIG_STORE_HEADER_SIZE + payload_len;
+}
+
+static esp_err_t save(const app_config_t *cfg)
+{
+    if (!config_valid(cfg))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t blob[CONFIG_STORE_RECORD_MAX];
+    uint32_t sequence = s_sequence + 1;
+    size_t record_len = build_record(cfg, sequence, blob, sizeof(blob));
+    if (record_len == 0)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Never overwrite the slot that holds the current good record
+    int slot = s_active_slot == 0 ? 1 : 0;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "nvs_open failed (%s)", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, s_slot_keys[slot], blob, record_len);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Writing %s failed (%s)", s_slot_keys[slot], esp_err_to_name(err));
+        return err;
+    }
+
+    s_active_slot = slot;
+    s_sequence = sequence;
+    metrics_inc(METRICS_CONFIG_SAVES);
+    ESP_LOGI(TAG, "Saved configuration seq %" PRIu32 " to %s (%u bytes)",
+             sequence, s_slot_keys[slot], (unsigned)record_len);
+    return ESP_OK;
+}
+
+esp_err_t config_store_load(app_config_t *cfg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = load(cfg);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t config_store_save(const app_config_t *cfg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = save(cfg);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+size_t config_store_export(const app_config_t *cfg, uint8_t *record, size_t len)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t sequence = s_sequence;
+    xSemaphoreGive(s_lock);
+    return build_record(cfg, sequence, record, len);
+}
+
+esp_err_t config_store_import(const uint8_t *record, size_t len, app_config_t *cfg)
+{
+    uint8_t blob[CONFIG_STORE_RECORD_MAX];
+    uint8_t version;
+    uint32_t sequence;
+    size_t payload_len;
+
+    if (len > sizeof(blob))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Migrations work in place, so never on the caller's buffer
+    memcpy(blob, record, len);
+    if (!parse_record(blob, len, &version, &sequence, &payload_len))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    app_config_t imported;
+    config_store_defaults(&imported);
+    esp_err_t err = migrate_and_decode(blob + CONFIG_STORE_HEADER_SIZE, payload_len, version, &imported);
+    if (err == ESP_OK)
+    {
+        *cfg = imported;
+    }
+    return err;
+}
+
+esp_err_t config_store_erase(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CONFIG_STORE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        xSemaphoreGive(s_lock);
+        return err;
+    }
+
+    err = nvs_erase_all(handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    s_active_slot = -1;
+    s_sequence = 0;
+    xSemaphoreGive(s_lock);
+    return err;
+}
@@ -13,6 +13,9 @@
 #include "nvs.h"
 #include "esp_http_server.h"
 #include "http_server.h"
+#include "ota_update.h"
+#include "metrics.h"
+#include "coex_policy.h"
 
 static const char *TAG = "HTTP";
 
@@ -196,6 +199,7 @@ esp_err_t Image2Html(httpd_req_t *req, char *filename, char *type)
 static esp_err_t root_get_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, "root_get_handler req->uri=[%s]", req->uri);
+    coex_policy_note_ui_access(); // Keep Wi-Fi at full power while the UI is in use
 
     /* Send index.html */
     Text2Html(req, "/html/index.html");
@@ -218,6 +222,8 @@ static esp_err_t root_post_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, "root_post_handler req->uri=[%s]", req->uri);           // Log: Print the URI of the incoming POST request.
     URL_t urlBuf;                                                         // Define a structure to store URL information.
+    metrics_inc(METRICS_HTTP_POSTS);                                      // Count the settings post.
+    coex_policy_note_ui_access();                                         // Keep Wi-Fi at full power while the UI is in use.
     find_key_value("value=", (char *)req->uri, urlBuf.str_value);         // Extract the 'value' parameter from the URI.
     find_key_value("variable_id=", (char *)req->uri, urlBuf.variable_id); // Extract the 'variable_id' parameter from the URI.
 
@@ -307,6 +313,12 @@ esp_err_t start_server(const char *base_path, int port)
     };
     httpd_register_uri_handler(server, &_favicon_get_handler); // Register the handler for GET requests of the favicon.
 
+    /* URI handler for firmware uploads */
+    ota_register_handlers(server);
+
+    /* URI handler for runtime metrics */
+    metrics_register_handlers(server);
+
     return ESP_OK; // Return success status.
 }
 
@@ -1,5 +1,6 @@
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include <freertos/task.h>
 #include "esp_log.h"
 
@@ -8,37 +9,54 @@
 // #include "soft_access_point.h"
 #include "softap_sta.h"
 #include "BleGamepad.h"
+#include "BleHidMacro.h"
+#include "NimBLEDeferredLog.h"
+#include "config_store.h"
+#include "ota_update.h"
+#include "metrics.h"
+#include "coex_policy.h"
+#include "sensor_aggregator.h"
+#include "bulk_transfer.h"
+#include "telemetry_broadcast.h"
 
 // #include "Arduino.h"
 // static const char *TAG_AP = "WiFi SoftAP";
 // static const char *TAG_STA = "WiFi Sta";
 
-#define numOfButtons 14
-#define numOfHatSwitches 0
-#define enableX false
-#define enableY false
-#define enableZ false
-#define enableRX false
-#define enableRY false
-#define enableRZ false
-#define enableSlider1 false
-#define enableSlider2 false
-#define enableRudder false
-#define enableThrottle true
-#define enableAccelerator false
-#define enableBrake true
-#define enableSteering false
-
 BleGamepad bleGamepad("BLE Driving Controller", "test", 100);
 
 static const char *TAG = "example";
 
+#if CONFIG_COMPOSITE_HID_KEYBOARD
+// Played from its own task, started by the web UI (variable_id=macro) or the macro GPIO. Neither
+// they nor the gamepad report wait for it
+static BleHidMacro hidMacro;
+static const BleHidMacroStep macroSteps[] = {
+    {MACRO_KEY_TAP, 0, CONFIG_COMPOSITE_HID_MACRO_KEY, CONFIG_COMPOSITE_HID_MACRO_HOLD_MS},
+};
+#define MACRO_GPIO CONFIG_COMPOSITE_HID_MACRO_GPIO
+#else
+#define MACRO_GPIO -1
+#endif
+
 char variable_id_g[64] = "";
 char str_value_g[64] = "";
 int long_value_g = 0;
 
 char esp32_chip_series[64] = "ESP32_S3";
 
+// Persistent configuration, loaded from NVS at boot and saved whenever the web UI applies a change.
+// Only variable_id_web_sever_task changes it once the tasks run.
+app_config_t app_config;
+
+#if CONFIG_BULK_XFER_ENABLE
+// Configuration records from the companion, saved and applied by variable_id_web_sever_task
+// which answers on config_results
+#define CONFIG_UPDATE_TIMEOUT_MS 5000
+static QueueHandle_t config_updates;
+static QueueHandle_t config_results;
+#endif
+
 typedef struct
 {
     gpio_num_t *data;
@@ -84,11 +102,18 @@ extern "C" void variable_id_web_sever_task(void *pvParameters)
 
                 DynamicArray tempArray;
                 // DynamicArray tempArray;
-                initializeDynamicArray(&tempArray, 48); // Start with an initial size
+                initializeDynamicArray(&tempArray, CONFIG_STORE_MAX_GPIOS); // Room for the most GPIOs the store keeps
+                tempArray.size = 0;                                        // Nothing parsed yet
 
                 // Loop through the tokens
                 while (token != NULL)
                 {
+                    if (tempArray.size == CONFIG_STORE_MAX_GPIOS)
+                    {
+                        ESP_LOGW(TAG, "Only the first %d GPIOs are used", CONFIG_STORE_MAX_GPIOS);
+                        break;
+                    }
+
                     // Convert the token to an integer using atoi
                     uint8_t temp_int = atoi(token);
 
@@ -100,6 +125,14 @@ extern "C" void variable_id_web_sever_task(void *pvParameters)
                     token = strtok(NULL, delimiter);
                 }
 
+                if (tempArray.size == 0)
+                {
+                    ESP_LOGE(TAG, "No GPIOs in apply: %s", str_value_g);
+                    free(tempArray.data);
+                    strcpy(variable_id_last, variable_id_g);
+                    continue;
+                }
+
                 // For DynamicArray tempArray "local" scope
                 // Resize tempArray based on the actual number of elements
                 resizeDynamicArray(&tempArray, tempArray.size);
@@ -107,15 +140,22 @@ extern "C" void variable_id_web_sever_task(void *pvParameters)
                 // Now, assign the tempArray to gpios array
                 gpio_num_t temp_gpios[tempArray.size];
                 // memset(gpios, 0, sizeof(gpios));
-                memcpy(temp_gpios, tempArray.data, tempArray.size);
+                memcpy(temp_gpios, tempArray.data, tempArray.size * sizeof(gpio_num_t));
 
                 init_gpio(temp_gpios);
 
+                // Persist the parsed GPIO list, never more than CONFIG_STORE_MAX_GPIOS entries
+                app_config.gpio_count = tempArray.size;
+                for (size_t i = 0; i < app_config.gpio_count; i++)
+                {
+                    app_config.gpios[i] = (uint8_t)tempArray.data[i];
+                }
+                config_store_save(&app_config);
+
                 // For DynamicArray gpios "global" scope
                 // Resize gpios based on the actual number of elements
-                resizeDynamicArray(&gpios, gpios.size);
-                memset(gpios.data, 0, sizeof(gpios));
-                memcpy(gpios.data, tempArray.data, tempArray.size);
+                resizeDynamicArray(&gpios, tempArray.size);
+                memcpy(gpios.data, tempArray.data, tempArray.size * sizeof(gpio_num_t));
                 gpios.size = tempArray.size;
 
                 // Free the memory allocated for tempArray
@@ -125,8 +165,34 @@ extern "C" void variable_id_web_sever_task(void *pvParameters)
             {
                 strcpy(esp32_chip_series, str_value_g);
                 // update_chip_series();
+                strlcpy(app_config.chip_series, esp32_chip_series, sizeof(app_config.chip_series));
+                config_store_save(&app_config);
                 printf("esp32_chip_series: %s\n", esp32_chip_series);
             }
+            else if (strcmp(variable_id_g, "coex_policy") == 0)
+            {
+                int policy = atoi(str_value_g);
+                if (policy >= 0 && policy < COEX_POLICY_MAX)
+                {
+                    coex_policy_set((coex_policy_t)policy);
+                    app_config.coex_policy = (uint8_t)policy;
+                    config_store_save(&app_config);
+                }
+                else
+                {
+                    ESP_LOGE(TAG, "Invalid coex_policy: %s", str_value_g);
+                }
+            }
+#if CONFIG_COMPOSITE_HID_KEYBOARD
+            else if (strcmp(variable_id_g, "macro") == 0)
+            {
+                coex_policy_note_input();
+                hidMacro.run(macroSteps, sizeof(macroSteps) / sizeof(macroSteps[0]));
+
+                // An action, not a setting: forget it so the same request plays the macro again
+                variable_id_g[0] = '\0';
+            }
+#endif
             else
             {
                 // Handle the default case or log an error
@@ -135,7 +201,25 @@ extern "C" void variable_id_web_sever_task(void *pvParameters)
             }
             strcpy(variable_id_last, variable_id_g);
         }
+
+#if CONFIG_BULK_XFER_ENABLE
+        // Wakes at once for a configuration from the companion
+        app_config_t update;
+        if (xQueueReceive(config_updates, &update, 2000) == pdTRUE)
+        {
+            esp_err_t err = config_store_save(&update);
+            if (err == ESP_OK)
+            {
+                // The radio policy applies at once, the HID layout and GPIOs on the next boot
+                app_config = update;
+                strlcpy(esp32_chip_series, app_config.chip_series, sizeof(esp32_chip_series));
+                coex_policy_set((coex_policy_t)app_config.coex_policy);
+            }
+            xQueueOverwrite(config_results, &err);
+        }
+#else
         vTaskDelay(2000); // Adjust the delay based on your requirements
+#endif
     }
 }
 
@@ -157,9 +241,20 @@ extern "C" void button_task(void *arg)
                 vTaskDelay(pdMS_TO_TICKS(2));
                 if (gpio_get_level(gpios.data[i]) == 0)
                 {
-                    printf("GPIO: %d High\n", gpios.data[i]);
-                    bleGamepad.press(1);
-                    bleGamepad.sendReport();
+                    NIMBLE_DEFERRED_LOGI(TAG, "GPIO: %d High", gpios.data[i]);
+                    metrics_inc(METRICS_BUTTON_EVENTS);
+                    coex_policy_note_input();
+#if CONFIG_COMPOSITE_HID_KEYBOARD
+                    if (gpios.data[i] == MACRO_GPIO)
+                    {
+                        hidMacro.run(macroSteps, sizeof(macroSteps) / sizeof(macroSteps[0]));
+                    }
+                    else
+#endif
+                    {
+                        bleGamepad.press(1);
+                        bleGamepad.sendReport();
+                    }
                     pressed[i] = true;
                     vTaskDelay(pdMS_TO_TICKS(50)); // Adjust the delay according to your needs
                 }
@@ -167,8 +262,13 @@ extern "C" void button_task(void *arg)
             else if (gpio_get_level(gpios.data[i]) == 1 && pressed[i] == true)
             {
                 vTaskDelay(pdMS_TO_TICKS(2));
-                bleGamepad.release(1);
-                bleGamepad.sendReport();
+                metrics_inc(METRICS_BUTTON_EVENTS);
+                coex_policy_note_input();
+                if (gpios.data[i] != MACRO_GPIO)
+                {
+                    bleGamepad.release(1);
+                    bleGamepad.sendReport();
+                }
                 pressed[i] = false;
                 vTaskDelay(pdMS_TO_TICKS(50));
             }
@@ -195,7 +295,9 @@ extern "C" void button_matrix_task(void *arg)
                 vTaskDelay(pdMS_TO_TICKS(2));
                 if (gpio_get_level(gpios.data[i]) == 0)
                 {
-                    printf("GPIO: %d and GPIO: %d High\n", gpios.data[i], gpios.data[i + 1]);
+                    NIMBLE_DEFERRED_LOGI(TAG, "GPIO: %d and GPIO: %d High", gpios.data[i], gpios.data[i + 1]);
+                    metrics_inc(METRICS_BUTTON_EVENTS);
+                    coex_policy_note_input();
                     bleGamepad.press(1);
                     bleGamepad.sendReport();
                     pressed[i] = true;
@@ -205,6 +307,8 @@ extern "C" void button_matrix_task(void *arg)
             else if (gpio_get_level(gpios.data[i]) == 1 && gpio_get_level(gpios.data[i + 1]) == 1 && pressed[i] == true)
             {
                 vTaskDelay(pdMS_TO_TICKS(2));
+                metrics_inc(METRICS_BUTTON_EVENTS);
+                coex_policy_note_input();
                 bleGamepad.release(1);
                 bleGamepad.sendReport();
                 pressed[i] = false;
@@ -244,27 +348,290 @@ extern "C" void gpio_update(gpio_num_t gpios[])
 
 extern "C" void http_server_task_1(void *pvParameters);
 
+/**
+ * @brief Health check for a freshly updated image: BLE came up and is advertising or connected.
+ */
+static bool ble_gamepad_healthy(void)
+{
+    return bleGamepad.isAdvertising() || bleGamepad.isConnected();
+}
+
+/**
+ * @brief Host connection state for the coexistence policy.
+ */
+static bool ble_gamepad_connected(void)
+{
+    return bleGamepad.isConnected();
+}
+
+/**
+ * @brief Copies the stored gamepad settings into a BleGamepadConfiguration.
+ * @param cfg Configuration loaded from the config store.
+ * @param bleGamepadConfig Gamepad configuration to fill in before calling begin().
+ */
+static void apply_gamepad_config(const app_config_t *cfg, BleGamepadConfiguration *bleGamepadConfig)
+{
+    bleGamepadConfig->setAutoReport(cfg->auto_report);
+    bleGamepadConfig->setControllerType(cfg->controller_type); // CONTROLLER_TYPE_JOYSTICK, CONTROLLER_TYPE_GAMEPAD (DEFAULT), CONTROLLER_TYPE_MULTI_AXIS
+    bleGamepadConfig->setHidReportId(cfg->hid_report_id);
+    bleGamepadConfig->setButtonCount(cfg->button_count);
+    bleGamepadConfig->setHatSwitchCount(cfg->hat_switch_count);
+
+#define CFG_BIT(mask, bit) (((mask) >> (bit)) & 1)
+    bleGamepadConfig->setWhichSpecialButtons(CFG_BIT(cfg->special_buttons, START_BUTTON), CFG_BIT(cfg->special_buttons, SELECT_BUTTON),
+                                             CFG_BIT(cfg->special_buttons, MENU_BUTTON), CFG_BIT(cfg->special_buttons, HOME_BUTTON),
+                                             CFG_BIT(cfg->special_buttons, BACK_BUTTON), CFG_BIT(cfg->special_buttons, VOLUME_INC_BUTTON),
+                                             CFG_BIT(cfg->special_buttons, VOLUME_DEC_BUTTON), CFG_BIT(cfg->special_buttons, VOLUME_MUTE_BUTTON));
+    bleGamepadConfig->setWhichAxes(CFG_BIT(cfg->axes, X_AXIS), CFG_BIT(cfg->axes, Y_AXIS), CFG_BIT(cfg->axes, Z_AXIS),
+                                   CFG_BIT(cfg->axes, RX_AXIS), CFG_BIT(cfg->axes, RY_AXIS), CFG_BIT(cfg->axes, RZ_AXIS),
+                                   CFG_BIT(cfg->axes, SLIDER1), CFG_BIT(cfg->axes, SLIDER2));
+    bleGamepadConfig->setWhichSimulationControls(CFG_BIT(cfg->simulation_controls, RUDDER), CFG_BIT(cfg->simulation_controls, THROTTLE),
+                                                 CFG_BIT(cfg->simulation_controls, ACCELERATOR), CFG_BIT(cfg->simulation_controls, BRAKE),
+                                                 CFG_BIT(cfg->simulation_controls, STEERING));
+#undef CFG_BIT
+
+    bleGamepadConfig->setVid(cfg->vid);
+    bleGamepadConfig->setPid(cfg->pid);
+    // Some non-Windows operating systems and web based gamepad testers don't like min axis set below 0, so 0 is set by default
+    bleGamepadConfig->setAxesMin(cfg->axes_min);
+    bleGamepadConfig->setAxesMax(cfg->axes_max);
+    bleGamepadConfig->setSimulationMin(cfg->simulation_min);
+    bleGamepadConfig->setSimulationMax(cfg->simulation_max);
+
+#if CONFIG_COMPOSITE_HID_KEYBOARD
+    bleGamepadConfig->setIncludeKeyboard(true);
+#endif
+#if CONFIG_COMPOSITE_HID_CONSUMER
+    bleGamepadConfig->setIncludeConsumer(true);
+#endif
+
+#if CONFIG_SENSOR_AGG_ENABLE
+    // The aggregator owns the report: it sends one per merged update, see sensor_aggregator.h
+    bleGamepadConfig->setAutoReport(false);
+    if (strlen(CONFIG_SENSOR_AGG_PEDAL_SERVICE_UUID) > 0)
+    {
+        // The pedal drives the brake, which must be in the descriptor
+        bleGamepadConfig->setIncludeBrake(true);
+    }
+#endif
+}
+
+#if CONFIG_SENSOR_AGG_ENABLE
+/**
+ * @brief Starts merging the wireless pedal and shifter configured in menuconfig into the gamepad.
+ * @param cfg Configuration loaded from the config store, for the simulation control range.
+ */
+static void start_sensor_aggregator(const app_config_t *cfg)
+{
+    static sensor_config_t sensors[2];
+    uint8_t count = 0;
+
+    if (strlen(CONFIG_SENSOR_AGG_PEDAL_SERVICE_UUID) > 0)
+    {
+        sensor_config_t *pedal = &sensors[count++];
+        pedal->name = "pedal";
+        pedal->service_uuid = CONFIG_SENSOR_AGG_PEDAL_SERVICE_UUID;
+        pedal->characteristic_uuid = CONFIG_SENSOR_AGG_PEDAL_CHAR_UUID;
+        pedal->map.format = SENSOR_FORMAT_U16_LE;
+        pedal->map.axis = 8 + BRAKE;
+        pedal->map.raw_min = 0;
+        pedal->map.raw_max = CONFIG_SENSOR_AGG_PEDAL_RAW_MAX;
+        pedal->map.out_min = cfg->simulation_min;
+        pedal->map.out_max = cfg->simulation_max;
+        pedal->map.raw_rest = 0;
+    }
+
+    if (strlen(CONFIG_SENSOR_AGG_SHIFTER_SERVICE_UUID) > 0)
+    {
+        sensor_config_t *shifter = &sensors[count++];
+        shifter->name = "shifter";
+        shifter->service_uuid = CONFIG_SENSOR_AGG_SHIFTER_SERVICE_UUID;
+        shifter->characteristic_uuid = CONFIG_SENSOR_AGG_SHIFTER_CHAR_UUID;
+        shifter->map.format = SENSOR_FORMAT_U8;
+        shifter->map.axis = SENSOR_MERGE_BUTTONS;
+        shifter->map.first_button = CONFIG_SENSOR_AGG_SHIFTER_FIRST_BUTTON;
+        shifter->map.button_count = 8;
+    }
+
+    esp_err_t err = sensor_aggregator_start(sensors, count);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Sensor aggregator not started (%s)", esp_err_to_name(err));
+    }
+}
+#endif
+
+#if CONFIG_BULK_XFER_ENABLE
+// Resource content as of OPEN_GET, so a transfer never mixes two versions
+static uint8_t bulk_snapshot[CONFIG_STORE_RECORD_MAX];
+static_assert(sizeof(bulk_snapshot) >= COEX_MODE_MAX * sizeof(coex_mode_stats_t), "Latency statistics do not fit the snapshot");
+static size_t bulk_snapshot_len;
+
+/**
+ * @brief Copies the part of the snapshot taken at offset 0 that starts at offset.
+ */
+static size_t read_snapshot(uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (offset >= bulk_snapshot_len)
+    {
+        return 0;
+    }
+    if (len > bulk_snapshot_len - offset)
+    {
+        len = bulk_snapshot_len - offset;
+    }
+    memcpy(buf, bulk_snapshot + offset, len);
+    return len;
+}
+
+static size_t read_config(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    if (offset == 0)
+    {
+        // The stored record, app_config belongs to the web UI task
+        app_config_t cfg;
+        esp_err_t err = config_store_load(&cfg);
+        if (err != ESP_OK && err != ESP_ERR_NOT_FOUND)
+        {
+            // Not the defaults, the companion would take them for the stored record
+            bulk_snapshot_len = 0;
+            return 0;
+        }
+        bulk_snapshot_len = config_store_export(&cfg, bulk_snapshot, sizeof(bulk_snapshot));
+    }
+    return read_snapshot(offset, buf, len);
+}
+
+static bulk_status_t write_config(const uint8_t *data, size_t len, void *ctx)
+{
+    app_config_t cfg;
+    esp_err_t err = config_store_import(data, len, &cfg);
+    if (err == ESP_OK)
+    {
+        // A result left by an update that timed out is stale
+        xQueueReset(config_results);
+        xQueueOverwrite(config_updates, &cfg);
+        if (xQueueReceive(config_results, &err, pdMS_TO_TICKS(CONFIG_UPDATE_TIMEOUT_MS)) != pdTRUE)
+        {
+            err = ESP_ERR_TIMEOUT;
+        }
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Configuration from the companion rejected (%s)", esp_err_to_name(err));
+        return BULK_STATUS_WRITE_FAILED;
+    }
+
+    ESP_LOGI(TAG, "Configuration from the companion saved, restart to apply the gamepad layout");
+    return BULK_STATUS_OK;
+}
+
+static size_t read_latency(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    if (offset == 0)
+    {
+        uint8_t *p = bulk_snapshot;
+        for (int mode = 0; mode < COEX_MODE_MAX; mode++)
+        {
+            coex_mode_stats_t stats;
+            coex_policy_get_stats((coex_mode_t)mode, &stats);
+            const uint32_t fields[5] = {stats.samples, stats.mean_us, stats.max_us, stats.jitter_us, stats.time_ms};
+            for (uint32_t field : fields)
+            {
+                *p++ = field;
+                *p++ = field >> 8;
+                *p++ = field >> 16;
+                *p++ = field >> 24;
+            }
+        }
+        bulk_snapshot_len = p - bulk_snapshot;
+    }
+    return read_snapshot(offset, buf, len);
+}
+
+#if CONFIG_NIMBLE_CPP_LOG_DEFERRED && !CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT
+static size_t read_log(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    // The SDU may be smaller than a record: records are drained into a buffer that holds the
+    // largest one and handed out in SDU sized pieces. Drained, so a second GET returns what was
+    // logged since; what an abandoned GET left staged is sent first.
+    static uint8_t staged[NimBLEDeferredLog::RECORD_MAX];
+    static size_t staged_len;
+    static size_t staged_pos;
+
+    if (staged_pos == staged_len)
+    {
+        staged_len = NimBLEDeferredLog::dump(staged, sizeof(staged));
+        staged_pos = 0;
+    }
+
+    size_t n = staged_len - staged_pos < len ? staged_len - staged_pos : len;
+    memcpy(buf, staged + staged_pos, n);
+    staged_pos += n;
+    return n;
+}
+#endif
+
+/**
+ * @brief Serves the configuration, latency statistics and deferred log over L2CAP.
+ */
+static void start_bulk_transfer(void)
+{
+    static const bulk_resource_t resources[] = {
+        {BULK_RESOURCE_CONFIG, CONFIG_STORE_RECORD_MAX, read_config, write_config, NULL},
+        {BULK_RESOURCE_LATENCY, 0, read_latency, NULL, NULL},
+#if CONFIG_NIMBLE_CPP_LOG_DEFERRED && !CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT
+        {BULK_RESOURCE_LOG, 0, read_log, NULL, NULL},
+#endif
+    };
+
+    // Static, the web UI task is started later and relies on them
+    static StaticQueue_t updates_queue, results_queue;
+    static uint8_t updates_storage[sizeof(app_config_t)], results_storage[sizeof(esp_err_t)];
+    config_updates = xQueueCreateStatic(1, sizeof(app_config_t), updates_storage, &updates_queue);
+    config_results = xQueueCreateStatic(1, sizeof(esp_err_t), results_storage, &results_queue);
+
+    esp_err_t err = bulk_transfer_start(resources, sizeof(resources) / sizeof(resources[0]));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Bulk transfer not started (%s)", esp_err_to_name(err));
+    }
+}
+#endif
+
 extern "C" void app_main(void)
 {
     printf("Starting BLE work!");
 
-    // Setup controller with 10 buttons, accelerator, brake and steering
+    // Initialize NVS
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Load the stored configuration (falls back to defaults on first boot)
+    config_store_load(&app_config);
+    strlcpy(esp32_chip_series, app_config.chip_series, sizeof(esp32_chip_series));
+
     BleGamepadConfiguration bleGamepadConfig;
-    bleGamepadConfig.setAutoReport(false);
-    bleGamepadConfig.setControllerType(CONTROLLER_TYPE_JOYSTICK); // CONTROLLER_TYPE_JOYSTICK, CONTROLLER_TYPE_GAMEPAD (DEFAULT), CONTROLLER_TYPE_MULTI_AXIS
-    bleGamepadConfig.setButtonCount(numOfButtons);
-    bleGamepadConfig.setWhichAxes(enableX, enableY, enableZ, enableRX, enableRY, enableRZ, enableSlider1, enableSlider2);      // Can also be done per-axis individually. All are true by default
-    bleGamepadConfig.setWhichSimulationControls(enableRudder, enableThrottle, enableAccelerator, enableBrake, enableSteering); // Can also be done per-control individually. All are false by default
-    bleGamepadConfig.setHatSwitchCount(numOfHatSwitches);                                                                      // 1 by default
-    // Some non-Windows operating systems and web based gamepad testers don't like min axis set below 0, so 0 is set by default
-    bleGamepadConfig.setAxesMin(0x0000); // -32767 --> int16_t - 16 bit signed integer - Can be in decimal or hexadecimal
-    bleGamepadConfig.setAxesMax(0x7FFF); // 32767 --> int16_t - 16 bit signed integer - Can be in decimal or hexadecimal
-    bleGamepadConfig.setSimulationMin(0x0000);
-    bleGamepadConfig.setSimulationMax(0x0FFF);
+    apply_gamepad_config(&app_config, &bleGamepadConfig);
 
     bleGamepad.begin(&bleGamepadConfig);
     // changing bleGamepadConfig after the begin function has no effect, unless you call the begin function again
 
+#if CONFIG_COMPOSITE_HID_KEYBOARD
+    hidMacro.begin(&bleGamepad, bleGamepadConfig.getAutoReport());
+#endif
+
+    // Measure notification latency per Wi-Fi mode
+    bleGamepad.getConnectionStatus()->notifyLatencyCallback = coex_policy_record_notify_latency;
+
+    // Roll back to the previous firmware if an updated image cannot bring BLE up
+    ota_start_rollback_check(ble_gamepad_healthy, CONFIG_OTA_VERIFY_TIMEOUT_MS);
+
     // Set accelerator and brake to min
     // bleGamepad.setAccelerator(-32767);
     // bleGamepad.setBrake(-32767);
@@ -275,19 +642,41 @@ extern "C" void app_main(void)
     // Set steering to center
     // bleGamepad.setSteering(0);
 
+    // The services below use the host and the gamepad's advertising instance. If the setup never
+    // finishes, the rollback check above restores the previous image.
+    bleGamepad.waitForStart();
+
+#if CONFIG_SENSOR_AGG_ENABLE
+    // The aggregator sends the reports from now on, see sensor_aggregator.h
+    start_sensor_aggregator(&app_config);
+#endif
+
+#if CONFIG_BULK_XFER_ENABLE
+    start_bulk_transfer();
+#endif
+
+#if CONFIG_TELEMETRY_BCAST_ENABLE
+    // Pedals and shifter for overlays and loggers, without a connection
+    esp_err_t err = telemetry_broadcast_start();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Telemetry broadcast not started (%s)", esp_err_to_name(err));
+    }
+#endif
+
     // adc_init();
     // init_gpio(gpios);
 
-    // DynamicArray tempArray;
-    initializeDynamicArray(&gpios, 1); // Start with an initial size
-
-    // Now, assign the tempArray to gpios array
-    gpio_num_t temp_gpios_main[gpios.size] = {GPIO_NUM_0};
-    // memset(gpios, 0, sizeof(gpios));
-    memcpy(temp_gpios_main, gpios.data, gpios.size);
+    // Restore the stored GPIO list
+    initializeDynamicArray(&gpios, CONFIG_STORE_MAX_GPIOS);
+    gpios.size = 0;
+    for (uint8_t i = 0; i < app_config.gpio_count; i++)
+    {
+        addToDynamicArray(&gpios, (gpio_num_t)app_config.gpios[i]);
+    }
 
-    // Free the memory allocated for tempArray
-    // free(gpios.data);
+    gpio_num_t temp_gpios_main[CONFIG_STORE_MAX_GPIOS] = {GPIO_NUM_0};
+    memcpy(temp_gpios_main, gpios.data, gpios.size * sizeof(gpio_num_t));
 
     init_gpio(temp_gpios_main);
 
@@ -297,15 +686,6 @@ extern "C" void app_main(void)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
-    {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-
     /* Initialize event group */
     s_wifi_event_group = xEventGroupCreate();
 
@@ -405,6 +785,9 @@ extern "C" void app_main(void)
     // xTaskCreate(printVariablesTask, "PrintVariablesTask", 4096, NULL, 1, NULL);
     xTaskCreate(variable_id_web_sever_task, "variable_id_web_sever_task", 4096, NULL, 1, NULL);
 
+    // Back Wi-Fi off while the gamepad is in active use
+    coex_policy_start((coex_policy_t)app_config.coex_policy, ble_gamepad_connected);
+
     // Wait for the task to start, because cparam0 is discarded.
     vTaskDelay(10);
 }
\ No newline at end of file
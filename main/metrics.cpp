@@ -0,0 +1,389 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "os/os_mbuf.h"
+
+#include "metrics.h"
+#include "coex_policy.h"
+#include "BleGamepad.h"
+#include "NimBLEDeferredLog.h"
+
+static const char *TAG = "METRICS";
+
+extern BleGamepad bleGamepad;
+
+uint32_t metrics_counters[METRICS_COUNTER_MAX];
+
+static const char *s_counter_names[METRICS_COUNTER_MAX] = {
+    "button_events",
+    "http_posts",
+    "config_saves",
+};
+
+/**
+ * @brief Streams formatted output to the client in HTTP chunks.
+ */
+typedef struct
+{
+    httpd_req_t *req;
+    bool json;
+    bool first; // No comma before the first element of a JSON array/object
+} metrics_writer_t;
+
+static void emit(metrics_writer_t *w, const char *fmt, ...)
+{
+    char line[160];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (len > 0)
+    {
+        httpd_resp_send_chunk(w->req, line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+    }
+}
+
+/**
+ * @brief Emits one sample, either as a Prometheus line or as a JSON member.
+ * @param name Metric name without the gamepad_ prefix.
+ * @param label Optional label in Prometheus form (key="value"), NULL for none.
+ * @param value Sample value.
+ */
+static void emit_u32(metrics_writer_t *w, const char *name, const char *label, uint32_t value)
+{
+    if (w->json)
+    {
+        emit(w, "%s\"%s\":%" PRIu32, w->first ? "" : ",", name, value);
+        w->first = false;
+    }
+    else if (label)
+    {
+        emit(w, "gamepad_%s{%s} %" PRIu32 "\n", name, label, value);
+    }
+    else
+    {
+        emit(w, "gamepad_%s %" PRIu32 "\n", name, value);
+    }
+}
+
+static void emit_type(metrics_writer_t *w, const char *name, const char *type)
+{
+    if (!w->json)
+    {
+        emit(w, "# TYPE gamepad_%s %s\n", name, type);
+    }
+}
+
+static void emit_object_start(metrics_writer_t *w, const char *name)
+{
+    if (w->json)
+    {
+        emit(w, "%s\"%s\":{", w->first ? "" : ",", name);
+        w->first = true;
+    }
+}
+
+static void emit_object_end(metrics_writer_t *w)
+{
+    if (w->json)
+    {
+        emit(w, "}");
+        w->first = false;
+    }
+}
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+static uint32_t task_share(const TaskStatus_t *task, uint64_t capacity_runtime)
+{
+    return capacity_runtime ? (uint32_t)((uint64_t)task->ulRunTimeCounter * 10000 / capacity_runtime) : 0;
+}
+#endif
+
+/**
+ * @brief Per-task CPU share and stack high-water marks.
+ *
+ * CPU share is the fraction of total CPU time (all cores) used since boot, in hundredths of a percent.
+ */
+static void write_tasks(metrics_writer_t *w)
+{
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 2; // Headroom for tasks created while we allocate
+    TaskStatus_t *tasks = (TaskStatus_t *)malloc(capacity * sizeof(TaskStatus_t));
+    if (tasks == NULL)
+    {
+        ESP_LOGE(TAG, "No memory for %u task entries", (unsigned)capacity);
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE total_runtime = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks, capacity, &total_runtime);
+    uint64_t capacity_runtime = (uint64_t)total_runtime * portNUM_PROCESSORS;
+
+    if (w->json)
+    {
+        emit(w, "%s\"tasks\":[", w->first ? "" : ",");
+        for (UBaseType_t i = 0; i < count; i++)
+        {
+            emit(w, "%s{\"name\":\"%s\",\"runtime\":%" PRIu32 ",\"cpu\":%" PRIu32 ",\"stack_free\":%" PRIu32 "}",
+                 i == 0 ? "" : ",", tasks[i].pcTaskName, (uint32_t)tasks[i].ulRunTimeCounter,
+                 task_share(&tasks[i], capacity_runtime), (uint32_t)tasks[i].usStackHighWaterMark);
+        }
+    }
+    else
+    {
+        // Prometheus wants all samples of a family together, right after its # TYPE line
+        static const struct
+        {
+            const char *name;
+            const char *type;
+        } families[] = {
+            {"task_runtime_total", "counter"},
+            {"task_cpu_share_centipercent", "gauge"},
+            {"task_stack_free_bytes", "gauge"},
+        };
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++)
+        {
+            emit_type(w, families[f].name, families[f].type);
+            for (UBaseType_t i = 0; i < count; i++)
+            {
+                uint32_t value = f == 0   ? (uint32_t)tasks[i].ulRunTimeCounter
+                                 : f == 1 ? task_share(&tasks[i], capacity_runtime)
+                                          : (uint32_t)tasks[i].usStackHighWaterMark;
+                char label[48];
+                snprintf(label, sizeof(label), "task=\"%s\"", tasks[i].pcTaskName);
+                emit_u32(w, families[f].name, label, value);
+            }
+        }
+    }
+
+    if (w->json)
+    {
+        emit(w, "]");
+        w->first = false;
+    }
+
+    free(tasks);
+#else
+    ESP_LOGW(TAG, "Enable CONFIG_FREERTOS_USE_TRACE_FACILITY for per-task metrics");
+#endif
+}
+
+static void write_heap(metrics_writer_t *w)
+{
+    emit_object_start(w, "heap");
+    emit_type(w, "heap_free_bytes", "gauge");
+    emit_u32(w, w->json ? "free" : "heap_free_bytes", "caps=\"default\"", heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    emit_u32(w, w->json ? "internal_free" : "heap_free_bytes", "caps=\"internal\"", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    emit_u32(w, w->json ? "psram_free" : "heap_free_bytes", "caps=\"spiram\"", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    emit_u32(w, w->json ? "min_free" : "heap_minimum_free_bytes", NULL, heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+    emit_type(w, "heap_largest_free_block_bytes", "gauge");
+    emit_u32(w, w->json ? "largest" : "heap_largest_free_block_bytes", "caps=\"default\"", heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+    emit_u32(w, w->json ? "internal_largest" : "heap_largest_free_block_bytes", "caps=\"internal\"", heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+    emit_u32(w, w->json ? "psram_largest" : "heap_largest_free_block_bytes", "caps=\"spiram\"", heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+    emit_object_end(w);
+}
+
+static void write_ble(metrics_writer_t *w)
+{
+    BleConnectionStatus *status = bleGamepad.getConnectionStatus();
+
+    emit_object_start(w, "msys");
+    emit_u32(w, w->json ? "total" : "msys_mbufs_total", NULL, os_msys_count());
+    emit_u32(w, w->json ? "free" : "msys_mbufs_free", NULL, os_msys_num_free());
+    emit_object_end(w);
+
+    emit_object_start(w, "ble");
+    emit_u32(w, w->json ? "connected" : "ble_connected", NULL, bleGamepad.isConnected());
+    emit_type(w, "ble_notify_total", "counter");
+    emit_u32(w, w->json ? "notify_ok" : "ble_notify_total", "result=\"success\"", status->notifySuccessCount.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "notify_fail" : "ble_notify_total", "result=\"failure\"", status->notifyFailureCount.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "conn_interval" : "ble_conn_interval_1250us", NULL, status->connInterval.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "conn_latency" : "ble_conn_latency", NULL, status->connLatency.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "conn_timeout" : "ble_conn_timeout_10ms", NULL, status->connTimeout.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "mtu" : "ble_mtu", NULL, status->mtu.load(std::memory_order_relaxed));
+    emit_u32(w, w->json ? "setup_stack_used" : "ble_setup_stack_used_bytes", NULL, bleGamepad.getSetupStackUsed());
+    emit_object_end(w);
+}
+
+/**
+ * @brief Coexistence policy and notification latency/jitter measured under each Wi-Fi mode.
+ */
+static void write_coex(metrics_writer_t *w)
+{
+    coex_policy_t policy = coex_policy_get();
+    coex_mode_t mode = coex_policy_get_mode();
+
+    coex_mode_stats_t stats[COEX_MODE_MAX];
+    for (int m = 0; m < COEX_MODE_MAX; m++)
+    {
+        coex_policy_get_stats((coex_mode_t)m, &stats[m]);
+    }
+
+    if (w->json)
+    {
+        emit(w, "%s\"coex\":{\"policy\":\"%s\",\"mode\":\"%s\",\"modes\":{", w->first ? "" : ",",
+             coex_policy_name(policy), coex_mode_name(mode));
+        for (int m = 0; m < COEX_MODE_MAX; m++)
+        {
+            emit(w, "%s\"%s\":{\"samples\":%" PRIu32 ",\"latency_us\":%" PRIu32 ",\"max_us\":%" PRIu32 ",\"jitter_us\":%" PRIu32 ",\"time_ms\":%" PRIu32 "}",
+                 m == 0 ? "" : ",", coex_mode_name((coex_mode_t)m), stats[m].samples, stats[m].mean_us, stats[m].max_us,
+                 stats[m].jitter_us, stats[m].time_ms);
+        }
+    }
+    else
+    {
+        char label[48];
+        snprintf(label, sizeof(label), "policy=\"%s\",mode=\"%s\"", coex_policy_name(policy), coex_mode_name(mode));
+        emit_type(w, "coex_info", "gauge");
+        emit_u32(w, "coex_info", label, 1);
+
+        // One family at a time, each after its own # TYPE line
+        static const struct
+        {
+            const char *name;
+            const char *type;
+            uint32_t coex_mode_stats_t::*field;
+        } families[] = {
+            {"coex_notify_samples_total", "counter", &coex_mode_stats_t::samples},
+            {"coex_notify_latency_us", "gauge", &coex_mode_stats_t::mean_us},
+            {"coex_notify_latency_max_us", "gauge", &coex_mode_stats_t::max_us},
+            {"coex_notify_jitter_us", "gauge", &coex_mode_stats_t::jitter_us},
+            {"coex_mode_time_ms_total", "counter", &coex_mode_stats_t::time_ms},
+        };
+        for (size_t f = 0; f < sizeof(families) / sizeof(families[0]); f++)
+        {
+            emit_type(w, families[f].name, families[f].type);
+            for (int m = 0; m < COEX_MODE_MAX; m++)
+            {
+                snprintf(label, sizeof(label), "mode=\"%s\"", coex_mode_name((coex_mode_t)m));
+                emit_u32(w, families[f].name, label, stats[m].*families[f].field);
+            }
+        }
+    }
+
+    if (w->json)
+    {
+        emit(w, "}}");
+        w->first = false;
+    }
+}
+
+static void write_counters(metrics_writer_t *w)
+{
+    emit_object_start(w, "counters");
+    for (int i = 0; i < METRICS_COUNTER_MAX; i++)
+    {
+        uint32_t value = __atomic_load_n(&metrics_counters[i], __ATOMIC_RELAXED);
+        if (w->json)
+        {
+            emit_u32(w, s_counter_names[i], NULL, value);
+        }
+        else
+        {
+            char name[48];
+            snprintf(name, sizeof(name), "%s_total", s_counter_names[i]);
+            emit_type(w, name, "counter");
+            emit_u32(w, name, NULL, value);
+        }
+    }
+    emit_object_end(w);
+}
+
+/**
+ * @brief HTTP GET handler for /metrics.
+ * @param req HTTP request structure.
+ * @return ESP_OK if successful, otherwise ESP_FAIL.
+ */
+static esp_err_t metrics_get_handler(httpd_req_t *req)
+{
+    metrics_writer_t w = {req, false, true};
+
+    char query[32];
+    char format[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "format", format, sizeof(format)) == ESP_OK)
+    {
+        w.json = strcmp(format, "json") == 0;
+    }
+
+    httpd_resp_set_type(req, w.json ? "application/json" : "text/plain; version=0.0.4");
+
+    if (w.json)
+    {
+        emit(&w, "{");
+    }
+    emit_u32(&w, "uptime_ms", NULL, (uint32_t)(esp_timer_get_time() / 1000));
+    write_tasks(&w);
+    write_heap(&w);
+    write_ble(&w);
+    write_coex(&w);
+    write_counters(&w);
+    if (w.json)
+    {
+        emit(&w, "}");
+    }
+
+    /* Send empty chunk to signal HTTP response completion */
+    httpd_resp_sendstr_chunk(req, NULL);
+    return ESP_OK;
+}
+
+#if CONFIG_NIMBLE_CPP_LOG_DEFERRED && !CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT
+/**
+ * @brief HTTP GET handler for /log, streams the pending deferred log records in the dump layout.
+ * Decode with components/esp-nimble-cpp/tools/decode_deferred_log.py and the application ELF.
+ * @param req HTTP request structure.
+ * @return ESP_OK if successful, otherwise ESP_FAIL.
+ */
+static esp_err_t log_get_handler(httpd_req_t *req)
+{
+    uint8_t chunk[512];
+    static_assert(sizeof(chunk) >= NimBLEDeferredLog::RECORD_MAX, "A record must fit one chunk");
+    size_t len;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    while ((len = NimBLEDeferredLog::dump(chunk, sizeof(chunk))) > 0)
+    {
+        if (httpd_resp_send_chunk(req, (const char *)chunk, len) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+    }
+
+    /* Send empty chunk to signal HTTP response completion */
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+#endif
+
+extern "C" esp_err_t metrics_register_handlers(httpd_handle_t server)
+{
+    /* URI handler for metrics */
+    httpd_uri_t _metrics_get_handler = {
+        .uri = "/metrics",              // URI path for the metrics handler.
+        .method = HTTP_GET,             // Handler for GET requests.
+        .handler = metrics_get_handler, // Function pointer to the handler for GET requests.
+        .user_ctx = NULL,
+    };
+#if CONFIG_NIMBLE_CPP_LOG_DEFERRED && !CONFIG_NIMBLE_CPP_LOG_DEFERRED_PRINT
+    /* URI handler for the deferred log dump */
+    httpd_uri_t _log_get_handler = {
+        .uri = "/log",
+        .method = HTTP_GET,
+        .handler = log_get_handler,
+        .user_ctx = NULL,
+    };
+    httpd_register_uri_handler(server, &_log_get_handler);
+#endif
+    return httpd_register_uri_handler(server, &_metrics_get_handler);
+}
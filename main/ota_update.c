@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <mbedtls/sha256.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_system.h"
+#include "esp_ota_ops.h"
+#include "esp_http_server.h"
+#include "ota_update.h"
+
+static const char *TAG = "OTA";
+
+// Priority the upload runs at, below the input tasks so flash writes never delay a button report
+#define OTA_UPLOAD_PRIORITY 1
+
+// Consecutive receive timeouts before the upload is given up, so a stalled client cannot hold the OTA slot
+#define OTA_RECV_TIMEOUT_RETRIES 5
+
+// Only one upload can be in flight (httpd serves requests from a single task), so the chunk buffer is static
+static char s_ota_buffer[CONFIG_OTA_RECV_BUFFER_SIZE];
+
+typedef struct
+{
+    ota_health_check_t is_healthy;
+    uint32_t timeout_ms;
+} rollback_check_t;
+
+static rollback_check_t s_rollback_check;
+
+/**
+ * @brief Converts a 64 character hex string into a 32 byte digest.
+ * @return true if the string was well formed.
+ */
+static bool parse_sha256_hex(const char *hex, uint8_t *digest)
+{
+    if (strlen(hex) != 64)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 32; i++)
+    {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1)
+        {
+            return false;
+        }
+        digest[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends an error response and logs the reason.
+ * @return ESP_FAIL, so handlers can return it directly.
+ */
+static esp_err_t ota_fail(httpd_req_t *req, httpd_err_code_t code, const char *msg)
+{
+    ESP_LOGE(TAG, "%s", msg);
+    httpd_resp_send_err(req, code, msg);
+    return ESP_FAIL;
+}
+
+/**
+ * @brief HTTP POST handler for the firmware image.
+ * @param req HTTP request structure.
+ * @return ESP_OK if successful, otherwise ESP_FAIL.
+ */
+static esp_err_t ota_post_handler(httpd_req_t *req)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    if (update == NULL)
+    {
+        return ota_fail(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No OTA partition available");
+    }
+    if (req->content_len == 0 || req->content_len > update->size)
+    {
+        return ota_fail(req, HTTPD_400_BAD_REQUEST, "Image size does not fit the OTA partition");
+    }
+
+    uint8_t expected[32];
+    bool have_expected = false;
+    char hex[65];
+    if (httpd_req_get_hdr_value_str(req, "X-Image-SHA256", hex, sizeof(hex)) == ESP_OK)
+    {
+        if (!parse_sha256_hex(hex, expected))
+        {
+            return ota_fail(req, HTTPD_400_BAD_REQUEST, "Malformed X-Image-SHA256 header");
+        }
+        have_expected = true;
+    }
+
+    ESP_LOGI(TAG, "Writing %d bytes from %s to %s", req->content_len, running->label, update->label);
+
+    // Sequential writes erase sector by sector, instead of blocking for the whole partition erase up front
+    esp_ota_handle_t ota_handle;
+    esp_err_t err = esp_ota_begin(update, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+    if (err != ESP_OK)
+    {
+        return ota_fail(req, HTTPD_500_INTERNAL_SERVER_ERROR, "esp_ota_begin failed");
+    }
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, OTA_UPLOAD_PRIORITY);
+
+    size_t remaining = req->content_len;
+    int timeouts = 0;
+    while (remaining > 0)
+    {
+        int received = httpd_req_recv(req, s_ota_buffer, remaining < sizeof(s_ota_buffer) ? remaining : sizeof(s_ota_buffer));
+        if (received == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= OTA_RECV_TIMEOUT_RETRIES)
+        {
+            continue; // Retry on timeout
+        }
+        if (received == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            ESP_LOGE(TAG, "Upload stalled, %d bytes left", (int)remaining);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        timeouts = 0;
+        if (received <= 0)
+        {
+            err = ESP_FAIL;
+            break;
+        }
+
+        mbedtls_sha256_update(&sha, (const unsigned char *)s_ota_buffer, received);
+        err = esp_ota_write(ota_handle, s_ota_buffer, received);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        remaining -= received;
+
+        // Give equal and lower priority tasks a turn between chunks
+        taskYIELD();
+    }
+
+    vTaskPrioritySet(NULL, priority);
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (err != ESP_OK)
+    {
+        esp_ota_abort(ota_handle);
+        return ota_fail(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Receiving or writing the image failed");
+    }
+
+    if (have_expected && memcmp(digest, expected, sizeof(digest)) != 0)
+    {
+        esp_ota_abort(ota_handle);
+        return ota_fail(req, HTTPD_400_BAD_REQUEST, "SHA-256 mismatch");
+    }
+
+    // esp_ota_end() validates the image header, segments and the appended image hash
+    err = esp_ota_end(ota_handle);
+    if (err != ESP_OK)
+    {
+        return ota_fail(req, HTTPD_400_BAD_REQUEST, err == ESP_ERR_OTA_VALIDATE_FAILED ? "Image validation failed" : "esp_ota_end failed");
+    }
+
+    err = esp_ota_set_boot_partition(update);
+    if (err != ESP_OK)
+    {
+        return ota_fail(req, HTTPD_500_INTERNAL_SERVER_ERROR, "esp_ota_set_boot_partition failed");
+    }
+
+    ESP_LOGI(TAG, "Update written to %s, restarting", update->label);
+    httpd_resp_sendstr(req, "update successful, restarting");
+
+    vTaskDelay(pdMS_TO_TICKS(500)); // Let the response go out
+    esp_restart();
+    return ESP_OK;
+}
+
+esp_err_t ota_register_handlers(httpd_handle_t server)
+{
+    /* URI handler for firmware uploads */
+    httpd_uri_t _ota_post_handler = {
+        .uri = "/ota",               // URI path for the upload handler.
+        .method = HTTP_POST,         // Handler for POST requests.
+        .handler = ota_post_handler, // Function pointer to the handler for POST requests.
+    };
+    return httpd_register_uri_handler(server, &_ota_post_handler);
+}
+
+/**
+ * @brief Waits for the health check, then confirms or rolls back the running image.
+ * @param pvParameters Pointer to the rollback_check_t settings.
+ */
+static void ota_rollback_task(void *pvParameters)
+{
+    rollback_check_t *check = (rollback_check_t *)pvParameters;
+    TickType_t start = xTaskGetTickCount();
+
+    while (!check->is_healthy())
+    {
+        if (xTaskGetTickCount() - start >= pdMS_TO_TICKS(check->timeout_ms))
+        {
+            ESP_LOGE(TAG, "New image failed its health check, rolling back");
+            esp_ota_mark_app_invalid_rollback_and_reboot();
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    ESP_LOGI(TAG, "New image confirmed");
+    esp_ota_mark_app_valid_cancel_rollback();
+    vTaskDelete(NULL);
+}
+
+void ota_start_rollback_check(ota_health_check_t is_healthy, uint32_t timeout_ms)
+{
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK ||
+        state != ESP_OTA_IMG_PENDING_VERIFY)
+    {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Image pending verification, waiting up to %" PRIu32 " ms", timeout_ms);
+    s_rollback_check.is_healthy = is_healthy;
+    s_rollback_check.timeout_ms = timeout_ms;
+    xTaskCreate(ota_rollback_task, "ota_rollback", 2048, &s_rollback_check, 1, NULL);
+}
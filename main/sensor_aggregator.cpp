@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "NimBLEDevice.h"
+
+#include "sensor_aggregator.h"
+#include "BleGamepad.h"
+#include "coex_policy.h"
+
+static const char *TAG = "SENSOR_AGG";
+
+extern BleGamepad bleGamepad;
+
+static const sensor_config_t *s_sensors;
+static uint8_t s_count;
+static sensor_merge_t s_merge;
+static sensor_map_t s_maps[SENSOR_MERGE_MAX_SENSORS];
+static NimBLEClient *s_clients[SENSOR_MERGE_MAX_SENSORS];
+static TaskHandle_t s_aggregator_task;
+
+// Connector state, only used by the scan timer and the host task callbacks it chains
+static esp_timer_handle_t s_scan_timer;
+static NimBLEAddress s_found[SENSOR_MERGE_MAX_SENSORS];
+static uint32_t s_found_mask; // Sensors found by the last scan and not yet tried
+
+// Indexed like sensor_map_t::axis: X_AXIS..SLIDER2, then RUDDER..STEERING
+static void (BleGamepad::*const s_axis_setters[SENSOR_MERGE_AXIS_COUNT])(int16_t) = {
+    &BleGamepad::setX, &BleGamepad::setY, &BleGamepad::setZ, &BleGamepad::setRZ,
+    &BleGamepad::setRX, &BleGamepad::setRY, &BleGamepad::setSlider1, &BleGamepad::setSlider2,
+    &BleGamepad::setRudder, &BleGamepad::setThrottle, &BleGamepad::setAccelerator, &BleGamepad::setBrake,
+    &BleGamepad::setSteering,
+};
+
+static inline uint32_t now_us(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+/**
+ * @brief Copies one merged update into the gamepad and sends it.
+ */
+static void emit_report(const sensor_report_t *report, void *ctx)
+{
+    // The sensors are the gamepad's live inputs, they keep the radio policy in play mode
+    coex_policy_note_input();
+
+    for (uint8_t axis = 0; axis < SENSOR_MERGE_AXIS_COUNT; axis++)
+    {
+        if (report->axis_mask & (1u << axis))
+        {
+            (bleGamepad.*s_axis_setters[axis])(report->axis[axis]);
+        }
+    }
+
+    for (uint8_t i = 0; i < sizeof(report->button_mask) * 8; i++)
+    {
+        if (report->button_mask[i >> 3] & (1u << (i & 7)))
+        {
+            if (report->buttons[i >> 3] & (1u << (i & 7)))
+            {
+                bleGamepad.press(i + 1);
+            }
+            else
+            {
+                bleGamepad.release(i + 1);
+            }
+        }
+    }
+
+    bleGamepad.sendReport();
+}
+
+/**
+ * @brief Applies queued sensor values as soon as a notification arrives.
+ */
+static void aggregator_task(void *arg)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        sensor_merge_drain(&s_merge, emit_report, NULL, now_us());
+    }
+}
+
+static void connect_next(void);
+
+/**
+ * @brief Returns a sensor to rest when its link drops, in the host task.
+ */
+class SensorClientCallbacks : public NimBLEClientCallbacks
+{
+    void onDisconnect(NimBLEClient *client, int reason) override
+    {
+        for (uint8_t i = 0; i < s_count; i++)
+        {
+            if (s_clients[i] == client)
+            {
+                ESP_LOGW(TAG, "%s: disconnected (%d)", s_sensors[i].name, reason);
+                sensor_merge_release(&s_merge, i);
+                xTaskNotifyGive(s_aggregator_task);
+            }
+        }
+    }
+};
+
+static SensorClientCallbacks s_client_callbacks;
+
+/**
+ * @brief Runs the next scan after delay_ms.
+ */
+static void schedule_scan(uint32_t delay_ms)
+{
+    esp_timer_start_once(s_scan_timer, (uint64_t)delay_ms * 1000);
+}
+
+static bool sensor_missing(uint8_t index)
+{
+    return s_clients[index] == nullptr || !s_clients[index]->isConnected();
+}
+
+/**
+ * @brief Subscribes to the value once the sensor's attributes are known, in the host task.
+ */
+static void sensor_discovered(uint8_t index, NimBLEClient *client, int rc)
+{
+    const sensor_config_t *sensor = &s_sensors[index];
+    if (rc != 0)
+    {
+        ESP_LOGW(TAG, "%s: discovery failed (%d)", sensor->name, rc);
+        client->disconnect();
+        connect_next();
+        return;
+    }
+
+    // No refresh: with the attributes discovered, looking them up never blocks the host task
+    NimBLERemoteCharacteristic *chr = nullptr;
+    NimBLEUUID service_uuid(sensor->service_uuid);
+    NimBLEUUID chr_uuid(sensor->characteristic_uuid);
+    for (NimBLERemoteService *service : *client->getServices(false))
+    {
+        if (service->getUUID() != service_uuid)
+        {
+            continue;
+        }
+        for (NimBLERemoteCharacteristic *c : *service->getCharacteristics(false))
+        {
+            if (c->getUUID() == chr_uuid)
+            {
+                chr = c;
+                break;
+            }
+        }
+    }
+    if (chr == nullptr || !chr->canNotify())
+    {
+        ESP_LOGE(TAG, "%s: characteristic %s not found or cannot notify", sensor->name, sensor->characteristic_uuid);
+        client->disconnect();
+        connect_next();
+        return;
+    }
+
+    // Runs in the NimBLE host task: only decode and queue, the aggregator task does the rest
+    bool queued = chr->subscribeAsync(true, [index](NimBLERemoteCharacteristic *, uint8_t *data, size_t length, bool)
+                                      {
+                                          sensor_merge_push(&s_merge, index, data, length, now_us());
+                                          xTaskNotifyGive(s_aggregator_task);
+                                      },
+                                      [index, client](int rc, const NimBLEAttValue &)
+                                      {
+                                          if (rc != 0)
+                                          {
+                                              ESP_LOGE(TAG, "%s: subscribe failed (%d)", s_sensors[index].name, rc);
+                                              client->disconnect();
+                                          }
+                                          else
+                                          {
+                                              char addr[18];
+                                              ESP_LOGI(TAG, "%s: connected to %s", s_sensors[index].name,
+                                                       client->getPeerAddress().formatTo(addr));
+                                          }
+                                          connect_next();
+                                      });
+    if (!queued)
+    {
+        ESP_LOGE(TAG, "%s: subscribe failed", sensor->name);
+        client->disconnect();
+        connect_next();
+    }
+}
+
+/**
+ * @brief Discovers the attributes of a sensor once connected, in the host task.
+ */
+static void sensor_connected(uint8_t index, NimBLEClient *client, int rc)
+{
+    if (rc != 0)
+    {
+        ESP_LOGW(TAG, "%s: connect failed (%d)", s_sensors[index].name, rc);
+        connect_next();
+        return;
+    }
+
+    if (!client->discoverAttributesAsync([index](NimBLEClient *client, int rc)
+                                         { sensor_discovered(index, client, rc); }))
+    {
+        client->disconnect();
+        connect_next();
+    }
+}
+
+/**
+ * @brief Starts connecting to a sensor found by the last scan.
+ * @return true if the connection started, connect_next() runs again when it is done.
+ */
+static bool connect_sensor(uint8_t index)
+{
+    const sensor_config_t *sensor = &s_sensors[index];
+
+    if (s_clients[index] == nullptr)
+    {
+        s_clients[index] = NimBLEDevice::createClient();
+        if (s_clients[index] == nullptr)
+        {
+            ESP_LOGE(TAG, "%s: no free client", sensor->name);
+            return false;
+        }
+        s_clients[index]->setConnectTimeout(5000);
+        s_clients[index]->setClientCallbacks(&s_client_callbacks, false);
+    }
+
+    bool started = s_clients[index]->connectAsync(s_found[index], [index](NimBLEClient *client, int rc)
+                                                  { sensor_connected(index, client, rc); });
+    if (!started)
+    {
+        ESP_LOGW(TAG, "%s: connect failed", sensor->name);
+    }
+    return started;
+}
+
+/**
+ * @brief Connects the sensors found by the last scan one after another, then schedules the next scan.
+ */
+static void connect_next(void)
+{
+    while (s_found_mask != 0)
+    {
+        uint8_t index = __builtin_ctz(s_found_mask);
+        s_found_mask &= s_found_mask - 1;
+        if (connect_sensor(index))
+        {
+            return;
+        }
+    }
+    schedule_scan(CONFIG_SENSOR_AGG_RECONNECT_MS);
+}
+
+/**
+ * @brief Picks the sensors that are not connected out of the scan results, in the host task.
+ */
+static void scan_done(NimBLEScanResults &results)
+{
+    s_found_mask = 0;
+    for (NimBLEAdvertisedDevice *device : results)
+    {
+        for (uint8_t i = 0; i < s_count; i++)
+        {
+            if (sensor_missing(i) && !(s_found_mask & (1u << i)) &&
+                device->isAdvertisingService(NimBLEUUID(s_sensors[i].service_uuid)))
+            {
+                s_found[i] = device->getAddress();
+                s_found_mask |= 1u << i;
+                break;
+            }
+        }
+    }
+    NimBLEDevice::getScan()->clearResults();
+
+    connect_next();
+}
+
+/**
+ * @brief Scans for the sensors that are not connected, from the esp_timer task.
+ *
+ * Scanning and connecting are chained from the completion callbacks in the host task rather than
+ * run by a task blocking on each step, so the connector needs no stack of its own.
+ */
+static void scan_timer(void *arg)
+{
+    uint8_t missing = 0;
+    for (uint8_t i = 0; i < s_count; i++)
+    {
+        if (sensor_missing(i))
+        {
+            missing++;
+        }
+    }
+
+    NimBLEScan *scan = NimBLEDevice::getScan();
+    scan->setActiveScan(false);
+    if (missing == 0 || !scan->getResultsAsync(CONFIG_SENSOR_AGG_SCAN_MS, scan_done))
+    {
+        schedule_scan(CONFIG_SENSOR_AGG_RECONNECT_MS);
+    }
+}
+
+esp_err_t sensor_aggregator_start(const sensor_config_t *sensors, uint8_t count)
+{
+    if (s_aggregator_task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (count > SENSOR_MERGE_MAX_SENSORS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        s_maps[i] = sensors[i].map;
+    }
+    if (!sensor_merge_init(&s_merge, s_maps, count))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_sensors = sensors;
+    s_count = count;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = scan_timer,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "sensor_scan",
+        .skip_unhandled_events = false,
+    };
+    if (esp_timer_create(&timer_args, &s_scan_timer) != ESP_OK)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Above the gamepad server so a merged update is reported as soon as it arrives
+    xTaskCreate(aggregator_task, "sensor_agg", 3072, NULL, 6, &s_aggregator_task);
+    schedule_scan(0);
+
+    ESP_LOGI(TAG, "Aggregating %u sensor(s)", count);
+    return ESP_OK;
+}
+
+void sensor_aggregator_get_stats(sensor_merge_stats_t *stats)
+{
+    sensor_merge_get_stats(&s_merge, stats);
+}
@@ -0,0 +1,248 @@
+#include <string.h>
+
+#include "sensor_merge.h"
+
+static const uint8_t s_format_size[SENSOR_FORMAT_MAX] = {1, 1, 2, 2, 4, 4};
+
+/**
+ * @brief Reads the configured field of a notification.
+ * @return false if the notification is too short.
+ */
+static bool decode(const sensor_map_t *map, const uint8_t *data, size_t len, int32_t *raw)
+{
+    if ((size_t)map->offset + s_format_size[map->format] > len)
+    {
+        return false;
+    }
+
+    const uint8_t *p = data + map->offset;
+    switch (map->format)
+    {
+    case SENSOR_FORMAT_U8:
+        *raw = p[0];
+        break;
+    case SENSOR_FORMAT_I8:
+        *raw = (int8_t)p[0];
+        break;
+    case SENSOR_FORMAT_U16_LE:
+        *raw = (uint16_t)(p[0] | (p[1] << 8));
+        break;
+    case SENSOR_FORMAT_I16_LE:
+        *raw = (int16_t)(p[0] | (p[1] << 8));
+        break;
+    default:
+        // U32 values above INT32_MAX wrap, only the bit pattern matters for buttons
+        *raw = (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        break;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps a raw value linearly onto the axis range, clamped.
+ */
+static int16_t scale(const sensor_map_t *map, int32_t raw)
+{
+    int64_t span = (int64_t)map->raw_max - map->raw_min;
+    int64_t out = map->out_min + ((int64_t)raw - map->raw_min) * (map->out_max - map->out_min) / span;
+    int16_t lo = map->out_min < map->out_max ? map->out_min : map->out_max;
+    int16_t hi = map->out_min < map->out_max ? map->out_max : map->out_min;
+
+    if (out < lo)
+    {
+        return lo;
+    }
+    if (out > hi)
+    {
+        return hi;
+    }
+    return (int16_t)out;
+}
+
+bool sensor_merge_init(sensor_merge_t *merge, const sensor_map_t *maps, uint8_t count)
+{
+    if (count > SENSOR_MERGE_MAX_SENSORS)
+    {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const sensor_map_t *map = &maps[i];
+        if (map->format >= SENSOR_FORMAT_MAX)
+        {
+            return false;
+        }
+        if (map->axis == SENSOR_MERGE_BUTTONS)
+        {
+            if (map->first_button < 1 || map->button_count < 1 || map->button_count > 32 ||
+                map->first_button + map->button_count - 1 > 128)
+            {
+                return false;
+            }
+        }
+        else if (map->axis >= SENSOR_MERGE_AXIS_COUNT || map->raw_min == map->raw_max)
+        {
+            return false;
+        }
+    }
+
+    memset(merge, 0, sizeof(*merge));
+    merge->maps = maps;
+    merge->count = count;
+    return true;
+}
+
+bool sensor_merge_push(sensor_merge_t *merge, uint8_t sensor, const uint8_t *data, size_t len, uint32_t now_us)
+{
+    int32_t raw;
+    uint32_t head = merge->head;
+    uint32_t tail = __atomic_load_n(&merge->tail, __ATOMIC_ACQUIRE);
+
+    if (sensor >= merge->count || head - tail >= SENSOR_MERGE_QUEUE_LEN || !decode(&merge->maps[sensor], data, len, &raw))
+    {
+        __atomic_fetch_add(&merge->dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    sensor_value_t *slot = &merge->queue[head & (SENSOR_MERGE_QUEUE_LEN - 1)];
+    slot->sensor = sensor;
+    slot->raw = raw;
+    slot->time_us = now_us;
+    __atomic_store_n(&merge->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Hands the pending changes to the emit callback and clears the change masks.
+ */
+static void flush(sensor_merge_t *merge, sensor_merge_emit_t emit, void *ctx, uint32_t now_us)
+{
+    emit(&merge->report, ctx);
+
+    uint32_t latency = now_us - merge->oldest_us;
+    sensor_merge_stats_t *stats = &merge->stats;
+    stats->latency_mean_us = stats->reports == 0 ? latency : stats->latency_mean_us - stats->latency_mean_us / 16 + latency / 16;
+    if (latency > stats->latency_max_us)
+    {
+        stats->latency_max_us = latency;
+    }
+    stats->reports++;
+
+    merge->report.axis_mask = 0;
+    memset(merge->report.button_mask, 0, sizeof(merge->report.button_mask));
+    merge->pending = false;
+}
+
+/**
+ * @brief Marks the report as changed by a value pushed at time_us.
+ */
+static inline void mark_pending(sensor_merge_t *merge, uint32_t time_us)
+{
+    if (!merge->pending)
+    {
+        merge->pending = true;
+        merge->oldest_us = time_us;
+    }
+}
+
+void sensor_merge_release(sensor_merge_t *merge, uint8_t sensor)
+{
+    if (sensor < merge->count)
+    {
+        __atomic_fetch_or(&merge->release, 1u << sensor, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Applies one value of a sensor to the report, emitting first if it would undo an unsent button edge.
+ */
+static void apply(sensor_merge_t *merge, const sensor_map_t *map, int32_t raw, uint32_t time_us,
+                  sensor_merge_emit_t emit, void *ctx, uint32_t now_us)
+{
+    sensor_report_t *report = &merge->report;
+
+    if (map->axis != SENSOR_MERGE_BUTTONS)
+    {
+        // Axes are levels, a newer value simply replaces one that was not sent yet
+        int16_t out = scale(map, raw);
+        if (report->axis[map->axis] != out)
+        {
+            report->axis[map->axis] = out;
+            report->axis_mask |= 1u << map->axis;
+            mark_pending(merge, time_us);
+        }
+        return;
+    }
+
+    // A value is applied as a whole: if it would undo an edge that was not sent yet, send that first
+    uint32_t changed = 0;
+    bool conflict = false;
+    for (uint8_t bit = 0; bit < map->button_count; bit++)
+    {
+        uint8_t index = map->first_button - 1 + bit;
+        uint8_t mask = 1u << (index & 7);
+        bool pressed = ((uint32_t)raw >> bit) & 1;
+
+        if (((report->buttons[index >> 3] & mask) != 0) != pressed)
+        {
+            changed |= 1u << bit;
+            conflict |= (report->button_mask[index >> 3] & mask) != 0;
+        }
+    }
+    if (changed == 0)
+    {
+        return;
+    }
+    if (conflict)
+    {
+        flush(merge, emit, ctx, now_us);
+    }
+
+    for (uint8_t bit = 0; bit < map->button_count; bit++)
+    {
+        if (changed & (1u << bit))
+        {
+            uint8_t index = map->first_button - 1 + bit;
+            report->buttons[index >> 3] ^= 1u << (index & 7);
+            report->button_mask[index >> 3] |= 1u << (index & 7);
+        }
+    }
+    mark_pending(merge, time_us);
+}
+
+uint32_t sensor_merge_drain(sensor_merge_t *merge, sensor_merge_emit_t emit, void *ctx, uint32_t now_us)
+{
+    uint32_t reports = merge->stats.reports;
+    uint32_t tail = merge->tail;
+    uint32_t head = __atomic_load_n(&merge->head, __ATOMIC_ACQUIRE);
+
+    for (; tail != head; tail++)
+    {
+        const sensor_value_t *value = &merge->queue[tail & (SENSOR_MERGE_QUEUE_LEN - 1)];
+        apply(merge, &merge->maps[value->sensor], value->raw, value->time_us, emit, ctx, now_us);
+    }
+    __atomic_store_n(&merge->tail, tail, __ATOMIC_RELEASE);
+
+    // Released after the values already queued, the sensor's last values cannot undo the release
+    uint32_t release = __atomic_exchange_n(&merge->release, 0, __ATOMIC_ACQUIRE);
+    while (release != 0)
+    {
+        const sensor_map_t *map = &merge->maps[__builtin_ctz(release)];
+        apply(merge, map, map->axis == SENSOR_MERGE_BUTTONS ? 0 : map->raw_rest, now_us, emit, ctx, now_us);
+        release &= release - 1;
+    }
+
+    if (merge->pending)
+    {
+        flush(merge, emit, ctx, now_us);
+    }
+    return merge->stats.reports - reports;
+}
+
+void sensor_merge_get_stats(const sensor_merge_t *merge, sensor_merge_stats_t *stats)
+{
+    *stats = merge->stats;
+    stats->values = __atomic_load_n(&merge->head, __ATOMIC_ACQUIRE);
+    stats->dropped = __atomic_load_n(&merge->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,121 @@
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "NimBLEDevice.h"
+#include "BleGamepad.h"
+
+#include "telemetry_broadcast.h"
+
+static const char *TAG = "TELEMETRY";
+
+extern BleGamepad bleGamepad;
+
+// Manufacturer data AD structure: length, type, company id, frame
+#define AD_HEADER_LEN 4
+// Periodic advertising interval in 1.25 ms units, extended advertising interval in 0.625 ms units
+#define PERIODIC_ITVL (CONFIG_TELEMETRY_BCAST_INTERVAL_MS * 4 / 5)
+#define EXT_ADV_ITVL_MIN 160 // 100 ms, only carries the sync info once observers follow the train
+#define EXT_ADV_ITVL_MAX 240
+
+static TaskHandle_t s_task;
+
+static void get_state(telemetry_state_t *state)
+{
+    BleGamepadState gamepad;
+    bleGamepad.getState(&gamepad);
+
+    static_assert(sizeof(gamepad.axes) == sizeof(state->axis), "axis count");
+    static_assert(sizeof(gamepad.buttons) == sizeof(state->buttons), "button count");
+    memcpy(state->axis, gamepad.axes, sizeof(state->axis));
+    memcpy(state->buttons, gamepad.buttons, sizeof(state->buttons));
+    state->special = gamepad.specialButtons;
+    for (int i = 0; i < TELEMETRY_HAT_COUNT; i++)
+    {
+        state->hat[i] = gamepad.hats[i];
+    }
+}
+
+static bool setup_instance(NimBLEExtAdvertising *advertising, const uint8_t *data, size_t len)
+{
+    uint8_t id[3] = {CONFIG_TELEMETRY_BCAST_COMPANY_ID & 0xFF, CONFIG_TELEMETRY_BCAST_COMPANY_ID >> 8, TELEMETRY_FRAME_VERSION};
+
+    // Not connectable nor scannable, extended PDUs: the only kind periodic advertising runs on
+    NimBLEExtAdvertisement instance(BLE_HCI_LE_PHY_1M, BLE_HCI_LE_PHY_1M);
+    instance.setName(bleGamepad.deviceName);
+    instance.setManufacturerData(std::string((const char *)id, sizeof(id)));
+    instance.setMinInterval(EXT_ADV_ITVL_MIN);
+    instance.setMaxInterval(EXT_ADV_ITVL_MAX);
+
+    return advertising->setInstanceData(TELEMETRY_ADV_INSTANCE, instance) &&
+           advertising->setPeriodicParams(TELEMETRY_ADV_INSTANCE, PERIODIC_ITVL, PERIODIC_ITVL) &&
+           advertising->setPeriodicData(TELEMETRY_ADV_INSTANCE, data, len) &&
+           advertising->startPeriodic(TELEMETRY_ADV_INSTANCE) &&
+           advertising->start(TELEMETRY_ADV_INSTANCE);
+}
+
+static void telemetry_task(void *arg)
+{
+    static telemetry_encoder_t encoder;
+    static uint8_t ad[AD_HEADER_LEN + TELEMETRY_FRAME_MAX];
+    telemetry_state_t state;
+
+    telemetry_encoder_init(&encoder, CONFIG_TELEMETRY_BCAST_KEY_INTERVAL);
+    ad[1] = BLE_HS_ADV_TYPE_MFG_DATA;
+    ad[2] = CONFIG_TELEMETRY_BCAST_COMPANY_ID & 0xFF;
+    ad[3] = CONFIG_TELEMETRY_BCAST_COMPANY_ID >> 8;
+
+    get_state(&state);
+    size_t len = telemetry_encode(&encoder, &state, ad + AD_HEADER_LEN);
+    ad[0] = len + AD_HEADER_LEN - 1;
+
+    NimBLEExtAdvertising *advertising = NimBLEDevice::getAdvertising();
+    if (!setup_instance(advertising, ad, AD_HEADER_LEN + len))
+    {
+        ESP_LOGE(TAG, "Periodic advertising setup failed");
+        advertising->removeInstance(TELEMETRY_ADV_INSTANCE);
+        s_task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Broadcasting on instance %d every %d ms", TELEMETRY_ADV_INSTANCE, CONFIG_TELEMETRY_BCAST_INTERVAL_MS);
+
+    TickType_t wake = xTaskGetTickCount();
+    for (;;)
+    {
+        // One tick per periodic event: a faster tick only replaces frames nobody received
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(CONFIG_TELEMETRY_BCAST_INTERVAL_MS));
+
+        get_state(&state);
+        len = telemetry_encode(&encoder, &state, ad + AD_HEADER_LEN);
+        if (len == 0)
+        {
+            continue;
+        }
+
+        ad[0] = len + AD_HEADER_LEN - 1;
+        if (!advertising->setPeriodicData(TELEMETRY_ADV_INSTANCE, ad, AD_HEADER_LEN + len))
+        {
+            // The encoder counts the frame as on air, start over with a key frame next tick
+            telemetry_encoder_init(&encoder, CONFIG_TELEMETRY_BCAST_KEY_INTERVAL);
+        }
+    }
+}
+
+esp_err_t telemetry_broadcast_start(void)
+{
+    if (s_task != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Below the gamepad server and sensor aggregator, a late frame only costs one interval
+    if (xTaskCreate(telemetry_task, "telemetry", 3072, NULL, 3, &s_task) != pdPASS)
+    {
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
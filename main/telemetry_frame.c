@@ -0,0 +1,408 @@
+#include <string.h>
+
+#include "telemetry_frame.h"
+
+#define HEADER(flags) ((TELEMETRY_FRAME_VERSION << 4) | (flags))
+#define BUTTON_COUNT (TELEMETRY_BUTTON_BYTES * 8)
+
+static bool state_equal(const telemetry_state_t *a, const telemetry_state_t *b)
+{
+    // Member by member, the padding of the struct is never compared
+    return memcmp(a->axis, b->axis, sizeof(a->axis)) == 0 &&
+           memcmp(a->buttons, b->buttons, sizeof(a->buttons)) == 0 &&
+           a->special == b->special &&
+           memcmp(a->hat, b->hat, sizeof(a->hat)) == 0;
+}
+
+static bool hats_zero(const telemetry_state_t *state)
+{
+    for (int i = 0; i < TELEMETRY_HAT_COUNT; i++)
+    {
+        if (state->hat[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t put_hats(uint8_t *p, const telemetry_state_t *state)
+{
+    for (int i = 0; i < TELEMETRY_HAT_COUNT; i += 2)
+    {
+        *p++ = (state->hat[i] & 0x0F) | (state->hat[i + 1] << 4);
+    }
+    return TELEMETRY_HAT_COUNT / 2;
+}
+
+static void get_hats(const uint8_t *p, telemetry_state_t *state)
+{
+    for (int i = 0; i < TELEMETRY_HAT_COUNT; i += 2)
+    {
+        state->hat[i] = *p & 0x0F;
+        state->hat[i + 1] = *p++ >> 4;
+    }
+}
+
+/**
+ * @brief Writes the header shared by both frame kinds.
+ */
+static void put_header(uint8_t *out, uint8_t flags, uint8_t seq, uint8_t base_seq, uint16_t mask)
+{
+    out[0] = HEADER(flags);
+    out[1] = seq;
+    out[2] = base_seq;
+    out[3] = mask;
+    out[4] = mask >> 8;
+}
+
+static size_t encode_key(const telemetry_state_t *state, uint8_t seq, uint8_t base_seq, uint8_t *out)
+{
+    uint8_t flags = 0;
+    uint16_t mask = 0;
+    uint8_t *p = out + 5;
+
+    for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+    {
+        if (state->axis[i] != 0)
+        {
+            mask |= 1u << i;
+            *p++ = (uint16_t)state->axis[i];
+            *p++ = (uint16_t)state->axis[i] >> 8;
+        }
+    }
+
+    uint8_t n = TELEMETRY_BUTTON_BYTES;
+    while (n > 0 && state->buttons[n - 1] == 0)
+    {
+        n--;
+    }
+    *p++ = n;
+    memcpy(p, state->buttons, n);
+    p += n;
+
+    if (state->special != 0)
+    {
+        flags |= TELEMETRY_FLAG_SPECIAL;
+        *p++ = state->special;
+    }
+    if (!hats_zero(state))
+    {
+        flags |= TELEMETRY_FLAG_HATS;
+        p += put_hats(p, state);
+    }
+
+    put_header(out, flags, seq, base_seq, mask);
+    return p - out;
+}
+
+/**
+ * @brief Encodes the difference to the base, as long as it stays shorter than limit.
+ * @return Frame length, 0 if it reached limit.
+ */
+static size_t encode_delta(const telemetry_state_t *base, uint8_t base_seq, const telemetry_state_t *state, uint8_t seq,
+                           uint8_t *out, size_t limit)
+{
+    uint8_t flags = TELEMETRY_FLAG_DELTA;
+    uint16_t mask = 0;
+    uint8_t *p = out + 5;
+    uint8_t *end = out + limit;
+
+    for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+    {
+        if (state->axis[i] == base->axis[i])
+        {
+            continue;
+        }
+        // Zigzag maps small differences of either sign to small varints
+        int32_t diff = (int32_t)state->axis[i] - base->axis[i];
+        uint32_t v = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+        mask |= 1u << i;
+        do
+        {
+            if (p >= end)
+            {
+                return 0;
+            }
+            *p++ = (v & 0x7F) | (v > 0x7F ? 0x80 : 0);
+            v >>= 7;
+        } while (v != 0);
+    }
+
+    if (p >= end)
+    {
+        return 0;
+    }
+    uint8_t *count = p++;
+    *count = 0;
+    for (int i = 0; i < TELEMETRY_BUTTON_BYTES; i++)
+    {
+        uint8_t toggled = state->buttons[i] ^ base->buttons[i];
+        while (toggled != 0)
+        {
+            if (p >= end)
+            {
+                return 0;
+            }
+            *p++ = i * 8 + __builtin_ctz(toggled);
+            (*count)++;
+            toggled &= toggled - 1;
+        }
+    }
+
+    if (state->special != base->special)
+    {
+        if (p >= end)
+        {
+            return 0;
+        }
+        flags |= TELEMETRY_FLAG_SPECIAL;
+        *p++ = state->special;
+    }
+    if (memcmp(state->hat, base->hat, sizeof(state->hat)) != 0)
+    {
+        if (p + TELEMETRY_HAT_COUNT / 2 > end)
+        {
+            return 0;
+        }
+        flags |= TELEMETRY_FLAG_HATS;
+        p += put_hats(p, state);
+    }
+
+    put_header(out, flags, seq, base_seq, mask);
+    return p - out;
+}
+
+void telemetry_encoder_init(telemetry_encoder_t *encoder, uint8_t key_interval)
+{
+    memset(encoder, 0, sizeof(*encoder));
+    // A repeated base is followed by the current state, so at least every other tick is current
+    encoder->key_interval = key_interval > 2 ? key_interval : 2;
+}
+
+size_t telemetry_encode(telemetry_encoder_t *encoder, const telemetry_state_t *state, uint8_t *out)
+{
+    uint8_t seq = encoder->seq + 1;
+
+    if (!encoder->started)
+    {
+        encoder->started = true;
+        encoder->sent = *state;
+        encoder->base = *state;
+        encoder->base_seq = seq;
+        encoder->seq = seq;
+        encoder->since_key = 0;
+        encoder->current = true;
+        return encode_key(state, seq, seq, out);
+    }
+
+    if (seq == encoder->base_seq)
+    {
+        // Wrapped around a base that was kept for 256 frames, only the base may use its number
+        seq++;
+    }
+    if (encoder->since_key < 0xFF)
+    {
+        encoder->since_key++;
+    }
+
+    // Nothing to repeat while the base itself, with the current state, is on air
+    bool base_on_air = encoder->current && encoder->seq == encoder->base_seq;
+    if (encoder->since_key >= encoder->key_interval && !base_on_air)
+    {
+        encoder->seq = seq;
+        encoder->since_key = 0;
+        encoder->current = false;
+        return encode_key(&encoder->base, seq, encoder->base_seq, out);
+    }
+
+    bool changed = !state_equal(state, &encoder->sent);
+    if (!changed && encoder->current)
+    {
+        return 0;
+    }
+
+    // Only worth it while shorter than the key frame that would replace the base
+    size_t key_len = encode_key(state, seq, seq, out);
+    size_t len = encode_delta(&encoder->base, encoder->base_seq, state, seq, out, key_len - 1);
+    if (len == 0)
+    {
+        len = encode_key(state, seq, seq, out);
+        encoder->base = *state;
+        encoder->base_seq = seq;
+        encoder->since_key = 0;
+    }
+
+    encoder->sent = *state;
+    encoder->seq = seq;
+    encoder->current = true;
+    return len;
+}
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+static bool decode_key(const uint8_t *p, const uint8_t *end, uint8_t flags, uint16_t mask, telemetry_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+
+    for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+    {
+        if (mask & (1u << i))
+        {
+            if (end - p < 2)
+            {
+                return false;
+            }
+            state->axis[i] = (int16_t)(p[0] | (p[1] << 8));
+            p += 2;
+        }
+    }
+
+    if (p >= end || *p > TELEMETRY_BUTTON_BYTES || end - p - 1 < *p)
+    {
+        return false;
+    }
+    memcpy(state->buttons, p + 1, *p);
+    p += 1 + *p;
+
+    if (flags & TELEMETRY_FLAG_SPECIAL)
+    {
+        if (p >= end)
+        {
+            return false;
+        }
+        state->special = *p++;
+    }
+    if (flags & TELEMETRY_FLAG_HATS)
+    {
+        if (end - p < TELEMETRY_HAT_COUNT / 2)
+        {
+            return false;
+        }
+        get_hats(p, state);
+    }
+    return true;
+}
+
+/**
+ * @brief Applies a delta to the state, which holds the base.
+ */
+static bool decode_delta(const uint8_t *p, const uint8_t *end, uint8_t flags, uint16_t mask, telemetry_state_t *state)
+{
+    for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+    {
+        if (!(mask & (1u << i)))
+        {
+            continue;
+        }
+        uint32_t v = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            if (p >= end || shift > 14)
+            {
+                return false;
+            }
+            v |= (uint32_t)(*p & 0x7F) << shift;
+            if (!(*p++ & 0x80))
+            {
+                break;
+            }
+        }
+        int32_t diff = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+        state->axis[i] = (int16_t)(state->axis[i] + diff);
+    }
+
+    if (p >= end || end - p - 1 < *p)
+    {
+        return false;
+    }
+    uint8_t count = *p++;
+    for (uint8_t i = 0; i < count; i++, p++)
+    {
+        if (*p >= BUTTON_COUNT)
+        {
+            return false;
+        }
+        state->buttons[*p / 8] ^= 1 << (*p % 8);
+    }
+
+    if (flags & TELEMETRY_FLAG_SPECIAL)
+    {
+        if (p >= end)
+        {
+            return false;
+        }
+        state->special = *p++;
+    }
+    if (flags & TELEMETRY_FLAG_HATS)
+    {
+        if (end - p < TELEMETRY_HAT_COUNT / 2)
+        {
+            return false;
+        }
+        get_hats(p, state);
+    }
+    return true;
+}
+
+telemetry_decode_result_t telemetry_decode(telemetry_decoder_t *decoder, const uint8_t *frame, size_t len)
+{
+    if (len < 5 || (frame[0] >> 4) != TELEMETRY_FRAME_VERSION)
+    {
+        return TELEMETRY_DECODE_INVALID;
+    }
+
+    uint8_t flags = frame[0] & 0x0F;
+    uint8_t seq = frame[1];
+    uint8_t base_seq = frame[2];
+    uint16_t mask = frame[3] | (frame[4] << 8);
+    if (decoder->has_seq && seq == decoder->seq)
+    {
+        return TELEMETRY_DECODE_REPEAT;
+    }
+
+    telemetry_decode_result_t result = TELEMETRY_DECODE_OK;
+    telemetry_state_t state;
+    if (flags & TELEMETRY_FLAG_DELTA)
+    {
+        if (!decoder->has_base || base_seq != decoder->base_seq)
+        {
+            return TELEMETRY_DECODE_NO_KEY;
+        }
+        state = decoder->base;
+        if (!decode_delta(frame + 5, frame + len, flags, mask, &state))
+        {
+            return TELEMETRY_DECODE_INVALID;
+        }
+        decoder->state = state;
+    }
+    else
+    {
+        if (!decode_key(frame + 5, frame + len, flags, mask, &state))
+        {
+            return TELEMETRY_DECODE_INVALID;
+        }
+        decoder->base = state;
+        decoder->base_seq = base_seq;
+        decoder->has_base = true;
+        if (seq == base_seq)
+        {
+            decoder->state = state;
+        }
+        else
+        {
+            result = TELEMETRY_DECODE_BASE;
+        }
+    }
+
+    if (decoder->has_seq)
+    {
+        decoder->missed += (uint8_t)(seq - decoder->seq - 1);
+    }
+    decoder->seq = seq;
+    decoder->has_seq = true;
+    return result;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file bench_address.cpp
+ * @brief Checks NimBLEAddress's conversions, equality and hash, and times compare, hash and format.
+ *
+ * The addresses share one OUI like the public addresses of a batch of devices. The times are
+ * compared with the former representation, a 6 byte array compared with memcmp, hashed with FNV-1a
+ * and formatted with snprintf, which is kept here as the reference.
+ *
+ *   bench_address [rounds]
+ */
+
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "NimBLEAddress.h"
+#include "host_test.h"
+
+/**
+ * @brief The former NimBLEAddress, the reference of the benchmark.
+ */
+struct byte_address_t
+{
+    uint8_t val[6];
+    uint8_t type;
+
+    bool operator==(const byte_address_t &rhs) const { return memcmp(val, rhs.val, sizeof(val)) == 0; }
+
+    uint32_t hash() const
+    {
+        uint32_t hash = 2166136261u;
+        for (int i = 0; i < 6; i++)
+        {
+            hash = (hash ^ val[i]) * 16777619u;
+        }
+        return hash ^ (hash >> 16);
+    }
+
+    std::string toString() const
+    {
+        char buffer[18];
+        snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x", val[5], val[4], val[3], val[2], val[1], val[0]);
+        return buffer;
+    }
+};
+
+static std::vector<ble_addr_t> addresses(int count)
+{
+    std::vector<ble_addr_t> addrs;
+    uint64_t x = 0x123456789abcULL;
+    for (int i = 0; i < count; i++)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        ble_addr_t a;
+        a.type = i & 1;
+        memcpy(a.val, &x, 6);
+        a.val[5] = 0xa4;
+        a.val[4] = 0xc1;
+        a.val[3] = 0x38;
+        addrs.push_back(a);
+    }
+    return addrs;
+}
+
+/**
+ * @brief String, integer and byte forms are the same address, the string is most significant byte first.
+ */
+static void conversions_agree(void)
+{
+    char buf[18];
+    uint8_t bytes[6] = {0x16, 0xef, 0x5d, 0x38, 0xc1, 0xa4};
+    NimBLEAddress a(std::string("a4:c1:38:5d:ef:16"), BLE_ADDR_RANDOM);
+    NimBLEAddress b(0xa4c1385def16ULL);
+    NimBLEAddress c(bytes);
+
+    CHECK(std::string(a.formatTo(buf)) == "a4:c1:38:5d:ef:16");
+    CHECK(a.toString() == "a4:c1:38:5d:ef:16");
+    CHECK(NimBLEAddress(std::string("A4:C1:38:5D:EF:16")) == a);
+    CHECK((uint64_t)a == 0xa4c1385def16ULL);
+    CHECK(memcmp(a.getNative(), bytes, 6) == 0);
+    CHECK(a.getType() == BLE_ADDR_RANDOM && b.getType() == BLE_ADDR_PUBLIC);
+    CHECK(NimBLEAddress() == NimBLEAddress(std::string("")));
+    CHECK((uint64_t)NimBLEAddress() == 0);
+
+    for (const ble_addr_t &addr : addresses(64))
+    {
+        byte_address_t ref = {};
+        memcpy(ref.val, addr.val, 6);
+        CHECK(NimBLEAddress(addr).toString() == ref.toString());
+        CHECK(NimBLEAddress(NimBLEAddress(addr).toString(), addr.type) == NimBLEAddress(addr));
+    }
+}
+
+/**
+ * @brief Equality and the hash ignore the type, like the former byte compare.
+ */
+static void equality_ignores_type(void)
+{
+    NimBLEAddress a(0xa4c1385def16ULL, BLE_ADDR_RANDOM);
+    NimBLEAddress b(0xa4c1385def16ULL, BLE_ADDR_PUBLIC);
+    NimBLEAddress c(0xa4c1385def17ULL, BLE_ADDR_RANDOM);
+
+    CHECK(a == b && a.equals(b));
+    CHECK(a != c);
+    CHECK(a.hash() == b.hash());
+    CHECK(std::unordered_set<NimBLEAddress>({a, b, c}).size() == 2);
+}
+
+/**
+ * @brief Longest chain of 48 addresses in a 64 entry index, the scan pool proportions.
+ */
+template <typename H>
+static int worst_bucket(const std::vector<ble_addr_t> &addrs, H hash)
+{
+    int bucket[64] = {};
+    int worst = 0;
+    for (int i = 0; i < 48; i++)
+    {
+        int b = hash(addrs[i]) & 63;
+        worst = std::max(worst, ++bucket[b]);
+    }
+    return worst;
+}
+
+static void run_benchmark(int rounds)
+{
+    const int n = 256;
+    std::vector<ble_addr_t> addrs = addresses(n);
+    std::vector<NimBLEAddress> packed;
+    std::vector<byte_address_t> bytes;
+    for (const ble_addr_t &a : addrs)
+    {
+        packed.emplace_back(a);
+        bytes.push_back({});
+        memcpy(bytes.back().val, a.val, 6);
+        bytes.back().type = a.type;
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto ns = [](clock::time_point from, clock::time_point to, double ops)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / ops; };
+    size_t sink = 0;
+    char buf[18];
+
+    auto t0 = clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        const NimBLEAddress &k = packed[r % n];
+        for (int i = 0; i < n; i++)
+        {
+            sink += packed[i] == k;
+        }
+    }
+    auto t1 = clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        const byte_address_t &k = bytes[r % n];
+        for (int i = 0; i < n; i++)
+        {
+            sink += bytes[i] == k;
+        }
+    }
+    auto t2 = clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sink += packed[i].hash();
+        }
+    }
+    auto t3 = clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sink += bytes[i].hash();
+        }
+    }
+    auto t4 = clock::now();
+    for (int r = 0; r < rounds / 10; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sink += packed[i].formatTo(buf)[16];
+        }
+    }
+    auto t5 = clock::now();
+    for (int r = 0; r < rounds / 10; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sink += packed[i].toString().size();
+        }
+    }
+    auto t6 = clock::now();
+    for (int r = 0; r < rounds / 10; r++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sink += bytes[i].toString().size();
+        }
+    }
+    auto t7 = clock::now();
+    asm volatile("" : : "r"(sink));
+
+    double ops = (double)rounds * n;
+    printf("sizeof %zu (former %zu)\n", sizeof(NimBLEAddress), sizeof(byte_address_t));
+    printf("compare:  %5.2f ns, former %5.2f ns\n", ns(t0, t1, ops), ns(t1, t2, ops));
+    printf("hash:     %5.2f ns, former %5.2f ns\n", ns(t2, t3, ops), ns(t3, t4, ops));
+    printf("formatTo: %5.1f ns, toString %5.1f ns, former toString %5.1f ns\n", ns(t4, t5, ops / 10),
+           ns(t5, t6, ops / 10), ns(t6, t7, ops / 10));
+    printf("worst chain of 48 in 64: %d, former %d\n",
+           worst_bucket(addrs, [](const ble_addr_t &a) { return NimBLEAddress(a).hash(); }),
+           worst_bucket(addrs, [](const ble_addr_t &a)
+                        { byte_address_t b = {}; memcpy(b.val, a.val, 6); return b.hash(); }));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(conversions_agree);
+    RUN_TEST(equality_ignores_type);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 20000);
+    return host_test_failures;
+}
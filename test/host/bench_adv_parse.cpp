@@ -0,0 +1,138 @@
+/**
+ * @file bench_adv_parse.cpp
+ * @brief Checks and times NimBLEAdvertisedDevice payload parsing and lookups.
+ *
+ * The payload is a typical gamepad advertisement (flags, name, HID and battery services,
+ * manufacturer data) and scan response (TX power, battery service data, appearance, a 128 bit
+ * UUID). Setting it indexes the AD structures once, the getters then read the index.
+ *
+ *   bench_adv_parse [iterations]
+ */
+
+#include <chrono>
+#include <vector>
+
+// setPayload() is only called by the scan
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEAdvertisedDevice.h"
+#undef private
+
+#include "host_test.h"
+
+static std::vector<uint8_t> adv_payload(void)
+{
+    std::vector<uint8_t> p = {2, BLE_HS_ADV_TYPE_FLAGS, 0x06};
+    const char *name = "BLE Gamepad";
+    p.push_back(strlen(name) + 1);
+    p.push_back(BLE_HS_ADV_TYPE_COMP_NAME);
+    p.insert(p.end(), name, name + strlen(name));
+    p.insert(p.end(), {5, BLE_HS_ADV_TYPE_COMP_UUIDS16, 0x12, 0x18, 0x0F, 0x18});
+    p.insert(p.end(), {7, BLE_HS_ADV_TYPE_MFG_DATA, 0xE5, 0x02, 0x01, 1, 2, 3});
+    return p;
+}
+
+static std::vector<uint8_t> scan_rsp_payload(void)
+{
+    std::vector<uint8_t> p = {2, BLE_HS_ADV_TYPE_TX_PWR_LVL, 9};
+    p.insert(p.end(), {5, BLE_HS_ADV_TYPE_SVC_DATA_UUID16, 0x0F, 0x18, 0x55, 0x01});
+    p.insert(p.end(), {3, BLE_HS_ADV_TYPE_APPEARANCE, 0xC4, 0x03});
+    p.insert(p.end(), {17, BLE_HS_ADV_TYPE_COMP_UUIDS128});
+    for (int i = 0; i < 16; i++)
+    {
+        p.push_back(i * 7);
+    }
+    return p;
+}
+
+static void set_payloads(NimBLEAdvertisedDevice &dev, const std::vector<uint8_t> &adv, const std::vector<uint8_t> &rsp)
+{
+    dev.setPayload(adv.data(), adv.size(), false);
+    dev.setPayload(rsp.data(), rsp.size(), true);
+}
+
+static void lookups_read_the_payload(void)
+{
+    NimBLEAdvertisedDevice dev;
+    set_payloads(dev, adv_payload(), scan_rsp_payload());
+
+    CHECK(dev.getNameView() == "BLE Gamepad");
+    CHECK(dev.getManufacturerDataCount() == 1);
+    CHECK(dev.getManufacturerDataView() == std::string_view("\xE5\x02\x01\x01\x02\x03", 6));
+    CHECK(dev.getServiceUUIDCount() == 3);
+    CHECK(dev.isAdvertisingService(NimBLEUUID((uint16_t)0x1812)));
+    CHECK(!dev.isAdvertisingService(NimBLEUUID((uint16_t)0x2A00)));
+    CHECK(dev.getServiceDataView(NimBLEUUID((uint16_t)0x180F)) == std::string_view("\x55\x01", 2));
+    CHECK(dev.getAppearance() == 0x03C4);
+    CHECK(dev.getTXPower() == 9);
+}
+
+/**
+ * @brief The last index is out of range, it must not wrap around to the first item.
+ */
+static void index_255_does_not_wrap(void)
+{
+    NimBLEAdvertisedDevice dev;
+    set_payloads(dev, adv_payload(), scan_rsp_payload());
+
+    CHECK(!dev.getManufacturerDataView(0).empty());
+    CHECK(dev.getManufacturerDataView(1).empty());
+    CHECK(dev.getManufacturerDataView(255).empty());
+    CHECK(!dev.getServiceDataView((uint8_t)0).empty());
+    CHECK(dev.getServiceDataView((uint8_t)255).empty());
+
+    std::vector<uint8_t> target = {7, BLE_HS_ADV_TYPE_PUBLIC_TGT_ADDR, 1, 2, 3, 4, 5, 6};
+    dev.setPayload(target.data(), target.size(), false);
+    CHECK(dev.getTargetAddressCount() == 1);
+    CHECK(dev.getTargetAddress(0) != NimBLEAddress());
+    CHECK(dev.getTargetAddress(255) == NimBLEAddress());
+}
+
+static void run_benchmark(int iterations)
+{
+    NimBLEAdvertisedDevice dev;
+    std::vector<uint8_t> adv = adv_payload();
+    std::vector<uint8_t> rsp = scan_rsp_payload();
+    size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        set_payloads(dev, adv, rsp);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        sink += dev.getName().size();
+        sink += dev.getManufacturerData().size();
+        sink += dev.isAdvertisingService(NimBLEUUID((uint16_t)0x1812));
+        sink += dev.getServiceData(NimBLEUUID((uint16_t)0x180F)).size();
+        sink += dev.getAppearance();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        sink += dev.getNameView().size();
+        sink += dev.getManufacturerDataView().size();
+        sink += dev.isAdvertisingService(NimBLEUUID((uint16_t)0x1812));
+        sink += dev.getServiceDataView(NimBLEUUID((uint16_t)0x180F)).size();
+        sink += dev.getAppearance();
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    asm volatile("" : : "r"(sink));
+
+    auto ns = [iterations](auto from, auto to)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / iterations; };
+    printf("set adv + scan response: %6.1f ns\n", ns(t0, t1));
+    printf("5 lookups, copies:       %6.1f ns\n", ns(t1, t2));
+    printf("5 lookups, views:        %6.1f ns\n", ns(t2, t3));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(lookups_read_the_payload);
+    RUN_TEST(index_255_does_not_wrap);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 2000000);
+    return host_test_failures;
+}
@@ -0,0 +1,328 @@
+/**
+ * @file bench_advertising.cpp
+ * @brief Checks NimBLEAdvertising's restart paths against a mock controller and times start() to the first PDU.
+ *
+ * The mock controller runs on a virtual clock: every HCI command costs HCI_US, and the first
+ * advertising PDU goes out after the enable plus the random 0-10 ms advDelay of the
+ * specification. Restarting after a disconnect must not send the payload again, a
+ * configuration change or a host reset must, and the fast phase must fall back to the
+ * configured interval when it times out.
+ *
+ *   bench_advertising [starts]
+ */
+
+#include <chrono>
+#include <random>
+
+// The payload state, onHostSync() and the fast phase are private
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEAdvertising.h"
+#undef private
+
+#include "host_test.h"
+
+#define HCI_US 250.0
+
+struct controller_t
+{
+    double now_us = 0;
+    double first_pdu_us = 0;
+    int commands = 0;
+    int data_commands = 0;
+    bool active = false;
+    int32_t duration = 0;
+    uint16_t itvl_min = 0;
+    uint16_t itvl_max = 0;
+    ble_gap_event_fn *cb = nullptr;
+    void *arg = nullptr;
+    uint8_t adv_len = 0;
+    uint8_t rsp_len = 0;
+    double hci_us = HCI_US;
+    std::mt19937 rng{1};
+};
+
+static controller_t s_ctrl;
+
+static void hci(void)
+{
+    s_ctrl.now_us += s_ctrl.hci_us;
+    s_ctrl.commands++;
+}
+
+static int put_field(uint8_t *dst, uint8_t *len, uint8_t max, uint8_t type, const void *value, uint8_t value_len)
+{
+    if (*len + 2 + value_len > max)
+    {
+        return BLE_HS_EMSGSIZE;
+    }
+    dst[(*len)++] = value_len + 1;
+    dst[(*len)++] = type;
+    memcpy(dst + *len, value, value_len);
+    *len += value_len;
+    return 0;
+}
+
+int ble_hs_adv_set_fields(const struct ble_hs_adv_fields *f, uint8_t *dst, uint8_t *len, uint8_t max)
+{
+    uint8_t buf[BLE_HS_ADV_MAX_SZ];
+    int rc = 0;
+
+    *len = 0;
+    if (f->flags)
+    {
+        rc |= put_field(dst, len, max, BLE_HS_ADV_TYPE_FLAGS, &f->flags, 1);
+    }
+    if (f->num_uuids16)
+    {
+        for (int i = 0; i < f->num_uuids16; i++)
+        {
+            memcpy(buf + 2 * i, &f->uuids16[i].value, 2);
+        }
+        rc |= put_field(dst, len, max, f->uuids16_is_complete ? BLE_HS_ADV_TYPE_COMP_UUIDS16 : BLE_HS_ADV_TYPE_INCOMP_UUIDS16,
+                        buf, 2 * f->num_uuids16);
+    }
+    if (f->name)
+    {
+        rc |= put_field(dst, len, max, f->name_is_complete ? BLE_HS_ADV_TYPE_COMP_NAME : BLE_HS_ADV_TYPE_INCOMP_NAME,
+                        f->name, f->name_len);
+    }
+    if (f->tx_pwr_lvl_is_present)
+    {
+        rc |= put_field(dst, len, max, BLE_HS_ADV_TYPE_TX_PWR_LVL, &f->tx_pwr_lvl, 1);
+    }
+    if (f->appearance_is_present)
+    {
+        rc |= put_field(dst, len, max, BLE_HS_ADV_TYPE_APPEARANCE, &f->appearance, 2);
+    }
+    if (f->mfg_data_len)
+    {
+        rc |= put_field(dst, len, max, BLE_HS_ADV_TYPE_MFG_DATA, f->mfg_data, f->mfg_data_len);
+    }
+    return rc;
+}
+
+int ble_gap_adv_set_data(const uint8_t *data, int len)
+{
+    hci();
+    s_ctrl.data_commands++;
+    s_ctrl.adv_len = len;
+    return 0;
+}
+
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int len)
+{
+    hci();
+    s_ctrl.data_commands++;
+    s_ctrl.rsp_len = len;
+    return 0;
+}
+
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *fields)
+{
+    uint8_t buf[BLE_HS_ADV_MAX_SZ], len;
+    int rc = ble_hs_adv_set_fields(fields, buf, &len, sizeof(buf));
+    return rc != 0 ? rc : ble_gap_adv_set_data(buf, len);
+}
+
+int ble_gap_adv_rsp_set_fields(const struct ble_hs_adv_fields *fields)
+{
+    uint8_t buf[BLE_HS_ADV_MAX_SZ], len;
+    int rc = ble_hs_adv_set_fields(fields, buf, &len, sizeof(buf));
+    return rc != 0 ? rc : ble_gap_adv_rsp_set_data(buf, len);
+}
+
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *params, ble_gap_event_fn *cb, void *arg)
+{
+    if (s_ctrl.active)
+    {
+        return BLE_HS_EALREADY;
+    }
+
+    // Set parameters, then enable
+    hci();
+    hci();
+    s_ctrl.active = true;
+    s_ctrl.itvl_min = params->itvl_min;
+    s_ctrl.itvl_max = params->itvl_max;
+    s_ctrl.duration = duration_ms;
+    s_ctrl.cb = cb;
+    s_ctrl.arg = arg;
+    s_ctrl.first_pdu_us = s_ctrl.now_us + std::uniform_real_distribution<double>(0, 10000)(s_ctrl.rng);
+    return 0;
+}
+
+int ble_gap_adv_stop(void)
+{
+    hci();
+    s_ctrl.active = false;
+    return 0;
+}
+
+int ble_gap_adv_active(void)
+{
+    return s_ctrl.active;
+}
+
+const char *ble_svc_gap_device_name(void)
+{
+    return "BLE Driving Controller";
+}
+
+/**
+ * @brief The controller ends advertising with reason, like a duration running out.
+ */
+static void adv_complete(int reason)
+{
+    ble_gap_event event = {};
+    s_ctrl.active = false;
+    event.type = BLE_GAP_EVENT_ADV_COMPLETE;
+    event.adv_complete.reason = reason;
+    s_ctrl.cb(&event, s_ctrl.arg);
+}
+
+/**
+ * @brief A gamepad advertisement: appearance and the HID service, with the fast phase of the example.
+ */
+static void configure(NimBLEAdvertising &adv)
+{
+    adv.setAppearance(0x03C4);
+    adv.addServiceUUID(NimBLEUUID((uint16_t)0x1812));
+    adv.setMinInterval(244);
+    adv.setMaxInterval(338);
+    adv.setFastAdvertising(30000, 32, 48);
+}
+
+/**
+ * @brief A restart after a disconnect only sets the parameters and enables, a configuration change reloads the payload.
+ */
+static void restart_keeps_the_payload(void)
+{
+    NimBLEAdvertising adv;
+    configure(adv);
+
+    s_ctrl.data_commands = 0;
+    CHECK(adv.start());
+    CHECK(s_ctrl.data_commands == 2);
+    CHECK(s_ctrl.adv_len > 0 && s_ctrl.rsp_len > 0);
+
+    // Connected: the controller stopped advertising
+    s_ctrl.active = false;
+    s_ctrl.commands = 0;
+    CHECK(adv.start());
+    CHECK(s_ctrl.data_commands == 2);
+    CHECK(s_ctrl.commands == 2);
+
+    s_ctrl.active = false;
+    adv.setAppearance(0x03C5);
+    CHECK(adv.start());
+    CHECK(s_ctrl.data_commands == 4);
+    s_ctrl.active = false;
+}
+
+/**
+ * @brief After a host reset the controller lost the payload, the sync loads it again and restarts.
+ */
+static void host_sync_reloads_the_payload(void)
+{
+    NimBLEAdvertising adv;
+    configure(adv);
+
+    CHECK(adv.start());
+    s_ctrl.active = false;
+    s_ctrl.data_commands = 0;
+    adv.onHostSync();
+    CHECK(s_ctrl.active);
+    CHECK(s_ctrl.data_commands == 2);
+    s_ctrl.active = false;
+}
+
+/**
+ * @brief The fast phase runs for its duration, then advertising continues forever at the configured interval.
+ */
+static void fast_phase_falls_back(void)
+{
+    NimBLEAdvertising adv;
+    configure(adv);
+
+    CHECK(adv.start());
+    CHECK(s_ctrl.itvl_min == 32 && s_ctrl.itvl_max == 48);
+    CHECK(s_ctrl.duration == 30000);
+
+    adv_complete(BLE_HS_ETIMEOUT);
+    CHECK(s_ctrl.active);
+    CHECK(s_ctrl.itvl_min == 244 && s_ctrl.itvl_max == 338);
+    CHECK(s_ctrl.duration == BLE_HS_FOREVER);
+    s_ctrl.active = false;
+}
+
+static void run_benchmark(int starts)
+{
+    NimBLEAdvertising adv;
+    configure(adv);
+
+    const char *names[3] = {"first start", "restart after disconnect", "restart after host reset"};
+    double first_pdu_us[3] = {};
+    int commands[3] = {};
+    for (int i = 0; i < starts; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            if (k == 0)
+            {
+                adv.setAppearance(0x03C4); // The configuration was touched
+            }
+            double start_us = s_ctrl.now_us;
+            int start_commands = s_ctrl.commands;
+            if (k == 2)
+            {
+                adv.onHostSync();
+            }
+            else
+            {
+                adv.start();
+            }
+            first_pdu_us[k] += s_ctrl.first_pdu_us - start_us;
+            commands[k] += s_ctrl.commands - start_commands;
+            s_ctrl.active = false;
+        }
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        printf("%-26s start to first PDU %.2f ms, %.1f HCI commands\n", names[k], first_pdu_us[k] / starts / 1000,
+               (double)commands[k] / starts);
+    }
+
+    // Host CPU time of start() alone
+    s_ctrl.hci_us = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < starts; i++)
+    {
+        adv.start();
+        s_ctrl.active = false;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < starts; i++)
+    {
+        adv.setAppearance(0x03C4);
+        adv.start();
+        s_ctrl.active = false;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    s_ctrl.hci_us = HCI_US;
+
+    auto ns = [starts](auto from, auto to)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / starts; };
+    printf("host CPU per start(): restart %.0f ns, after a configuration change %.0f ns\n", ns(t0, t1), ns(t1, t2));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(restart_keeps_the_payload);
+    RUN_TEST(host_sync_reloads_the_payload);
+    RUN_TEST(fast_phase_falls_back);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 20000);
+    return host_test_failures;
+}
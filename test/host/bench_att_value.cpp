@@ -0,0 +1,166 @@
+/**
+ * @file bench_att_value.cpp
+ * @brief Checks that NimBLEAttValue's single writer read never returns a torn value, and times read.
+ *
+ * One writer thread plays the task updating a report value, several reader threads play the host
+ * task answering reads and building notifications. Every value the writer sets is self describing:
+ * all its bytes are the same and its length follows from that byte, so a reader can tell a copy
+ * that mixed two updates from a real value.
+ *
+ *   bench_att_value [writes]
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// The header relies on its includer for the host definitions, like the attribute classes do
+#include "host/ble_hs.h"
+#include "NimBLEAttValue.h"
+#include "host_test.h"
+
+static constexpr uint16_t VALUE_LEN = CONFIG_NIMBLE_CPP_ATT_VALUE_INLINE_LENGTH;
+
+/**
+ * @brief The value the writer sets for a counter, its length changes with every update.
+ */
+static uint16_t make_value(uint32_t counter, uint8_t *value)
+{
+    uint8_t b = (uint8_t)counter;
+    uint16_t len = 1 + b % VALUE_LEN;
+    memset(value, b, len);
+    return len;
+}
+
+static bool is_whole(const uint8_t *value, uint16_t len)
+{
+    if (len == 0 || len != 1 + value[0] % VALUE_LEN)
+    {
+        return false;
+    }
+    for (uint16_t i = 1; i < len; i++)
+    {
+        if (value[i] != value[0])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Values longer than the inline storage are refused, the value stays as it was.
+ */
+static void single_writer_stays_inline(void)
+{
+    uint8_t value[VALUE_LEN + 1];
+    uint8_t out[VALUE_LEN + 1];
+    NimBLEAttValue att;
+
+    memset(value, 0x5a, sizeof(value));
+    CHECK(att.setValue(value, VALUE_LEN + 1));
+    CHECK(!att.setSingleWriter(true));
+
+    CHECK(att.setValue(value, 4));
+    CHECK(att.setSingleWriter(true) && att.isSingleWriter());
+    CHECK(!att.setValue(value, VALUE_LEN + 1));
+    CHECK(att.read(out, sizeof(out)) == 4 && memcmp(out, value, 4) == 0);
+    CHECK(att.read(out, 2) == 2);
+
+    att.append(value, 1);
+    CHECK(att.size() == 4);
+
+    CHECK(att.setSingleWriter(false) && !att.isSingleWriter());
+    CHECK(att.setValue(value, VALUE_LEN + 1) && att.size() == VALUE_LEN + 1);
+}
+
+/**
+ * @brief One writer and several readers, no reader ever sees a value the writer did not set.
+ */
+static void readers_see_whole_values(int writes)
+{
+    const int readers = std::max(2u, std::min(4u, std::thread::hardware_concurrency() - 1));
+    NimBLEAttValue att;
+    uint8_t value[VALUE_LEN];
+
+    att.setValue(value, make_value(0, value));
+    CHECK(att.setSingleWriter(true));
+
+    std::atomic<bool> done{false};
+    std::atomic<long> torn{0};
+    std::atomic<long> reads{0};
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; r++)
+    {
+        threads.emplace_back([&]
+        {
+            uint8_t out[VALUE_LEN];
+            long n = 0;
+            long bad = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                uint16_t len = att.read(out, sizeof(out));
+                bad += !is_whole(out, len);
+                n++;
+            }
+            torn += bad;
+            reads += n;
+        });
+    }
+
+    for (int i = 1; i <= writes; i++)
+    {
+        CHECK(att.setValue(value, make_value(i, value)));
+    }
+    done = true;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    printf("%d writes, %d readers, %ld reads, %ld torn\n", writes, readers, reads.load(), torn.load());
+}
+
+static void run_benchmark(int rounds)
+{
+    NimBLEAttValue att;
+    uint8_t value[VALUE_LEN];
+    uint8_t out[VALUE_LEN];
+    att.setValue(value, make_value(VALUE_LEN - 1, value));
+    att.setSingleWriter(true);
+
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+        sink += att.read(out, sizeof(out));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+    {
+        sink += att.setValue(value, VALUE_LEN);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    asm volatile("" : : "r"(sink));
+
+    auto ns = [rounds](auto from, auto to)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / rounds; };
+    printf("%u byte value, single writer: read %5.2f ns, setValue %5.2f ns\n", VALUE_LEN, ns(t0, t1), ns(t1, t2));
+}
+
+int main(int argc, char **argv)
+{
+    int writes = argc > 1 ? atoi(argv[1]) : 2000000;
+
+    RUN_TEST(single_writer_stays_inline);
+
+    readers_see_whole_values(writes);
+    run_benchmark(writes);
+    return host_test_failures;
+}
@@ -0,0 +1,301 @@
+/**
+ * @file bench_beacon_frame.cpp
+ * @brief Round trips the iBeacon and Eddystone frames through an advertisement, and times reading them.
+ *
+ * Random frames are encoded into the manufacturer and service data of a payload, read back with
+ * NimBLEAdvertisedDevice::getBeaconFrame() and getEddystoneFrame(), and handed to the legacy
+ * NimBLEBeacon and NimBLEEddystone* classes, which must read the same values from the same bytes.
+ * URLs are built from random pieces, expansion texts among them, and must format back to themselves.
+ *
+ *   bench_beacon_frame [frames]
+ */
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// setPayload() is only called by the scan
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEAdvertisedDevice.h"
+#undef private
+#include "NimBLEBeacon.h"
+#include "NimBLEEddystoneTLM.h"
+#include "NimBLEEddystoneURL.h"
+
+#include "host_test.h"
+
+static uint16_t swap16(uint16_t x)
+{
+    return x >> 8 | x << 8;
+}
+
+static std::vector<uint8_t> beacon_payload(const NimBLEBeaconFrame &frame)
+{
+    std::vector<uint8_t> p = {2, BLE_HS_ADV_TYPE_FLAGS, 0x06, NimBLEBeaconFrame::SIZE + 1, BLE_HS_ADV_TYPE_MFG_DATA};
+    p.resize(p.size() + NimBLEBeaconFrame::SIZE);
+    CHECK(frame.encode(&p[5], NimBLEBeaconFrame::SIZE) == NimBLEBeaconFrame::SIZE);
+    return p;
+}
+
+/**
+ * @brief A scan response with TX power and an Eddystone frame after it.
+ */
+template <typename Frame> static std::vector<uint8_t> eddystone_payload(const Frame &frame)
+{
+    uint8_t data[32];
+    size_t len = frame.encode(data, sizeof(data));
+    CHECK(len > 0);
+    std::vector<uint8_t> p = {2, BLE_HS_ADV_TYPE_TX_PWR_LVL, 4};
+    p.insert(p.end(), {uint8_t(len + 3), BLE_HS_ADV_TYPE_SVC_DATA_UUID16, 0xAA, 0xFE});
+    p.insert(p.end(), data, data + len);
+    CHECK(p.size() <= 31);
+    return p;
+}
+
+static NimBLEBeaconFrame random_beacon(std::mt19937 &rng)
+{
+    NimBLEBeaconFrame frame;
+    frame.manufacturerId = rng() % 4 ? NimBLEBeaconFrame::APPLE_COMPANY_ID : rng();
+    for (uint8_t &b : frame.proximityUUID)
+    {
+        b = rng();
+    }
+    frame.major = rng();
+    frame.minor = rng();
+    frame.signalPower = rng();
+    return frame;
+}
+
+static NimBLEEddystoneTLMFrame random_tlm(std::mt19937 &rng)
+{
+    NimBLEEddystoneTLMFrame frame;
+    frame.volt = rng();
+    frame.temp = rng();
+    frame.advCount = rng();
+    frame.uptime = rng();
+    return frame;
+}
+
+/**
+ * @brief A URL of a scheme, a host, maybe a top level domain and maybe a path.
+ */
+static std::string random_url(std::mt19937 &rng)
+{
+    static const char *const schemes[] = {"http://www.", "https://www.", "http://", "https://"};
+    static const char *const tlds[] = {".com", ".org", ".edu", ".net", ".info", ".biz", ".gov", ".io", ".co"};
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789-_~";
+
+    std::string url = schemes[rng() % 4];
+    for (int n = 1 + rng() % 12; n > 0; n--)
+    {
+        url += chars[rng() % (sizeof(chars) - 1)];
+    }
+    if (rng() % 4)
+    {
+        url += tlds[rng() % 9];
+    }
+    if (rng() % 2)
+    {
+        url += '/';
+        for (int n = rng() % 6; n > 0; n--)
+        {
+            url += chars[rng() % (sizeof(chars) - 1)];
+        }
+    }
+    return url;
+}
+
+static std::string format_url(const NimBLEEddystoneURLFrame &frame)
+{
+    char text[64];
+    size_t len = frame.formatURL(text, sizeof(text));
+    CHECK(len < sizeof(text) && strlen(text) == len);
+    return text;
+}
+
+/**
+ * @brief iBeacon frames read from the manufacturer data are the frames sent, the legacy class agrees.
+ */
+static void beacon_round_trip(int frames)
+{
+    std::mt19937 rng(1);
+    NimBLEAdvertisedDevice dev;
+    for (int i = 0; i < frames; i++)
+    {
+        NimBLEBeaconFrame sent = random_beacon(rng);
+        std::vector<uint8_t> adv = beacon_payload(sent);
+        dev.setPayload(adv.data(), adv.size(), false);
+
+        NimBLEBeaconFrame got;
+        CHECK(dev.getBeaconFrame(&got));
+        CHECK(got.manufacturerId == sent.manufacturerId && got.major == sent.major && got.minor == sent.minor);
+        CHECK(got.signalPower == sent.signalPower);
+        CHECK(memcmp(got.proximityUUID, sent.proximityUUID, 16) == 0);
+
+        NimBLEBeacon legacy;
+        legacy.setData(dev.getManufacturerData());
+        CHECK(legacy.getManufacturerId() == sent.manufacturerId);
+        CHECK(swap16(legacy.getMajor()) == sent.major && swap16(legacy.getMinor()) == sent.minor);
+        CHECK(legacy.getSignalPower() == sent.signalPower);
+        CHECK(legacy.getProximityUUID() == got.getProximityUUID());
+        CHECK(legacy.getData() == std::string((const char *)&adv[5], NimBLEBeaconFrame::SIZE));
+    }
+
+    // Manufacturer data of another layout is not a beacon
+    std::vector<uint8_t> adv = {2, BLE_HS_ADV_TYPE_FLAGS, 0x06, 7, BLE_HS_ADV_TYPE_MFG_DATA, 0x4C, 0x00, 0x02, 0x15, 1, 2};
+    dev.setPayload(adv.data(), adv.size(), false);
+    NimBLEBeaconFrame untouched;
+    untouched.major = 7;
+    CHECK(!dev.getBeaconFrame(&untouched) && untouched.major == 7);
+}
+
+/**
+ * @brief TLM frames read from the service data are the frames sent, the legacy class agrees.
+ */
+static void tlm_round_trip(int frames)
+{
+    std::mt19937 rng(2);
+    NimBLEAdvertisedDevice dev;
+    for (int i = 0; i < frames; i++)
+    {
+        NimBLEEddystoneTLMFrame sent = random_tlm(rng);
+        std::vector<uint8_t> rsp = eddystone_payload(sent);
+        dev.setPayload(rsp.data(), rsp.size(), true);
+
+        NimBLEEddystoneTLMFrame got;
+        NimBLEEddystoneURLFrame url;
+        CHECK(dev.getEddystoneFrame(&got) && !dev.getEddystoneFrame(&url));
+        CHECK(got.volt == sent.volt && got.temp == sent.temp && got.getTemp() == sent.temp / 256.0f);
+        CHECK(got.advCount == sent.advCount && got.uptime == sent.uptime);
+
+        NimBLEEddystoneTLM legacy;
+        legacy.setData(dev.getServiceData(NimBLEUUID(NimBLEEddystoneTLMFrame::SERVICE_UUID)));
+        // The legacy class reads the temperature as unsigned and returns the uptime in seconds
+        CHECK(legacy.getVersion() == 0 && legacy.getVolt() == sent.volt);
+        CHECK(legacy.getTemp() == uint16_t(sent.temp) / 256.0f);
+        CHECK(legacy.getCount() == sent.advCount && legacy.getTime() == sent.uptime / 10);
+    }
+
+    // Encrypted TLM frames are not read
+    NimBLEEddystoneTLMFrame sent;
+    std::vector<uint8_t> rsp = eddystone_payload(sent);
+    rsp[8] = 1;
+    dev.setPayload(rsp.data(), rsp.size(), true);
+    NimBLEEddystoneTLMFrame got;
+    CHECK(!dev.getEddystoneFrame(&got));
+}
+
+/**
+ * @brief URLs that fit come back from the service data as they were set, the legacy class agrees.
+ */
+static void url_round_trip(int frames)
+{
+    std::mt19937 rng(3);
+    NimBLEAdvertisedDevice dev;
+    int fit = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        std::string text = random_url(rng);
+        NimBLEEddystoneURLFrame sent;
+        sent.txPower = rng();
+        if (!sent.setURL(text))
+        {
+            // Only URLs longer than the limit are refused, each expansion text is at least 4 characters
+            CHECK(text.size() > NimBLEEddystoneURLFrame::URL_MAX + 7);
+            CHECK(sent.urlLength == 0);
+            continue;
+        }
+        fit++;
+        CHECK(sent.urlLength <= NimBLEEddystoneURLFrame::URL_MAX);
+        CHECK(format_url(sent) == text);
+
+        std::vector<uint8_t> rsp = eddystone_payload(sent);
+        dev.setPayload(rsp.data(), rsp.size(), true);
+        NimBLEEddystoneURLFrame got;
+        NimBLEEddystoneTLMFrame tlm;
+        CHECK(dev.getEddystoneFrame(&got) && !dev.getEddystoneFrame(&tlm));
+        CHECK(got.txPower == sent.txPower && got.scheme == sent.scheme && got.urlLength == sent.urlLength);
+        CHECK(format_url(got) == text);
+
+        // The legacy class holds the scheme and 15 bytes of URL, not the 17 of the specification
+        if (sent.urlLength <= 15)
+        {
+            NimBLEEddystoneURL legacy;
+            legacy.setData(dev.getServiceData(NimBLEUUID(NimBLEEddystoneURLFrame::SERVICE_UUID)));
+            CHECK(legacy.getPower() == sent.txPower && legacy.getDecodedURL() == text);
+        }
+    }
+    CHECK(fit > frames / 2);
+    printf("%d of %d URLs fit\n", fit, frames);
+
+    // Formatting into a short buffer truncates and terminates
+    NimBLEEddystoneURLFrame frame;
+    char text[8];
+    CHECK(frame.setURL("https://example.org/a") && frame.formatURL(text, sizeof(text)) == 21);
+    CHECK(std::string(text) == "https:/");
+}
+
+static void run_benchmark(int iterations)
+{
+    std::mt19937 rng(4);
+    NimBLEAdvertisedDevice beacon;
+    std::vector<uint8_t> adv = beacon_payload(random_beacon(rng));
+    beacon.setPayload(adv.data(), adv.size(), false);
+    NimBLEAdvertisedDevice eddystone;
+    NimBLEEddystoneURLFrame url;
+    url.setURL("https://www.example.com/gamepad");
+    std::vector<uint8_t> rsp = eddystone_payload(url);
+    eddystone.setPayload(rsp.data(), rsp.size(), true);
+    size_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        NimBLEBeacon legacy;
+        legacy.setData(beacon.getManufacturerData());
+        sink += legacy.getMajor() + legacy.getProximityUUID().bitSize();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        NimBLEBeaconFrame frame;
+        sink += beacon.getBeaconFrame(&frame) + frame.major + frame.getProximityUUID().bitSize();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        NimBLEEddystoneURL legacy;
+        legacy.setData(eddystone.getServiceData(NimBLEUUID(NimBLEEddystoneURLFrame::SERVICE_UUID)));
+        sink += legacy.getDecodedURL().size();
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        NimBLEEddystoneURLFrame frame;
+        char text[64];
+        sink += eddystone.getEddystoneFrame(&frame) + frame.formatURL(text, sizeof(text));
+    }
+    auto t4 = std::chrono::steady_clock::now();
+    asm volatile("" : : "r"(sink));
+
+    auto ns = [iterations](auto from, auto to)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / iterations; };
+    printf("iBeacon, NimBLEBeacon:             %6.1f ns\n", ns(t0, t1));
+    printf("iBeacon, getBeaconFrame:           %6.1f ns\n", ns(t1, t2));
+    printf("Eddystone URL, NimBLEEddystoneURL: %6.1f ns\n", ns(t2, t3));
+    printf("Eddystone URL, getEddystoneFrame:  %6.1f ns\n", ns(t3, t4));
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 20000;
+
+    beacon_round_trip(frames);
+    tlm_round_trip(frames);
+    url_round_trip(frames);
+
+    run_benchmark(frames * 100);
+    return host_test_failures;
+}
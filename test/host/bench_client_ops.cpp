@@ -0,0 +1,586 @@
+/**
+ * @file bench_client_ops.cpp
+ * @brief Checks NimBLEClient's queued GATT operations: FIFO order, error propagation, the write
+ * without response retry and a link dropped with an operation in flight. Times the queue.
+ *
+ * Built against the real NimBLEClient.cpp and remote attribute classes. This file plays the NimBLE
+ * host: the porting layer event queue and callouts run when run_host() is called, like the host
+ * task, and the GATT client procedures are a mock peer with an attribute table that answers one
+ * request at a time. Reads are answered in MTU sized parts like ble_gattc_read_long(), and the
+ * peer logs every request it receives so the order on the link can be checked.
+ *
+ *   bench_client_ops [ops]
+ */
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// The client's queue state and its GAP handler are private
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEClient.h"
+#undef private
+
+#include "host_test.h"
+
+#define MOCK_CONN_HANDLE 1
+#define MOCK_MTU 23
+
+/*************************** Host task ****************************/
+
+static std::deque<ble_npl_event *> s_events;
+static std::vector<ble_npl_callout *> s_callouts;
+static bool s_in_host;
+
+void ble_npl_event_init(ble_npl_event *ev, ble_npl_event_fn *fn, void *arg)
+{
+    ev->fn = fn;
+    ev->arg = arg;
+    ev->queued = false;
+}
+
+void ble_npl_event_deinit(ble_npl_event *ev) {}
+
+void ble_npl_eventq_put(ble_npl_eventq *evq, ble_npl_event *ev)
+{
+    if (!ev->queued)
+    {
+        ev->queued = true;
+        s_events.push_back(ev);
+    }
+}
+
+void ble_npl_eventq_remove(ble_npl_eventq *evq, ble_npl_event *ev)
+{
+    for (auto it = s_events.begin(); it != s_events.end(); ++it)
+    {
+        if (*it == ev)
+        {
+            s_events.erase(it);
+            break;
+        }
+    }
+    ev->queued = false;
+}
+
+ble_npl_eventq *nimble_port_get_dflt_eventq(void)
+{
+    static ble_npl_eventq evq;
+    return &evq;
+}
+
+void ble_npl_callout_init(ble_npl_callout *co, ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg)
+{
+    ble_npl_event_init(&co->ev, fn, arg);
+    co->evq = evq;
+    co->active = false;
+    s_callouts.push_back(co);
+}
+
+int ble_npl_callout_reset(ble_npl_callout *co, ble_npl_time_t ticks)
+{
+    co->ticks = ticks;
+    co->active = true;
+    return 0;
+}
+
+void ble_npl_callout_stop(ble_npl_callout *co)
+{
+    co->active = false;
+}
+
+void ble_npl_callout_deinit(ble_npl_callout *co)
+{
+    co->active = false;
+    for (auto it = s_callouts.begin(); it != s_callouts.end(); ++it)
+    {
+        if (*it == co)
+        {
+            s_callouts.erase(it);
+            break;
+        }
+    }
+}
+
+/*************************** Mock peer ****************************/
+
+struct mock_request_t
+{
+    enum { READ, READ_MULT, WRITE, WRITE_LONG, WRITE_NO_RSP } type;
+    uint16_t handle;
+    std::vector<uint16_t> handles;
+    std::string value;
+    uint16_t offset;
+    ble_gatt_attr_fn *cb;
+    void *arg;
+};
+
+static std::map<uint16_t, std::string> s_attrs;
+static std::vector<mock_request_t> s_log;
+static mock_request_t s_pending;
+static bool s_busy;
+static bool s_connected;
+static int s_no_rsp_credits;
+
+// The host buffers a write without response holds until the controller sent it
+#define MOCK_NO_RSP_CREDITS 1000000
+
+static int start_request(const mock_request_t &req)
+{
+    if (!s_connected)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    // ATT allows one outstanding request per link, the queue must never start a second
+    CHECK(!s_busy);
+    s_log.push_back(req);
+    s_pending = req;
+    s_busy = true;
+    return 0;
+}
+
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset, ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    return start_request({mock_request_t::READ, handle, {}, "", offset, cb, cb_arg});
+}
+
+int ble_gattc_read_mult(uint16_t conn_handle, const uint16_t *handles, uint8_t num_handles, ble_gatt_attr_fn *cb,
+                        void *cb_arg)
+{
+    return start_request(
+        {mock_request_t::READ_MULT, handles[0], std::vector<uint16_t>(handles, handles + num_handles), "", 0, cb, cb_arg});
+}
+
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len,
+                         ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    return start_request({mock_request_t::WRITE, attr_handle, {}, std::string((const char *)data, data_len), 0, cb, cb_arg});
+}
+
+int ble_gattc_write_long(uint16_t conn_handle, uint16_t attr_handle, uint16_t offset, os_mbuf *om,
+                         ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    std::string value((const char *)om->om_data, om->om_len);
+    os_mbuf_free_chain(om);
+    return start_request({mock_request_t::WRITE_LONG, attr_handle, {}, value, offset, cb, cb_arg});
+}
+
+int ble_gattc_write_no_rsp_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len)
+{
+    if (!s_connected)
+    {
+        return BLE_HS_ENOTCONN;
+    }
+    if (s_no_rsp_credits == 0)
+    {
+        return BLE_HS_ENOMEM;
+    }
+    s_no_rsp_credits--;
+    std::string value((const char *)data, data_len);
+    s_log.push_back({mock_request_t::WRITE_NO_RSP, attr_handle, {}, value, 0, nullptr, nullptr});
+    if (s_attrs.count(attr_handle))
+    {
+        s_attrs[attr_handle] = value;
+    }
+    return 0;
+}
+
+static void respond(uint16_t status, uint16_t handle, const std::string *part)
+{
+    ble_gatt_error error = {status, handle};
+    ble_gatt_attr attr = {handle, 0, nullptr};
+    if (part != nullptr)
+    {
+        attr.om = ble_hs_mbuf_from_flat(part->data(), part->size());
+    }
+    s_pending.cb(MOCK_CONN_HANDLE, &error, part != nullptr ? &attr : nullptr, s_pending.arg);
+    if (attr.om != nullptr)
+    {
+        os_mbuf_free_chain(attr.om);
+    }
+}
+
+/**
+ * @brief The peer answers the pending request, a long read takes several responses.
+ */
+static void answer_pending(void)
+{
+    mock_request_t &req = s_pending;
+    auto missing = [](uint16_t handle) { return s_attrs.count(handle) == 0; };
+
+    switch (req.type)
+    {
+    case mock_request_t::READ:
+    {
+        if (missing(req.handle))
+        {
+            s_busy = false;
+            respond(BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE), req.handle, nullptr);
+            return;
+        }
+        const std::string &value = s_attrs[req.handle];
+        for (size_t offset = 0;; offset += MOCK_MTU - 1)
+        {
+            std::string part = value.substr(std::min(offset, value.size()), MOCK_MTU - 1);
+            respond(0, req.handle, &part);
+            if (part.size() < MOCK_MTU - 1)
+            {
+                break;
+            }
+        }
+        s_busy = false;
+        respond(BLE_HS_EDONE, req.handle, nullptr);
+        return;
+    }
+
+    case mock_request_t::READ_MULT:
+    {
+        std::string value;
+        for (uint16_t handle : req.handles)
+        {
+            if (missing(handle))
+            {
+                s_busy = false;
+                respond(BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE), handle, nullptr);
+                return;
+            }
+            value += s_attrs[handle];
+        }
+        s_busy = false;
+        value.resize(std::min(value.size(), (size_t)MOCK_MTU - 1));
+        respond(0, req.handle, &value);
+        return;
+    }
+
+    default:
+        s_busy = false;
+        if (missing(req.handle))
+        {
+            respond(BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE), req.handle, nullptr);
+            return;
+        }
+        s_attrs[req.handle] = req.value;
+        respond(0, req.handle, nullptr);
+        return;
+    }
+}
+
+/**
+ * @brief Run the host task until it is idle: queued events first, then the peer's response, then
+ * expired callouts. The controller sends the buffered writes while time passes.
+ */
+static void run_host(bool answer = true)
+{
+    s_in_host = true;
+    for (;;)
+    {
+        if (!s_events.empty())
+        {
+            ble_npl_event *ev = s_events.front();
+            s_events.pop_front();
+            ev->queued = false;
+            ev->fn(ev);
+            continue;
+        }
+        if (answer && s_busy)
+        {
+            answer_pending();
+            continue;
+        }
+        ble_npl_callout *expired = nullptr;
+        for (ble_npl_callout *co : s_callouts)
+        {
+            expired = co->active && (expired == nullptr || co->ticks < expired->ticks) ? co : expired;
+        }
+        if (expired == nullptr)
+        {
+            break;
+        }
+        expired->active = false;
+        s_no_rsp_credits = MOCK_NO_RSP_CREDITS;
+        expired->ev.fn(&expired->ev);
+    }
+    s_in_host = false;
+}
+
+/**
+ * @brief The link drops: the host fails the procedure in flight, then reports the disconnect.
+ */
+static void drop_link(NimBLEClient *pClient)
+{
+    s_connected = false;
+    s_in_host = true;
+    if (s_busy)
+    {
+        s_busy = false;
+        respond(BLE_HS_ENOTCONN, s_pending.handle, nullptr);
+    }
+    ble_gap_event event = {};
+    event.type = BLE_GAP_EVENT_DISCONNECT;
+    event.disconnect.reason = BLE_ERR_REM_USER_CONN_TERM;
+    event.disconnect.conn.conn_handle = MOCK_CONN_HANDLE;
+    NimBLEClient::handleGapEvent(&event, pClient);
+    s_in_host = false;
+}
+
+static NimBLEClient *connect_client(void)
+{
+    s_attrs.clear();
+    s_log.clear();
+    s_busy = false;
+    s_connected = true;
+    s_no_rsp_credits = MOCK_NO_RSP_CREDITS;
+    for (uint16_t handle = 0x10; handle < 0x30; handle++)
+    {
+        s_attrs[handle] = std::string(1, (char)handle);
+    }
+
+    NimBLEClient *pClient = NimBLEDevice::createClient(NimBLEAddress(0xa4c1385def16ULL));
+    NimBLEDevice::setClientConnId(pClient, MOCK_CONN_HANDLE);
+    pClient->m_connEstablished = true;
+    return pClient;
+}
+
+static void delete_client(NimBLEClient *pClient)
+{
+    if (pClient->isConnected())
+    {
+        drop_link(pClient);
+    }
+    run_host();
+    CHECK(!pClient->m_opBusy && pClient->getPendingOpCount() == 0);
+    NimBLEDevice::removeClient(pClient);
+}
+
+/**
+ * @brief The record of one completion callback.
+ */
+struct completion_t
+{
+    int id;
+    int rc;
+    std::string value;
+    bool in_host;
+};
+
+static std::vector<completion_t> s_done;
+
+static gatt_op_callback record(int id)
+{
+    return [id](int rc, const NimBLEAttValue &value)
+    { s_done.push_back({id, rc, std::string((const char *)value.data(), value.size()), s_in_host}); };
+}
+
+/*************************** Tests ****************************/
+
+/**
+ * @brief Mixed reads and writes complete in the order queued, one request on the link at a time,
+ * and every callback runs in the host task, writes without response included.
+ */
+static void ops_complete_in_order(void)
+{
+    NimBLEClient *pClient = connect_client();
+    s_done.clear();
+
+    std::string longValue(50, 'L');
+    std::string shortValue = "abc";
+    uint16_t mult[] = {0x10, 0x11, 0x12};
+    s_attrs[0x20] = std::string(60, 'R');
+
+    CHECK(pClient->writeValueAsync(0x13, (const uint8_t *)shortValue.data(), shortValue.size(), false, record(0)));
+    CHECK(pClient->readValueAsync(0x20, record(1)));
+    CHECK(pClient->writeValueAsync(0x14, (const uint8_t *)longValue.data(), longValue.size(), true, record(2)));
+    CHECK(pClient->readValuesAsync(mult, 3, record(3)));
+    CHECK(pClient->writeValueAsync(0x15, (const uint8_t *)shortValue.data(), shortValue.size(), true, record(4)));
+    CHECK(pClient->writeValueAsync(0x16, (const uint8_t *)longValue.data(), longValue.size(), false, record(5)));
+    CHECK(pClient->readValueAsync(0x14, record(6)));
+
+    // Nothing ran in the task that queued them
+    CHECK(s_done.empty() && s_log.empty());
+    CHECK(pClient->getPendingOpCount() == 7);
+
+    run_host();
+    CHECK(s_done.size() == 7 && pClient->getPendingOpCount() == 0 && !pClient->m_opBusy);
+    for (size_t i = 0; i < s_done.size(); i++)
+    {
+        CHECK(s_done[i].id == (int)i && s_done[i].rc == 0 && s_done[i].in_host);
+    }
+
+    // The order on the link, the long write without response falls back to a long write
+    const int types[] = {mock_request_t::WRITE_NO_RSP, mock_request_t::READ,      mock_request_t::WRITE_LONG,
+                         mock_request_t::READ_MULT,    mock_request_t::WRITE,     mock_request_t::WRITE_LONG,
+                         mock_request_t::READ};
+    const uint16_t handles[] = {0x13, 0x20, 0x14, 0x10, 0x15, 0x16, 0x14};
+    CHECK(s_log.size() == 7);
+    for (size_t i = 0; i < s_log.size() && i < 7; i++)
+    {
+        CHECK(s_log[i].type == types[i] && s_log[i].handle == handles[i]);
+    }
+
+    CHECK(s_done[1].value == s_attrs[0x20]);
+    CHECK(s_done[2].value == longValue && s_attrs[0x14] == longValue);
+    CHECK(s_done[3].value == "\x10\x11\x12");
+    CHECK(s_attrs[0x15] == shortValue && s_attrs[0x16] == longValue);
+    CHECK(s_done[6].value == longValue);
+    delete_client(pClient);
+}
+
+/**
+ * @brief An operation queued from a callback goes behind the ones already queued.
+ */
+static void callbacks_queue_behind(void)
+{
+    NimBLEClient *pClient = connect_client();
+    s_done.clear();
+
+    CHECK(pClient->readValueAsync(0x10, [pClient](int rc, const NimBLEAttValue &value)
+    {
+        record(0)(rc, value);
+        CHECK(pClient->readValueAsync(0x13, record(3)));
+    }));
+    CHECK(pClient->readValueAsync(0x11, record(1)));
+    CHECK(pClient->readValueAsync(0x12, record(2)));
+
+    run_host();
+    CHECK(s_done.size() == 4);
+    for (size_t i = 0; i < s_done.size(); i++)
+    {
+        CHECK(s_done[i].id == (int)i && s_done[i].rc == 0);
+        CHECK(s_done[i].value == std::string(1, (char)(0x10 + i)));
+    }
+    delete_client(pClient);
+}
+
+/**
+ * @brief A failed operation reports the peer's error to its own callback only, the rest still run.
+ */
+static void errors_propagate(void)
+{
+    NimBLEClient *pClient = connect_client();
+    s_done.clear();
+    uint8_t byte = 7;
+    uint16_t mult[] = {0x10, 0x99};
+
+    CHECK(pClient->readValueAsync(0x99, record(0)));
+    CHECK(pClient->writeValueAsync(0x10, &byte, 1, true, record(1)));
+    CHECK(pClient->writeValueAsync(0x98, &byte, 1, true, record(2)));
+    CHECK(pClient->readValuesAsync(mult, 2, record(3)));
+    CHECK(pClient->readValueAsync(0x10, record(4)));
+
+    // Refused before they are queued
+    CHECK(!pClient->readValuesAsync(mult, 0, record(5)));
+    CHECK(!pClient->readValuesAsync(mult, NimBLEClient::MAX_READ_MULT + 1, record(5)));
+    std::vector<uint8_t> tooLong(BLE_ATT_ATTR_MAX_LEN + 1);
+    CHECK(!pClient->writeValueAsync(0x10, tooLong.data(), tooLong.size(), true, record(5)));
+
+    run_host();
+    const int expected[] = {BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE), 0, BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE),
+                            BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_HANDLE), 0};
+    CHECK(s_done.size() == 5);
+    for (size_t i = 0; i < s_done.size() && i < 5; i++)
+    {
+        CHECK(s_done[i].id == (int)i && s_done[i].rc == expected[i]);
+    }
+    CHECK(s_done.size() == 5 && s_done[4].value == "\x07");
+    delete_client(pClient);
+}
+
+/**
+ * @brief Writes without response wait for host buffers and stay in order with what follows.
+ */
+static void no_rsp_writes_wait_for_buffers(void)
+{
+    NimBLEClient *pClient = connect_client();
+    s_done.clear();
+    s_no_rsp_credits = 2;
+
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        CHECK(pClient->writeValueAsync(0x10 + i, &i, 1, false, record(i)));
+    }
+    CHECK(pClient->readValueAsync(0x15, record(6)));
+
+    run_host();
+    CHECK(s_done.size() == 7);
+    for (size_t i = 0; i < s_done.size(); i++)
+    {
+        CHECK(s_done[i].id == (int)i && s_done[i].rc == 0 && s_done[i].in_host);
+    }
+    CHECK(s_log.size() == 7 && s_log.back().type == mock_request_t::READ);
+    CHECK(s_done.size() == 7 && s_done[6].value == "\x05");
+    delete_client(pClient);
+}
+
+/**
+ * @brief A link dropped with a read in flight fails it and the rest of the queue with
+ * BLE_HS_ENOTCONN, in order, before the client can be deleted.
+ */
+static void dropped_link_fails_queue(void)
+{
+    NimBLEClient *pClient = connect_client();
+    s_done.clear();
+    uint8_t byte = 1;
+
+    CHECK(pClient->readValueAsync(0x10, record(0)));
+    CHECK(pClient->writeValueAsync(0x11, &byte, 1, true, record(1)));
+    CHECK(pClient->writeValueAsync(0x12, &byte, 1, false, record(2)));
+
+    // The read is on the link, the peer has not answered
+    run_host(false);
+    CHECK(s_busy && s_log.size() == 1 && s_done.empty());
+
+    drop_link(pClient);
+    run_host();
+    CHECK(s_done.size() == 3);
+    for (size_t i = 0; i < s_done.size(); i++)
+    {
+        CHECK(s_done[i].id == (int)i && s_done[i].rc == BLE_HS_ENOTCONN && s_done[i].in_host);
+    }
+    CHECK(!pClient->m_opBusy && pClient->getPendingOpCount() == 0);
+
+    // Nothing is queued on a closed link
+    CHECK(!pClient->readValueAsync(0x10, record(3)));
+    CHECK(s_done.size() == 3);
+    delete_client(pClient);
+}
+
+static void run_benchmark(int ops)
+{
+    NimBLEClient *pClient = connect_client();
+    int done = 0;
+    uint8_t byte = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+    {
+        pClient->readValueAsync(0x10 + i % 16, [&done](int rc, const NimBLEAttValue &value) { done += rc == 0; });
+    }
+    run_host();
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; i++)
+    {
+        pClient->writeValueAsync(0x10 + i % 16, &byte, 1, false, [&done](int rc, const NimBLEAttValue &value) { done += rc == 0; });
+    }
+    run_host();
+    auto t2 = std::chrono::steady_clock::now();
+    CHECK(done == 2 * ops);
+    delete_client(pClient);
+
+    auto ns = [ops](auto from, auto to) { return std::chrono::duration<double, std::nano>(to - from).count() / ops; };
+    printf("%d ops, queue and complete: read %5.1f ns, write without response %5.1f ns\n", ops, ns(t0, t1), ns(t1, t2));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(ops_complete_in_order);
+    RUN_TEST(callbacks_queue_behind);
+    RUN_TEST(errors_propagate);
+    RUN_TEST(no_rsp_writes_wait_for_buffers);
+    RUN_TEST(dropped_link_fails_queue);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 200000);
+    return host_test_failures;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file bench_client_registry.cpp
+ * @brief Checks NimBLEDevice's client indexes against a search of the slots, and times the lookups at max connections.
+ *
+ * Built with the ESP32 controller maximum of 9 connections, against NimBLEClientRegistry.cpp. The
+ * client here is only what the registry reads: its slot, connection handle and peer address. The
+ * lookups are compared with a walk of a std::list of the same clients, the former container.
+ *
+ *   bench_client_registry [lookups]
+ */
+
+#include <chrono>
+#include <list>
+#include <random>
+
+// The client fields and the indexes are private
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEClient.h"
+#undef private
+
+#include "host_test.h"
+
+NimBLEClient::NimBLEClient(const NimBLEAddress &peerAddress) : m_peerAddress(peerAddress)
+{
+    m_conn_id = BLE_HS_CONN_HANDLE_NONE;
+    m_clientSlot = 0;
+}
+
+NimBLEClient::~NimBLEClient() {}
+
+bool NimBLEClient::isConnected()
+{
+    return m_conn_id != BLE_HS_CONN_HANDLE_NONE;
+}
+
+static NimBLEAddress random_address(std::mt19937 &rng)
+{
+    uint8_t val[6];
+    for (auto &b : val)
+    {
+        b = rng();
+    }
+    return NimBLEAddress(val, BLE_ADDR_RANDOM);
+}
+
+/**
+ * @brief Both lookups must agree with a plain search of the slots.
+ */
+static void check_lookups(const std::vector<uint16_t> &handles, const std::vector<NimBLEAddress> &addresses)
+{
+    for (uint16_t handle : handles)
+    {
+        NimBLEClient *expected = nullptr;
+        for (NimBLEClient *pClient : NimBLEDevice::getClients())
+        {
+            expected = pClient->m_conn_id == handle ? pClient : expected;
+        }
+        CHECK(NimBLEDevice::getClientByID(handle) == expected);
+    }
+    // Clients may share a peer address, any of them will do
+    for (const NimBLEAddress &address : addresses)
+    {
+        bool exists = false;
+        for (NimBLEClient *pClient : NimBLEDevice::getClients())
+        {
+            exists |= pClient->m_peerAddress == address;
+        }
+        NimBLEClient *pFound = NimBLEDevice::getClientByPeerAddress(address);
+        CHECK(exists ? pFound != nullptr && pFound->m_peerAddress == address : pFound == nullptr);
+    }
+}
+
+static void delete_all(void)
+{
+    for (NimBLEClient *pClient : NimBLEDevice::getClients())
+    {
+        NimBLEDevice::setClientConnId(pClient, BLE_HS_CONN_HANDLE_NONE);
+        NimBLEDevice::removeClient(pClient);
+    }
+}
+
+/**
+ * @brief A slot is freed and reused, creating a client with every slot taken fails.
+ */
+static void slots_are_reused(void)
+{
+    std::vector<NimBLEClient *> clients;
+    for (int i = 0; i < NIMBLE_MAX_CONNECTIONS; i++)
+    {
+        clients.push_back(NimBLEDevice::createClient());
+        CHECK(clients.back() != nullptr);
+    }
+    CHECK(NimBLEDevice::createClient() == nullptr);
+    CHECK(NimBLEDevice::getClientListSize() == NIMBLE_MAX_CONNECTIONS);
+
+    NimBLEDevice::removeClient(clients[4]);
+    NimBLEClient *pClient = NimBLEDevice::createClient();
+    CHECK(pClient != nullptr && pClient->m_clientSlot == 4);
+    CHECK(NimBLEDevice::getDisconnectedClient() == clients[0]);
+    delete_all();
+    CHECK(NimBLEDevice::getClientListSize() == 0);
+}
+
+/**
+ * @brief Random creates, connects, disconnects, address changes and deletes keep both indexes right.
+ *
+ * Handles and addresses are drawn from small sets so that probes collide and wrap, and
+ * several clients share a peer address.
+ */
+static void indexes_follow_changes(void)
+{
+    std::mt19937 rng(7);
+    std::vector<uint16_t> handles;
+    std::vector<NimBLEAddress> addresses;
+    for (uint16_t i = 0; i < 40; i++)
+    {
+        handles.push_back(i % 2 ? i : i * NimBLEDevice::CLIENT_INDEX_SIZE + 1);
+    }
+    for (int i = 0; i < 12; i++)
+    {
+        addresses.push_back(random_address(rng));
+    }
+
+    for (int op = 0; op < 20000; op++)
+    {
+        std::vector<NimBLEClient *> clients = NimBLEDevice::getClients();
+        NimBLEClient *pClient = clients.empty() ? nullptr : clients[rng() % clients.size()];
+        switch (rng() % 5)
+        {
+        case 0:
+            NimBLEDevice::createClient(addresses[rng() % addresses.size()]);
+            break;
+        case 1:
+            if (pClient != nullptr && NimBLEDevice::getClientByID(handles[op % handles.size()]) == nullptr)
+            {
+                NimBLEDevice::setClientConnId(pClient, handles[op % handles.size()]);
+            }
+            break;
+        case 2:
+            if (pClient != nullptr)
+            {
+                NimBLEDevice::setClientConnId(pClient, BLE_HS_CONN_HANDLE_NONE);
+            }
+            break;
+        case 3:
+            if (pClient != nullptr)
+            {
+                NimBLEDevice::setClientPeerAddress(pClient, addresses[rng() % addresses.size()]);
+            }
+            break;
+        default:
+            if (pClient != nullptr && rng() % 2)
+            {
+                NimBLEDevice::setClientConnId(pClient, BLE_HS_CONN_HANDLE_NONE);
+                NimBLEDevice::removeClient(pClient);
+            }
+            break;
+        }
+        check_lookups(handles, addresses);
+    }
+    delete_all();
+}
+
+static void run_benchmark(int lookups)
+{
+    // Max connections, handles as the controller hands them out
+    std::mt19937 rng(1);
+    std::list<NimBLEClient *> list;
+    std::vector<NimBLEAddress> addresses;
+    for (uint16_t i = 0; i < NIMBLE_MAX_CONNECTIONS; i++)
+    {
+        addresses.push_back(random_address(rng));
+        NimBLEClient *pClient = NimBLEDevice::createClient(addresses.back());
+        NimBLEDevice::setClientConnId(pClient, i + 1);
+        list.push_back(pClient);
+    }
+
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+        sink += (uintptr_t)NimBLEDevice::getClientByID(i % NIMBLE_MAX_CONNECTIONS + 1);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+        uint16_t handle = i % NIMBLE_MAX_CONNECTIONS + 1;
+        for (NimBLEClient *pClient : list)
+        {
+            if (pClient->m_conn_id == handle)
+            {
+                sink += (uintptr_t)pClient;
+                break;
+            }
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+        sink += (uintptr_t)NimBLEDevice::getClientByPeerAddress(addresses[i % NIMBLE_MAX_CONNECTIONS]);
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; i++)
+    {
+        const NimBLEAddress &address = addresses[i % NIMBLE_MAX_CONNECTIONS];
+        for (NimBLEClient *pClient : list)
+        {
+            if (pClient->m_peerAddress == address)
+            {
+                sink += (uintptr_t)pClient;
+                break;
+            }
+        }
+    }
+    auto t4 = std::chrono::steady_clock::now();
+    asm volatile("" : : "r"(sink));
+    delete_all();
+
+    auto ns = [lookups](auto from, auto to)
+    { return std::chrono::duration<double, std::nano>(to - from).count() / lookups; };
+    printf("%d clients, by handle:  index %5.1f ns, list walk %5.1f ns\n", NIMBLE_MAX_CONNECTIONS, ns(t0, t1), ns(t1, t2));
+    printf("%d clients, by address: index %5.1f ns, list walk %5.1f ns\n", NIMBLE_MAX_CONNECTIONS, ns(t2, t3), ns(t3, t4));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(slots_are_reused);
+    RUN_TEST(indexes_follow_changes);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 10000000);
+    return host_test_failures;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file bench_deferred_log.cpp
+ * @brief Checks NimBLEDeferredLog's dump and readers, and times NIMBLE_LOGx deferred against printed.
+ *
+ * Built with CONFIG_NIMBLE_CPP_LOG_DEFERRED and the debug log level, so NIMBLE_LOGI and NIMBLE_LOGD
+ * are the deferred macros of NimBLELog.h. The records store 32 bit format addresses, the program
+ * is linked without PIE so the host addresses fit.
+ *
+ *   bench_deferred_log [calls]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The reader flag is private to the implementation
+#include "NimBLEDeferredLog.cpp"
+
+#include "host_test.h"
+
+static const char *TAG = "bench";
+
+/**
+ * @brief Decodes a dump with the same formatter as print() and returns the lines.
+ */
+static std::vector<std::string> decode(const uint8_t *dump, size_t len)
+{
+    std::vector<std::string> lines;
+    for (size_t pos = 0; pos + NimBLEDeferredLog::DUMP_HEADER_LEN <= len;)
+    {
+        uint16_t size;
+        uint32_t format;
+        memcpy(&size, dump + pos, sizeof(size));
+        memcpy(&format, dump + pos + 8, sizeof(format));
+
+        char line[128];
+        NimBLEDeferredLog::format(line, sizeof(line), reinterpret_cast<const char *>(static_cast<uintptr_t>(format)),
+                                  dump + pos + NimBLEDeferredLog::DUMP_HEADER_LEN, size - NimBLEDeferredLog::DUMP_HEADER_LEN);
+        lines.push_back(line);
+        pos += size;
+    }
+    return lines;
+}
+
+/**
+ * @brief Records logged on both cores come out of a dump in time order and format like printf.
+ */
+static void dump_matches_printf(void)
+{
+    std::vector<std::string> expected;
+    char line[128];
+    for (int i = 0; i < 6; i++)
+    {
+        host_core_id = i & 1;
+        NIMBLE_LOGI(TAG, "Updated advertiser: %s", "aa:bb:cc:dd:ee:ff");
+        expected.push_back("Updated advertiser: aa:bb:cc:dd:ee:ff");
+        NIMBLE_LOGD(TAG, "x=%5d y=%-4u h=0x%04x c=%c f=%.3f ll=%lld s=%.4s %%", -i, i, 0xbeef, 'A' + i, i * 1.25,
+                    -123456789012LL * i, "abcdefgh");
+        snprintf(line, sizeof(line), "x=%5d y=%-4u h=0x%04x c=%c f=%.3f ll=%lld s=%.4s %%", -i, i, 0xbeef, 'A' + i,
+                 i * 1.25, -123456789012LL * i, "abcdefgh");
+        expected.push_back(line);
+        usleep(10);
+    }
+    host_core_id = 0;
+
+    uint8_t dump[2048];
+    size_t len = NimBLEDeferredLog::dump(dump, sizeof(dump));
+    CHECK(decode(dump, len) == expected);
+    CHECK(NimBLEDeferredLog::dump(dump, sizeof(dump)) == 0);
+}
+
+/**
+ * @brief A record larger than the dump buffer is dropped instead of stalling every later dump.
+ */
+static void large_record_does_not_stall_dump(void)
+{
+    uint32_t dropped = NimBLEDeferredLog::getDropped();
+    std::string name(40, 'n');
+    NIMBLE_LOGI(TAG, "name %s", name.c_str());
+    NIMBLE_LOGI(TAG, "rc=%d", 7);
+
+    uint8_t dump[32];
+    size_t len = NimBLEDeferredLog::dump(dump, sizeof(dump));
+    CHECK(decode(dump, len) == std::vector<std::string>({"rc=7"}));
+    CHECK(NimBLEDeferredLog::getDropped() == dropped + 1);
+
+    // Over RECORD_MAX, never recorded
+    std::string s(63, 's');
+    NIMBLE_LOGI(TAG, "%s %s %s %s", s.c_str(), s.c_str(), s.c_str(), s.c_str());
+    CHECK(NimBLEDeferredLog::getDropped() == dropped + 2);
+    CHECK(NimBLEDeferredLog::dump(dump, sizeof(dump)) == 0);
+}
+
+/**
+ * @brief A reader arriving while another one drains waits for it instead of returning nothing.
+ */
+static void second_reader_waits(void)
+{
+    NIMBLE_LOGI(TAG, "rc=%d", 8);
+
+    __atomic_test_and_set(&s_reading, __ATOMIC_ACQUIRE);
+    std::atomic<size_t> len{SIZE_MAX};
+    uint8_t dump[NimBLEDeferredLog::RECORD_MAX];
+    std::thread reader([&]
+                       { len = NimBLEDeferredLog::dump(dump, sizeof(dump)); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(len == SIZE_MAX);
+    __atomic_clear(&s_reading, __ATOMIC_RELEASE);
+    reader.join();
+    CHECK(decode(dump, len) == std::vector<std::string>({"rc=8"}));
+}
+
+static void run_benchmark(int calls)
+{
+    const int batch = 64;
+    std::string addr = "aa:bb:cc:dd:ee:ff";
+    double deferred_str = 0, printed_str = 0, deferred_int = 0, printed_int = 0, drained = 0;
+
+    using clock = std::chrono::steady_clock;
+    auto ns = [](clock::time_point from, clock::time_point to)
+    { return std::chrono::duration<double, std::nano>(to - from).count(); };
+
+    for (int r = 0; r < calls / batch; r++)
+    {
+        auto t0 = clock::now();
+        for (int i = 0; i < batch; i++)
+        {
+            NIMBLE_LOGI(TAG, "Updated advertiser: %s", addr.c_str());
+        }
+        auto t1 = clock::now();
+        NimBLEDeferredLog::print();
+        auto t2 = clock::now();
+        for (int i = 0; i < batch; i++)
+        {
+            NIMBLE_CPP_LOG_PRINT(ESP_LOG_INFO, TAG, "Updated advertiser: %s", addr.c_str());
+        }
+        auto t3 = clock::now();
+        for (int i = 0; i < batch; i++)
+        {
+            NIMBLE_LOGD(TAG, "notify: rc=%d handle=%u len=%u", i - 3, 42u, (unsigned)i);
+        }
+        auto t4 = clock::now();
+        NimBLEDeferredLog::print();
+        auto t5 = clock::now();
+        for (int i = 0; i < batch; i++)
+        {
+            NIMBLE_CPP_LOG_PRINT(ESP_LOG_DEBUG, TAG, "notify: rc=%d handle=%u len=%u", i - 3, 42u, (unsigned)i);
+        }
+        auto t6 = clock::now();
+
+        deferred_str += ns(t0, t1);
+        printed_str += ns(t2, t3);
+        deferred_int += ns(t3, t4);
+        printed_int += ns(t5, t6);
+        drained += ns(t1, t2) + ns(t4, t5);
+    }
+
+    int n = calls / batch * batch;
+    printf("string arg:      deferred %5.1f ns/call, printed %5.1f ns/call\n", deferred_str / n, printed_str / n);
+    printf("3 integer args:  deferred %5.1f ns/call, printed %5.1f ns/call\n", deferred_int / n, printed_int / n);
+    printf("print task side: %5.1f ns/record, %u records dropped\n", drained / (2 * n), NimBLEDeferredLog::getDropped());
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(dump_matches_printf);
+    RUN_TEST(large_record_does_not_stall_dump);
+    RUN_TEST(second_reader_waits);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 200000);
+    return host_test_failures;
+}
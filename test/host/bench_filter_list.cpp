@@ -0,0 +1,279 @@
+/**
+ * @file bench_filter_list.cpp
+ * @brief Model checks the NimBLEDevice white list, ignore list and controller filter accept list, and
+ * times the scan report filter.
+ *
+ * Random adds and removes on both lists are checked against a std::set model keyed on the address
+ * value and type, with the controller refusing changes now and then like it does while it is
+ * scanning or advertising with the list. A public and a random address with the same value are
+ * both in the address pool.
+ *
+ *   bench_filter_list [ops]
+ */
+
+#include <array>
+#include <chrono>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+// The lists are private, the test reads them to check the controller copy
+#define private public
+#include "NimBLEDevice.h"
+#undef private
+#include "host_test.h"
+
+typedef std::pair<std::array<uint8_t, 6>, uint8_t> addr_key_t;
+
+static addr_key_t key_of(const ble_addr_t &addr)
+{
+    addr_key_t key;
+    memcpy(key.first.data(), addr.val, 6);
+    key.second = addr.type & BLE_ADDR_RANDOM;
+    return key;
+}
+
+/**
+ * @brief Twelve address values, each as a public and as a random address.
+ */
+static std::vector<NimBLEAddress> address_pool(void)
+{
+    std::vector<NimBLEAddress> pool;
+    uint64_t x = 0x5eed;
+    for (int i = 0; i < 12; i++)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t val = 0xa4c138000000ULL | (x >> 40);
+        pool.emplace_back(val, BLE_ADDR_PUBLIC);
+        pool.emplace_back(val, BLE_ADDR_RANDOM);
+    }
+    return pool;
+}
+
+static ble_addr_t native(const NimBLEAddress &address)
+{
+    ble_addr_t addr;
+    memcpy(addr.val, address.getNative(), 6);
+    addr.type = address.getType();
+    return addr;
+}
+
+static void reset_lists(void)
+{
+    NimBLEDevice::m_ignoreListCount = 0;
+    NimBLEDevice::m_whiteListCount = 0;
+    NimBLEDevice::m_ctrlWhiteListCount = 0;
+    NimBLEDevice::m_ctrlWhiteListSynced = false;
+    NimBLEDevice::m_ctrlWhiteListPending = false;
+    NimBLEDevice::m_synced = true;
+    host_wl = {};
+}
+
+/**
+ * @brief The same value with another type is another address, a resolved identity address is its base type.
+ */
+static void type_is_compared(void)
+{
+    reset_lists();
+    NimBLEAddress pub(0xa4c1385def16ULL, BLE_ADDR_PUBLIC);
+    NimBLEAddress rnd(0xa4c1385def16ULL, BLE_ADDR_RANDOM);
+
+    CHECK(NimBLEDevice::whiteListAdd(pub));
+    CHECK(NimBLEDevice::onWhiteList(pub) && !NimBLEDevice::onWhiteList(rnd));
+    CHECK(NimBLEDevice::whiteListAdd(rnd) && NimBLEDevice::getWhiteListCount() == 2);
+    CHECK(host_wl.count == 2);
+
+    CHECK(NimBLEDevice::addIgnored(rnd));
+    CHECK(NimBLEDevice::isIgnored(rnd) && !NimBLEDevice::isIgnored(pub));
+    CHECK(host_wl.count == 1 && host_wl.addrs[0].type == BLE_ADDR_PUBLIC);
+
+    ble_addr_t identity = native(pub);
+    identity.type = BLE_ADDR_PUBLIC_ID;
+    NimBLEDevice::m_ctrlWhiteListSynced = false;
+    CHECK(!NimBLEDevice::isFiltered(identity, true));
+    identity.type = BLE_ADDR_RANDOM_ID;
+    CHECK(NimBLEDevice::isFiltered(identity, false) && NimBLEDevice::isFiltered(identity, true));
+
+    NimBLEDevice::removeIgnored(rnd);
+    CHECK(NimBLEDevice::whiteListRemove(pub) && NimBLEDevice::getWhiteListCount() == 1);
+    CHECK(NimBLEDevice::getWhiteListAddress(0).getType() == BLE_ADDR_RANDOM);
+    CHECK(host_wl.count == 1 && host_wl.addrs[0].type == BLE_ADDR_RANDOM);
+}
+
+/**
+ * @brief A change the controller refuses is kept pending and applied by the retry, an unchanged list is not written.
+ */
+static void busy_controller_retries(void)
+{
+    reset_lists();
+    NimBLEAddress a(0xa4c1385def16ULL);
+    NimBLEAddress b(0xa4c1385def17ULL);
+    NimBLEAddress c(0xa4c1385def18ULL);
+    NimBLEAddress d(0xa4c1385def19ULL);
+
+    CHECK(NimBLEDevice::whiteListAdd(a) && host_wl.writes == 1);
+    CHECK(NimBLEDevice::whiteListAdd(a) && host_wl.writes == 1);
+    CHECK(NimBLEDevice::addIgnored(b) && NimBLEDevice::whiteListAdd(b) && host_wl.writes == 1);
+
+    host_wl.rc = BLE_HS_EBUSY;
+    CHECK(NimBLEDevice::whiteListAdd(c) && host_wl.writes == 2);
+    CHECK(NimBLEDevice::m_ctrlWhiteListPending && !NimBLEDevice::m_ctrlWhiteListSynced);
+    CHECK(!NimBLEDevice::isFiltered(native(c), true) && NimBLEDevice::isFiltered(native(b), true));
+    CHECK(NimBLEDevice::isFiltered(native(d), true));
+
+    host_wl.rc = BLE_HS_ERR_HCI_BASE + BLE_ERR_CMD_DISALLOWED;
+    NimBLEDevice::removeIgnored(b);
+    CHECK(NimBLEDevice::m_ctrlWhiteListPending && host_wl.writes == 3);
+
+    host_wl.rc = 0;
+    NimBLEDevice::whiteListRetry();
+    CHECK(NimBLEDevice::m_ctrlWhiteListSynced && !NimBLEDevice::m_ctrlWhiteListPending);
+    CHECK(host_wl.count == 3 && host_wl.writes == 4);
+    NimBLEDevice::whiteListRetry();
+    CHECK(host_wl.writes == 4);
+}
+
+/**
+ * @brief Random list changes against the model, the controller busy for a tenth of them.
+ */
+static void model_check(int ops)
+{
+    reset_lists();
+    const std::vector<NimBLEAddress> pool = address_pool();
+    std::set<addr_key_t> white;
+    std::set<addr_key_t> ignored;
+    std::mt19937 rng(1);
+
+    for (int op = 0; op < ops; op++)
+    {
+        const NimBLEAddress &address = pool[rng() % pool.size()];
+        addr_key_t key = key_of(native(address));
+        host_wl.rc = rng() % 10 == 0 ? BLE_HS_EBUSY : 0;
+
+        switch (rng() % 4)
+        {
+        case 0:
+        {
+            bool room = white.count(key) || white.size() < CONFIG_NIMBLE_CPP_FILTER_LIST_MAX;
+            CHECK(NimBLEDevice::whiteListAdd(address) == room);
+            if (room)
+            {
+                white.insert(key);
+            }
+            break;
+        }
+        case 1:
+            CHECK(NimBLEDevice::whiteListRemove(address));
+            white.erase(key);
+            break;
+        case 2:
+        {
+            bool room = ignored.count(key) || ignored.size() < CONFIG_NIMBLE_CPP_FILTER_LIST_MAX;
+            CHECK(NimBLEDevice::addIgnored(address) == room);
+            if (room)
+            {
+                ignored.insert(key);
+            }
+            break;
+        }
+        default:
+            NimBLEDevice::removeIgnored(address);
+            ignored.erase(key);
+            break;
+        }
+
+        // The controller holds the list, or the update waits for the retry
+        CHECK(NimBLEDevice::m_ctrlWhiteListSynced || NimBLEDevice::m_ctrlWhiteListPending);
+        if (host_wl.rc == 0)
+        {
+            NimBLEDevice::whiteListRetry();
+            CHECK(NimBLEDevice::m_ctrlWhiteListSynced && !NimBLEDevice::m_ctrlWhiteListPending);
+        }
+
+        std::vector<addr_key_t> accepted;
+        for (const addr_key_t &k : white)
+        {
+            if (!ignored.count(k))
+            {
+                accepted.push_back(k);
+            }
+        }
+        if (NimBLEDevice::m_ctrlWhiteListSynced)
+        {
+            CHECK(host_wl.count == accepted.size());
+            for (size_t i = 0; i < accepted.size() && i < host_wl.count; i++)
+            {
+                CHECK(key_of(host_wl.addrs[i]) == accepted[i]);
+            }
+        }
+
+        CHECK(NimBLEDevice::getWhiteListCount() == white.size());
+        size_t index = 0;
+        for (const addr_key_t &k : white)
+        {
+            CHECK(key_of(native(NimBLEDevice::getWhiteListAddress(index++))) == k);
+        }
+        for (const NimBLEAddress &a : pool)
+        {
+            addr_key_t k = key_of(native(a));
+            bool on = white.count(k);
+            bool ign = ignored.count(k);
+            CHECK(NimBLEDevice::onWhiteList(a) == on);
+            CHECK(NimBLEDevice::isIgnored(a) == ign);
+            CHECK(NimBLEDevice::isFiltered(native(a), false) == ign);
+            if (!NimBLEDevice::m_ctrlWhiteListSynced)
+            {
+                CHECK(NimBLEDevice::isFiltered(native(a), true) == (ign || !on));
+            }
+        }
+    }
+    printf("%d ops, white list %zu, ignore list %zu, %d controller writes\n", ops, white.size(), ignored.size(),
+           host_wl.writes);
+}
+
+static void run_benchmark(int rounds)
+{
+    reset_lists();
+    const std::vector<NimBLEAddress> pool = address_pool();
+    std::vector<ble_addr_t> reports;
+    for (const NimBLEAddress &a : pool)
+    {
+        reports.push_back(native(a));
+    }
+    for (int i = 0; i < CONFIG_NIMBLE_CPP_FILTER_LIST_MAX; i++)
+    {
+        NimBLEDevice::addIgnored(pool[i]);
+        NimBLEDevice::whiteListAdd(pool[pool.size() - 1 - i]);
+    }
+    NimBLEDevice::m_ctrlWhiteListSynced = false;
+
+    using clock = std::chrono::steady_clock;
+    size_t sink = 0;
+    auto t0 = clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (const ble_addr_t &addr : reports)
+        {
+            sink += NimBLEDevice::isFiltered(addr, r & 1);
+        }
+    }
+    auto t1 = clock::now();
+    asm volatile("" : : "r"(sink));
+
+    double ops = (double)rounds * reports.size();
+    printf("%d addresses per list, isFiltered %5.2f ns\n", CONFIG_NIMBLE_CPP_FILTER_LIST_MAX,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / ops);
+}
+
+int main(int argc, char **argv)
+{
+    int ops = argc > 1 ? atoi(argv[1]) : 20000;
+
+    RUN_TEST(type_is_compared);
+    RUN_TEST(busy_controller_retries);
+
+    model_check(ops);
+    run_benchmark(ops * 10);
+    return host_test_failures;
+}
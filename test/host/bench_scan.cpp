@@ -0,0 +1,218 @@
+/**
+ * @file bench_scan.cpp
+ * @brief Replays an advertising report trace through NimBLEScan and times the result store.
+ *
+ * The trace reuses addresses with an exponential popularity, like a busy room where a few
+ * devices advertise often, and every fifth report is a scan response. Each replay is checked
+ * against a reference LRU model of the pool: the same devices stored, the payloads intact, and
+ * the index consistent with the pool. The last test shows the documented pointer reuse.
+ *
+ *   bench_scan [reports]
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+// The report handler, the pool and its index are private
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEAdvertisedDevice.h"
+#undef private
+
+#include "host_test.h"
+
+struct report_t
+{
+    uint8_t addr[6];
+    uint8_t type;
+    uint8_t len;
+    uint8_t data[31];
+};
+
+static NimBLEAddress make_address(const uint8_t *val)
+{
+    ble_addr_t addr = {};
+    memcpy(addr.val, val, 6);
+    return NimBLEAddress(addr);
+}
+
+static std::vector<report_t> make_trace(int advertisers, size_t reports)
+{
+    std::mt19937 rng(42);
+    std::vector<std::array<uint8_t, 6>> addrs(advertisers);
+    for (auto &addr : addrs)
+    {
+        for (auto &b : addr)
+        {
+            b = rng();
+        }
+    }
+
+    std::vector<report_t> trace(reports);
+    std::exponential_distribution<> popularity(3.0 / advertisers);
+    for (auto &r : trace)
+    {
+        int i = std::min<int>(advertisers - 1, (int)popularity(rng));
+        memcpy(r.addr, addrs[i].data(), 6);
+        r.type = (rng() % 5 == 0) ? BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP : BLE_HCI_ADV_RPT_EVTYPE_ADV_IND;
+        r.len = 3 + rng() % 20;
+        r.data[0] = r.len - 1;
+        r.data[1] = BLE_HS_ADV_TYPE_MFG_DATA;
+        for (int k = 2; k < r.len; k++)
+        {
+            r.data[k] = rng();
+        }
+    }
+    return trace;
+}
+
+static void feed(const report_t &r)
+{
+    ble_gap_event ev = {};
+    ev.type = BLE_GAP_EVENT_DISC;
+    ev.disc.event_type = r.type;
+    ev.disc.length_data = r.len;
+    memcpy(ev.disc.addr.val, r.addr, 6);
+    ev.disc.data = r.data;
+    NimBLEScan::handleGapEvent(&ev, nullptr);
+}
+
+static NimBLEScan *fresh_scan(void)
+{
+    NimBLEScan *scan = NimBLEDevice::getScan();
+    scan->clearResults();
+    scan->m_scan_params.passive = 0;
+    return scan;
+}
+
+/**
+ * @brief Replays the trace and checks the pool against an LRU model after every report.
+ */
+static void replay_matches_lru_model(void)
+{
+    const size_t capacity = CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX;
+    std::vector<report_t> trace = make_trace(300, 20000);
+    NimBLEScan *scan = fresh_scan();
+    std::list<std::string> lru; // Front is the least recently seen
+
+    size_t step = 0;
+    for (const report_t &r : trace)
+    {
+        feed(r);
+
+        // A scan response for an unknown device is dropped, anything else refreshes or inserts
+        std::string key((const char *)r.addr, 6);
+        auto it = std::find(lru.begin(), lru.end(), key);
+        bool stored = it != lru.end() || r.type != BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP;
+        if (it != lru.end())
+        {
+            lru.erase(it);
+            lru.push_back(key);
+        }
+        else if (stored)
+        {
+            if (lru.size() == capacity)
+            {
+                lru.pop_front();
+            }
+            lru.push_back(key);
+        }
+        CHECK(scan->m_scanResults.m_advertisedDevicesVector.size() == lru.size());
+
+        if (stored)
+        {
+            NimBLEAdvertisedDevice *dev = &scan->m_devicePool[scan->findDevice(make_address(r.addr))];
+            if (r.type == BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP)
+            {
+                CHECK(dev->getPayloadLength() == dev->getAdvLength() + r.len);
+                CHECK(memcmp(dev->getPayload() + dev->getAdvLength(), r.data, r.len) == 0);
+            }
+            else
+            {
+                CHECK(dev->getPayloadLength() == r.len);
+                CHECK(memcmp(dev->getPayload(), r.data, r.len) == 0);
+            }
+        }
+
+        if (++step % 97 == 0)
+        {
+            for (const std::string &k : lru)
+            {
+                NimBLEAddress addr = make_address((const uint8_t *)k.data());
+                uint8_t slot = scan->findDevice(addr);
+                CHECK(slot != NimBLEScan::POOL_NONE);
+                CHECK(slot == NimBLEScan::POOL_NONE || scan->m_devicePool[slot].getAddress() == addr);
+            }
+            size_t used = 0;
+            for (uint8_t slot : scan->m_index)
+            {
+                used += slot != NimBLEScan::POOL_NONE;
+            }
+            CHECK(used == lru.size());
+        }
+    }
+
+    for (const std::string &k : lru)
+    {
+        scan->erase(make_address((const uint8_t *)k.data()));
+    }
+    CHECK(scan->m_scanResults.m_advertisedDevicesVector.empty());
+    for (uint8_t slot : scan->m_index)
+    {
+        CHECK(slot == NimBLEScan::POOL_NONE);
+    }
+}
+
+/**
+ * @brief A device pointer kept across an eviction refers to the device that took its slot.
+ */
+static void evicted_pointer_is_reused(void)
+{
+    NimBLEScan *scan = fresh_scan();
+    report_t r = {{1, 0, 0, 0, 0, 0}, BLE_HCI_ADV_RPT_EVTYPE_ADV_IND, 3, {2, BLE_HS_ADV_TYPE_MFG_DATA, 0}};
+    feed(r);
+    NimBLEAdvertisedDevice *first = *scan->getResults().begin();
+    NimBLEAddress first_addr = first->getAddress();
+
+    for (int i = 0; i < CONFIG_NIMBLE_CPP_SCAN_RESULTS_MAX; i++)
+    {
+        r.addr[0] = 2 + i;
+        feed(r);
+    }
+    CHECK(scan->getResults().getDevice(first_addr) == nullptr);
+    CHECK(first->getAddress() != first_addr);
+}
+
+static void run_benchmark(size_t reports)
+{
+    for (int advertisers : {16, 64, 300, 1000})
+    {
+        std::vector<report_t> trace = make_trace(advertisers, reports);
+        NimBLEScan *scan = fresh_scan();
+
+        auto start = std::chrono::steady_clock::now();
+        for (const report_t &r : trace)
+        {
+            feed(r);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        printf("%4d advertisers: %3zu stored, %6.1f ns/report\n", advertisers,
+               scan->m_scanResults.m_advertisedDevicesVector.size(),
+               std::chrono::duration<double, std::nano>(end - start).count() / trace.size());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(replay_matches_lru_model);
+    RUN_TEST(evicted_pointer_is_reused);
+
+    run_benchmark(argc > 1 ? strtoul(argv[1], NULL, 10) : 200000);
+    return host_test_failures;
+}
@@ -0,0 +1,355 @@
+/**
+ * @file bench_server_handles.cpp
+ * @brief Checks NimBLEServer's handle table against the GATT database, also after services are
+ * removed and added, and times handle lookups against the linear walk used before start().
+ *
+ * Built against the real NimBLEServer.cpp, NimBLEService.cpp and NimBLECharacteristic.cpp. The
+ * GATT server functions here are a mock database that assigns handles in registration order like
+ * ble_gatts_start(): the service, then per characteristic its declaration, its value, the CCCD
+ * NimBLE adds for notify and indicate, and its descriptors. It records which object owns each
+ * handle, the reference for the lookups.
+ *
+ *   bench_server_handles [lookups]
+ */
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+// The server's handle table, its started flag and the attribute handles are private
+#define private public
+#include "NimBLEDevice.h"
+#include "NimBLEServer.h"
+#undef private
+
+#include "host_test.h"
+
+// Handles before ours belong to the GAP and GATT services
+#define MOCK_FIRST_HANDLE 0x0010
+
+struct mock_svc_t
+{
+    const ble_gatt_svc_def *def;
+    uint16_t handle;
+    bool visible;
+};
+
+static std::vector<mock_svc_t> s_svcs;
+static bool s_started;
+
+// What each handle of the started database is, the reference for the lookups
+static std::map<uint16_t, const ble_gatt_svc_def *> s_svc_at;
+static std::map<uint16_t, NimBLECharacteristic *> s_chr_at;
+static uint16_t s_last_handle;
+
+int ble_gatts_count_cfg(const ble_gatt_svc_def *defs)
+{
+    return 0;
+}
+
+int ble_gatts_add_svcs(const ble_gatt_svc_def *svcs)
+{
+    if (s_started)
+    {
+        return BLE_HS_EBUSY;
+    }
+    for (; svcs->type != BLE_GATT_SVC_TYPE_END; svcs++)
+    {
+        s_svcs.push_back({svcs, 0, true});
+    }
+    return 0;
+}
+
+int ble_gatts_start(void)
+{
+    uint16_t handle = MOCK_FIRST_HANDLE;
+    for (mock_svc_t &svc : s_svcs)
+    {
+        svc.handle = handle++;
+        s_svc_at[svc.handle] = svc.def;
+        for (const ble_gatt_chr_def *chr = svc.def->characteristics; chr != nullptr && chr->uuid != nullptr; chr++)
+        {
+            handle++; // Declaration
+            *chr->val_handle = handle;
+            s_chr_at[handle++] = (NimBLECharacteristic *)chr->arg;
+            handle += (chr->flags & (BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE)) != 0;
+            for (const ble_gatt_dsc_def *dsc = chr->descriptors; dsc != nullptr && dsc->uuid != nullptr; dsc++)
+            {
+                handle++;
+            }
+        }
+    }
+    s_last_handle = handle - 1;
+    s_started = true;
+    return 0;
+}
+
+int ble_gatts_reset(void)
+{
+    s_svcs.clear();
+    s_svc_at.clear();
+    s_chr_at.clear();
+    s_started = false;
+    return 0;
+}
+
+int ble_gatts_find_svc(const ble_uuid_t *uuid, uint16_t *out_handle)
+{
+    for (const mock_svc_t &svc : s_svcs)
+    {
+        if (svc.visible && ble_uuid_cmp(svc.def->uuid, uuid) == 0)
+        {
+            *out_handle = svc.handle;
+            return 0;
+        }
+    }
+    return BLE_HS_ENOENT;
+}
+
+int ble_gatts_find_chr(const ble_uuid_t *svc_uuid, const ble_uuid_t *chr_uuid, uint16_t *out_def_handle,
+                       uint16_t *out_val_handle)
+{
+    return BLE_HS_ENOENT;
+}
+
+int ble_gatts_svc_set_visibility(uint16_t handle, int visible)
+{
+    for (mock_svc_t &svc : s_svcs)
+    {
+        if (svc.handle == handle)
+        {
+            svc.visible = visible;
+            return 0;
+        }
+    }
+    return BLE_HS_ENOENT;
+}
+
+// The server only tells advertising which services are gone and starts or stops it
+static NimBLEAdvertising *s_advertising;
+static int s_removed_uuids;
+
+NimBLEAdvertising::NimBLEAdvertising() {}
+int NimBLEAdvertising::handleGapEvent(ble_gap_event *event, void *arg) { return 0; }
+void NimBLEAdvertising::removeServiceUUID(const NimBLEUUID &serviceUUID) { s_removed_uuids++; }
+bool NimBLEAdvertising::start(uint32_t duration, void (*advCompleteCB)(NimBLEAdvertising *pAdv), NimBLEAddress *dirAddr)
+{
+    return true;
+}
+bool NimBLEAdvertising::stop() { return true; }
+
+NimBLEAdvertising *NimBLEDevice::getAdvertising()
+{
+    if (s_advertising == nullptr)
+    {
+        s_advertising = new NimBLEAdvertising();
+    }
+    return s_advertising;
+}
+
+/**
+ * @brief Counts the status callbacks, to see which characteristic a NOTIFY_TX event reached.
+ */
+class StatusCounter : public NimBLECharacteristicCallbacks
+{
+public:
+    void onStatus(NimBLECharacteristic *pCharacteristic, int code) override { m_count[pCharacteristic]++; }
+    std::map<NimBLECharacteristic *, int> m_count;
+};
+
+static StatusCounter s_status;
+
+/**
+ * @brief A server with services of mixed sizes and characteristics, the HID service and friends in proportion.
+ */
+static NimBLEServer *create_server(int services, int characteristics)
+{
+    NimBLEServer *pServer = new NimBLEServer();
+    NimBLEDevice::m_pServer = pServer;
+    for (int s = 0; s < services; s++)
+    {
+        NimBLEService *pService = pServer->createService(NimBLEUUID((uint16_t)(0x1800 + 0x10 + s)));
+        for (int c = 0; c < characteristics + s % 3; c++)
+        {
+            uint32_t properties = c % 3 == 0 ? NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY : NIMBLE_PROPERTY::READ;
+            NimBLECharacteristic *pChr = pService->createCharacteristic(NimBLEUUID((uint16_t)(0x2a00 + s * 32 + c)), properties);
+            if (c % 4 == 1)
+            {
+                pChr->createDescriptor(NimBLEUUID((uint16_t)0x2908), NIMBLE_PROPERTY::READ, 4);
+            }
+            pChr->setCallbacks(&s_status);
+        }
+        pService->start();
+    }
+    pServer->start();
+    return pServer;
+}
+
+static void delete_server(NimBLEServer *pServer)
+{
+    delete pServer;
+    NimBLEDevice::m_pServer = nullptr;
+    ble_gatts_reset();
+}
+
+/**
+ * @brief Every handle from before the first to past the last resolves to what the database holds there.
+ */
+static void check_lookups(NimBLEServer *pServer)
+{
+    CHECK(pServer->m_gattsStarted);
+    // Past the last handle too, where attributes of removed services had their handles
+    for (uint32_t handle = 0; handle <= s_last_handle + 64u; handle++)
+    {
+        NimBLEService *pService = pServer->getServiceByHandle(handle);
+        auto svc = s_svc_at.find(handle);
+        CHECK(svc == s_svc_at.end() ? pService == nullptr : pService != nullptr && pService->m_pSvcDef == svc->second);
+
+        NimBLECharacteristic *pChr = pServer->getCharacteristicByHandle(handle);
+        auto chr = s_chr_at.find(handle);
+        CHECK(pChr == (chr == s_chr_at.end() ? nullptr : chr->second));
+        if (pChr != nullptr)
+        {
+            CHECK(pChr->getHandle() == handle);
+            CHECK(pChr->getService()->getCharacteristicByHandle(handle) == pChr);
+        }
+        for (NimBLEService *pOther : pServer->m_svcVec)
+        {
+            if (pChr == nullptr || pOther != pChr->getService())
+            {
+                CHECK(pOther->getCharacteristicByHandle(handle) == nullptr);
+            }
+        }
+    }
+    CHECK(pServer->getCharacteristicByHandle(0xffff) == nullptr);
+}
+
+/**
+ * @brief The table agrees with the database after start, and with the linear walk before it.
+ */
+static void lookups_match_database(void)
+{
+    NimBLEServer *pServer = create_server(6, 7);
+    check_lookups(pServer);
+
+    // The fallback walk used before start finds the same attributes
+    for (auto &chr : s_chr_at)
+    {
+        pServer->m_gattsStarted = false;
+        NimBLECharacteristic *pWalk = pServer->getCharacteristicByHandle(chr.first);
+        pServer->m_gattsStarted = true;
+        CHECK(pWalk == chr.second);
+    }
+    delete_server(pServer);
+}
+
+/**
+ * @brief Hiding, deleting and adding back services and characteristics rebuilds the table on the next start.
+ */
+static void lookups_follow_changes(void)
+{
+    NimBLEServer *pServer = create_server(5, 6);
+    NimBLEService *pHidden = pServer->m_svcVec[4];
+    NimBLEService *pDeleted = pServer->m_svcVec[1];
+    uint16_t hiddenHandle = pHidden->getHandle();
+
+    // Removing resets the GATT database, the table goes with it until the next start
+    pServer->removeService(pHidden);
+    CHECK(!pServer->m_gattsStarted && pServer->m_attrTable.empty());
+    CHECK(pServer->getServiceByHandle(hiddenHandle) == pHidden);
+    pServer->start();
+    check_lookups(pServer);
+    CHECK(s_removed_uuids == 1);
+
+    // The hidden service keeps its stale handle, which now belongs to the next live service
+    CHECK(pServer->getServiceByHandle(hiddenHandle) != pHidden);
+    for (NimBLECharacteristic *pChr : pHidden->m_chrVec)
+    {
+        CHECK(pServer->getCharacteristicByHandle(pChr->getHandle()) != pChr);
+    }
+
+    pServer->removeService(pDeleted, true);
+    pServer->start();
+    check_lookups(pServer);
+    CHECK(pServer->m_svcVec.size() == 4);
+
+    NimBLEService *pLast = pServer->m_svcVec.back();
+    pLast->removeCharacteristic(pLast->m_chrVec[2]);
+    pServer->start();
+    check_lookups(pServer);
+
+    pServer->addService(pHidden);
+    pServer->start();
+    check_lookups(pServer);
+    CHECK(pServer->getServiceByHandle(pHidden->getHandle()) == pHidden);
+
+    // A service created after start is registered by the reset, empty, and found once the server restarts
+    NimBLEService *pNew = pServer->createService(NimBLEUUID((uint16_t)0x1850));
+    pServer->start();
+    check_lookups(pServer);
+    CHECK(pServer->getServiceByHandle(pNew->getHandle()) == pNew);
+    delete_server(pServer);
+}
+
+/**
+ * @brief NOTIFY_TX reaches the characteristic at the event's handle, other handles are dropped.
+ */
+static void notify_tx_dispatch(void)
+{
+    NimBLEServer *pServer = create_server(3, 4);
+    s_status.m_count.clear();
+    for (uint32_t handle = 0; handle <= s_last_handle; handle++)
+    {
+        ble_gap_event event = {};
+        event.type = BLE_GAP_EVENT_NOTIFY_TX;
+        event.notify_tx.attr_handle = handle;
+        event.notify_tx.status = BLE_HS_EDONE;
+        NimBLEServer::handleGapEvent(&event, pServer);
+    }
+    CHECK(s_status.m_count.size() == s_chr_at.size());
+    for (auto &chr : s_chr_at)
+    {
+        CHECK(s_status.m_count[chr.second] == 1);
+    }
+    delete_server(pServer);
+}
+
+static void run_benchmark(int lookups)
+{
+    NimBLEServer *pServer = create_server(8, 8);
+    std::vector<uint16_t> handles;
+    for (auto &chr : s_chr_at)
+    {
+        handles.push_back(chr.first);
+    }
+
+    size_t sink = 0;
+    auto lookup = [&](bool started)
+    {
+        pServer->m_gattsStarted = started;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < lookups; i++)
+        {
+            sink += (uintptr_t)pServer->getCharacteristicByHandle(handles[i % handles.size()]);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / lookups;
+    };
+    double table = lookup(true);
+    double walk = lookup(false);
+    pServer->m_gattsStarted = true;
+    asm volatile("" : : "r"(sink));
+
+    printf("%zu characteristics over %u handles, by handle: table %5.1f ns, walk %5.1f ns\n", handles.size(),
+           (unsigned)pServer->m_attrTable.size(), table, walk);
+    delete_server(pServer);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(lookups_match_database);
+    RUN_TEST(lookups_follow_changes);
+    RUN_TEST(notify_tx_dispatch);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 10000000);
+    return host_test_failures;
+}
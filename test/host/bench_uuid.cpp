@@ -0,0 +1,165 @@
+/**
+ * @file bench_uuid.cpp
+ * @brief Checks NimBLEUUID's equality and hash across UUID sizes, and times the compares.
+ *
+ * A 16 or 32 bit UUID is the same UUID as the 128 bit UUID holding it in the Bluetooth base UUID
+ * 0000xxxx-0000-1000-8000-00805f9b34fb, so they must compare equal and hash equal.
+ *
+ *   bench_uuid [rounds]
+ */
+
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "NimBLEUUID.h"
+#include "host_test.h"
+
+// The literal constructors and the compare are usable in constant expressions
+static_assert(NimBLEUUID("1812") == NimBLEUUID((uint16_t)0x1812));
+static_assert(NimBLEUUID("00001812-0000-1000-8000-00805f9b34fb") == NimBLEUUID((uint16_t)0x1812));
+static_assert(NimBLEUUID("00001812-0000-1000-8000-00805f9b34fb").hash() == NimBLEUUID((uint32_t)0x1812).hash());
+static_assert(NimBLEUUID("00001812-0000-1000-8000-00805f9b34fc") != NimBLEUUID((uint16_t)0x1812));
+static_assert(NimBLEUUID("12x4") == NimBLEUUID());
+
+/**
+ * @brief 16, 32 and 128 bit forms of one UUID are equal in every combination, other UUIDs are not.
+ */
+static void cross_width_equality(void)
+{
+    const uint8_t bytes16[2] = {0x18, 0x12};
+    const NimBLEUUID forms[] = {
+        NimBLEUUID((uint16_t)0x1812),
+        NimBLEUUID((uint32_t)0x1812),
+        NimBLEUUID("00001812-0000-1000-8000-00805f9b34fb"),
+        NimBLEUUID::fromString("0x00001812"),
+        NimBLEUUID(bytes16, 2, true),
+        NimBLEUUID(0x00001812, 0x0000, 0x1000, 0x800000805f9b34fb),
+    };
+    for (const NimBLEUUID &a : forms)
+    {
+        for (const NimBLEUUID &b : forms)
+        {
+            CHECK(a == b && a.equals(b));
+        }
+    }
+
+    const NimBLEUUID others[] = {
+        NimBLEUUID((uint16_t)0x1813),
+        NimBLEUUID((uint32_t)0x00011812),
+        NimBLEUUID("00001812-0000-1000-8000-00805f9b34fc"),
+        NimBLEUUID("00001812-0001-1000-8000-00805f9b34fb"),
+        NimBLEUUID(),
+    };
+    for (const NimBLEUUID &a : forms)
+    {
+        for (const NimBLEUUID &b : others)
+        {
+            CHECK(a != b && b != a);
+        }
+    }
+
+    // A 32 bit UUID in the base is equal to its 128 bit form too
+    CHECK(NimBLEUUID((uint32_t)0xabcd1234) == NimBLEUUID("abcd1234-0000-1000-8000-00805f9b34fb"));
+    CHECK(NimBLEUUID() == NimBLEUUID(""));
+
+    // to128 and to16 keep the UUID equal
+    NimBLEUUID u((uint16_t)0x2a4d);
+    CHECK(u.to128() == NimBLEUUID((uint16_t)0x2a4d) && u.bitSize() == 128);
+    CHECK(u.to16() == NimBLEUUID((uint16_t)0x2a4d) && u.bitSize() == 16);
+}
+
+/**
+ * @brief Equal UUIDs of any size hash equal, distinct ones mostly do not.
+ */
+static void hash_follows_equality(void)
+{
+    for (uint32_t v = 0; v < 4096; v += 7)
+    {
+        char text[37];
+        snprintf(text, sizeof(text), "%08x-0000-1000-8000-00805f9b34fb", (unsigned)v);
+        NimBLEUUID u128(text);
+        CHECK(u128.hash() == NimBLEUUID(v).hash());
+        CHECK(std::hash<NimBLEUUID>()(u128) == std::hash<NimBLEUUID>()(NimBLEUUID(v)));
+        if (v <= 0xffff)
+        {
+            CHECK(u128.hash() == NimBLEUUID((uint16_t)v).hash());
+        }
+    }
+
+    std::unordered_set<NimBLEUUID> set = {NimBLEUUID((uint16_t)0x180f), NimBLEUUID((uint32_t)0x180f),
+                                          NimBLEUUID("0000180f-0000-1000-8000-00805f9b34fb"),
+                                          NimBLEUUID("beb5483e-36e1-4688-b7f5-ea07361b26a8")};
+    CHECK(set.size() == 2);
+
+    // The characteristic UUIDs of a vendor service differ in one byte, they must spread
+    std::unordered_set<uint32_t> hashes;
+    for (int i = 0; i < 256; i++)
+    {
+        char text[37];
+        snprintf(text, sizeof(text), "beb5483e-36e1-4688-b7f5-ea07361b26%02x", i);
+        hashes.insert(NimBLEUUID(text).hash());
+    }
+    CHECK(hashes.size() == 256);
+}
+
+/**
+ * @brief The UUID stays the size of the native UUID plus the set flag, it is embedded in every attribute.
+ */
+static void size_unchanged(void)
+{
+    CHECK(sizeof(NimBLEUUID) == 24);
+}
+
+static void run_benchmark(int rounds)
+{
+    const int n = 64;
+    std::vector<NimBLEUUID> short16, long128;
+    for (int i = 0; i < n; i++)
+    {
+        char text[37];
+        short16.emplace_back((uint16_t)(0x2a00 + i));
+        snprintf(text, sizeof(text), "beb5483e-36e1-4688-b7f5-ea07361b26%02x", i);
+        long128.emplace_back(text);
+    }
+    std::vector<NimBLEUUID> base128 = short16;
+    for (NimBLEUUID &u : base128)
+    {
+        u.to128();
+    }
+
+    using clock = std::chrono::steady_clock;
+    size_t sink = 0;
+    auto time = [&](const std::vector<NimBLEUUID> &a, const std::vector<NimBLEUUID> &b)
+    {
+        auto t0 = clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            const NimBLEUUID &k = b[r % n];
+            for (int i = 0; i < n; i++)
+            {
+                sink += a[i] == k;
+            }
+        }
+        return std::chrono::duration<double, std::nano>(clock::now() - t0).count() / ((double)rounds * n);
+    };
+
+    double same16 = time(short16, short16);
+    double cross = time(base128, short16);
+    double same128 = time(long128, long128);
+    asm volatile("" : : "r"(sink));
+
+    printf("sizeof %zu\n", sizeof(NimBLEUUID));
+    printf("compare: 16/16 %5.2f ns, 128/16 %5.2f ns, 128/128 %5.2f ns\n", same16, cross, same128);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(cross_width_equality);
+    RUN_TEST(hash_follows_equality);
+    RUN_TEST(size_unchanged);
+
+    run_benchmark(argc > 1 ? atoi(argv[1]) : 200000);
+    return host_test_failures;
+}
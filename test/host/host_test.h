@@ -0,0 +1,33 @@
+/**
+ * @file host_test.h
+ * @brief Minimal check macros shared by the host tests.
+ *
+ * Each test program returns the number of failed checks, so ctest reports any failure.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(cond)                                                        \
+    do                                                                     \
+    {                                                                      \
+        if (!(cond))                                                       \
+        {                                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++;                                          \
+        }                                                                  \
+    } while (0)
+
+#define RUN_TEST(fn)                     \
+    do                                   \
+    {                                    \
+        int before = host_test_failures; \
+        fn();                            \
+        printf("%s %s\n", host_test_failures == before ? "PASS" : "FAIL", #fn); \
+    } while (0)
+
+#endif // HOST_TEST_H
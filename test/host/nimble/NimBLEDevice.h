@@ -0,0 +1,107 @@
+/**
+ * @file NimBLEDevice.h
+ * @brief Host stand-in for NimBLEDevice, the scan object and the few device queries the benchmarked classes make.
+ *
+ * The advertising benchmark has no server, so advertising reports its events to
+ * NimBLEAdvertising::handleGapEvent. The server benchmark sets m_pServer and defines the
+ * advertising members the server calls. The client registry and filter list members are declared
+ * like the real header, NimBLEClientRegistry.cpp and NimBLEFilterList.cpp define them.
+ */
+
+#ifndef HOST_NIMBLE_DEVICE_H
+#define HOST_NIMBLE_DEVICE_H
+
+#include "host/ble_hs.h"
+#include "NimBLEScan.h"
+#include "NimBLEAddress.h"
+
+#include <vector>
+
+#define NIMBLE_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+#if !defined(CONFIG_NIMBLE_CPP_FILTER_LIST_MAX)
+#define CONFIG_NIMBLE_CPP_FILTER_LIST_MAX 16
+#endif
+
+class NimBLEServer;
+class NimBLEClient;
+class NimBLEAdvertising;
+
+class NimBLEDevice
+{
+public:
+    static NimBLEScan *getScan()
+    {
+        if (m_pScan == nullptr)
+        {
+            m_pScan = new NimBLEScan();
+        }
+        return m_pScan;
+    }
+    static bool getInitialized() { return true; }
+    static int getPower() { return 9; }
+    static NimBLEServer *getServer() { return m_pServer; }
+    static void onReset(int reason) { m_synced = false; }
+    static NimBLEAdvertising *getAdvertising();
+    static bool startAdvertising(uint32_t duration = 0) { return true; }
+    static bool stopAdvertising() { return true; }
+    static int startSecurity(uint16_t conn_id) { return 0; }
+    static uint32_t getSecurityPasskey() { return 123456; }
+
+    static inline bool m_synced = true;
+    static inline uint8_t m_own_addr_type = 0;
+    static inline uint32_t m_passkey = 123456;
+    static inline NimBLEScan *m_pScan = nullptr;
+    static inline NimBLEServer *m_pServer = nullptr;
+
+    static NimBLEClient *createClient(NimBLEAddress peerAddress = NimBLEAddress());
+    static NimBLEClient *getClientByID(uint16_t conn_id);
+    static NimBLEClient *getClientByPeerAddress(const NimBLEAddress &peer_addr);
+    static NimBLEClient *getDisconnectedClient();
+    static size_t getClientListSize();
+    static std::vector<NimBLEClient *> getClients();
+
+    static constexpr uint8_t CLIENT_NONE = 0xFF;
+    static constexpr uint16_t CLIENT_INDEX_SIZE = NIMBLE_MAX_CONNECTIONS > 64   ? 256
+                                                  : NIMBLE_MAX_CONNECTIONS > 32 ? 128
+                                                  : NIMBLE_MAX_CONNECTIONS > 16 ? 64
+                                                  : NIMBLE_MAX_CONNECTIONS > 8  ? 32
+                                                                                : 16;
+
+    static uint16_t clientAddressHash(const NimBLEAddress &address);
+    static uint16_t clientHandleHome(uint8_t slot);
+    static uint16_t clientAddressHome(uint8_t slot);
+    static void clientIndexInsert(uint8_t *index, uint16_t home, uint8_t slot);
+    static void clientIndexRemove(uint8_t *index, uint16_t (*homeOf)(uint8_t), uint8_t slot);
+    static void removeClient(NimBLEClient *pClient);
+    static void setClientConnId(NimBLEClient *pClient, uint16_t conn_id);
+    static void setClientPeerAddress(NimBLEClient *pClient, const NimBLEAddress &address);
+
+    static bool whiteListAdd(const NimBLEAddress &address);
+    static bool whiteListRemove(const NimBLEAddress &address);
+    static bool onWhiteList(const NimBLEAddress &address);
+    static size_t getWhiteListCount();
+    static NimBLEAddress getWhiteListAddress(size_t index);
+    static bool isIgnored(const NimBLEAddress &address);
+    static bool addIgnored(const NimBLEAddress &address);
+    static void removeIgnored(const NimBLEAddress &address);
+    static bool whiteListSync();
+    static void whiteListRetry();
+    static bool isFiltered(const ble_addr_t &address, bool acceptListOnly);
+
+    static NimBLEClient *m_pClients[NIMBLE_MAX_CONNECTIONS];
+    static uint8_t m_clientCount;
+    static uint8_t m_clientHandleIndex[CLIENT_INDEX_SIZE];
+    static uint8_t m_clientAddressIndex[CLIENT_INDEX_SIZE];
+
+    static ble_addr_t m_ignoreList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t m_ignoreListCount;
+    static ble_addr_t m_whiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t m_whiteListCount;
+    static ble_addr_t m_ctrlWhiteList[CONFIG_NIMBLE_CPP_FILTER_LIST_MAX];
+    static uint8_t m_ctrlWhiteListCount;
+    static bool m_ctrlWhiteListSynced;
+    static bool m_ctrlWhiteListPending;
+};
+
+#endif // HOST_NIMBLE_DEVICE_H
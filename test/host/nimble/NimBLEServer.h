@@ -0,0 +1,22 @@
+/**
+ * @file NimBLEServer.h
+ * @brief Host stand-in for the parts of NimBLEServer the advertising code uses. No server is ever created.
+ */
+
+#ifndef HOST_NIMBLE_SERVER_H
+#define HOST_NIMBLE_SERVER_H
+
+#include "host/ble_gap.h"
+
+#define NIMBLE_MAX_CONNECTIONS CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+class NimBLEServer
+{
+public:
+    bool m_gattsStarted = true;
+    void start() {}
+    int getConnectedCount() { return 0; }
+    static int handleGapEvent(struct ble_gap_event *event, void *arg) { return 0; }
+};
+
+#endif // HOST_NIMBLE_SERVER_H
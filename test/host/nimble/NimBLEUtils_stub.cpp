@@ -0,0 +1,9 @@
+// Host stand-in for NimBLEUtils: the string helpers only feed logs, no task waits on a scan here and
+// the connection parameters are never sent to a controller
+#include "NimBLEUtils.h"
+
+const char *NimBLEUtils::returnCodeToString(int rc) { return ""; }
+char *NimBLEUtils::buildHexData(uint8_t *target, const uint8_t *source, uint8_t length) { return (char *)target; }
+const char *NimBLEUtils::advTypeToString(uint8_t advType) { return ""; }
+void NimBLEUtils::taskRelease(ble_task_data_t *pTaskData) {}
+int NimBLEUtils::checkConnParams(ble_gap_conn_params *params) { return 0; }
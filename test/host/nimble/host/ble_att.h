@@ -0,0 +1,20 @@
+/**
+ * @file ble_att.h
+ * @brief Host stand-in for the ATT limits and error codes used by NimBLEAttValue and the client.
+ */
+
+#ifndef HOST_BLE_ATT_H
+#define HOST_BLE_ATT_H
+
+#include <stdint.h>
+
+#define BLE_ATT_ATTR_MAX_LEN 512
+
+#define BLE_ATT_ERR_INSUFFICIENT_AUTHEN 0x05
+#define BLE_ATT_ERR_INSUFFICIENT_AUTHOR 0x08
+#define BLE_ATT_ERR_ATTR_NOT_LONG 0x0b
+#define BLE_ATT_ERR_INSUFFICIENT_ENC 0x0f
+
+static inline uint16_t ble_att_mtu(uint16_t conn_handle) { return 23; }
+
+#endif // HOST_BLE_ATT_H
@@ -0,0 +1,364 @@
+/**
+ * @file ble_gap.h
+ * @brief Host stand-in for the NimBLE GAP declarations used by the scan and advertising code.
+ *
+ * Scanning is a no-op, the benchmarks feed the reports to NimBLEScan::handleGapEvent directly.
+ * The advertising functions are only declared, the advertising benchmark defines them as a mock
+ * controller.
+ */
+
+#ifndef HOST_BLE_GAP_H
+#define HOST_BLE_GAP_H
+
+#include "nimble/ble.h"
+#include "nimble/nimble_npl.h"
+#include "host/ble_att.h"
+#include "host/ble_uuid.h"
+#include "host/ble_hs_adv.h"
+
+#define BLE_HS_FOREVER INT32_MAX
+#define BLE_HS_EALREADY 2
+#define BLE_HS_EINVAL 3
+#define BLE_HS_EMSGSIZE 4
+#define BLE_HS_ENOENT 5
+#define BLE_HS_ENOMEM 6
+#define BLE_HS_ENOTCONN 7
+#define BLE_HS_EAPP 9
+#define BLE_HS_EOS 11
+#define BLE_HS_ECONTROLLER 12
+#define BLE_HS_ETIMEOUT 13
+#define BLE_HS_EDONE 14
+#define BLE_HS_EBUSY 15
+#define BLE_HS_ETIMEOUT_HCI 19
+#define BLE_HS_ENOTSYNCED 22
+#define BLE_HS_EPREEMPTED 25
+#define BLE_HS_EUNKNOWN 17
+#define BLE_HS_ERR_ATT_BASE 0x100
+#define BLE_HS_ERR_HCI_BASE 0x200
+#define BLE_HS_ATT_ERR(x) ((x) ? BLE_HS_ERR_ATT_BASE + (x) : 0)
+
+#define BLE_GAP_EVENT_CONNECT 0
+#define BLE_GAP_EVENT_DISCONNECT 1
+#define BLE_GAP_EVENT_CONN_UPDATE 3
+#define BLE_GAP_EVENT_CONN_UPDATE_REQ 4
+#define BLE_GAP_EVENT_L2CAP_UPDATE_REQ 5
+#define BLE_GAP_EVENT_DISC 7
+#define BLE_GAP_EVENT_DISC_COMPLETE 8
+#define BLE_GAP_EVENT_ADV_COMPLETE 9
+#define BLE_GAP_EVENT_ENC_CHANGE 10
+#define BLE_GAP_EVENT_PASSKEY_ACTION 11
+#define BLE_GAP_EVENT_NOTIFY_RX 12
+#define BLE_GAP_EVENT_NOTIFY_TX 13
+#define BLE_GAP_EVENT_SUBSCRIBE 14
+#define BLE_GAP_EVENT_MTU 15
+#define BLE_GAP_EVENT_IDENTITY_RESOLVED 16
+#define BLE_GAP_EVENT_REPEAT_PAIRING 17
+#define BLE_GAP_EVENT_EXT_DISC 19
+#define BLE_GAP_EVENT_SCAN_REQ_RCVD 23
+
+#define BLE_GAP_REPEAT_PAIRING_RETRY 1
+#define BLE_GAP_REPEAT_PAIRING_IGNORE 2
+#define BLE_GAP_INITIAL_CONN_ITVL_MIN 0x18
+#define BLE_GAP_INITIAL_CONN_ITVL_MAX 0x28
+#define BLE_GAP_INITIAL_CONN_LATENCY 0
+#define BLE_GAP_INITIAL_SUPERVISION_TIMEOUT 0x100
+#define BLE_GAP_INITIAL_CONN_MIN_CE_LEN 0
+#define BLE_GAP_INITIAL_CONN_MAX_CE_LEN 0
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+#define BLE_ERR_REM_USER_CONN_TERM 0x13
+#define BLE_ERR_CONN_TERM_LOCAL 0x16
+#define BLE_ERR_PINKEY_MISSING 0x06
+#define BLE_ERR_CMD_DISALLOWED 0x0c
+#define BLE_ERR_CONN_PARMS 0x3b
+#define BLE_GAP_LE_PHY_1M_MASK 0x01
+#define BLE_GAP_LE_PHY_2M_MASK 0x02
+#define BLE_GAP_LE_PHY_CODED_MASK 0x04
+#define BLE_GAP_ROLE_MASTER 0
+#define BLE_GAP_ROLE_SLAVE 1
+
+#define BLE_GAP_CONN_MODE_NON 0
+#define BLE_GAP_CONN_MODE_DIR 1
+#define BLE_GAP_CONN_MODE_UND 2
+#define BLE_GAP_DISC_MODE_NON 0
+#define BLE_GAP_DISC_MODE_LTD 1
+#define BLE_GAP_DISC_MODE_GEN 2
+
+#define BLE_HCI_ADV_TYPE_ADV_IND 0
+#define BLE_HCI_ADV_TYPE_ADV_DIRECT_IND_HD 1
+#define BLE_HCI_ADV_TYPE_ADV_SCAN_IND 2
+#define BLE_HCI_ADV_TYPE_ADV_NONCONN_IND 3
+#define BLE_HCI_ADV_TYPE_ADV_DIRECT_IND_LD 4
+#define BLE_HCI_ADV_RPT_EVTYPE_ADV_IND 0
+#define BLE_HCI_ADV_RPT_EVTYPE_DIR_IND 1
+#define BLE_HCI_ADV_RPT_EVTYPE_SCAN_IND 2
+#define BLE_HCI_ADV_RPT_EVTYPE_NONCONN_IND 3
+#define BLE_HCI_ADV_RPT_EVTYPE_SCAN_RSP 4
+#define BLE_HCI_ADV_CONN_MASK 0x01
+#define BLE_HCI_ADV_SCAN_MASK 0x02
+#define BLE_HCI_ADV_DIRECT_MASK 0x04
+#define BLE_HCI_ADV_LEGACY_MASK 0x10
+#define BLE_HCI_ADV_FILT_NONE 0
+#define BLE_HCI_ADV_FILT_SCAN 1
+#define BLE_HCI_ADV_FILT_CONN 2
+#define BLE_HCI_ADV_FILT_BOTH 3
+#define BLE_HCI_SCAN_FILT_NO_WL 0
+#define BLE_HCI_SCAN_FILT_USE_WL 1
+#define BLE_HCI_SCAN_FILT_NO_WL_INITA 2
+#define BLE_HCI_SCAN_FILT_USE_WL_INITA 3
+#define BLE_HCI_LE_PHY_1M 1
+#define BLE_HCI_LE_PHY_2M 2
+#define BLE_HCI_LE_PHY_CODED 3
+
+struct ble_gap_disc_params
+{
+    uint16_t itvl, window;
+    uint8_t filter_policy;
+    uint8_t limited : 1, passive : 1, filter_duplicates : 1;
+};
+
+struct ble_gap_disc_desc
+{
+    uint8_t event_type;
+    uint8_t length_data;
+    ble_addr_t addr;
+    int8_t rssi;
+    const uint8_t *data;
+    ble_addr_t direct_addr;
+};
+
+struct ble_gap_ext_disc_desc
+{
+    uint8_t props;
+    uint8_t data_status;
+    uint8_t legacy_event_type;
+    ble_addr_t addr;
+    int8_t rssi;
+    int8_t tx_power;
+    uint8_t sid;
+    uint8_t prim_phy, sec_phy;
+    uint8_t length_data;
+    const uint8_t *data;
+    uint16_t periodic_adv_itvl;
+    ble_addr_t direct_addr;
+};
+
+struct ble_gap_ext_disc_params
+{
+    uint16_t itvl, window;
+    uint8_t passive : 1;
+};
+
+struct ble_gap_conn_params
+{
+    uint16_t scan_itvl, scan_window, itvl_min, itvl_max, latency, supervision_timeout, min_ce_len, max_ce_len;
+};
+
+struct ble_gap_sec_state
+{
+    unsigned encrypted : 1, authenticated : 1, bonded : 1, key_size : 5;
+};
+
+struct ble_gap_conn_desc
+{
+    struct ble_gap_sec_state sec_state;
+    ble_addr_t our_id_addr, peer_id_addr, our_ota_addr, peer_ota_addr;
+    uint16_t conn_handle, conn_itvl, conn_latency, supervision_timeout;
+    uint8_t role, master_clock_accuracy;
+};
+
+struct ble_gap_upd_params
+{
+    uint16_t itvl_min, itvl_max, latency, supervision_timeout, min_ce_len, max_ce_len;
+};
+
+struct ble_gap_adv_params
+{
+    uint8_t conn_mode, disc_mode;
+    uint16_t itvl_min, itvl_max;
+    uint8_t channel_map, filter_policy, high_duty_cycle;
+};
+
+struct os_mbuf;
+
+struct ble_gap_event
+{
+    uint8_t type;
+    union
+    {
+        struct ble_gap_disc_desc disc;
+        struct ble_gap_ext_disc_desc ext_disc;
+        struct
+        {
+            int reason;
+        } disc_complete;
+        struct
+        {
+            int reason;
+        } adv_complete;
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } connect;
+        struct
+        {
+            int reason;
+            struct ble_gap_conn_desc conn;
+        } disconnect;
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } conn_update;
+        struct
+        {
+            struct ble_gap_upd_params *peer_params;
+            struct ble_gap_upd_params *self_params;
+            uint16_t conn_handle;
+        } conn_update_req;
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+        } enc_change;
+        struct
+        {
+            uint16_t conn_handle;
+            struct
+            {
+                uint8_t action;
+                uint32_t numcmp;
+            } params;
+        } passkey;
+        struct
+        {
+            struct os_mbuf *om;
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t indication : 1;
+        } notify_rx;
+        struct
+        {
+            int status;
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t indication : 1;
+        } notify_tx;
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t reason;
+            uint8_t prev_notify : 1, cur_notify : 1, prev_indicate : 1, cur_indicate : 1;
+        } subscribe;
+        struct
+        {
+            uint16_t conn_handle;
+            uint16_t channel_id;
+            uint16_t value;
+        } mtu;
+        struct
+        {
+            uint16_t conn_handle;
+        } identity_resolved;
+        struct
+        {
+            uint16_t conn_handle;
+            uint8_t cur_key_size, cur_authenticated : 1, cur_sc : 1, new_key_size, new_authenticated : 1, new_sc : 1,
+                new_bonding : 1;
+        } repeat_pairing;
+        struct
+        {
+            uint8_t instance;
+            ble_addr_t scan_addr;
+        } scan_req_rcvd;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event *event, void *arg);
+typedef struct ble_gap_event ble_gap_event;
+typedef struct ble_gap_disc_params ble_gap_disc_params;
+typedef struct ble_gap_ext_disc_params ble_gap_ext_disc_params;
+typedef struct ble_gap_conn_params ble_gap_conn_params;
+typedef struct ble_gap_adv_params ble_gap_adv_params;
+typedef struct ble_gap_conn_desc ble_gap_conn_desc;
+typedef struct ble_gap_upd_params ble_gap_upd_params;
+
+static inline int ble_gap_disc(uint8_t own_addr_type, int32_t duration_ms, const ble_gap_disc_params *params,
+                               ble_gap_event_fn *cb, void *arg)
+{
+    return 0;
+}
+
+static inline int ble_gap_ext_disc(uint8_t own_addr_type, uint16_t duration, uint16_t period, uint8_t filter_duplicates,
+                                   uint8_t filter_policy, uint8_t limited, const ble_gap_ext_disc_params *uncoded,
+                                   const ble_gap_ext_disc_params *coded, ble_gap_event_fn *cb, void *arg)
+{
+    return 0;
+}
+
+static inline int ble_gap_disc_active(void) { return 0; }
+static inline int ble_gap_disc_cancel(void) { return 0; }
+
+// No peer is ever connected
+static inline int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc *out_desc) { return BLE_HS_ENOTCONN; }
+static inline int ble_gap_conn_find_by_addr(const ble_addr_t *addr, struct ble_gap_conn_desc *out_desc)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gap_connect(uint8_t own_addr_type, const ble_addr_t *peer_addr, int32_t duration_ms,
+                                  const struct ble_gap_conn_params *params, ble_gap_event_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gap_conn_cancel(void) { return BLE_HS_EALREADY; }
+static inline int ble_gap_conn_rssi(uint16_t conn_handle, int8_t *out_rssi) { return BLE_HS_ENOTCONN; }
+static inline int ble_gap_terminate(uint16_t conn_handle, uint8_t hci_reason) { return BLE_HS_ENOTCONN; }
+static inline int ble_gap_update_params(uint16_t conn_handle, const struct ble_gap_upd_params *params)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gap_set_data_len(uint16_t conn_handle, uint16_t tx_octets, uint16_t tx_time)
+{
+    return BLE_HS_ENOTCONN;
+}
+
+/**
+ * @brief The controller filter accept list. The filter list benchmark sets rc to play a controller that
+ * is using the list, and reads back what was loaded.
+ */
+struct host_wl_t
+{
+    int rc;
+    int writes;
+    uint8_t count;
+    ble_addr_t addrs[64];
+};
+inline host_wl_t host_wl = {};
+
+static inline int ble_gap_wl_set(const ble_addr_t *addrs, uint8_t white_list_count)
+{
+    host_wl.writes++;
+    if (host_wl.rc != 0)
+    {
+        return host_wl.rc;
+    }
+    memcpy(host_wl.addrs, addrs, white_list_count * sizeof(ble_addr_t));
+    host_wl.count = white_list_count;
+    return 0;
+}
+
+int ble_gap_adv_set_data(const uint8_t *data, int len);
+int ble_gap_adv_rsp_set_data(const uint8_t *data, int len);
+int ble_gap_adv_set_fields(const struct ble_hs_adv_fields *fields);
+int ble_gap_adv_rsp_set_fields(const struct ble_hs_adv_fields *fields);
+int ble_gap_adv_start(uint8_t own_addr_type, const ble_addr_t *direct_addr, int32_t duration_ms,
+                      const struct ble_gap_adv_params *params, ble_gap_event_fn *cb, void *arg);
+int ble_gap_adv_stop(void);
+int ble_gap_adv_active(void);
+
+// The real header includes the whole host, the remote attribute classes rely on it
+#include "host/ble_hs.h"
+
+#endif // HOST_BLE_GAP_H
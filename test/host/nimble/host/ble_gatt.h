@@ -0,0 +1,202 @@
+/**
+ * @file ble_gatt.h
+ * @brief Host stand-in for the NimBLE GATT server and client definitions used by the attribute classes.
+ *
+ * The GATT server functions are only declared, the server benchmark defines them as a mock
+ * attribute database that assigns handles like ble_gatts_start(). The client read and write
+ * procedures are declared too, the client benchmark defines them as a mock peer. Discovery has
+ * no peer to ask, it fails like on a dropped link.
+ */
+
+#ifndef HOST_BLE_GATT_H
+#define HOST_BLE_GATT_H
+
+#include <stdint.h>
+#include "host/ble_gap.h"
+#include "host/ble_uuid.h"
+
+#define BLE_GATT_SVC_TYPE_END 0
+#define BLE_GATT_SVC_TYPE_PRIMARY 1
+#define BLE_GATT_SVC_TYPE_SECONDARY 2
+
+#define BLE_GATT_ACCESS_OP_READ_CHR 0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR 1
+#define BLE_GATT_ACCESS_OP_READ_DSC 2
+#define BLE_GATT_ACCESS_OP_WRITE_DSC 3
+
+#define BLE_GATT_CHR_F_BROADCAST 0x0001
+#define BLE_GATT_CHR_F_READ 0x0002
+#define BLE_GATT_CHR_F_WRITE_NO_RSP 0x0004
+#define BLE_GATT_CHR_F_WRITE 0x0008
+#define BLE_GATT_CHR_F_NOTIFY 0x0010
+#define BLE_GATT_CHR_F_INDICATE 0x0020
+#define BLE_GATT_CHR_F_AUTH_SIGN_WRITE 0x0040
+#define BLE_GATT_CHR_F_RELIABLE_WRITE 0x0080
+#define BLE_GATT_CHR_F_AUX_WRITE 0x0100
+#define BLE_GATT_CHR_F_READ_ENC 0x0200
+#define BLE_GATT_CHR_F_READ_AUTHEN 0x0400
+#define BLE_GATT_CHR_F_READ_AUTHOR 0x0800
+#define BLE_GATT_CHR_F_WRITE_ENC 0x1000
+#define BLE_GATT_CHR_F_WRITE_AUTHEN 0x2000
+#define BLE_GATT_CHR_F_WRITE_AUTHOR 0x4000
+
+#define BLE_GATT_CHR_PROP_BROADCAST 0x01
+#define BLE_GATT_CHR_PROP_READ 0x02
+#define BLE_GATT_CHR_PROP_WRITE_NO_RSP 0x04
+#define BLE_GATT_CHR_PROP_WRITE 0x08
+#define BLE_GATT_CHR_PROP_NOTIFY 0x10
+#define BLE_GATT_CHR_PROP_INDICATE 0x20
+#define BLE_GATT_CHR_PROP_AUTH_SIGN_WRITE 0x40
+#define BLE_GATT_CHR_PROP_EXTENDED 0x80
+
+struct os_mbuf;
+
+typedef uint16_t ble_gatt_chr_flags;
+
+struct ble_gatt_access_ctxt
+{
+    uint8_t op;
+    struct os_mbuf *om;
+    union
+    {
+        const struct ble_gatt_chr_def *chr;
+        const struct ble_gatt_dsc_def *dsc;
+    };
+};
+
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt, void *arg);
+
+struct ble_gatt_dsc_def
+{
+    const ble_uuid_t *uuid;
+    uint8_t att_flags;
+    uint8_t min_key_size;
+    ble_gatt_access_fn *access_cb;
+    void *arg;
+};
+
+struct ble_gatt_chr_def
+{
+    const ble_uuid_t *uuid;
+    ble_gatt_access_fn *access_cb;
+    void *arg;
+    struct ble_gatt_dsc_def *descriptors;
+    ble_gatt_chr_flags flags;
+    uint8_t min_key_size;
+    uint16_t *val_handle;
+};
+
+struct ble_gatt_svc_def
+{
+    uint8_t type;
+    const ble_uuid_t *uuid;
+    const struct ble_gatt_svc_def **includes;
+    const struct ble_gatt_chr_def *characteristics;
+};
+
+typedef struct ble_gatt_svc_def ble_gatt_svc_def;
+typedef struct ble_gatt_chr_def ble_gatt_chr_def;
+typedef struct ble_gatt_dsc_def ble_gatt_dsc_def;
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *svcs);
+int ble_gatts_start(void);
+int ble_gatts_reset(void);
+int ble_gatts_find_svc(const ble_uuid_t *uuid, uint16_t *out_handle);
+int ble_gatts_find_chr(const ble_uuid_t *svc_uuid, const ble_uuid_t *chr_uuid, uint16_t *out_def_handle,
+                       uint16_t *out_val_handle);
+int ble_gatts_svc_set_visibility(uint16_t handle, int visible);
+static inline void ble_gatts_show_local(void) {}
+
+struct ble_gatt_error
+{
+    uint16_t status;
+    uint16_t att_handle;
+};
+
+struct ble_gatt_svc
+{
+    uint16_t start_handle;
+    uint16_t end_handle;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_chr
+{
+    uint16_t def_handle;
+    uint16_t val_handle;
+    uint8_t properties;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_dsc
+{
+    uint16_t handle;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_attr
+{
+    uint16_t handle;
+    uint16_t offset;
+    struct os_mbuf *om;
+};
+
+typedef int ble_gatt_mtu_fn(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t mtu, void *arg);
+typedef int ble_gatt_disc_svc_fn(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                 const struct ble_gatt_svc *service, void *arg);
+typedef int ble_gatt_chr_fn(uint16_t conn_handle, const struct ble_gatt_error *error, const struct ble_gatt_chr *chr,
+                            void *arg);
+typedef int ble_gatt_dsc_fn(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t chr_val_handle,
+                            const struct ble_gatt_dsc *dsc, void *arg);
+typedef int ble_gatt_attr_fn(uint16_t conn_handle, const struct ble_gatt_error *error, struct ble_gatt_attr *attr,
+                             void *arg);
+
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset, ble_gatt_attr_fn *cb, void *cb_arg);
+int ble_gattc_read_mult(uint16_t conn_handle, const uint16_t *handles, uint8_t num_handles, ble_gatt_attr_fn *cb,
+                        void *cb_arg);
+int ble_gattc_write_no_rsp_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len);
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void *data, uint16_t data_len,
+                         ble_gatt_attr_fn *cb, void *cb_arg);
+int ble_gattc_write_long(uint16_t conn_handle, uint16_t attr_handle, uint16_t offset, struct os_mbuf *om,
+                         ble_gatt_attr_fn *cb, void *cb_arg);
+
+static inline int ble_gattc_exchange_mtu(uint16_t conn_handle, ble_gatt_mtu_fn *cb, void *cb_arg) { return 0; }
+static inline int ble_gattc_disc_all_svcs(uint16_t conn_handle, ble_gatt_disc_svc_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_disc_svc_by_uuid(uint16_t conn_handle, const ble_uuid_t *uuid, ble_gatt_disc_svc_fn *cb,
+                                             void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_disc_all_chrs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                          ble_gatt_chr_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_disc_chrs_by_uuid(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                              const ble_uuid_t *uuid, ble_gatt_chr_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_disc_all_dscs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                          ble_gatt_dsc_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_read(uint16_t conn_handle, uint16_t attr_handle, ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+static inline int ble_gattc_read_by_uuid(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                                         const ble_uuid_t *uuid, ble_gatt_attr_fn *cb, void *cb_arg)
+{
+    return BLE_HS_ENOTCONN;
+}
+
+static inline int ble_gattc_notify_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om) { return 0; }
+static inline int ble_gattc_indicate_custom(uint16_t conn_handle, uint16_t att_handle, struct os_mbuf *om) { return 0; }
+
+#endif // HOST_BLE_GATT_H
@@ -0,0 +1,83 @@
+/**
+ * @file ble_hs.h
+ * @brief Host stand-in for the NimBLE host header the server classes include, and the mbuf and
+ * security manager pieces they touch.
+ *
+ * Mbufs are single flat buffers, nothing here sends or receives a packet.
+ */
+
+#ifndef HOST_BLE_HS_H
+#define HOST_BLE_HS_H
+
+#include <stdlib.h>
+#include "host/ble_gap.h"
+#include "host/ble_gatt.h"
+
+#define BLE_HCI_LE_CONN_HANDLE_MAX 0x0eff
+
+#define BLE_ATT_ERR_INVALID_HANDLE 0x01
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN 0x0d
+#define BLE_ATT_ERR_UNLIKELY 0x0e
+#define BLE_ATT_ERR_INSUFFICIENT_RES 0x11
+
+#define BLE_ATT_F_READ 0x01
+#define BLE_ATT_F_WRITE 0x02
+#define BLE_ATT_F_READ_ENC 0x04
+#define BLE_ATT_F_READ_AUTHEN 0x08
+#define BLE_ATT_F_READ_AUTHOR 0x10
+#define BLE_ATT_F_WRITE_ENC 0x20
+#define BLE_ATT_F_WRITE_AUTHEN 0x40
+#define BLE_ATT_F_WRITE_AUTHOR 0x80
+
+#define BLE_SM_IOACT_NONE 0
+#define BLE_SM_IOACT_OOB 1
+#define BLE_SM_IOACT_INPUT 2
+#define BLE_SM_IOACT_DISP 3
+#define BLE_SM_IOACT_NUMCMP 4
+
+#define SLIST_NEXT(elm, field) ((elm)->field.sle_next)
+#define OS_MBUF_PKTLEN(om) ((om)->om_len)
+
+struct os_mbuf
+{
+    uint8_t *om_data;
+    uint16_t om_len;
+    uint8_t om_pkthdr_len;
+    struct
+    {
+        struct os_mbuf *sle_next;
+    } om_next;
+};
+
+struct ble_sm_io
+{
+    uint8_t action;
+    union
+    {
+        uint32_t passkey;
+        uint8_t oob[16];
+        uint8_t numcmp_accept;
+    };
+};
+
+static inline struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len)
+{
+    struct os_mbuf *om = (struct os_mbuf *)calloc(1, sizeof(struct os_mbuf) + len);
+    om->om_data = (uint8_t *)(om + 1);
+    om->om_len = len;
+    memcpy(om->om_data, buf, len);
+    return om;
+}
+
+static inline int os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len) { return 0; }
+static inline int os_mbuf_free_chain(struct os_mbuf *om)
+{
+    free(om);
+    return 0;
+}
+
+static inline int ble_sm_inject_io(uint16_t conn_handle, struct ble_sm_io *pkey) { return 0; }
+static inline int ble_store_util_delete_peer(const ble_addr_t *peer_id_addr) { return 0; }
+static inline void ble_hs_sched_reset(int reason) {}
+
+#endif // HOST_BLE_HS_H
@@ -0,0 +1,35 @@
+/**
+ * @file ble_uuid.h
+ * @brief Host stand-in for the NimBLE UUID types, compare and format.
+ */
+
+#ifndef HOST_BLE_UUID_H
+#define HOST_BLE_UUID_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#define BLE_UUID_TYPE_16 16
+#define BLE_UUID_TYPE_32 32
+#define BLE_UUID_TYPE_128 128
+#define BLE_UUID_STR_LEN 37
+typedef struct { uint8_t type; } ble_uuid_t;
+typedef struct { ble_uuid_t u; uint16_t value; } ble_uuid16_t;
+typedef struct { ble_uuid_t u; uint32_t value; } ble_uuid32_t;
+typedef struct { ble_uuid_t u; uint8_t value[16]; } ble_uuid128_t;
+typedef union { ble_uuid_t u; ble_uuid16_t u16; ble_uuid32_t u32; ble_uuid128_t u128; } ble_uuid_any_t;
+#define BLE_UUID16_INIT(v) {{BLE_UUID_TYPE_16}, (v)}
+static inline int ble_uuid_cmp(const ble_uuid_t *a, const ble_uuid_t *b){
+  if (a->type != b->type) return a->type - b->type;
+  switch(a->type){case 16: return ((const ble_uuid16_t*)a)->value - ((const ble_uuid16_t*)b)->value;
+  case 32: return ((const ble_uuid32_t*)a)->value != ((const ble_uuid32_t*)b)->value;
+  default: return memcmp(((const ble_uuid128_t*)a)->value, ((const ble_uuid128_t*)b)->value, 16);}
+}
+static inline char* ble_uuid_to_str(const ble_uuid_t *u, char *dst){
+  switch(u->type){case 16: sprintf(dst,"0x%04x",((const ble_uuid16_t*)u)->value); break;
+  case 32: sprintf(dst,"0x%08x",(unsigned)((const ble_uuid32_t*)u)->value); break;
+  default: {const uint8_t*v=((const ble_uuid128_t*)u)->value; sprintf(dst,"%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",v[15],v[14],v[13],v[12],v[11],v[10],v[9],v[8],v[7],v[6],v[5],v[4],v[3],v[2],v[1],v[0]);}}
+  return dst;
+}
+
+#endif // HOST_BLE_UUID_H
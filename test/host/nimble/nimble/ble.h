@@ -0,0 +1,26 @@
+/**
+ * @file ble.h
+ * @brief Host stand-in for the NimBLE address type, and the includes NimBLE headers get through it.
+ */
+
+#ifndef HOST_NIMBLE_BLE_H
+#define HOST_NIMBLE_BLE_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#define BLE_ADDR_PUBLIC 0
+#define BLE_ADDR_RANDOM 1
+#define BLE_ADDR_PUBLIC_ID 2
+#define BLE_ADDR_RANDOM_ID 3
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t val[6];
+} ble_addr_t;
+
+#endif // HOST_NIMBLE_BLE_H
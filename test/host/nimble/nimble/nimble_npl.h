@@ -0,0 +1,57 @@
+/**
+ * @file nimble_npl.h
+ * @brief Host stand-in for the NimBLE porting layer types and the event queue the client runs on.
+ *
+ * The event and callout functions are only declared, the client benchmark defines them as the
+ * host task's event queue. The other benchmarks never post an event.
+ */
+
+#ifndef HOST_NIMBLE_NPL_H
+#define HOST_NIMBLE_NPL_H
+
+#include <stdint.h>
+
+typedef uint32_t ble_npl_time_t;
+typedef void ble_npl_event_fn(struct ble_npl_event *ev);
+
+struct ble_npl_event
+{
+    ble_npl_event_fn *fn;
+    void *arg;
+    bool queued;
+};
+
+struct ble_npl_eventq
+{
+    struct ble_npl_event *head;
+};
+
+struct ble_npl_callout
+{
+    struct ble_npl_event ev;
+    struct ble_npl_eventq *evq;
+    ble_npl_time_t ticks;
+    bool active;
+};
+
+static inline uint32_t ble_npl_hw_enter_critical(void) { return 0; }
+static inline void ble_npl_hw_exit_critical(uint32_t ctx) {}
+static inline void *ble_npl_event_get_arg(struct ble_npl_event *ev) { return ev->arg; }
+static inline ble_npl_time_t ble_npl_time_ms_to_ticks32(uint32_t ms) { return ms; }
+static inline int ble_npl_time_ms_to_ticks(uint32_t ms, ble_npl_time_t *out_ticks)
+{
+    *out_ticks = ms;
+    return 0;
+}
+static inline bool ble_npl_callout_is_active(struct ble_npl_callout *co) { return co->active; }
+
+void ble_npl_event_init(struct ble_npl_event *ev, ble_npl_event_fn *fn, void *arg);
+void ble_npl_event_deinit(struct ble_npl_event *ev);
+void ble_npl_eventq_put(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
+void ble_npl_eventq_remove(struct ble_npl_eventq *evq, struct ble_npl_event *ev);
+void ble_npl_callout_init(struct ble_npl_callout *co, struct ble_npl_eventq *evq, ble_npl_event_fn *fn, void *arg);
+int ble_npl_callout_reset(struct ble_npl_callout *co, ble_npl_time_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *co);
+void ble_npl_callout_deinit(struct ble_npl_callout *co);
+
+#endif // HOST_NIMBLE_NPL_H
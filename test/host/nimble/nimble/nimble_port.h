@@ -0,0 +1,13 @@
+/**
+ * @file nimble_port.h
+ * @brief Host stand-in for the NimBLE port, the client benchmark defines the host task's event queue.
+ */
+
+#ifndef HOST_NIMBLE_PORT_H
+#define HOST_NIMBLE_PORT_H
+
+#include "nimble/nimble_npl.h"
+
+struct ble_npl_eventq *nimble_port_get_dflt_eventq(void);
+
+#endif // HOST_NIMBLE_PORT_H
@@ -0,0 +1 @@
+// Empty on the host, the option names in sdkconfig.h are already the current ones
@@ -0,0 +1,24 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host configuration of the NimBLE C++ library for the benchmarks.
+ */
+
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_BT_ENABLED 1
+#define CONFIG_BT_NIMBLE_ROLE_OBSERVER 1
+#define CONFIG_BT_NIMBLE_ROLE_CENTRAL 1
+#define CONFIG_BT_NIMBLE_ROLE_PERIPHERAL 1
+#define CONFIG_BT_NIMBLE_ROLE_BROADCASTER 1
+#ifndef CONFIG_NIMBLE_CPP_LOG_LEVEL
+#define CONFIG_NIMBLE_CPP_LOG_LEVEL 0
+#endif
+#ifndef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+#define CONFIG_BT_NIMBLE_MAX_CONNECTIONS 3
+#endif
+#ifndef CONFIG_BT_NIMBLE_EXT_ADV
+#define CONFIG_BT_NIMBLE_EXT_ADV 0
+#endif
+
+#endif // HOST_SDKCONFIG_H
@@ -0,0 +1,12 @@
+/**
+ * @file ble_svc_gap.h
+ * @brief Host stand-in for the GAP service. The device name is defined by the advertising benchmark.
+ */
+
+#ifndef HOST_BLE_SVC_GAP_H
+#define HOST_BLE_SVC_GAP_H
+
+const char *ble_svc_gap_device_name(void);
+static inline void ble_svc_gap_init(void) {}
+
+#endif // HOST_BLE_SVC_GAP_H
@@ -0,0 +1,14 @@
+/**
+ * @file ble_svc_gatt.h
+ * @brief Host stand-in for the GATT service, registered by NimBLE itself and not modelled here.
+ */
+
+#ifndef HOST_BLE_SVC_GATT_H
+#define HOST_BLE_SVC_GATT_H
+
+#include <stdint.h>
+
+static inline void ble_svc_gatt_init(void) {}
+static inline void ble_svc_gatt_changed(uint16_t start_handle, uint16_t end_handle) {}
+
+#endif // HOST_BLE_SVC_GATT_H
@@ -0,0 +1,11 @@
+/**
+ * @file esp_http_server.h
+ * @brief Host stand-in, only the handle type the headers under test refer to.
+ */
+
+#ifndef HOST_ESP_HTTP_SERVER_H
+#define HOST_ESP_HTTP_SERVER_H
+
+typedef void *httpd_handle_t;
+
+#endif // HOST_ESP_HTTP_SERVER_H
@@ -0,0 +1,43 @@
+/**
+ * @file esp_log.h
+ * @brief Host stand-in for ESP_LOGx, errors and warnings go to stderr, the rest is dropped.
+ *
+ * esp_log_write() formats like the real one but discards the text, so a logging benchmark still
+ * pays for the formatting.
+ */
+
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGV(tag, fmt, ...) ((void)(tag))
+
+#define ESP_LOG_ERROR 1
+#define ESP_LOG_WARN 2
+#define ESP_LOG_INFO 3
+#define ESP_LOG_DEBUG 4
+
+typedef int esp_log_level_t;
+
+static inline void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+}
+
+static inline uint32_t esp_log_timestamp(void) { return 0; }
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, fmt, ...) \
+    esp_log_write(level, tag, "%c (%u) %s: " fmt "\n", "NEWIDV"[level], (unsigned)esp_log_timestamp(), tag, ##__VA_ARGS__)
+
+#endif // HOST_ESP_LOG_H
@@ -0,0 +1,19 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for esp_timer_get_time, the monotonic clock in microseconds.
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+#endif // HOST_ESP_TIMER_H
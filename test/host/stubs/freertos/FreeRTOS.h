@@ -0,0 +1,32 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types and task notifications, single threaded.
+ *
+ * Two cores, the calling code runs on host_core_id.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define portMAX_DELAY 0xffffffff
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(x) (x)
+#define pdPASS 1
+#define portNUM_PROCESSORS 2
+
+inline int host_core_id = 0;
+static inline BaseType_t xPortGetCoreID(void) { return host_core_id; }
+
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) { return 0; }
+static inline void xTaskNotifyGive(TaskHandle_t task) {}
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { return 0; }
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,32 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for the FreeRTOS mutexes, backed by pthread mutexes.
+ */
+
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include <pthread.h>
+#include "FreeRTOS.h"
+
+typedef pthread_mutex_t StaticSemaphore_t;
+typedef pthread_mutex_t *SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    pthread_mutex_init(buffer, NULL);
+    return buffer;
+}
+
+// Only portMAX_DELAY is used on the host
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    return pthread_mutex_lock(mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pthread_mutex_unlock(mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+#endif // HOST_FREERTOS_SEMPHR_H
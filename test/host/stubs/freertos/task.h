@@ -0,0 +1,18 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for freertos/task.h, a tick is a millisecond and no task is ever started.
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include <unistd.h>
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+static inline void vTaskDelay(TickType_t ticks) { usleep(ticks * 1000); }
+static inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                     UBaseType_t priority, TaskHandle_t *handle) { return pdPASS; }
+
+#endif // HOST_FREERTOS_TASK_H
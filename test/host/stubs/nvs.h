@@ -0,0 +1,70 @@
+/**
+ * @file nvs.h
+ * @brief File-backed NVS stand-in for host tests.
+ *
+ * Every namespace/key pair is a file under the directory given to nvs_file_init(). Blobs set
+ * through a handle stay pending until nvs_commit(), which replaces each file atomically, the
+ * way an NVS commit either lands or leaves the previous value.
+ */
+
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef uint32_t nvs_handle_t;
+
+    typedef enum
+    {
+        NVS_READONLY,
+        NVS_READWRITE
+    } nvs_open_mode_t;
+
+    esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+    esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+    esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+    esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+    esp_err_t nvs_erase_all(nvs_handle_t handle);
+    esp_err_t nvs_commit(nvs_handle_t handle);
+    void nvs_close(nvs_handle_t handle);
+
+    /**
+     * @brief Empties (creating it if needed) the directory that backs the store.
+     */
+    void nvs_file_init(const char *dir);
+
+    /**
+     * @brief Makes the next commits fail before anything is written, like a power loss.
+     * @param commits Number of commits that fail, 0 to stop failing.
+     */
+    void nvs_file_fail_commits(int commits);
+
+    /**
+     * @brief Makes the next opens fail with ESP_FAIL, like a flash read error.
+     * @param opens Number of opens that fail, 0 to stop failing.
+     */
+    void nvs_file_fail_opens(int opens);
+
+    /**
+     * @brief Makes the next blob reads fail with ESP_FAIL, like a flash read error.
+     * @param reads Number of reads that fail, 0 to stop failing.
+     */
+    void nvs_file_fail_reads(int reads);
+
+    /**
+     * @brief Path of the file holding a key, to corrupt or inspect it.
+     */
+    const char *nvs_file_path(const char *name, const char *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_NVS_H
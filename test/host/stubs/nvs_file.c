@@ -0,0 +1,309 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "nvs.h"
+
+#define MAX_HANDLES 8
+#define MAX_PENDING 16
+
+typedef struct
+{
+    char key[16];
+    uint8_t *data; /**< NULL for an erased key. */
+    size_t len;
+} pending_t;
+
+typedef struct
+{
+    bool open;
+    bool writable;
+    bool erase_all;
+    char name[16];
+    pending_t pending[MAX_PENDING];
+    int pending_count;
+} handle_t;
+
+static char s_dir[256];
+static handle_t s_handles[MAX_HANDLES];
+static int s_fail_commits;
+static int s_fail_opens;
+static int s_fail_reads;
+
+static void remove_tree(const char *path)
+{
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+    {
+        unlink(path);
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+        char child[512];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        remove_tree(child);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+void nvs_file_init(const char *dir)
+{
+    strncpy(s_dir, dir, sizeof(s_dir) - 1);
+    remove_tree(s_dir);
+    mkdir(s_dir, 0755);
+    memset(s_handles, 0, sizeof(s_handles));
+    s_fail_commits = 0;
+    s_fail_opens = 0;
+    s_fail_reads = 0;
+}
+
+void nvs_file_fail_commits(int commits)
+{
+    s_fail_commits = commits;
+}
+
+void nvs_file_fail_opens(int opens)
+{
+    s_fail_opens = opens;
+}
+
+void nvs_file_fail_reads(int reads)
+{
+    s_fail_reads = reads;
+}
+
+const char *nvs_file_path(const char *name, const char *key)
+{
+    static char path[512];
+    snprintf(path, sizeof(path), "%s/%s/%s", s_dir, name, key);
+    return path;
+}
+
+static handle_t *get_handle(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > MAX_HANDLES || !s_handles[handle - 1].open)
+    {
+        return NULL;
+    }
+    return &s_handles[handle - 1];
+}
+
+static void drop_pending(handle_t *h)
+{
+    for (int i = 0; i < h->pending_count; i++)
+    {
+        free(h->pending[i].data);
+    }
+    h->pending_count = 0;
+    h->erase_all = false;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (s_fail_opens > 0)
+    {
+        s_fail_opens--;
+        return ESP_FAIL;
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", s_dir, name);
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        if (open_mode == NVS_READONLY)
+        {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        mkdir(path, 0755);
+    }
+
+    for (int i = 0; i < MAX_HANDLES; i++)
+    {
+        if (!s_handles[i].open)
+        {
+            memset(&s_handles[i], 0, sizeof(s_handles[i]));
+            s_handles[i].open = true;
+            s_handles[i].writable = open_mode == NVS_READWRITE;
+            strncpy(s_handles[i].name, name, sizeof(s_handles[i].name) - 1);
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    handle_t *h = get_handle(handle);
+    if (h == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (s_fail_reads > 0)
+    {
+        s_fail_reads--;
+        return ESP_FAIL;
+    }
+
+    // Reads see the committed value, as the real NVS does for another handle
+    FILE *f = fopen(nvs_file_path(h->name, key), "rb");
+    if (f == NULL)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    esp_err_t err = ESP_OK;
+    if (out_value == NULL)
+    {
+        *length = size;
+    }
+    else if (*length < size)
+    {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    else
+    {
+        *length = fread(out_value, 1, size, f);
+    }
+    fclose(f);
+    return err;
+}
+
+static esp_err_t stage(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    handle_t *h = get_handle(handle);
+    if (h == NULL || !h->writable)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pending_t *p = NULL;
+    for (int i = 0; i < h->pending_count; i++)
+    {
+        if (strcmp(h->pending[i].key, key) == 0)
+        {
+            p = &h->pending[i];
+            free(p->data);
+        }
+    }
+    if (p == NULL)
+    {
+        if (h->pending_count == MAX_PENDING)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+        p = &h->pending[h->pending_count++];
+        strncpy(p->key, key, sizeof(p->key) - 1);
+    }
+
+    p->data = NULL;
+    p->len = length;
+    if (value != NULL)
+    {
+        p->data = (uint8_t *)malloc(length ? length : 1);
+        memcpy(p->data, value, length);
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return stage(handle, key, value != NULL ? value : "", length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    handle_t *h = get_handle(handle);
+    if (h == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (access(nvs_file_path(h->name, key), F_OK) != 0)
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return stage(handle, key, NULL, 0);
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    handle_t *h = get_handle(handle);
+    if (h == NULL || !h->writable)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    drop_pending(h);
+    h->erase_all = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    handle_t *h = get_handle(handle);
+    if (h == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_fail_commits > 0)
+    {
+        s_fail_commits--;
+        drop_pending(h);
+        return ESP_FAIL;
+    }
+
+    if (h->erase_all)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", s_dir, h->name);
+        remove_tree(path);
+        mkdir(path, 0755);
+    }
+    for (int i = 0; i < h->pending_count; i++)
+    {
+        pending_t *p = &h->pending[i];
+        const char *path = nvs_file_path(h->name, p->key);
+        if (p->data == NULL)
+        {
+            unlink(path);
+            continue;
+        }
+        char tmp[520];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        FILE *f = fopen(tmp, "wb");
+        if (f == NULL)
+        {
+            return ESP_FAIL;
+        }
+        fwrite(p->data, 1, p->len, f);
+        fclose(f);
+        rename(tmp, path);
+    }
+    drop_pending(h);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    handle_t *h = get_handle(handle);
+    if (h != NULL)
+    {
+        drop_pending(h);
+        h->open = false;
+    }
+}
@@ -0,0 +1,431 @@
+/**
+ * @file test_bulk_frame.cpp
+ * @brief Runs bulk transfer sessions against a companion over a loopback transport.
+ *
+ * The transport hands every SDU the session sends to a model of the companion, which checks the
+ * framing (sequence numbers, offsets, END length and CRC) and counts credits: the device must
+ * never send more DATA frames than the companion granted, and never grant more than its window.
+ * The transport can refuse SDUs, like an L2CAP channel out of its own credits.
+ *
+ *   test_bulk_frame
+ */
+
+#include <deque>
+#include <string.h>
+#include <vector>
+
+#include "bulk_frame.h"
+#include "esp_rom_crc.h"
+#include "host_test.h"
+
+#define RESOURCE_CONFIG 1
+#define RESOURCE_LOG 2
+#define PUT_MAX 600
+#define WINDOW 4
+
+/**
+ * @brief The loopback: SDUs from the device wait here until the companion reads them.
+ */
+struct link_t
+{
+    std::deque<std::vector<uint8_t>> to_companion;
+    int refuse = 0; // SDUs the transport refuses before it takes one again
+    int refused = 0;
+};
+
+static bool loopback_send(const uint8_t *sdu, size_t len, void *ctx)
+{
+    link_t *link = (link_t *)ctx;
+    if (link->refuse > 0)
+    {
+        link->refuse--;
+        link->refused++;
+        return false;
+    }
+    link->to_companion.emplace_back(sdu, sdu + len);
+    return true;
+}
+
+static std::vector<uint8_t> s_content;
+static std::vector<uint8_t> s_written;
+
+static size_t read_content(uint32_t offset, uint8_t *buf, size_t len, void *ctx)
+{
+    if (offset >= s_content.size())
+    {
+        return 0;
+    }
+    len = len < s_content.size() - offset ? len : s_content.size() - offset;
+    memcpy(buf, s_content.data() + offset, len);
+    return len;
+}
+
+static bulk_status_t write_content(const uint8_t *data, size_t len, void *ctx)
+{
+    s_written.assign(data, data + len);
+    return BULK_STATUS_OK;
+}
+
+static const bulk_resource_t s_resources[] = {
+    {RESOURCE_CONFIG, PUT_MAX, read_content, write_content, NULL},
+    {RESOURCE_LOG, 0, read_content, NULL, NULL},
+};
+
+/**
+ * @brief A session and its loopback, the device side of a channel with the given peer MTU.
+ */
+struct device_t
+{
+    link_t link;
+    uint8_t tx_buf[256];
+    uint8_t put_buf[PUT_MAX];
+    bulk_session_t session;
+
+    explicit device_t(size_t peer_mtu)
+    {
+        bulk_session_config_t config = {s_resources, 2, loopback_send, &link, tx_buf, sizeof(tx_buf),
+                                        put_buf, sizeof(put_buf), WINDOW};
+        CHECK(bulk_session_init(&session, &config));
+        bulk_session_reset(&session, peer_mtu);
+    }
+
+    void receive(uint8_t type, uint8_t resource, uint16_t seq, uint32_t offset, uint32_t value,
+                 const uint8_t *payload = nullptr, size_t payload_len = 0)
+    {
+        bulk_frame_t frame = {type, resource, seq, offset, value, payload, payload_len};
+        uint8_t sdu[256];
+        size_t len = bulk_frame_encode(&frame, sdu, sizeof(sdu));
+        CHECK(len == BULK_FRAME_HEADER_LEN + payload_len);
+        bulk_session_receive(&session, sdu, len);
+    }
+
+    bool next(bulk_frame_t *frame)
+    {
+        if (link.to_companion.empty())
+        {
+            return false;
+        }
+        last = link.to_companion.front();
+        link.to_companion.pop_front();
+        CHECK(last.size() <= session.sdu_max);
+        CHECK(bulk_frame_decode(last.data(), last.size(), frame));
+        return true;
+    }
+
+    std::vector<uint8_t> last;
+};
+
+static std::vector<uint8_t> pattern(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        data[i] = (uint8_t)(i * 31 + seed);
+    }
+    return data;
+}
+
+/**
+ * @brief Companion side of a GET: grants credits in batches and checks every frame.
+ * @return The status that ended the transfer, BULK_STATUS_OK after a good END.
+ */
+static bulk_status_t companion_get(device_t &dev, uint8_t resource, uint32_t credits, std::vector<uint8_t> *data)
+{
+    dev.receive(BULK_FRAME_OPEN_GET, resource, 0, 0, credits);
+
+    int32_t outstanding = credits;
+    uint32_t received = 0;
+    bulk_frame_t frame;
+    for (;;)
+    {
+        if (!dev.next(&frame))
+        {
+            // Nothing sent, which is only right once the credits ran out
+            if (outstanding > 0)
+            {
+                CHECK(false);
+                return BULK_STATUS_PROTOCOL;
+            }
+            dev.receive(BULK_FRAME_CREDIT, resource, 0, 0, received);
+            outstanding += received;
+            received = 0;
+            continue;
+        }
+
+        switch (frame.type)
+        {
+        case BULK_FRAME_DATA:
+            CHECK(frame.resource == resource);
+            CHECK(--outstanding >= 0);
+            CHECK(frame.offset == data->size());
+            data->insert(data->end(), frame.payload, frame.payload + frame.payload_len);
+            received++;
+            break;
+        case BULK_FRAME_END:
+            CHECK(frame.offset == data->size());
+            CHECK(frame.value == esp_rom_crc32_le(0, data->data(), data->size()));
+            return BULK_STATUS_OK;
+        case BULK_FRAME_STATUS:
+            return (bulk_status_t)frame.value;
+        default:
+            CHECK(false);
+            return BULK_STATUS_PROTOCOL;
+        }
+    }
+}
+
+/**
+ * @brief Companion side of a PUT: sends DATA only on credit and waits for the STATUS.
+ */
+static bulk_status_t companion_put(device_t &dev, uint8_t resource, const std::vector<uint8_t> &data, size_t chunk)
+{
+    dev.receive(BULK_FRAME_OPEN_PUT, resource, 0, data.size(), 0);
+
+    uint32_t credits = 0;
+    uint32_t in_flight = 0; // Sent, and not handed back by a CREDIT frame yet
+    uint32_t sent = 0;
+    uint16_t seq = 0;
+    bool ended = false;
+    bulk_frame_t frame;
+    for (;;)
+    {
+        while (dev.next(&frame))
+        {
+            if (frame.type == BULK_FRAME_STATUS)
+            {
+                return (bulk_status_t)frame.value;
+            }
+            CHECK(frame.type == BULK_FRAME_CREDIT);
+            credits += frame.value;
+            in_flight -= in_flight < frame.value ? in_flight : frame.value;
+        }
+        CHECK(credits + in_flight <= WINDOW);
+
+        if (credits > 0 && sent < data.size())
+        {
+            size_t n = data.size() - sent < chunk ? data.size() - sent : chunk;
+            dev.receive(BULK_FRAME_DATA, resource, seq++, sent, 0, data.data() + sent, n);
+            sent += n;
+            credits--;
+            in_flight++;
+        }
+        else if (sent == data.size() && !ended)
+        {
+            dev.receive(BULK_FRAME_END, resource, seq, sent, esp_rom_crc32_le(0, data.data(), data.size()));
+            ended = true;
+        }
+        else if (dev.link.to_companion.empty())
+        {
+            // Stuck: the device owes us a CREDIT or a STATUS
+            CHECK(false);
+            return BULK_STATUS_PROTOCOL;
+        }
+    }
+}
+
+/**
+ * @brief A GET arrives intact in frames no longer than the peer MTU, and never beyond the credits granted.
+ */
+static void get_respects_credits(void)
+{
+    s_content = pattern(3000, 1);
+    for (uint32_t credits : {1u, 3u, 16u})
+    {
+        device_t dev(64);
+        std::vector<uint8_t> data;
+        CHECK(companion_get(dev, RESOURCE_LOG, credits, &data) == BULK_STATUS_OK);
+        CHECK(data == s_content);
+        CHECK(dev.session.stats.transfers == 1);
+        CHECK(dev.session.stats.bytes_tx == s_content.size());
+    }
+}
+
+/**
+ * @brief A PUT reaches the resource intact, with the companion never holding more than the window.
+ */
+static void put_round_trip(void)
+{
+    std::vector<uint8_t> data = pattern(PUT_MAX, 7);
+    for (size_t chunk : {1u, 52u, 244u})
+    {
+        device_t dev(256);
+        s_written.clear();
+        CHECK(companion_put(dev, RESOURCE_CONFIG, data, chunk) == BULK_STATUS_OK);
+        CHECK(s_written == data);
+        CHECK(dev.session.stats.bytes_rx == data.size());
+    }
+}
+
+/**
+ * @brief A refused SDU is sent again from the next pump, without gaps or repeats in the data.
+ */
+static void refused_sdu_is_sent_again(void)
+{
+    s_content = pattern(1000, 3);
+    device_t dev(128);
+    dev.link.refuse = 1;
+    dev.receive(BULK_FRAME_OPEN_GET, RESOURCE_LOG, 0, 0, 4);
+    CHECK(dev.link.refused == 1);
+    CHECK(dev.link.to_companion.empty());
+
+    dev.link.refuse = 3;
+    CHECK(bulk_session_pump(&dev.session));
+    CHECK(bulk_session_pump(&dev.session));
+    CHECK(bulk_session_pump(&dev.session));
+    CHECK(dev.link.to_companion.empty());
+
+    // The GET goes on from the frame that was refused
+    std::vector<uint8_t> data;
+    bulk_session_pump(&dev.session);
+    bulk_frame_t frame;
+    uint16_t seq = 0;
+    uint32_t received = 0;
+    for (;;)
+    {
+        if (!dev.next(&frame))
+        {
+            dev.receive(BULK_FRAME_CREDIT, RESOURCE_LOG, 0, 0, received);
+            received = 0;
+            continue;
+        }
+        if (frame.type == BULK_FRAME_END)
+        {
+            CHECK(frame.value == esp_rom_crc32_le(0, data.data(), data.size()));
+            break;
+        }
+        CHECK(frame.type == BULK_FRAME_DATA);
+        CHECK(frame.seq == seq++);
+        data.insert(data.end(), frame.payload, frame.payload + frame.payload_len);
+        received++;
+    }
+    CHECK(data == s_content);
+}
+
+/**
+ * @brief Every broken PUT ends with the matching STATUS and leaves the session idle for the next transfer.
+ */
+static void put_errors_end_the_transfer(void)
+{
+    std::vector<uint8_t> data = pattern(100, 9);
+    uint32_t crc = esp_rom_crc32_le(0, data.data(), data.size());
+    bulk_frame_t frame;
+
+    const struct
+    {
+        const char *name;
+        bulk_status_t status;
+        void (*spoil)(device_t &dev, const std::vector<uint8_t> &data, uint32_t crc);
+    } cases[] = {
+        {"unknown resource", BULK_STATUS_UNKNOWN_RESOURCE,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         { dev.receive(BULK_FRAME_OPEN_PUT, 9, 0, data.size(), 0); }},
+        {"read only", BULK_STATUS_UNKNOWN_RESOURCE,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         { dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_LOG, 0, data.size(), 0); }},
+        {"too large", BULK_STATUS_TOO_LARGE,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         { dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, PUT_MAX + 1, 0); }},
+        {"no credit", BULK_STATUS_NO_CREDIT,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         {
+             // The device hands credits back as it copies the data, so only a companion that
+             // keeps sending while the CREDIT frame is stuck in the transport runs out
+             dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, data.size(), 0);
+             dev.link.refuse = 100;
+             for (uint16_t seq = 0; seq < 2 * WINDOW; seq++)
+             {
+                 dev.receive(BULK_FRAME_DATA, RESOURCE_CONFIG, seq, seq, 0, data.data() + seq, 1);
+             }
+             dev.link.refuse = 0;
+             bulk_session_pump(&dev.session);
+         }},
+        {"sequence", BULK_STATUS_SEQUENCE,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         {
+             dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, data.size(), 0);
+             dev.receive(BULK_FRAME_DATA, RESOURCE_CONFIG, 1, 0, 0, data.data(), 10);
+         }},
+        {"short END", BULK_STATUS_SEQUENCE,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         {
+             dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, data.size(), 0);
+             dev.receive(BULK_FRAME_DATA, RESOURCE_CONFIG, 0, 0, 0, data.data(), 10);
+             dev.receive(BULK_FRAME_END, RESOURCE_CONFIG, 1, 10, crc);
+         }},
+        {"CRC", BULK_STATUS_CRC,
+         [](device_t &dev, const std::vector<uint8_t> &data, uint32_t crc)
+         {
+             dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, data.size(), 0);
+             dev.receive(BULK_FRAME_DATA, RESOURCE_CONFIG, 0, 0, 0, data.data(), data.size());
+             dev.receive(BULK_FRAME_END, RESOURCE_CONFIG, 1, data.size(), crc ^ 1);
+         }},
+    };
+
+    for (const auto &c : cases)
+    {
+        device_t dev(256);
+        s_written.clear();
+        c.spoil(dev, data, crc);
+
+        bulk_status_t status = BULK_STATUS_OK;
+        while (dev.next(&frame))
+        {
+            if (frame.type == BULK_FRAME_STATUS)
+            {
+                status = (bulk_status_t)frame.value;
+            }
+        }
+        CHECK(status == c.status);
+        CHECK(s_written.empty());
+        if (status != c.status)
+        {
+            fprintf(stderr, "  case %s: status %d\n", c.name, status);
+        }
+
+        // Idle again, the next PUT works
+        CHECK(companion_put(dev, RESOURCE_CONFIG, data, 64) == BULK_STATUS_OK);
+        CHECK(s_written == data);
+    }
+}
+
+/**
+ * @brief An OPEN during a transfer is refused with BUSY, the transfer in progress goes on.
+ */
+static void open_while_busy(void)
+{
+    s_content = pattern(500, 5);
+    device_t dev(64);
+    dev.receive(BULK_FRAME_OPEN_GET, RESOURCE_LOG, 0, 0, 1);
+    bulk_frame_t frame;
+    CHECK(dev.next(&frame) && frame.type == BULK_FRAME_DATA);
+
+    dev.receive(BULK_FRAME_OPEN_PUT, RESOURCE_CONFIG, 0, 10, 0);
+    CHECK(dev.next(&frame) && frame.type == BULK_FRAME_STATUS && frame.value == BULK_STATUS_BUSY);
+    CHECK(frame.resource == RESOURCE_CONFIG);
+
+    dev.receive(BULK_FRAME_CREDIT, RESOURCE_LOG, 0, 0, 1);
+    CHECK(dev.next(&frame) && frame.type == BULK_FRAME_DATA && frame.seq == 1);
+}
+
+/**
+ * @brief An SDU shorter than the header is a protocol error.
+ */
+static void short_sdu_is_a_protocol_error(void)
+{
+    device_t dev(64);
+    uint8_t sdu[BULK_FRAME_HEADER_LEN - 1] = {BULK_FRAME_OPEN_GET};
+    bulk_session_receive(&dev.session, sdu, sizeof(sdu));
+    bulk_frame_t frame;
+    CHECK(dev.next(&frame) && frame.type == BULK_FRAME_STATUS && frame.value == BULK_STATUS_PROTOCOL);
+}
+
+int main(void)
+{
+    RUN_TEST(get_respects_credits);
+    RUN_TEST(put_round_trip);
+    RUN_TEST(refused_sdu_is_sent_again);
+    RUN_TEST(put_errors_end_the_transfer);
+    RUN_TEST(open_while_busy);
+    RUN_TEST(short_sdu_is_a_protocol_error);
+    return host_test_failures;
+}
@@ -0,0 +1,312 @@
+#include <string.h>
+#include <thread>
+
+#include "config_store.h"
+#include "coex_policy.h"
+#include "esp_rom_crc.h"
+#include "metrics.h"
+#include "nvs.h"
+#include "host_test.h"
+
+uint32_t metrics_counters[METRICS_COUNTER_MAX];
+
+#define HEADER_SIZE 14
+#define SEQUENCE_OFFSET 4
+#define LENGTH_OFFSET 8
+#define CRC_OFFSET 10
+#define GPIO_COUNT_OFFSET 21 // In the payload, after the gamepad fields
+
+static void put_le(uint8_t *p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        p[i] = value >> (8 * i);
+    }
+}
+
+/**
+ * @brief Rewrites the header of a record made by config_store_export() and seals it with a valid CRC.
+ */
+static void reseal(uint8_t *record, uint8_t version, uint32_t sequence, size_t payload_len)
+{
+    record[2] = version;
+    put_le(record + SEQUENCE_OFFSET, sequence, 4);
+    put_le(record + LENGTH_OFFSET, payload_len, 2);
+    uint32_t crc = esp_rom_crc32_le(0, record, CRC_OFFSET);
+    crc = esp_rom_crc32_le(crc, record + HEADER_SIZE, payload_len);
+    put_le(record + CRC_OFFSET, crc, 4);
+}
+
+static void write_slot(const char *key, const uint8_t *record, size_t len)
+{
+    FILE *f = fopen(nvs_file_path(CONFIG_STORE_NAMESPACE, key), "wb");
+    fwrite(record, 1, len, f);
+    fclose(f);
+}
+
+/**
+ * @brief Empty NVS and a store that forgot its active slot, as after a fresh boot.
+ */
+static void fresh_store(void)
+{
+    nvs_file_init("nvs_test");
+    config_store_erase();
+}
+
+static void sample_config(app_config_t *cfg)
+{
+    config_store_defaults(cfg);
+    cfg->button_count = 77;
+    cfg->hat_switch_count = 2;
+    cfg->gpio_count = 3;
+    cfg->gpios[0] = 4;
+    cfg->gpios[1] = 5;
+    cfg->gpios[2] = 21;
+    strcpy(cfg->chip_series, "ESP32_S3");
+    cfg->axis[1].adc_channel = 3;
+    cfg->axis[1].flags = CONFIG_STORE_AXIS_FLAG_INVERTED;
+    cfg->coex_policy = COEX_POLICY_SUSPEND;
+}
+
+static void test_defaults_when_empty(void)
+{
+    fresh_store();
+    app_config_t cfg, defaults;
+    config_store_defaults(&defaults);
+    CHECK(config_store_load(&cfg) == ESP_ERR_NOT_FOUND);
+    CHECK(memcmp(&cfg, &defaults, sizeof(cfg)) == 0);
+}
+
+static void test_round_trip(void)
+{
+    fresh_store();
+    app_config_t saved, loaded;
+    sample_config(&saved);
+    CHECK(config_store_save(&saved) == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(memcmp(&saved, &loaded, sizeof(saved)) == 0);
+
+    // Saves alternate slots, the newest one wins
+    saved.button_count = 12;
+    CHECK(config_store_save(&saved) == ESP_OK);
+    saved.button_count = 13;
+    CHECK(config_store_save(&saved) == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 13);
+}
+
+static void test_failed_commit_keeps_previous(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    cfg.button_count = 99;
+    nvs_file_fail_commits(1);
+    CHECK(config_store_save(&cfg) != ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 77);
+}
+
+static void test_failed_load_keeps_slot_state(void)
+{
+    // A load that fails on an NVS error must not forget the newest slot, or the next save overwrites it
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    cfg.button_count = 78;
+    CHECK(config_store_save(&cfg) == ESP_OK);
+
+    nvs_file_fail_opens(1);
+    CHECK(config_store_load(&loaded) == ESP_FAIL);
+    cfg.button_count = 79;
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 79);
+
+    // Same for a slot read that fails
+    nvs_file_fail_reads(1);
+    CHECK(config_store_load(&loaded) == ESP_FAIL);
+    nvs_file_fail_reads(0);
+    cfg.button_count = 80;
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 80);
+}
+
+static void test_corrupt_newest_falls_back(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK); // cfg_a
+    cfg.button_count = 50;
+    CHECK(config_store_save(&cfg) == ESP_OK); // cfg_b, newest
+
+    FILE *f = fopen(nvs_file_path(CONFIG_STORE_NAMESPACE, "cfg_b"), "r+b");
+    fseek(f, HEADER_SIZE + 2, SEEK_SET);
+    fputc(0xEE, f);
+    fclose(f);
+
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 77);
+}
+
+static void test_undecodable_newest_falls_back(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK); // cfg_a, sequence 1
+
+    // A record with a valid CRC and a higher sequence, but values out of range
+    const struct
+    {
+        const char *name;
+        void (*spoil)(app_config_t *);
+    } cases[] = {
+        {"gpio_count", [](app_config_t *c) { c->gpio_count = CONFIG_STORE_MAX_GPIOS + 1; }},
+        {"hat_switch_count", [](app_config_t *c) { c->hat_switch_count = CONFIG_STORE_MAX_HATS + 1; }},
+        {"button_count", [](app_config_t *c) { c->button_count = CONFIG_STORE_MAX_BUTTONS + 1; }},
+        {"coex_policy", [](app_config_t *c) { c->coex_policy = COEX_POLICY_MAX; }},
+        {"controller_type", [](app_config_t *c) { c->controller_type = 0x06; }},
+        {"hid_report_id", [](app_config_t *c) { c->hid_report_id = 0; }},
+        {"simulation_controls", [](app_config_t *c) { c->simulation_controls = 1 << 5; }},
+        {"axes range", [](app_config_t *c) { c->axes_min = c->axes_max; }},
+        {"simulation range", [](app_config_t *c) { c->simulation_min = 100; c->simulation_max = -100; }},
+        {"gpio", [](app_config_t *c) { c->gpios[1] = 49; }},
+        {"chip_series", [](app_config_t *c) { strcpy(c->chip_series, "ESP32\n"); }},
+        {"adc_channel", [](app_config_t *c) { c->axis[2].adc_channel = 10; }},
+        {"axis flags", [](app_config_t *c) { c->axis[2].flags = 0x80; }},
+        {"raw range", [](app_config_t *c) { c->axis[3].raw_max = 4096; }},
+    };
+    for (const auto &spoiled : cases)
+    {
+        app_config_t bad;
+        sample_config(&bad);
+        bad.button_count = 5;
+        spoiled.spoil(&bad);
+        // gpio_count beyond the limit is clamped by the encoder, patch the byte instead
+        uint8_t record[CONFIG_STORE_RECORD_MAX];
+        size_t len = config_store_export(&bad, record, sizeof(record));
+        CHECK(len > HEADER_SIZE);
+        if (&spoiled == &cases[0])
+        {
+            record[HEADER_SIZE + GPIO_COUNT_OFFSET] = CONFIG_STORE_MAX_GPIOS + 1;
+        }
+        reseal(record, CONFIG_STORE_VERSION, 7, len - HEADER_SIZE);
+        write_slot("cfg_b", record, len);
+
+        app_config_t imported = cfg;
+        CHECK(config_store_import(record, len, &imported) == ESP_ERR_INVALID_SIZE);
+        CHECK(memcmp(&imported, &cfg, sizeof(cfg)) == 0);
+
+        CHECK(config_store_load(&loaded) == ESP_OK);
+        CHECK(loaded.button_count == 77);
+        if (loaded.button_count != 77)
+        {
+            fprintf(stderr, "  spoiled %s\n", spoiled.name);
+        }
+    }
+
+    // The next save goes over the bad slot, so it is not picked up again
+    cfg.button_count = 33;
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 33);
+}
+
+static void test_save_rejects_out_of_range(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    cfg.hat_switch_count = CONFIG_STORE_MAX_HATS + 1;
+    CHECK(config_store_save(&cfg) == ESP_ERR_INVALID_ARG);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.hat_switch_count == 2);
+}
+
+static void test_migrates_version_1(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+
+    // Version 1 is the version 2 payload without the trailing coexistence policy
+    uint8_t record[CONFIG_STORE_RECORD_MAX];
+    size_t len = config_store_export(&cfg, record, sizeof(record)) - 1;
+    reseal(record, 1, 3, len - HEADER_SIZE);
+    write_slot("cfg_a", record, len);
+
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(loaded.button_count == 77);
+    CHECK(loaded.gpios[2] == 21);
+    CHECK(loaded.coex_policy == COEX_POLICY_POWER_SAVE);
+}
+
+static void test_erase(void)
+{
+    fresh_store();
+    app_config_t cfg, loaded;
+    sample_config(&cfg);
+    CHECK(config_store_save(&cfg) == ESP_OK);
+    CHECK(config_store_erase() == ESP_OK);
+    CHECK(config_store_load(&loaded) == ESP_ERR_NOT_FOUND);
+}
+
+/**
+ * @brief Two tasks saving at once never write the same slot or sequence number.
+ */
+static void test_concurrent_saves(void)
+{
+    fresh_store();
+    const int saves = 200;
+    auto saver = [](uint16_t button_count)
+    {
+        app_config_t cfg;
+        sample_config(&cfg);
+        cfg.button_count = button_count;
+        for (int i = 0; i < saves; i++)
+        {
+            CHECK(config_store_save(&cfg) == ESP_OK);
+        }
+    };
+    std::thread web(saver, 10);
+    std::thread bulk(saver, 20);
+    web.join();
+    bulk.join();
+
+    // The sequence counted every save
+    app_config_t loaded;
+    uint8_t record[CONFIG_STORE_RECORD_MAX];
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(config_store_export(&loaded, record, sizeof(record)) > HEADER_SIZE);
+    CHECK((record[SEQUENCE_OFFSET] | (record[SEQUENCE_OFFSET + 1] << 8)) == 2 * saves);
+
+    // and the other slot holds the save before
+    FILE *f = fopen(nvs_file_path(CONFIG_STORE_NAMESPACE, "cfg_b"), "r+b");
+    fseek(f, HEADER_SIZE + 2, SEEK_SET);
+    fputc(0xEE, f);
+    fclose(f);
+    CHECK(config_store_load(&loaded) == ESP_OK);
+    CHECK(config_store_export(&loaded, record, sizeof(record)) > HEADER_SIZE);
+    CHECK((record[SEQUENCE_OFFSET] | (record[SEQUENCE_OFFSET + 1] << 8)) == 2 * saves - 1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_defaults_when_empty);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_failed_commit_keeps_previous);
+    RUN_TEST(test_failed_load_keeps_slot_state);
+    RUN_TEST(test_corrupt_newest_falls_back);
+    RUN_TEST(test_undecodable_newest_falls_back);
+    RUN_TEST(test_save_rejects_out_of_range);
+    RUN_TEST(test_migrates_version_1);
+    RUN_TEST(test_erase);
+    RUN_TEST(test_concurrent_saves);
+    return host_test_failures;
+}
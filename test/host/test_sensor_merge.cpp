@@ -0,0 +1,244 @@
+/**
+ * @file test_sensor_merge.cpp
+ * @brief Checks the sensor merger's ordering and release, and measures its latency over a mock transport.
+ *
+ * The mock transport plays the NimBLE host task on one thread, pushing a pedal, a shifter and
+ * a third axis sensor like their notifications would, and the aggregator task on another, woken
+ * like a task notification. Every shifter change must reach the gamepad in order, and the final
+ * pedal position must be the last one pushed.
+ *
+ *   test_sensor_merge [values]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sensor_merge.h"
+#include "host_test.h"
+
+#define PEDAL_AXIS (8 + 3) // BRAKE
+#define OTHER_AXIS (8 + 4) // STEERING
+#define FIRST_GEAR 9
+
+static const sensor_map_t s_maps[3] = {
+    {SENSOR_FORMAT_U16_LE, 0, PEDAL_AXIS, 0, 0, 0, 4095, 0, 32767, 0},
+    {SENSOR_FORMAT_U8, 0, SENSOR_MERGE_BUTTONS, FIRST_GEAR, 8, 0, 0, 0, 0, 0},
+    {SENSOR_FORMAT_I16_LE, 1, OTHER_AXIS, 0, 0, -512, 511, 0, 32767, 0},
+};
+
+/**
+ * @brief What the gamepad saw: every report, the gear states in order and the last pedal value.
+ */
+struct gamepad_t
+{
+    uint32_t reports = 0;
+    std::vector<uint8_t> gears;
+    int16_t pedal = -1;
+    uint8_t buttons[16] = {};
+};
+
+static void emit(const sensor_report_t *report, void *ctx)
+{
+    gamepad_t *pad = (gamepad_t *)ctx;
+    pad->reports++;
+    if (report->axis_mask & (1u << PEDAL_AXIS))
+    {
+        pad->pedal = report->axis[PEDAL_AXIS];
+    }
+    if (report->button_mask[1])
+    {
+        pad->gears.push_back(report->buttons[1]);
+    }
+    memcpy(pad->buttons, report->buttons, sizeof(pad->buttons));
+}
+
+static uint32_t now_us(void)
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void push_pedal(sensor_merge_t *merge, uint16_t raw)
+{
+    uint8_t data[2] = {(uint8_t)raw, (uint8_t)(raw >> 8)};
+    sensor_merge_push(merge, 0, data, sizeof(data), now_us());
+}
+
+static void push_gear(sensor_merge_t *merge, uint8_t gear)
+{
+    sensor_merge_push(merge, 1, &gear, 1, now_us());
+}
+
+/**
+ * @brief A gear engaged, released and engaged again before a drain is reported three times.
+ */
+static void button_edges_are_kept(void)
+{
+    sensor_merge_t merge;
+    gamepad_t pad;
+    CHECK(sensor_merge_init(&merge, s_maps, 3));
+
+    push_gear(&merge, 1);
+    push_gear(&merge, 0);
+    push_gear(&merge, 1);
+    CHECK(sensor_merge_drain(&merge, emit, &pad, now_us()) == 3);
+    CHECK(pad.gears == std::vector<uint8_t>({1, 0, 1}));
+}
+
+/**
+ * @brief Pedal values queued between two drains end up in one report with the latest value.
+ */
+static void axes_are_coalesced(void)
+{
+    sensor_merge_t merge;
+    gamepad_t pad;
+    CHECK(sensor_merge_init(&merge, s_maps, 3));
+
+    push_pedal(&merge, 4095);
+    push_pedal(&merge, 0);
+    push_pedal(&merge, 2048);
+    CHECK(sensor_merge_drain(&merge, emit, &pad, now_us()) == 1);
+    CHECK(pad.pedal == 2048 * 32767 / 4095);
+
+    uint8_t too_short = 0;
+    CHECK(!sensor_merge_push(&merge, 0, &too_short, 1, now_us()));
+}
+
+/**
+ * @brief A disconnected pedal returns to rest and a disconnected shifter releases its gear, even with a full queue.
+ */
+static void release_returns_to_rest(void)
+{
+    sensor_merge_t merge;
+    gamepad_t pad;
+    CHECK(sensor_merge_init(&merge, s_maps, 3));
+
+    push_pedal(&merge, 3000);
+    push_gear(&merge, 1 << 2);
+    sensor_merge_drain(&merge, emit, &pad, now_us());
+    CHECK(pad.pedal > 0);
+    CHECK(pad.buttons[1] == 1 << 2);
+
+    for (int i = 0; i < SENSOR_MERGE_QUEUE_LEN; i++)
+    {
+        push_pedal(&merge, 4000);
+    }
+    CHECK(!sensor_merge_push(&merge, 0, (const uint8_t *)"\0\0", 2, now_us()));
+    sensor_merge_release(&merge, 0);
+    sensor_merge_release(&merge, 1);
+    CHECK(sensor_merge_drain(&merge, emit, &pad, now_us()) == 1);
+    CHECK(pad.pedal == 0);
+    CHECK(pad.buttons[1] == 0);
+
+    // Nothing left to release
+    sensor_merge_release(&merge, 1);
+    CHECK(sensor_merge_drain(&merge, emit, &pad, now_us()) == 0);
+}
+
+/**
+ * @brief Mock transport: a host task thread pushing notifications, an aggregator thread draining them.
+ */
+static void mock_transport(uint32_t values)
+{
+    static sensor_merge_t merge;
+    gamepad_t pad;
+    CHECK(sensor_merge_init(&merge, s_maps, 3));
+
+    // Task notification
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool notified = false;
+    std::atomic<bool> done{false};
+
+    std::thread aggregator([&]
+                           {
+                               for (;;)
+                               {
+                                   std::unique_lock<std::mutex> lock(mutex);
+                                   cv.wait_for(lock, std::chrono::milliseconds(5), [&] { return notified; });
+                                   notified = false;
+                                   lock.unlock();
+                                   bool last = done.load();
+                                   sensor_merge_drain(&merge, emit, &pad, now_us());
+                                   if (last)
+                                   {
+                                       break;
+                                   }
+                               } });
+
+    std::vector<uint8_t> gears_sent;
+    uint16_t pedal = 0;
+    uint32_t full = 0;
+    for (uint32_t i = 0; i < values; i++)
+    {
+        uint8_t data[3] = {};
+        uint8_t sensor = i % 3;
+        if (sensor == 0)
+        {
+            pedal = (i * 7) % 4096;
+            data[0] = pedal;
+            data[1] = pedal >> 8;
+        }
+        else if (sensor == 1)
+        {
+            data[0] = 1 << ((i / 3) % 8);
+            if (gears_sent.empty() || gears_sent.back() != data[0])
+            {
+                gears_sent.push_back(data[0]);
+            }
+        }
+        else
+        {
+            data[1] = i;
+        }
+
+        // A full queue drops the notification, the sensor would send it again
+        while (!sensor_merge_push(&merge, sensor, data, sizeof(data), now_us()))
+        {
+            full++;
+            std::this_thread::yield();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            notified = true;
+        }
+        cv.notify_one();
+
+        // Notifications arrive in connection events, a few at a time
+        if (i % 64 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    done = true;
+    cv.notify_one();
+    aggregator.join();
+
+    sensor_merge_stats_t stats;
+    sensor_merge_get_stats(&merge, &stats);
+    CHECK(pad.gears == gears_sent);
+    CHECK(pad.pedal == (int16_t)((int64_t)pedal * 32767 / 4095));
+    CHECK(stats.values == values);
+    CHECK(stats.dropped == full);
+
+    printf("%u values, %u reports (%.2f values/report), %u retried on a full queue\n", stats.values,
+           stats.reports, (double)stats.values / stats.reports, full);
+    printf("push to report latency: mean %u us, max %u us\n", stats.latency_mean_us, stats.latency_max_us);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(button_edges_are_kept);
+    RUN_TEST(axes_are_coalesced);
+    RUN_TEST(release_returns_to_rest);
+
+    mock_transport(argc > 1 ? strtoul(argv[1], NULL, 10) : 200000);
+    return host_test_failures;
+}
@@ -0,0 +1,282 @@
+/**
+ * @file test_telemetry_frame.cpp
+ * @brief Runs the telemetry encoder against observers of a periodic advertising train.
+ *
+ * Every tick the encoder either replaces the frame on air or leaves it, and the train repeats the
+ * frame on air to every observer. An observer can miss events, or sync to the train late. Whatever
+ * it decodes must be the state the gamepad had when that frame was encoded, and a late or lossy
+ * observer must catch up within a couple of key intervals.
+ *
+ *   test_telemetry_frame
+ */
+
+#include <random>
+#include <string.h>
+
+#include "telemetry_frame.h"
+#include "host_test.h"
+
+#define KEY_INTERVAL 8
+
+static bool state_equal(const telemetry_state_t &a, const telemetry_state_t &b)
+{
+    return memcmp(a.axis, b.axis, sizeof(a.axis)) == 0 && memcmp(a.buttons, b.buttons, sizeof(a.buttons)) == 0 &&
+           a.special == b.special && memcmp(a.hat, b.hat, sizeof(a.hat)) == 0;
+}
+
+/**
+ * @brief A player: axes drift, a few buttons and the hats change now and then, sometimes everything jumps.
+ */
+struct player_t
+{
+    std::mt19937 rng;
+    telemetry_state_t state = {};
+
+    explicit player_t(uint32_t seed) : rng(seed) {}
+
+    const telemetry_state_t &tick(void)
+    {
+        for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+        {
+            if (rng() % 4 == 0)
+            {
+                state.axis[i] = (int16_t)(state.axis[i] + (int)(rng() % 201) - 100);
+            }
+        }
+        if (rng() % 8 == 0)
+        {
+            unsigned b = rng() % (TELEMETRY_BUTTON_BYTES * 8);
+            state.buttons[b / 8] ^= 1 << (b % 8);
+        }
+        if (rng() % 32 == 0)
+        {
+            state.special = rng();
+            state.hat[rng() % TELEMETRY_HAT_COUNT] = rng() % 9;
+        }
+        if (rng() % 500 == 0)
+        {
+            for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+            {
+                state.axis[i] = (int16_t)rng();
+            }
+            for (int i = 0; i < TELEMETRY_BUTTON_BYTES; i++)
+            {
+                state.buttons[i] = rng();
+            }
+        }
+        return state;
+    }
+};
+
+/**
+ * @brief The train: the frame on air and the state it carries, if it is not a repeated base.
+ */
+struct train_t
+{
+    telemetry_encoder_t encoder;
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    size_t len = 0;
+    telemetry_state_t carried = {};
+
+    train_t() { telemetry_encoder_init(&encoder, KEY_INTERVAL); }
+
+    /**
+     * @return True if a new frame replaced the one on air.
+     */
+    bool tick(const telemetry_state_t &state)
+    {
+        uint8_t out[TELEMETRY_FRAME_MAX];
+        size_t n = telemetry_encode(&encoder, &state, out);
+        if (n == 0)
+        {
+            return false;
+        }
+        CHECK(n <= TELEMETRY_FRAME_MAX);
+        memcpy(frame, out, n);
+        len = n;
+        if (encoder.current)
+        {
+            carried = state;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief A key frame with every field set decodes to the same state and is the largest frame.
+ */
+static void full_key_frame_round_trip(void)
+{
+    telemetry_state_t state;
+    for (int i = 0; i < TELEMETRY_AXIS_COUNT; i++)
+    {
+        state.axis[i] = (int16_t)(i % 2 ? -32768 + i : 32767 - i);
+    }
+    memset(state.buttons, 0xff, sizeof(state.buttons));
+    state.special = 0x5a;
+    for (int i = 0; i < TELEMETRY_HAT_COUNT; i++)
+    {
+        state.hat[i] = 8 - i;
+    }
+
+    train_t train;
+    train.tick(state);
+    CHECK(train.len == TELEMETRY_FRAME_MAX);
+
+    telemetry_decoder_t decoder;
+    telemetry_decoder_init(&decoder);
+    CHECK(telemetry_decode(&decoder, train.frame, train.len) == TELEMETRY_DECODE_OK);
+    CHECK(state_equal(decoder.state, state));
+    CHECK(telemetry_decode(&decoder, train.frame, train.len) == TELEMETRY_DECODE_REPEAT);
+}
+
+/**
+ * @brief An observer that receives every event decodes every state, through sequence number wraps.
+ */
+static void every_event_decodes(void)
+{
+    player_t player(1);
+    train_t train;
+    telemetry_decoder_t decoder;
+    telemetry_decoder_init(&decoder);
+    int deltas = 0;
+
+    for (int t = 0; t < 20000; t++)
+    {
+        train.tick(player.tick());
+        telemetry_decode_result_t result = telemetry_decode(&decoder, train.frame, train.len);
+        CHECK(result != TELEMETRY_DECODE_NO_KEY && result != TELEMETRY_DECODE_INVALID);
+        if (result == TELEMETRY_DECODE_OK)
+        {
+            CHECK(state_equal(decoder.state, train.carried));
+        }
+        deltas += (train.frame[0] & TELEMETRY_FLAG_DELTA) != 0;
+    }
+    CHECK(decoder.missed == 0);
+    CHECK(deltas > 10000);
+}
+
+/**
+ * @brief Observers that miss events or sync late only ever decode states the gamepad had, and catch up.
+ */
+static void lossy_and_late_observers(void)
+{
+    const int loss[] = {10, 50, 90};
+    for (int percent : loss)
+    {
+        player_t player(percent);
+        std::mt19937 radio(percent + 1);
+        train_t train;
+        telemetry_decoder_t decoder;
+        telemetry_decoder_init(&decoder);
+        const int late = 1000;
+        int synced = -1; // Ticks from the first event received to the first state decoded
+        int since_ok = 0;
+        int worst = 0;
+
+        for (int t = 0; t < 20000; t++)
+        {
+            train.tick(player.tick());
+            since_ok++;
+            if (t >= late && (int)(radio() % 100) >= percent)
+            {
+                telemetry_decode_result_t result = telemetry_decode(&decoder, train.frame, train.len);
+                CHECK(result != TELEMETRY_DECODE_INVALID);
+                if (result == TELEMETRY_DECODE_OK)
+                {
+                    CHECK(state_equal(decoder.state, train.carried));
+                    synced = synced < 0 ? t - late : synced;
+                }
+                if (state_equal(decoder.state, train.carried))
+                {
+                    since_ok = 0;
+                }
+            }
+            if (synced >= 0)
+            {
+                worst = since_ok > worst ? since_ok : worst;
+            }
+        }
+        CHECK(synced >= 0);
+        // With 10% loss the observer catches up within a couple of key intervals
+        if (percent == 10)
+        {
+            CHECK(synced <= 2 * KEY_INTERVAL);
+            CHECK(worst <= 2 * KEY_INTERVAL);
+        }
+        printf("%d%% loss: synced after %d ticks, %u frames missed, stale for %d ticks at most\n", percent, synced,
+               (unsigned)decoder.missed, worst);
+    }
+}
+
+/**
+ * @brief Every strict prefix of a new frame and an unknown version are invalid, and leave the decoder as it was.
+ */
+static void truncated_frames_are_invalid(void)
+{
+    player_t player(7);
+    train_t train;
+    telemetry_decoder_t decoder;
+    telemetry_decoder_init(&decoder);
+
+    for (int t = 0; t < 2000; t++)
+    {
+        // The sequence number of a frame on air again tells it apart before it is parsed
+        if (!train.tick(player.tick()))
+        {
+            continue;
+        }
+        telemetry_decoder_t before = decoder;
+        for (size_t n = 0; n < train.len; n++)
+        {
+            CHECK(telemetry_decode(&decoder, train.frame, n) == TELEMETRY_DECODE_INVALID);
+        }
+        uint8_t other[TELEMETRY_FRAME_MAX];
+        memcpy(other, train.frame, train.len);
+        other[0] ^= 0x30;
+        CHECK(telemetry_decode(&decoder, other, train.len) == TELEMETRY_DECODE_INVALID);
+        CHECK(memcmp(&decoder, &before, sizeof(decoder)) == 0);
+
+        telemetry_decode(&decoder, train.frame, train.len);
+    }
+}
+
+/**
+ * @brief A state that stays put is sent once, then only the base comes back every key interval.
+ */
+static void idle_state_is_not_resent(void)
+{
+    telemetry_state_t state = {};
+    state.axis[0] = 100;
+    train_t train;
+    int frames = 0;
+    for (int t = 0; t < 10 * KEY_INTERVAL; t++)
+    {
+        uint8_t out[TELEMETRY_FRAME_MAX];
+        frames += telemetry_encode(&train.encoder, &state, out) != 0;
+    }
+    // The first key frame is the base, so nothing is repeated while it is on air
+    CHECK(frames == 1);
+
+    state.axis[0] = 101;
+    train.tick(state);
+    CHECK(train.frame[0] & TELEMETRY_FLAG_DELTA);
+    frames = 0;
+    for (int t = 0; t < 10 * KEY_INTERVAL; t++)
+    {
+        uint8_t out[TELEMETRY_FRAME_MAX];
+        frames += telemetry_encode(&train.encoder, &state, out) != 0;
+    }
+    // Every key interval the base is repeated, then followed by the current state again
+    CHECK(frames == 2 * 10);
+}
+
+int main(void)
+{
+    RUN_TEST(full_key_frame_round_trip);
+    RUN_TEST(every_event_decodes);
+    RUN_TEST(lossy_and_late_observers);
+    RUN_TEST(truncated_frames_are_invalid);
+    RUN_TEST(idle_state_is_not_resent);
+    return host_test_failures;
+}